@@ -0,0 +1,639 @@
+/**
+ * Benchmarks for spectra_core
+ * Times the hot kernels (spline lookups, the pion cross section and
+ * emissivity, secondary electron injection, IC, bremsstrahlung and
+ * synchrotron emissivities, the gamma-gamma opacity), the IC, bremsstrahlung
+ * and synchrotron table generation, the steady-state electron solve at
+ * n_E = 50, 100, 200 and 400, and the whole per-galaxy pipeline, all on a
+ * fixed set of representative galaxies so that runs can be compared across
+ * commits. Results are written as JSON.
+ *
+ * With --precision the pipeline is also run on each galaxy under every
+ * precision profile (precision.h), recording its time and its error
+ * against the reference profile.
+ *
+ * Usage: bench_spectra_core [--datadir DIR] [--out FILE] [--label TEXT] [--min-time SECONDS] [--quick]
+ *                           [--precision]
+ *
+ * The shared IC, bremsstrahlung and synchrotron tables are read from DIR, or
+ * generated there on the first run. Nothing is fetched over the network.
+ */
+
+#include <pybind11/embed.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "spectra_funcs.h"
+#include "CRe_steadystate.h"
+#include "gal_rad.h"
+#include "CR_spectra/inverse_Compton.h"
+#include "CR_spectra/synchrotron.h"
+#include "CR_spectra/bremsstrahlung.h"
+#include "data_objects.h"
+#include "gsl_decs.h"
+#include "math_funcs.h"
+#include "wrappers_handles.h"
+#include "wrappers_pipeline.h"
+#include "emission_kernels.h"
+
+namespace py = pybind11;
+
+// Run parameters declared in spectra_funcs.h, with the defaults of spectra_main.py
+double q_p_inject = 2.2;
+double q_e_inject = 2.2;
+double T_CR_lims__GeV[2] = { 1e-3, 1e8 };
+double E_CRe_lims__GeV[2] = { 1e-3 + 0.511e-3, 1e8 + 0.511e-3 };
+
+// Bremsstrahlung screening functions (Blumenthal & Gould 1970), as in init_do_2D_BS
+double Delta_x[11] = { 0., 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1., 2., 5., 10. };
+double Phi_1H[11] = { 45.79, 45.43, 45.09, 44.11, 42.64, 40.16, 34.97, 29.97, 24.73, 18.09, 13.65 };
+double Phi_2H[11] = { 44.46, 44.38, 44.24, 43.65, 42.49, 40.19, 34.93, 29.78, 24.34, 17.28, 12.41 };
+
+namespace {
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since(bench_clock::time_point t0) {
+    return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+// Results are accumulated here so that the compiler can't drop the timed calls
+volatile double bench_sink = 0.;
+
+struct BenchOptions {
+    std::string datadir = "data/";
+    std::string out;
+    std::string label;
+    double min_time = 0.5;
+    bool quick = false;
+    bool precision = false;
+};
+
+struct BenchResult {
+    std::string name;
+    // What one call is: a kernel evaluation, a table point, a solve, a galaxy
+    std::string unit;
+    size_t calls;
+    double seconds;
+    // Seconds spent in each stage over all repetitions
+    std::vector<std::pair<std::string, double>> stages;
+};
+
+// Repeat batch, which makes calls_per_batch calls, until min_time has passed (at least once)
+BenchResult time_case(const std::string &name, const std::string &unit, size_t calls_per_batch, double min_time,
+                      const std::function<void()> &batch) {
+    BenchResult r = { name, unit, 0, 0., {} };
+    bench_clock::time_point t0 = bench_clock::now();
+    do {
+        batch();
+        r.calls += calls_per_batch;
+        r.seconds = seconds_since(t0);
+    } while (r.seconds < min_time);
+    return r;
+}
+
+// One galaxy under one precision profile, errors relative to the reference profile
+struct PrecisionResult {
+    std::string profile;
+    std::string galaxy;
+    double seconds;
+    double max_rel_err;
+    double median_rel_err;
+    // Spectrum holding the largest error
+    std::string worst_spectrum;
+};
+
+// Representative galaxies: the halo is 10 times thicker and 100 times less dense than the disc,
+// as in spectra_main.py
+struct BenchGalaxy {
+    const char *name;
+    GalaxyParams params;
+};
+
+GalaxyParams make_galaxy(double z, double M_star__Msol, double Re__kpc, double SFR__Msolyrm1, double T_dust__K,
+                         double h__pc, double n_H__cmm3, double B__G) {
+    return GalaxyParams{ z, M_star__Msol, Re__kpc, SFR__Msolyrm1, T_dust__K, h__pc, n_H__cmm3, B__G,
+                         10. * h__pc, 1e-2 * n_H__cmm3, B__G / 3. };
+}
+
+const std::vector<BenchGalaxy> &bench_galaxies() {
+    static const std::vector<BenchGalaxy> galaxies = {
+        { "milky_way", make_galaxy(0., 6e10, 3.5, 1.5, 25., 100., 1., 6e-6) },
+        { "starburst", make_galaxy(0.05, 3e10, 0.5, 30., 45., 50., 150., 1.5e-4) },
+        { "high_z", make_galaxy(2., 1e11, 2., 150., 40., 200., 20., 4e-5) },
+    };
+    return galaxies;
+}
+
+// Fixed stand-ins for the per-galaxy inputs the Python driver computes: a calorimetry fraction rising with the
+// column density, and D_e = 3e28 (E/GeV)^(1/3) cm^2/s
+Spline1D make_f_cal(const GalaxyParams &gal) {
+    const int n = 200;
+    std::vector<double> T(n), f(n);
+    logspace_array(n, T_CR_lims__GeV[0], T_CR_lims__GeV[1], T.data());
+    double f_0 = 1. - exp(-gal.n_H__cmm3 * gal.h__pc / 3000.);
+    for (int i = 0; i < n; i++) f[i] = f_0 / (1. + pow(T[i] / 1e6, 0.3));
+    return Spline1D(gsl_so1D(n, T.data(), f.data()));
+}
+
+Spline1D make_D_e() {
+    const int n = 200;
+    std::vector<double> E(n), D(n);
+    logspace_array(n, E_CRe_lims__GeV[0], E_CRe_lims__GeV[1], E.data());
+    for (int i = 0; i < n; i++) D[i] = 3e28 * cbrt(E[i]);
+    return Spline1D(gsl_so1D(n, E.data(), D.data()));
+}
+
+// Shared tables, as a catalog run would load them
+struct BenchTables {
+    ICTables IC;
+    BSTable BS;
+    SyncTable SY;
+};
+
+// Everything the emission kernels need for one galaxy's disc, built the way the pipeline builds it
+struct GalaxyState {
+    const BenchGalaxy *gal;
+    Spline1D f_cal, D_e;
+    double C_p, C_e;
+    Spline1D Q_1, Q_2;
+    Spline2D IC_Gamma, IC;
+    Spline1D qe_1, qe_2;
+    galaxy_radfield rf;
+};
+
+const PipelineConfig &bench_config() {
+    static const PipelineConfig cfg;
+    return cfg;
+}
+
+// Steady-state solve of the disc on an n_E grid
+void solve_disc(const GalaxyState &s, const BenchTables &tables, int n_E, gsl_spline_object_1D *qe_1,
+                gsl_spline_object_1D *qe_2) {
+    const GalaxyParams &gal = s.gal->params;
+    double E_e_lims[2] = { bench_config().E_CRe_lims__GeV[0], bench_config().E_CRe_lims__GeV[1] };
+    gsl_spline_object_2D IC_Gamma_so = gsl_so2D_shared(s.IC_Gamma.so());
+    if (CRe_steadystate_solve(1, E_e_lims, n_E, gal.n_H__cmm3, gal.B__G, gal.h__pc, 1, &IC_Gamma_so,
+                              gsl_so2D_shared(tables.BS.so()), gsl_so1D_shared(s.D_e.so()),
+                              gsl_so1D_shared(s.Q_1.so()), gsl_so1D_shared(s.Q_2.so()), qe_1, qe_2) != 0) {
+        fprintf(stderr, "CRe_steadystate_solve failed for %s at n_E = %d\n", s.gal->name, n_E);
+        exit(1);
+    }
+}
+
+// Injection spectra, IC kernels and disc steady state of a galaxy. stages, if not NULL, receives the time
+// spent in each step
+GalaxyState prepare_galaxy(const BenchGalaxy &bg, const BenchTables &tables,
+                           std::vector<std::pair<std::string, double>> *stages) {
+    const PipelineConfig &cfg = bench_config();
+    const GalaxyParams &gal = bg.params;
+    GalaxyState s = { &bg, make_f_cal(gal), make_D_e(), 0., 0.,
+                      Spline1D(gsl_spline_object_1D{}), Spline1D(gsl_spline_object_1D{}),
+                      Spline2D(gsl_spline_object_2D{}), Spline2D(gsl_spline_object_2D{}),
+                      Spline1D(gsl_spline_object_1D{}), Spline1D(gsl_spline_object_1D{}), galaxy_radfield() };
+
+    // Injection, normalised as in GalaxySpectraPipeline::run
+    bench_clock::time_point t0 = bench_clock::now();
+    double V__cm3 = 2. * M_PI * pow(gal.Re__kpc * 1e3 * pc__cm, 2) * gal.h__pc * pc__cm;
+    double Edot_CR__GeVsm1 = cfg.f_EtoCR * cfg.E_SN_erg / GeV__erg * cfg.n_SN_Msolm1 * gal.SFR__Msolyrm1 / yr__s;
+    s.C_p = Edot_CR__GeVsm1 / (C_norm_E(q_p_inject, m_p__GeV, cfg.T_p_cutoff__GeV) * V__cm3 * gal.n_H__cmm3 *
+                               cfg.sigma_pp_cm2 * c__cmsm1);
+    s.C_e = cfg.f_CRe_CRp * Edot_CR__GeVsm1 / (C_norm_E(q_e_inject, m_e__GeV, cfg.T_e_cutoff__GeV) * V__cm3);
+
+    int n_inj = cfg.n_E_CRe + 1;
+    std::vector<double> E_e__GeV(n_inj), Q_1(n_inj), Q_2(n_inj);
+    logspace_array(n_inj, cfg.E_CRe_lims__GeV[0], cfg.E_CRe_lims__GeV[1], E_e__GeV.data());
+    gsl_spline_object_1D fcal = gsl_so1D_shared(s.f_cal.so());
+    for (int i = 0; i < n_inj; i++) {
+        double T_e__GeV = E_e__GeV[i] - m_e__GeV;
+        Q_1[i] = J(T_e__GeV, s.C_e, q_e_inject, m_e__GeV, cfg.T_e_cutoff__GeV);
+        Q_2[i] = q_e(T_e__GeV, gal.n_H__cmm3, s.C_p, cfg.T_p_cutoff__GeV, fcal);
+    }
+    s.Q_1 = Spline1D(gsl_so1D(n_inj, E_e__GeV.data(), Q_1.data()));
+    s.Q_2 = Spline1D(gsl_so1D(n_inj, E_e__GeV.data(), Q_2.data()));
+    if (stages) stages->push_back({ "injection", seconds_since(t0) });
+
+    // Radiation field and IC kernels
+    t0 = bench_clock::now();
+    s.rf = galaxy_radfield_init(gal.z, gal.T_dust__K, gal.M_star__Msol, gal.SFR__Msolyrm1, gal.Re__kpc, gal.h__pc);
+    s.IC_Gamma = ICKernel(tables.IC, gal.z, gal.T_dust__K, gal.M_star__Msol, gal.SFR__Msolyrm1, gal.Re__kpc,
+                          gal.h__pc, true).to_spline();
+    s.IC = ICKernel(tables.IC, gal.z, gal.T_dust__K, gal.M_star__Msol, gal.SFR__Msolyrm1, gal.Re__kpc,
+                    gal.h__pc, false).to_spline();
+    if (stages) stages->push_back({ "ic_kernels", seconds_since(t0) });
+
+    // Disc steady state
+    t0 = bench_clock::now();
+    gsl_spline_object_1D qe_1, qe_2;
+    solve_disc(s, tables, cfg.n_E_CRe, &qe_1, &qe_2);
+    s.qe_1 = Spline1D(qe_1);
+    s.qe_2 = Spline1D(qe_2);
+    if (stages) stages->push_back({ "steadystate", seconds_since(t0) });
+
+    return s;
+}
+
+std::vector<double> logspace(int n, double lo, double hi) {
+    std::vector<double> x(n);
+    logspace_array(n, lo, hi, x.data());
+    return x;
+}
+
+// A kernel case: fn evaluated at every energy of E for every galaxy, with the time spent on each galaxy as stages
+BenchResult kernel_case(const std::string &name, const std::vector<GalaxyState> &states, const std::vector<double> &E,
+                        double min_time, const std::function<double(const GalaxyState &, double)> &fn) {
+    std::vector<std::pair<std::string, double>> stages;
+    for (const GalaxyState &s : states) stages.push_back({ s.gal->name, 0. });
+
+    BenchResult r = time_case(name, "call", states.size() * E.size(), min_time, [&]() {
+        double acc = 0.;
+        for (size_t g = 0; g < states.size(); g++) {
+            bench_clock::time_point t0 = bench_clock::now();
+            for (double x : E) acc += fn(states[g], x);
+            stages[g].second += seconds_since(t0);
+        }
+        bench_sink = bench_sink + acc;
+    });
+    r.stages = stages;
+    return r;
+}
+
+/*
+ * Errors of spectra against the reference ones: |s - ref| / |ref| over every spectrum and energy, leaving out
+ * the points where the reference is below 1e-10 of its spectrum's largest value (the tails, where relative
+ * errors say nothing)
+ */
+void precision_errors(const GalaxySpectra &s, const GalaxySpectra &ref, PrecisionResult &r) {
+    std::vector<double> err;
+    r.max_rel_err = 0.;
+    for (int k = 0; k < N_GALAXY_SPECTRA; k++) {
+        double ref_max = 0.;
+        for (size_t j = 0; j < ref.n_E(); j++) ref_max = std::max(ref_max, fabs(ref.row(k)[j]));
+        for (size_t j = 0; j < ref.n_E(); j++) {
+            double x = ref.row(k)[j];
+            if (!(fabs(x) > 1e-10 * ref_max)) continue;
+            double e = fabs(s.row(k)[j] - x) / fabs(x);
+            if (!std::isfinite(e)) e = INFINITY;
+            err.push_back(e);
+            if (e > r.max_rel_err) {
+                r.max_rel_err = e;
+                r.worst_spectrum = galaxy_spectrum_names[k];
+            }
+        }
+    }
+    if (err.empty()) {
+        r.median_rel_err = 0.;
+        return;
+    }
+    std::nth_element(err.begin(), err.begin() + err.size() / 2, err.end());
+    r.median_rel_err = err[err.size() / 2];
+}
+
+// JSON output
+
+std::string json_string(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char) c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+void write_json(FILE *fp, const BenchOptions &opt, const std::vector<BenchResult> &results,
+                const std::vector<PrecisionResult> &precision) {
+    fprintf(fp, "{\n  \"label\": %s,\n  \"quick\": %s,\n  \"min_time_s\": %g,\n", json_string(opt.label).c_str(),
+            opt.quick ? "true" : "false", opt.min_time);
+
+    fprintf(fp, "  \"galaxies\": [\n");
+    const std::vector<BenchGalaxy> &galaxies = bench_galaxies();
+    for (size_t g = 0; g < galaxies.size(); g++) {
+        const GalaxyParams &p = galaxies[g].params;
+        fprintf(fp, "    {\"name\": %s, \"z\": %g, \"M_star__Msol\": %g, \"Re__kpc\": %g, \"SFR__Msolyrm1\": %g, "
+                    "\"T_dust__K\": %g, \"h__pc\": %g, \"n_H__cmm3\": %g, \"B__G\": %g}%s\n",
+                json_string(galaxies[g].name).c_str(), p.z, p.M_star__Msol, p.Re__kpc, p.SFR__Msolyrm1, p.T_dust__K,
+                p.h__pc, p.n_H__cmm3, p.B__G, g + 1 < galaxies.size() ? "," : "");
+    }
+    fprintf(fp, "  ],\n");
+
+    fprintf(fp, "  \"cases\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        fprintf(fp, "    {\"name\": %s, \"unit\": %s, \"calls\": %zu, \"seconds\": %.6g, \"ns_per_call\": %.6g, "
+                    "\"calls_per_s\": %.6g",
+                json_string(r.name).c_str(), json_string(r.unit).c_str(), r.calls, r.seconds,
+                1e9 * r.seconds / r.calls, r.calls / r.seconds);
+        if (!r.stages.empty()) {
+            fprintf(fp, ", \"stages\": {");
+            for (size_t k = 0; k < r.stages.size(); k++) {
+                fprintf(fp, "%s%s: %.6g", k ? ", " : "", json_string(r.stages[k].first).c_str(), r.stages[k].second);
+            }
+            fprintf(fp, "}");
+        }
+        fprintf(fp, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]");
+
+    if (!precision.empty()) {
+        fprintf(fp, ",\n  \"precision\": [\n");
+        for (size_t i = 0; i < precision.size(); i++) {
+            const PrecisionResult &r = precision[i];
+            // JSON has no infinity, an error that isn't finite is written as null
+            char max_err[32] = "null";
+            if (std::isfinite(r.max_rel_err)) snprintf(max_err, sizeof(max_err), "%.6g", r.max_rel_err);
+            fprintf(fp, "    {\"profile\": %s, \"galaxy\": %s, \"seconds\": %.6g, \"max_rel_err\": %s, "
+                        "\"median_rel_err\": %.6g, \"worst_spectrum\": %s}%s\n",
+                    json_string(r.profile).c_str(), json_string(r.galaxy).c_str(), r.seconds, max_err,
+                    r.median_rel_err, json_string(r.worst_spectrum).c_str(), i + 1 < precision.size() ? "," : "");
+        }
+        fprintf(fp, "  ]");
+    }
+    fprintf(fp, "\n}\n");
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--datadir DIR] [--out FILE] [--label TEXT] [--min-time SECONDS] [--quick] "
+                    "[--precision]\n", prog);
+    exit(2);
+}
+
+BenchOptions parse_args(int argc, char **argv) {
+    BenchOptions opt;
+    bool min_time_set = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--datadir" && has_value) {
+            opt.datadir = argv[++i];
+            if (!opt.datadir.empty() && opt.datadir.back() != '/') opt.datadir += '/';
+        } else if (arg == "--out" && has_value) {
+            opt.out = argv[++i];
+        } else if (arg == "--label" && has_value) {
+            opt.label = argv[++i];
+        } else if (arg == "--min-time" && has_value) {
+            opt.min_time = atof(argv[++i]);
+            min_time_set = true;
+        } else if (arg == "--quick") {
+            opt.quick = true;
+        } else if (arg == "--precision") {
+            opt.precision = true;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (opt.quick && !min_time_set) opt.min_time = 0.05;
+    return opt;
+}
+
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt = parse_args(argc, argv);
+    // The handles and the pipeline take NumPy arrays, so they need an interpreter
+    py::scoped_interpreter interpreter;
+    const PipelineConfig &cfg = bench_config();
+    std::vector<BenchResult> results;
+
+    auto report = [&](BenchResult r) {
+        fprintf(stderr, "%-36s %12.1f ns/%s\n", r.name.c_str(), 1e9 * r.seconds / r.calls, r.unit.c_str());
+        results.push_back(std::move(r));
+    };
+
+    // Shared tables, read from (or generated once into) the data directory
+    fprintf(stderr, "Loading tables from %s\n", opt.datadir.c_str());
+    std::array<double, 2> E_gam_lims = {{ 1e-16, 1e8 }};
+    std::array<double, 2> E_e_lims = cfg.E_CRe_lims__GeV;
+    BenchTables tables = {
+        ICTables({{ 100, 100 }}, E_gam_lims, E_e_lims, cfg.E_phot_lims__GeV, 30., 1., 20., 100., 5., opt.datadir),
+        BSTable({{ 100, 100 }}, E_gam_lims, E_e_lims, opt.datadir),
+        SyncTable(500, {{ 1e-6, 1e2 }}, opt.datadir),
+    };
+
+    std::vector<GalaxyState> states;
+    for (const BenchGalaxy &bg : bench_galaxies()) states.push_back(prepare_galaxy(bg, tables, NULL));
+
+    // Spline lookups
+    {
+        std::vector<double> x = logspace(256, tables.SY.x_lim()[0], tables.SY.x_lim()[1]);
+        gsl_spline_object_1D so = gsl_so1D_shared(tables.SY.so());
+        report(time_case("gsl_so1D_eval", "call", x.size(), opt.min_time, [&]() {
+            double acc = 0.;
+            for (double xi : x) acc += gsl_so1D_eval(so, xi);
+            bench_sink = bench_sink + acc;
+        }));
+
+        std::vector<double> E_gam = logspace(16, tables.BS.x_lim()[0], tables.BS.x_lim()[1]);
+        std::vector<double> E_e = logspace(16, tables.BS.y_lim()[0], tables.BS.y_lim()[1]);
+        gsl_spline_object_2D so2 = gsl_so2D_shared(tables.BS.so());
+        report(time_case("gsl_so2D_eval", "call", E_gam.size() * E_e.size(), opt.min_time, [&]() {
+            double acc = 0.;
+            for (double Ee : E_e) {
+                for (double Eg : E_gam) acc += gsl_so2D_eval(so2, Eg, Ee);
+            }
+            bench_sink = bench_sink + acc;
+        }));
+    }
+
+    // Kernels, over the band each one is used in
+    {
+        std::vector<double> T_p = logspace(64, 1., 1e6);
+        report(time_case("dsig_dEg", "call", T_p.size() * 4, opt.min_time, [&]() {
+            double acc = 0.;
+            for (double T : T_p) {
+                for (double frac : { 1e-3, 1e-2, 1e-1, 0.5 }) acc += dsig_dEg(T, frac * T);
+            }
+            bench_sink = bench_sink + acc;
+        }));
+    }
+
+    int n_kernel = opt.quick ? 8 : 32;
+    std::vector<double> E_pi = logspace(n_kernel, 1e-1, 1e7);
+    report(kernel_case("eps_pi", states, E_pi, opt.min_time, [&](const GalaxyState &s, double E) {
+        return eps_pi(E, s.gal->params.n_H__cmm3, s.C_p, cfg.T_p_cutoff__GeV, gsl_so1D_shared(s.f_cal.so()));
+    }));
+    report(kernel_case("fused_eps_pi", states, E_pi, opt.min_time, [&](const GalaxyState &s, double E) {
+        return fused_eps_pi(E, s.gal->params.n_H__cmm3, s.C_p, cfg.T_p_cutoff__GeV, gsl_so1D_shared(s.f_cal.so()));
+    }));
+
+    std::vector<double> T_e = logspace(n_kernel, 1e-3, 1e7);
+    report(kernel_case("q_e", states, T_e, opt.min_time, [&](const GalaxyState &s, double T) {
+        return q_e(T, s.gal->params.n_H__cmm3, s.C_p, cfg.T_p_cutoff__GeV, gsl_so1D_shared(s.f_cal.so()));
+    }));
+    report(kernel_case("fused_q_e", states, T_e, opt.min_time, [&](const GalaxyState &s, double T) {
+        return fused_q_e(T, s.gal->params.n_H__cmm3, s.C_p, cfg.T_p_cutoff__GeV, gsl_so1D_shared(s.f_cal.so()));
+    }));
+
+    std::vector<double> E_IC = logspace(n_kernel, 1e-6, 1e6);
+    report(kernel_case("eps_IC_3", states, E_IC, opt.min_time, [&](const GalaxyState &s, double E) {
+        return eps_IC_3(E, gsl_so2D_shared(s.IC.so()), gsl_so1D_shared(s.qe_1.so()));
+    }));
+
+    std::vector<double> E_BS = logspace(n_kernel, 1e-3, 1e6);
+    report(kernel_case("eps_BS_3", states, E_BS, opt.min_time, [&](const GalaxyState &s, double E) {
+        return eps_BS_3(E, s.gal->params.n_H__cmm3, gsl_so2D_shared(tables.BS.so()), gsl_so1D_shared(s.qe_1.so()));
+    }));
+    report(kernel_case("fused_eps_BS_3", states, E_BS, opt.min_time, [&](const GalaxyState &s, double E) {
+        return fused_eps_BS_3(E, s.gal->params.n_H__cmm3, gsl_so2D_shared(tables.BS.so()),
+                              gsl_so1D_shared(s.qe_1.so()));
+    }));
+
+    std::vector<double> E_SY = logspace(n_kernel, 1e-16, 1e-4);
+    report(kernel_case("eps_SY_4", states, E_SY, opt.min_time, [&](const GalaxyState &s, double E) {
+        return eps_SY_4(E, s.gal->params.B__G, gsl_so1D_shared(tables.SY.so()), gsl_so1D_shared(s.qe_1.so()));
+    }));
+    report(kernel_case("fused_eps_SY_4", states, E_SY, opt.min_time, [&](const GalaxyState &s, double E) {
+        return fused_eps_SY_4(E, s.gal->params.B__G, gsl_so1D_shared(tables.SY.so()), gsl_so1D_shared(s.qe_1.so()));
+    }));
+
+    std::vector<double> E_gg = logspace(n_kernel, 1e-1, 1e7);
+    report(kernel_case("tau_gg_gal_BW", states, E_gg, opt.min_time, [&](const GalaxyState &s, double E) {
+        double E_phot_lims[2] = { cfg.E_phot_lims__GeV[0], cfg.E_phot_lims__GeV[1] };
+        double params[6];
+        memcpy(params, s.rf.params, sizeof(params));
+        return tau_gg_gal_BW(E, dndEphot_total__cmm3GeVm1, params, E_phot_lims, s.gal->params.h__pc);
+    }));
+    report(kernel_case("tau_gg_gal_BW_radfield", states, E_gg, opt.min_time, [&](const GalaxyState &s, double E) {
+        double E_phot_lims[2] = { cfg.E_phot_lims__GeV[0], cfg.E_phot_lims__GeV[1] };
+        return tau_gg_gal_BW_radfield(E, &s.rf, E_phot_lims, s.gal->params.h__pc);
+    }));
+    report(kernel_case("fused_tau_gg_gal_BW_radfield", states, E_gg, opt.min_time, [&](const GalaxyState &s, double E) {
+        double E_phot_lims[2] = { cfg.E_phot_lims__GeV[0], cfg.E_phot_lims__GeV[1] };
+        return fused_tau_gg_gal_BW_radfield(E, &s.rf, E_phot_lims, s.gal->params.h__pc);
+    }));
+
+    // Table generation, per table point, on grids reduced from the production ones
+    {
+        size_t n_SY = opt.quick ? 32 : 128;
+        double x_lims[2] = { 1e-6, 1e2 };
+        report(time_case("init_do_1D_sync", "point", n_SY, opt.min_time, [&]() {
+            data_object_1D do1D = init_do_1D_sync(x_lims, n_SY);
+            data_object_1D_free(do1D);
+        }));
+
+        size_t n_BS[2] = { opt.quick ? 8u : 32u, opt.quick ? 8u : 32u };
+        double E_gam_BS[2] = { 1e-3, 1e6 }, E_e_BS[2] = { E_e_lims[0], E_e_lims[1] };
+        report(time_case("init_do_2D_BS", "point", n_BS[0] * n_BS[1], opt.min_time, [&]() {
+            data_object_2D do2D = init_do_2D_BS(E_gam_BS, E_e_BS, n_BS);
+            data_object_2D_free(do2D);
+        }));
+
+        size_t n_IC[2] = { opt.quick ? 6u : 16u, opt.quick ? 6u : 16u };
+        double E_gam_IC[2] = { 1e-6, 1e6 }, E_e_IC[2] = { E_e_lims[0], E_e_lims[1] };
+        double E_phot_IC[2] = { cfg.E_phot_lims__GeV[0], cfg.E_phot_lims__GeV[1] };
+        double T_BB__K[1] = { 3000. };
+        report(time_case("init_do_2D_IC", "point", n_IC[0] * n_IC[1], opt.min_time, [&]() {
+            data_object_2D do2D = init_do_2D_IC(dndEphot_BB__cmm3GeVm1, T_BB__K, E_gam_IC, E_e_IC, E_phot_IC, n_IC);
+            data_object_2D_free(do2D);
+        }));
+    }
+
+    // Steady-state solve of each galaxy's disc
+    for (int n_E : { 50, 100, 200, 400 }) {
+        std::vector<std::pair<std::string, double>> stages;
+        for (const GalaxyState &s : states) stages.push_back({ s.gal->name, 0. });
+        BenchResult r = time_case("CRe_steadystate_solve/n_E=" + std::to_string(n_E), "solve", states.size(),
+                                  opt.min_time, [&]() {
+            for (size_t g = 0; g < states.size(); g++) {
+                bench_clock::time_point t0 = bench_clock::now();
+                gsl_spline_object_1D qe_1, qe_2;
+                solve_disc(states[g], tables, n_E, &qe_1, &qe_2);
+                gsl_so1D_free(qe_1);
+                gsl_so1D_free(qe_2);
+                stages[g].second += seconds_since(t0);
+            }
+        });
+        r.stages = stages;
+        report(r);
+    }
+
+    // The disc chain a stage at a time, then the whole pipeline (disc and halo) per galaxy
+    {
+        std::vector<std::pair<std::string, double>> stages = { { "injection", 0. }, { "ic_kernels", 0. },
+                                                               { "steadystate", 0. } };
+        BenchResult r = time_case("galaxy_stages", "galaxy", states.size(), opt.min_time, [&]() {
+            for (const BenchGalaxy &bg : bench_galaxies()) {
+                std::vector<std::pair<std::string, double>> t;
+                prepare_galaxy(bg, tables, &t);
+                for (size_t k = 0; k < t.size(); k++) stages[k].second += t[k].second;
+            }
+        });
+        r.stages = stages;
+        report(r);
+
+        std::vector<double> E = logspace(opt.quick ? 50 : 200, 1e-16, 1e8);
+        c_array_d E_gam(E.size(), E.data());
+        Cosmology cosmo = Cosmology::current();
+        GalaxySpectraPipeline pipeline(tables.IC, tables.BS, tables.SY, E_gam, cfg, cosmo);
+        std::vector<std::pair<std::string, double>> per_galaxy;
+        for (const GalaxyState &s : states) per_galaxy.push_back({ s.gal->name, 0. });
+        r = time_case("GalaxySpectraPipeline.run", "galaxy", states.size(), opt.min_time, [&]() {
+            for (size_t g = 0; g < states.size(); g++) {
+                bench_clock::time_point t0 = bench_clock::now();
+                GalaxySpectra spectra = pipeline.run(states[g].gal->params, states[g].f_cal, states[g].D_e,
+                                                     states[g].D_e);
+                bench_sink = bench_sink + spectra.row(SPEC_PI)[0];
+                per_galaxy[g].second += seconds_since(t0);
+            }
+        });
+        r.stages = per_galaxy;
+        report(r);
+    }
+
+    // Each profile against the reference one, a single run per galaxy and profile
+    std::vector<PrecisionResult> precision;
+    if (opt.precision) {
+        std::vector<double> E = logspace(opt.quick ? 50 : 200, 1e-16, 1e8);
+        c_array_d E_gam(E.size(), E.data());
+        Cosmology cosmo = Cosmology::current();
+        for (const GalaxyState &s : states) {
+            PipelineConfig ref_cfg = cfg;
+            ref_cfg.precision = "reference";
+            GalaxySpectraPipeline ref_pipeline(tables.IC, tables.BS, tables.SY, E_gam, ref_cfg, cosmo);
+            bench_clock::time_point t0 = bench_clock::now();
+            GalaxySpectra ref = ref_pipeline.run(s.gal->params, s.f_cal, s.D_e, s.D_e);
+            double ref_seconds = seconds_since(t0);
+
+            for (const char *profile : { "preview", "production", "reference" }) {
+                PrecisionResult r = { profile, s.gal->name, ref_seconds, 0., 0., "" };
+                if (r.profile != "reference") {
+                    PipelineConfig p_cfg = cfg;
+                    p_cfg.precision = profile;
+                    GalaxySpectraPipeline pipeline(tables.IC, tables.BS, tables.SY, E_gam, p_cfg, cosmo);
+                    t0 = bench_clock::now();
+                    GalaxySpectra spectra = pipeline.run(s.gal->params, s.f_cal, s.D_e, s.D_e);
+                    r.seconds = seconds_since(t0);
+                    precision_errors(spectra, ref, r);
+                }
+                fprintf(stderr, "precision %-10s %-10s %10.3f s  max err %.3g (%s)  median err %.3g\n",
+                        r.profile.c_str(), r.galaxy.c_str(), r.seconds, r.max_rel_err, r.worst_spectrum.c_str(),
+                        r.median_rel_err);
+                precision.push_back(r);
+            }
+        }
+    }
+
+    FILE *fp = opt.out.empty() ? stdout : fopen(opt.out.c_str(), "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Can't write %s\n", opt.out.c_str());
+        return 1;
+    }
+    write_json(fp, opt, results, precision);
+    if (fp != stdout) fclose(fp);
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include "../physical_constants.h"
 #include "../gsl_decs.h"
 #include "../gsl_decs.h"
+#include "../instrument.h"
 
 //Differential cross-section for bremsstrahlung emission in mb GeV^-1
 double dsigma_BSdEgamm1__mbGeVm1( double E_gam__GeV, double E_e__GeV, gsl_spline_object_1D Phi_1H_gso1D, gsl_spline_object_1D Phi_2H_gso1D )
@@ -294,7 +295,7 @@ double tau_BS_fulltest__s( double E_e__GeV, double E_e__GeV_lims[2], double n_H_
 
     xmin[0] = log(E_e__GeV_lims[0]);
     xmax[0] = log(E_e__GeV);
-    hcubature_v( 1, F_BS_out, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F_BS_out, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
 
     return E_e__GeV/res;
 
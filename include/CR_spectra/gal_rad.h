@@ -4,6 +4,8 @@
 #include <math.h>
 
 #include "../gsl_decs.h"
+#include "../math_funcs.h"
+#include "../npy_io.h"
 #include "file_io.h"
 
 /**********************************************************************************************************************************/
@@ -233,142 +235,256 @@ double dndEphot_dUVMattis__cmm3GeVm1( double *params, double E_phot__GeV )
 
 // params 0 : double T_CMB__K, 1 : double T_dust__K, 2 : double Mstar__Msol, 3 : double SFR_Msolyrm1, 4 : double re_light_kpc, 5 : double h__pc
 
-
-int Cdils( double *params, double Cdils[5] )
+/*
+ * Radiation field of a single galaxy: CMB, dust FIR, the three Draine blackbodies and the UV Mattis field.
+ * Everything that depends only on the galaxy (the dilution factors, luminosities, kT and the blackbody
+ * normalisation) is evaluated once in galaxy_radfield_init, leaving only the energy dependence per photon energy.
+ */
+typedef struct galaxy_radfields
 {
-    //FIR field from dust
-    Cdils[0] = C_dil( u_rad_modBB__GeVcmm3( params[1] ),  LFIR__Lsol( params[3] ), params[4], params[5] );
+    //T_CMB, T_dust, Mstar, SFR, re, h as in the params arrays above
+    double params[6];
+    //Dilution factors: 3000K, 4000K, 7500K, UV, FIR
+    double Cdil[5];
+    //kT of the CMB, FIR, 3000K, 4000K, 7500K blackbodies
+    double kT__GeV[5];
+    //8 pi/(hc)^3 and the modified BB reference energy
+    double BB_norm__cmm3GeVm3;
+    double E_0__GeV;
+} galaxy_radfield;
+
+galaxy_radfield galaxy_radfield_from_params( double *params )
+{
+    galaxy_radfield rf;
+    unsigned short int i;
+    double T_BB__K[5] = { params[0], params[1], 3000., 4000., 7500. };
+
+    for (i = 0; i < 6; i++)
+    {
+        rf.params[i] = params[i];
+    }
+
     //Draine 3000K
-    Cdils[1] = C_dil( u_rad_BB__GeVcmm3( 3000. ), Lobs_old__Lsol( params[2] ), params[4], params[5] );
+    rf.Cdil[0] = C_dil( u_rad_BB__GeVcmm3( 3000. ), L3000K__Lsol( params[2] ), params[4], params[5] );
     //Draine 4000K
-    Cdils[2] = C_dil( u_rad_BB__GeVcmm3( 4000. ), Lobs_old__Lsol( params[2] ), params[4], params[5] );
+    rf.Cdil[1] = C_dil( u_rad_BB__GeVcmm3( 4000. ),  L4000K__Lsol( params[2] ), params[4], params[5] );
     //Draine 7500K
-    Cdils[3] = C_dil( u_rad_BB__GeVcmm3( 7500. ), L7500K__Lsol( params[3] ), params[4], params[5] );
+    rf.Cdil[2] = C_dil( u_rad_BB__GeVcmm3( 7500. ), L7500K__Lsol( params[3] ), params[4], params[5] );
     //Draine UV Mattis field
-    Cdils[4] = C_dil( u_rad_UVMattis__GeVcmm3(), LUV__Lsol( params[3] ), params[4], params[5] );
+    rf.Cdil[3] = C_dil( u_rad_UVMattis__GeVcmm3(), LUV__Lsol( params[3] ), params[4], params[5] );
+    //FIR field from dust
+    rf.Cdil[4] = C_dil( u_rad_modBB__GeVcmm3( params[1] ),  LFIR__Lsol( params[3] ), params[4], params[5] );
+
+    for (i = 0; i < 5; i++)
+    {
+        rf.kT__GeV[i] = k_B__GeVKm1 * T_BB__K[i];
+    }
+    rf.BB_norm__cmm3GeVm3 = 8.*M_PI/pow(h__GeVs * c__cmsm1, 3);
+    rf.E_0__GeV = 2e12 * h__GeVs;
 
-    return 0;
+    return rf;
 }
 
-double dndEphot_total__cmm3GeVm1( double *params, double E_phot__GeV )
+galaxy_radfield galaxy_radfield_init( double z, double T_dust__K, double M_star__Msol, double SFR__Msolyrm1, double Re__kpc, double h__pc )
 {
-    double Cdil_3000, Cdil_4000, Cdil_7500, Cdil_UV, Cdil_FIR;
-    double nphot_params[1];
-    double dndEphot_total__cmm3GeVm1 = 0.;
+    double params[6] = { T_0_CMB__K * (1.+z), T_dust__K, M_star__Msol, SFR__Msolyrm1, Re__kpc, h__pc };
+    return galaxy_radfield_from_params( params );
+}
 
-    //FIR field from dust
-    Cdil_FIR = C_dil( u_rad_modBB__GeVcmm3( params[1] ),  LFIR__Lsol( params[3] ), params[4], params[5] );
-    //Draine 3000K
-//    Cdil_3000 = C_dil( u_rad_BB__GeVcmm3( 3000. ), Lobs_old__Lsol( params[2] ), params[4], params[5] );
-    Cdil_3000 = C_dil( u_rad_BB__GeVcmm3( 3000. ), L3000K__Lsol( params[2] ), params[4], params[5] );
-    //Draine 4000K
-//    Cdil_4000 = C_dil( u_rad_BB__GeVcmm3( 4000. ), Lobs_old__Lsol( params[2] ), params[4], params[5] );
-    Cdil_4000 = C_dil( u_rad_BB__GeVcmm3( 4000. ),  L4000K__Lsol( params[2] ), params[4], params[5] );
-    //Draine 7500K
-    Cdil_7500 = C_dil( u_rad_BB__GeVcmm3( 7500. ), L7500K__Lsol( params[3] ), params[4], params[5] );
-    //Draine UV Mattis field
-    Cdil_UV = C_dil( u_rad_UVMattis__GeVcmm3(), LUV__Lsol( params[3] ), params[4], params[5] );
+//Photon energies evaluated together by galaxy_radfield_eval, sized for its stack buffers
+#define GALAXY_RADFIELD_BLOCK 256
 
-    dndEphot_total__cmm3GeVm1 = dndE_BB__cmm3GeVm1( params[0], E_phot__GeV ) + Cdil_FIR * dndE_modBB__cmm3GeVm1( params[1], E_phot__GeV ) +
-    Cdil_3000 * dndE_BB__cmm3GeVm1( 3000., E_phot__GeV ) + Cdil_4000 * dndE_BB__cmm3GeVm1( 4000., E_phot__GeV ) +
-    Cdil_7500 * dndE_BB__cmm3GeVm1( 7500., E_phot__GeV ) + Cdil_UV * dndEphot_UVMattis__cmm3GeVm1( nphot_params, E_phot__GeV );
+/*
+ * Diluted component k (0 CMB, 1 FIR, 2 3000K, 3 4000K, 4 7500K, 5 UV) of the photon number density at n_E photon
+ * energies, given the shared blackbody prefactor BB_E2[j] = 8 pi/(hc)^3 E_j^2. The component is chosen once and its
+ * loop runs over all the energies
+ */
+void galaxy_radfield_comp_n( const galaxy_radfield *rf, unsigned short int k, size_t n_E, const double *E_phot__GeV,
+                             const double *BB_E2, double *out )
+{
+    size_t j;
+    double C, kT;
 
-    return dndEphot_total__cmm3GeVm1;
+    switch (k)
+    {
+        case 0:
+            kT = rf->kT__GeV[0];
+            for (j = 0; j < n_E; j++)
+            {
+                out[j] = BB_E2[j]/( exp( E_phot__GeV[j]/kT ) - 1. );
+            }
+            break;
+        case 1:
+            C = rf->Cdil[4]/rf->E_0__GeV;
+            kT = rf->kT__GeV[1];
+            for (j = 0; j < n_E; j++)
+            {
+                out[j] = C * BB_E2[j]/( exp( E_phot__GeV[j]/kT ) - 1. ) * E_phot__GeV[j];
+            }
+            break;
+        case 2:
+        case 3:
+        case 4:
+            C = rf->Cdil[k-2];
+            kT = rf->kT__GeV[k];
+            for (j = 0; j < n_E; j++)
+            {
+                out[j] = C * BB_E2[j]/( exp( E_phot__GeV[j]/kT ) - 1. );
+            }
+            break;
+        case 5:
+            C = rf->Cdil[3];
+            for (j = 0; j < n_E; j++)
+            {
+                out[j] = C * dndEphot_UVMattis__cmm3GeVm1( NULL, E_phot__GeV[j] );
+            }
+            break;
+        default:
+            for (j = 0; j < n_E; j++)
+            {
+                out[j] = 0.;
+            }
+    }
 }
 
+//Diluted component k of the photon number density at a single photon energy
+double galaxy_radfield_comp__cmm3GeVm1( const galaxy_radfield *rf, unsigned short int k, double E_phot__GeV )
+{
+    double BB_E2 = rf->BB_norm__cmm3GeVm3 * E_phot__GeV * E_phot__GeV;
+    double out;
+    galaxy_radfield_comp_n( rf, k, 1, &E_phot__GeV, &BB_E2, &out );
+    return out;
+}
 
-double dndEphot_CMB__cmm3GeVm1( double *params, double E_phot__GeV )
+/*
+ * Photon number density for n_E photon energies. comp, if not NULL, receives the six diluted components
+ * row by row (comp[k*n_E+j]: CMB, FIR, 3000K, 4000K, 7500K, UV) and total, if not NULL, their sum.
+ * The energies are taken in blocks: the blackbody prefactor is evaluated once per energy, then each
+ * component runs over the whole block
+ */
+void galaxy_radfield_eval( const galaxy_radfield *rf, size_t n_E, const double *E_phot__GeV, double *comp, double *total )
 {
-    double nphot_params[1];
-    double dndEphot_total__cmm3GeVm1 = 0.;
+    double BB_E2[GALAXY_RADFIELD_BLOCK], c[GALAXY_RADFIELD_BLOCK];
+    double *row;
+    size_t j0, j, n;
+    unsigned short int k;
 
-    nphot_params[0] = params[0];
-    dndEphot_total__cmm3GeVm1 += dndEphot_BB__cmm3GeVm1( nphot_params, E_phot__GeV );
-    return dndEphot_total__cmm3GeVm1;
+    for (j0 = 0; j0 < n_E; j0 += GALAXY_RADFIELD_BLOCK)
+    {
+        n = n_E - j0 < GALAXY_RADFIELD_BLOCK ? n_E - j0 : GALAXY_RADFIELD_BLOCK;
+        for (j = 0; j < n; j++)
+        {
+            BB_E2[j] = rf->BB_norm__cmm3GeVm3 * E_phot__GeV[j0+j] * E_phot__GeV[j0+j];
+        }
+
+        for (k = 0; k < 6; k++)
+        {
+            row = comp != NULL ? comp + k * n_E + j0 : c;
+            galaxy_radfield_comp_n( rf, k, n, E_phot__GeV + j0, BB_E2, row );
+            if (total != NULL)
+            {
+                for (j = 0; j < n; j++)
+                {
+                    total[j0+j] = k == 0 ? row[j] : total[j0+j] + row[j];
+                }
+            }
+        }
+    }
 }
 
-double dndEphot_FIR__cmm3GeVm1( double *params, double E_phot__GeV )
+double galaxy_radfield_dndE__cmm3GeVm1( const galaxy_radfield *rf, double E_phot__GeV )
 {
-    double Cdil_FIR;
-    double nphot_params[1];
-    double dndEphot_total__cmm3GeVm1 = 0.;
+    double total;
+    galaxy_radfield_eval( rf, 1, &E_phot__GeV, NULL, &total );
+    return total;
+}
 
-    //FIR field from dust
-    Cdil_FIR = C_dil( u_rad_modBB__GeVcmm3( params[1] ),  LFIR__Lsol( params[3] ), params[4], params[5] );
-    nphot_params[0] = params[1];
-    dndEphot_total__cmm3GeVm1 += Cdil_FIR * dndEphot_modBB__cmm3GeVm1( nphot_params, E_phot__GeV );
-    return dndEphot_total__cmm3GeVm1;
+/*
+ * The params-based photon fields below keep the double (*)(double *, double) signature of the integrators, with
+ * params as for galaxy_radfield_from_params. Each call sets up the galaxy's field from params, so callers that
+ * evaluate many energies of one galaxy should build a galaxy_radfield once and use galaxy_radfield_eval.
+ */
+double dndEphot_total__cmm3GeVm1( double *params, double E_phot__GeV )
+{
+    galaxy_radfield rf = galaxy_radfield_from_params( params );
+    return galaxy_radfield_dndE__cmm3GeVm1( &rf, E_phot__GeV );
 }
 
-double dndEphot_3000__cmm3GeVm1( double *params, double E_phot__GeV )
+double dndEphot_CMB__cmm3GeVm1( double *params, double E_phot__GeV )
 {
-    double Cdil_3000;
-    double nphot_params[1];
-    double dndEphot_total__cmm3GeVm1 = 0.;
+    galaxy_radfield rf = galaxy_radfield_from_params( params );
+    return galaxy_radfield_comp__cmm3GeVm1( &rf, 0, E_phot__GeV );
+}
 
-    //Draine 3000K
-    Cdil_3000 = C_dil( u_rad_BB__GeVcmm3( 3000. ), Lobs_old__Lsol( params[2] ), params[4], params[5] );
-    nphot_params[0] = 3000.;
-    dndEphot_total__cmm3GeVm1 += Cdil_3000 * dndEphot_BB__cmm3GeVm1( nphot_params, E_phot__GeV );
-    return dndEphot_total__cmm3GeVm1;
+double dndEphot_FIR__cmm3GeVm1( double *params, double E_phot__GeV )
+{
+    galaxy_radfield rf = galaxy_radfield_from_params( params );
+    return galaxy_radfield_comp__cmm3GeVm1( &rf, 1, E_phot__GeV );
 }
 
-double dndEphot_4000__cmm3GeVm1( double *params, double E_phot__GeV )
+double dndEphot_3000__cmm3GeVm1( double *params, double E_phot__GeV )
 {
-    double Cdil_4000;
-    double nphot_params[1];
-    double dndEphot_total__cmm3GeVm1 = 0.;
+    galaxy_radfield rf = galaxy_radfield_from_params( params );
+    return galaxy_radfield_comp__cmm3GeVm1( &rf, 2, E_phot__GeV );
+}
 
-    //Draine 4000K
-    Cdil_4000 = C_dil( u_rad_BB__GeVcmm3( 4000. ), Lobs_old__Lsol( params[2] ), params[4], params[5] );
-    nphot_params[0] = 4000.;
-    dndEphot_total__cmm3GeVm1 += Cdil_4000 * dndEphot_BB__cmm3GeVm1( nphot_params, E_phot__GeV );
-    return dndEphot_total__cmm3GeVm1;
+double dndEphot_4000__cmm3GeVm1( double *params, double E_phot__GeV )
+{
+    galaxy_radfield rf = galaxy_radfield_from_params( params );
+    return galaxy_radfield_comp__cmm3GeVm1( &rf, 3, E_phot__GeV );
 }
 
 double dndEphot_7500__cmm3GeVm1( double *params, double E_phot__GeV )
 {
-    double Cdil_7500;
-    double nphot_params[1];
-    double dndEphot_total__cmm3GeVm1 = 0.;
-
-    //Draine 7500K
-    Cdil_7500 = C_dil( u_rad_BB__GeVcmm3( 7500. ), L7500K__Lsol( params[3] ), params[4], params[5] );
-    nphot_params[0] = 7500.;
-    dndEphot_total__cmm3GeVm1 += Cdil_7500 * dndEphot_BB__cmm3GeVm1( nphot_params, E_phot__GeV );
-    return dndEphot_total__cmm3GeVm1;
+    galaxy_radfield rf = galaxy_radfield_from_params( params );
+    return galaxy_radfield_comp__cmm3GeVm1( &rf, 4, E_phot__GeV );
 }
 
 double dndEphot_UV__cmm3GeVm1( double *params, double E_phot__GeV )
 {
-    double Cdil_UV;
-    double nphot_params[1];
-    double dndEphot_total__cmm3GeVm1 = 0.;
-
-    //Draine UV Mattis field
-    Cdil_UV = C_dil( u_rad_UVMattis__GeVcmm3(), LUV__Lsol( params[3] ), params[4], params[5] );
-    //nphot_params is only a dummy here
-    dndEphot_total__cmm3GeVm1 += Cdil_UV * dndEphot_UVMattis__cmm3GeVm1( nphot_params, E_phot__GeV );
-    return dndEphot_total__cmm3GeVm1;
+    galaxy_radfield rf = galaxy_radfield_from_params( params );
+    return galaxy_radfield_comp__cmm3GeVm1( &rf, 5, E_phot__GeV );
 }
 
 
-void write_radspecs( unsigned long int n_gal, double *z, double *T_dust__K, double *M_star__Msol, double *SFR__Msolyrm1, double *Re__kpc, double *h__pc, char *outfp )
+/*
+ * Radiation field spectra of n_gal galaxies on n_E photon energies, out has shape (n_gal, 7, n_E) with rows
+ * CMB, FIR, 3000K, 4000K, 7500K, UV, total. Galaxies are independent and are filled in parallel.
+ */
+void radspecs_fill( unsigned long int n_gal, double *z, double *T_dust__K, double *M_star__Msol, double *SFR__Msolyrm1, double *Re__kpc, double *h__pc, 
+                    unsigned int n_E, double *E__GeV, double *out )
 {
-    unsigned long int i;
-
-    double nphot_params[6];
-    double Cdil_3000, Cdil_4000, Cdil_7500, Cdil_UV, Cdil_FIR;
+    long int i;
 
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < (long int) n_gal; i++)
+    {
+        galaxy_radfield rf = galaxy_radfield_init( z[i], T_dust__K[i], M_star__Msol[i], SFR__Msolyrm1[i], Re__kpc[i], h__pc[i] );
+        galaxy_radfield_eval( &rf, n_E, E__GeV, out + (size_t) i * 7 * n_E, out + ((size_t) i * 7 + 6) * n_E );
+    }
+}
 
+//Galaxies per block in the file writers, bounding memory to RADSPECS_CHUNK * 7 * n_E doubles
+#define RADSPECS_CHUNK 1024
+#define RADSPECS_N_E 1000
 
-    unsigned int j;
-    unsigned int n_E = 1000;
+void write_radspecs( unsigned long int n_gal, double *z, double *T_dust__K, double *M_star__Msol, double *SFR__Msolyrm1, double *Re__kpc, double *h__pc, char *outfp )
+{
+    unsigned long int i, i0, n_chunk;
+    unsigned int j, k;
+    unsigned int n_E = RADSPECS_N_E;
     double E__GeV[n_E];
 
     logspace_array( n_E, 1.e-13, 2.e-8, E__GeV );
 
-    FILE *rad_specs = fopen( string_cat(outfp, "/rad_specs.txt"), "w+" );
+    char *filepath = string_cat(outfp, "/rad_specs.txt");
+    FILE *rad_specs = fopen( filepath, "w+" );
+    if (rad_specs == NULL)
+    {
+        printf("Error writing file %s: can't open output file\n", filepath);
+        free( filepath );
+        return;
+    }
 
     fprintf( rad_specs, "dnde_rad_CMB__cmm3GeVm1 dnde_rad_FIR__cmm3GeVm1 dnde_rad_3000__cmm3GeVm1 dnde_rad_4000__cmm3GeVm1 dnde_rad_7500__cmm3GeVm1 dnde_rad_UV__cmm3GeVm1 dnde_total__cmm3GeVm1\n" );
 
@@ -378,72 +494,83 @@ void write_radspecs( unsigned long int n_gal, double *z, double *T_dust__K, doub
     }
     fprintf( rad_specs, "\n" );
 
+    double *data = malloc( sizeof(double) * RADSPECS_CHUNK * 7 * n_E );
 
-    for (i = 0; i < n_gal; i++)
+    for (i0 = 0; i0 < n_gal; i0 += RADSPECS_CHUNK)
     {
+        n_chunk = (n_gal - i0 < RADSPECS_CHUNK) ? n_gal - i0 : RADSPECS_CHUNK;
+        radspecs_fill( n_chunk, z + i0, T_dust__K + i0, M_star__Msol + i0, SFR__Msolyrm1 + i0, Re__kpc + i0, h__pc + i0, n_E, E__GeV, data );
 
-        nphot_params[0] = T_0_CMB__K * (1.+z[i]);
-        nphot_params[1] = T_dust__K[i];
-        nphot_params[2] = M_star__Msol[i];
-        nphot_params[3] = SFR__Msolyrm1[i];
-        nphot_params[4] = Re__kpc[i];
-        nphot_params[5] = h__pc[i];
-
-        //FIR field from dust
-        Cdil_FIR = C_dil( u_rad_modBB__GeVcmm3( nphot_params[1] ),  LFIR__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-        //Draine 3000K
-        Cdil_3000 = C_dil( u_rad_BB__GeVcmm3( 3000. ), L3000K__Lsol( nphot_params[2] ), nphot_params[4], nphot_params[5] );
-        //Draine 4000K
-        Cdil_4000 = C_dil( u_rad_BB__GeVcmm3( 4000. ), L4000K__Lsol( nphot_params[2] ), nphot_params[4], nphot_params[5] );
-        //Draine 7500K
-        Cdil_7500 = C_dil( u_rad_BB__GeVcmm3( 7500. ), L7500K__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-        //Draine UV Mattis field
-        Cdil_UV = C_dil( u_rad_UVMattis__GeVcmm3(), LUV__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-
-
-        for (j = 0; j < n_E; j++)
-        {
-            fprintf( rad_specs, "%e ", dndE_BB__cmm3GeVm1( nphot_params[0], E__GeV[j] ) );
-        }
-        fprintf( rad_specs, "\n" );
-        for (j = 0; j < n_E; j++)
-        {
-            fprintf( rad_specs, "%e ", Cdil_FIR * dndE_modBB__cmm3GeVm1( nphot_params[1], E__GeV[j] ) );
-        }
-        fprintf( rad_specs, "\n" );
-        for (j = 0; j < n_E; j++)
-        {
-            fprintf( rad_specs, "%e ", Cdil_3000 * dndE_BB__cmm3GeVm1( 3000., E__GeV[j] ) );
-        }
-        fprintf( rad_specs, "\n" );
-        for (j = 0; j < n_E; j++)
-        {
-            fprintf( rad_specs, "%e ", Cdil_4000 * dndE_BB__cmm3GeVm1( 4000., E__GeV[j] ) );
-        }
-        fprintf( rad_specs, "\n" );
-        for (j = 0; j < n_E; j++)
-        {
-            fprintf( rad_specs, "%e ", Cdil_7500 * dndE_BB__cmm3GeVm1( 7500., E__GeV[j] ) );
-        }
-        fprintf( rad_specs, "\n" );
-        for (j = 0; j < n_E; j++)
+        for (i = 0; i < n_chunk; i++)
         {
-            fprintf( rad_specs, "%e ", Cdil_UV * dndEphot_UVMattis__cmm3GeVm1( nphot_params, E__GeV[j] ) );
+            for (k = 0; k < 7; k++)
+            {
+                for (j = 0; j < n_E; j++)
+                {
+                    fprintf( rad_specs, "%e ", data[(i * 7 + k) * n_E + j] );
+                }
+                fprintf( rad_specs, "\n" );
+            }
         }
-        fprintf( rad_specs, "\n" );
-        for (j = 0; j < n_E; j++)
-        {
-            fprintf( rad_specs, "%e ", dndEphot_total__cmm3GeVm1( nphot_params, E__GeV[j] ) );
-        }
-        fprintf( rad_specs, "\n" );
-
     }
+
+    free( data );
     fclose(rad_specs);
+    free( filepath );
 
     return;
 
 }
 
+/*
+ * Binary version of write_radspecs: rad_specs_E.npy holds the n_E photon energies and rad_specs.npy the
+ * (n_gal, 7, n_E) spectra, streamed out in blocks of RADSPECS_CHUNK galaxies
+ */
+int write_radspecs_npy( unsigned long int n_gal, double *z, double *T_dust__K, double *M_star__Msol, double *SFR__Msolyrm1, double *Re__kpc, double *h__pc, char *outfp )
+{
+    unsigned long int i0, n_chunk;
+    unsigned int n_E = RADSPECS_N_E;
+    double E__GeV[n_E];
+    size_t shape_E[1] = { n_E };
+    size_t shape[3] = { n_gal, 7, n_E };
+    int err;
+
+    logspace_array( n_E, 1.e-13, 2.e-8, E__GeV );
+
+    char *filepath = string_cat(outfp, "/rad_specs_E.npy");
+    err = npy_write_double( filepath, 1, shape_E, E__GeV );
+    free( filepath );
+    if (err){ return 1; }
+
+    filepath = string_cat(outfp, "/rad_specs.npy");
+    FILE *rad_specs = fopen( filepath, "wb" );
+    if (rad_specs == NULL)
+    {
+        printf("Error writing file %s: can't open output file\n", filepath);
+        free( filepath );
+        return 1;
+    }
+
+    err = npy_write_header( rad_specs, "<f8", 3, shape );
+
+    double *data = malloc( sizeof(double) * RADSPECS_CHUNK * 7 * n_E );
+
+    for (i0 = 0; i0 < n_gal && err == 0; i0 += RADSPECS_CHUNK)
+    {
+        n_chunk = (n_gal - i0 < RADSPECS_CHUNK) ? n_gal - i0 : RADSPECS_CHUNK;
+        radspecs_fill( n_chunk, z + i0, T_dust__K + i0, M_star__Msol + i0, SFR__Msolyrm1 + i0, Re__kpc + i0, h__pc + i0, n_E, E__GeV, data );
+        if (fwrite( data, sizeof(double), n_chunk * 7 * n_E, rad_specs ) != n_chunk * 7 * n_E){ err = 1; }
+    }
+
+    free( data );
+    if (fclose( rad_specs ) != 0){ err = 1; }
+    if (err){ printf("Error writing file %s: incomplete output\n", filepath); }
+    else { printf("Successfully written file %s\n", filepath); }
+    free( filepath );
+
+    return err;
+}
+
 
 
 
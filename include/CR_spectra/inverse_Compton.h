@@ -23,6 +23,7 @@
 #include <math.h>
 #include <string.h>
 #include <cubature.h>
+#include "../instrument.h"
 #include <gsl_spline2d.h>
 
 #include "../math_funcs.h"
@@ -87,21 +88,21 @@ void test_IC_interp_obj( double E_e__GeV_lims[2],
     xmax2D[0] = log(fdata.gso_2D_so.x_lim[1]);
     xmin2D[1] = log(fdata.gso_2D_so.y_lim[0]);
     xmax2D[1] = log(fdata.gso_2D_so.y_lim[1]);
-    hcubature_v( 1, int_F_IC, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_Gamma, &abserr );
+    HCUBATURE_V( 1, int_F_IC, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_Gamma, &abserr );
 
     fdata.gso_2D_so = gso_2D_so_IC_spec_low;
     xmin2D[0] = log(fdata.gso_2D_so.x_lim[0]);
     xmax2D[0] = log(fdata.gso_2D_so.x_lim[1]);
     xmin2D[1] = log(fdata.gso_2D_so.y_lim[0]);
     xmax2D[1] = log(fdata.gso_2D_so.y_lim[1]);
-    hcubature_v( 1, int_F_IC, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_spec_low, &abserr );
+    HCUBATURE_V( 1, int_F_IC, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_spec_low, &abserr );
 
     fdata.gso_2D_so = gso_2D_so_IC_spec_high;
     xmin2D[0] = log(fdata.gso_2D_so.x_lim[0]);
     xmax2D[0] = log(fdata.gso_2D_so.x_lim[1]);
     xmin2D[1] = log(fdata.gso_2D_so.y_lim[0]);
     xmax2D[1] = log(fdata.gso_2D_so.y_lim[1]);
-    hcubature_v( 1, int_F_IC, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_spec_high, &abserr );
+    HCUBATURE_V( 1, int_F_IC, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_spec_high, &abserr );
 
     printf("Gamma: %e Spec_sum: %e (low: %e high: %e)\n", res_Gamma, res_spec_low + res_spec_high, res_spec_low, res_spec_high);
 
@@ -247,7 +248,7 @@ gsl_spline_object_2D init_gso_2D_IC_new( double (*n_phot)(double *, double), dou
                 fdata.n_phot_params = n_phot_params;
 
                 //call integrator
-                hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+                HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 
                 if (res >= 0.)
                 {
@@ -342,7 +343,7 @@ gsl_spline_object_2D init_gso_2D_IC( double (*n_phot)(double *, double), double
                 gamma_e = fdata.E_e__GeV/m_e__GeV;
 
                 //call integrator
-                hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+                HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 
                 if (res >= 0.)
                 {
@@ -443,7 +444,7 @@ gsl_spline_object_2D init_gso_2D_IC_Gamma( double (*n_phot)(double *, double), d
                 gamma_e = fdata.E_e__GeV/m_e__GeV;
 
                 //call integrator
-                hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+                HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 
                 if (res >= 0.)
                 {
@@ -531,7 +532,7 @@ data_object_2D init_do_2D_IC( double (*n_phot)(double *, double), double *n_phot
                 gamma_e = fdata.E_e__GeV/m_e__GeV;
 //printf("%i %i\n", i,j);
                 //call integrator
-                hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+                HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 
                 if (res >= 0.)
                 {
@@ -625,7 +626,7 @@ data_object_2D init_do_2D_IC_Gamma( double (*n_phot)(double *, double), double *
                 gamma_e = fdata.E_e__GeV/m_e__GeV;
 
                 //call integrator
-                hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+                HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 
                 if (res >= 0.)
                 {
@@ -731,7 +732,7 @@ gsl_spline_object_2D init_gso_2D_IC_Gamma_new( double (*n_phot)(double *, double
                 fdata.E_f__GeV = E_f__GeV_array[i];
 
                 //call integrator
-                hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+                HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 
                 if (res >= 0.)
                 {
@@ -837,7 +838,7 @@ gsl_spline_object_2D init_gso_2D_IC_Gamma_old( double (*n_phot)(double *, double
                 fdata.n_phot_params = n_phot_params;
 
                 //call integrator
-                hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+                HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 //printf("%e\n", res);
                 if (res >= 0.)
                 {
@@ -947,7 +948,7 @@ double tau_IC_fulltest__s( double E_e__GeV, double E_e__GeV_lims[2], gsl_spline_
 
     xmin[0] = log(E_e__GeV_lims[0]);
     xmax[0] = log(E_e__GeV);
-    hcubature_v( 1, F_IC_out, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F_IC_out, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 
     return E_e__GeV/res;
 
@@ -989,12 +990,12 @@ double tau_IC_gamspec__s( double E_e__GeV, double E_e__GeV_lims[2], gsl_spline_o
     fdata.gso_2D_so = gso_2D_so_high;
     xmin[0] = log(gso_2D_so_high.x_lim[0]);
     xmax[0] = log(gso_2D_so_high.x_lim[1]);
-    hcubature_v( 1, F_IC_out, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_high, &abserr );
+    HCUBATURE_V( 1, F_IC_out, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_high, &abserr );
 
     fdata.gso_2D_so = gso_2D_so_low;
     xmin[0] = log(gso_2D_so_low.x_lim[0]);
     xmax[0] = log(gso_2D_so_low.x_lim[1]);
-    hcubature_v( 1, F_IC_out, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_low, &abserr );
+    HCUBATURE_V( 1, F_IC_out, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_low, &abserr );
 
     return E_e__GeV/(res_high + res_low);
 
@@ -1083,7 +1084,7 @@ int test_IC_integration( double E_e__GeV_lims[2], gsl_spline_object_2D gso_2D_IC
     {
         res = 0.;
         fdata.E_gam__GeV = E__GeV_low[i];
-        hcubature_v( 1, F_IC_ai, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_IC_ai, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         if ( res > 0. )
         {
             dNdEm1_low[i] = res;
@@ -1098,7 +1099,7 @@ int test_IC_integration( double E_e__GeV_lims[2], gsl_spline_object_2D gso_2D_IC
     xmin[0] = log(gso_2D_so_low.x_lim[0]);
     xmax[0] = log(gso_2D_so_low.x_lim[1]);
     fdata.gso_1D_so = gso_1D_low;
-    hcubature_v( 1, F_IC_Spec, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_speclow, &abserr );
+    HCUBATURE_V( 1, F_IC_Spec, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_speclow, &abserr );
 
 
     double E__GeV_high[n_Esteps], dNdEm1_high[n_Esteps];
@@ -1111,7 +1112,7 @@ int test_IC_integration( double E_e__GeV_lims[2], gsl_spline_object_2D gso_2D_IC
     {
         res = 0.;
         fdata.E_gam__GeV = E__GeV_high[i];
-        hcubature_v( 1, F_IC_ai, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_IC_ai, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         if ( res > 0. )
         {
             dNdEm1_high[i] = res;
@@ -1126,7 +1127,7 @@ int test_IC_integration( double E_e__GeV_lims[2], gsl_spline_object_2D gso_2D_IC
     xmin[0] = log(gso_2D_so_high.x_lim[0]);
     xmax[0] = log(gso_2D_so_high.x_lim[1]);
     fdata.gso_1D_so = gso_1D_high;
-    hcubature_v( 1, F_IC_Spec, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_spechigh, &abserr );
+    HCUBATURE_V( 1, F_IC_Spec, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_spechigh, &abserr );
 
 
 
@@ -1143,7 +1144,7 @@ int test_IC_integration( double E_e__GeV_lims[2], gsl_spline_object_2D gso_2D_IC
         res = 0.;
         xmax[0] = log(E__GeV[i]);
         fdata.E_e__GeV = E__GeV[i];
-        hcubature_v( 1, F_IC_Gamma, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_IC_Gamma, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         if ( res > 0. )
         {
             dNdEm1[i] = res;
@@ -1160,7 +1161,7 @@ int test_IC_integration( double E_e__GeV_lims[2], gsl_spline_object_2D gso_2D_IC
     xmin[0] = log(E_e__GeV_lims[0]);
     xmax[0] = log(E_e__GeV_lims[1]);
     fdata.gso_1D_so = gso_1D_P_out;
-    hcubature_v( 1, F_IC_P, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_Gamma_out, &abserr );
+    HCUBATURE_V( 1, F_IC_P, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res_Gamma_out, &abserr );
 
 
     printf("Inverse Compton - total spec: %e total Gamma: %e ratio: %e\n", res_speclow+res_spechigh, res_Gamma_out, 
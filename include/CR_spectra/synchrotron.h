@@ -5,6 +5,7 @@
 #include <string.h>
 #include <gsl_sf_bessel.h>
 #include <cubature.h>
+#include "../instrument.h"
 
 #include "physical_constants.h"
 #include "gsl_decs.h"
@@ -61,7 +62,7 @@ gsl_spline_object_1D init_gso_1D_sync( double x_lims[2], size_t n_pts, char type
         //call integrator
         if (xmin[0] < xmax[0])
         {
-            hcubature_v( 1, F_sync, fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+            HCUBATURE_V( 1, F_sync, fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         }
         else
         {
@@ -120,7 +121,7 @@ data_object_1D init_do_1D_sync( double x_lims[2], size_t n_pts )
         //call integrator
         if (xmin[0] < xmax[0])
         {
-            hcubature_v( 1, F_sync, fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+            HCUBATURE_V( 1, F_sync, fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         }
         else
         {
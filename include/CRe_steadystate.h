@@ -2,6 +2,7 @@
 #define CRe_steadystate
 
 #include <cubature.h>
+#include "instrument.h"
 #include <gsl_linalg.h>
 
 #include "gen_funcs.h"
@@ -241,6 +242,8 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
         return 0;
     }
 
+    INSTR_STAGE_BEGIN(t_solve, "CRe_steadystate_solve");
+
     double E__GeV[n_E+1];
     logspace_array( n_E+1, E_e_lim__GeV[0], E_e_lim__GeV[1], E__GeV );
 
@@ -281,6 +284,7 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
 
 
     //calculate losses to anything below min energy down to m_e
+    INSTR_STAGE_BEGIN(t_Gamma_i0, "CRe_steadystate_solve:Gamma_i0");
     double Gamma_i0[n_E];
     double Gamma_i0_prime[n_E];
     xmin2D[1] = log(m_e__GeV);
@@ -289,14 +293,17 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
     {
         xmin2D[0] = log(E__GeV[i]);
         xmax2D[0] = log(E__GeV[i+1]);
-        hcubature_v( 2, F_Gamma_i0_2D_2_log_E, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
+        HCUBATURE_V( 2, F_Gamma_i0_2D_2_log_E, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
         Gamma_i0[i] = res2[0]/DeltalogE;
         Gamma_i0_prime[i] = res2[1]/pow(DeltalogE,2) - lnE_i__GeV[i]/DeltalogE * Gamma_i0[i];
     }
 
 
 
+    INSTR_STAGE_END(t_Gamma_i0);
+
     //Energy correction for intra-bin losses
+    INSTR_STAGE_BEGIN(t_Gamma_ii, "CRe_steadystate_solve:Gamma_ii");
     double Gamma_ii[n_E];
     double Gamma_ii_prime[n_E];
     for (i = 0; i < n_E; ++i)
@@ -305,13 +312,16 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
         xmax2D[0] = log(E__GeV[i+1]);
         xmin2D[1] = log(E__GeV[i]);
         xmax2D[1] = log(E__GeV[i+1]);
-        hcubature_v( 4, F_Gamma_2D_4_log_E, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res4, abserr4 );
+        HCUBATURE_V( 4, F_Gamma_2D_4_log_E, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res4, abserr4 );
         Gamma_ii[i] = (res4[0]/DeltalogE) - (res4[2]/DeltalogE) ;
         Gamma_ii_prime[i] = (res4[1]/pow(DeltalogE,2) - lnE_i__GeV[i]/DeltalogE * (res4[0]/DeltalogE)) - 
                             (res4[3]/pow(DeltalogE,2) - lnE_i__GeV[i]/DeltalogE * (res4[2]/DeltalogE));
     }
 
+    INSTR_STAGE_END(t_Gamma_ii);
+
     //transitions from bin i to bin j
+    INSTR_STAGE_BEGIN(t_Gamma_ij, "CRe_steadystate_solve:Gamma_ij");
 //    double Gamma_ij[n_E][n_E];
 //    double Gamma_ij_prime[n_E][n_E];
 //    double Gamma_ji_prime[n_E][n_E];
@@ -335,7 +345,7 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
             xmin2D[1] = log(E__GeV[j]);
             xmax2D[1] = log(E__GeV[j+1]);
 
-            hcubature_v( 4, F_Gamma_2D_4_log_E, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res4, abserr4 );
+            HCUBATURE_V( 4, F_Gamma_2D_4_log_E, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res4, abserr4 );
 
             Gamma_ij[i][j] = res4[0]/DeltalogE;
             Gamma_ij_prime[i][j] = res4[1]/pow(DeltalogE,2) - lnE_i__GeV[i]/DeltalogE * Gamma_ij[i][j];
@@ -351,6 +361,8 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
         }
     }
 
+    INSTR_STAGE_END(t_Gamma_ij);
+
     //add up the transitions out of bin i
     double Gamma_i[n_E];
     double Gamma_i_prime[n_E];
@@ -365,6 +377,7 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
         }
     }
 
+    INSTR_STAGE_BEGIN(t_Edot_D, "CRe_steadystate_solve:Edot_D");
     double Edot_i[n_E+1];
     if (structure == 1)
     {
@@ -394,14 +407,17 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
     {
         xmin[0] = log(E__GeV[i]);
         xmax[0] = log(E__GeV[i+1]);
-        hcubature_v( 2, F_EdotDE_2_log_E, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
+        HCUBATURE_V( 2, F_EdotDE_2_log_E, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
         D_i[i] = res2[0]/DeltalogE;
         D_i_prime[i] = res2[1]/pow(DeltalogE,2) - lnE_i__GeV[i]/DeltalogE * D_i[i];
     }
 
 
 
+    INSTR_STAGE_END(t_Edot_D);
+
     //for readability and debugging, we populate the matrix separately before changing to a 1D array
+    INSTR_STAGE_BEGIN(t_matrix, "CRe_steadystate_solve:matrix");
     double **M = malloc(sizeof *M * n_E);
     if (M){for (i = 0; i < n_E; i++){M[i] = malloc(sizeof *M[i] * n_E);}}
 
@@ -483,14 +499,17 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
 
 
 
+    INSTR_STAGE_END(t_matrix);
+
     //set injection Q_i
+    INSTR_STAGE_BEGIN(t_Q, "CRe_steadystate_solve:Q_inject");
     double Q_i_1[n_E];
     fdata.gso_1D_Q = gso_1D_Q_inject_1;
     for (i = 0; i < n_E; ++i)
     {
         xmin[0] = log(E__GeV[i]);
         xmax[0] = log(E__GeV[i+1]);
-        hcubature_v( 1, F_QE2_i_log_E, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_QE2_i_log_E, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         Q_i_1[i] = -1.*res/DeltalogE; //-ve as on RHS of Eqn in linalg system
     }
 
@@ -500,12 +519,15 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
     {
         xmin[0] = log(E__GeV[i]);
         xmax[0] = log(E__GeV[i+1]);
-        hcubature_v( 1, F_QE2_i_log_E, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_QE2_i_log_E, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         Q_i_2[i] = -1.*res/DeltalogE; //-ve as on RHS of Eqn in linalg system
     }
 
 
 
+    INSTR_STAGE_END(t_Q);
+
+    INSTR_STAGE_BEGIN(t_linsolve, "CRe_steadystate_solve:linear_solve");
     double q_e_1[n_E+2];
 
     if (Q_i_1[n_E-1] == 0.)
@@ -631,6 +653,8 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
     }
 
  
+    INSTR_STAGE_END(t_linsolve);
+
     q_e_1[0] = fmax(0.,exp( ((log(q_e_1[2])-log(q_e_1[1]))/(log(E_out__GeV[2])-log(E_out__GeV[1]))) * (log(E_out__GeV[0]) - log(E_out__GeV[1])) + log(q_e_1[1]) ));
     q_e_1[n_E+1] = fmax(0.,exp( ((log(q_e_1[n_E])-log(q_e_1[n_E-1]))/(log(E_out__GeV[n_E])-log(E_out__GeV[n_E-1]))) * (log(E_out__GeV[n_E+1]) - log(E_out__GeV[n_E])) + log(q_e_1[n_E]) ));
     q_e_2[0] = fmax(0.,exp( ((log(q_e_2[2])-log(q_e_2[1]))/(log(E_out__GeV[2])-log(E_out__GeV[1]))) * (log(E_out__GeV[0]) - log(E_out__GeV[1])) + log(q_e_2[1]) ));
@@ -646,6 +670,7 @@ int CRe_steadystate_solve( int structure, double E_e_lim__GeV[2], int n_E, doubl
 
     free2D( n_E, M );
 
+    INSTR_STAGE_END(t_solve);
     return 0;
 
 }
@@ -722,7 +747,7 @@ int CRe_steadystate_solve_number( int structure, double E_e_lim__GeV[2], int n_E
         xmin2D[0] = log(E__GeV[i]);
         xmax2D[0] = log(E__GeV[i+1]);
 
-        hcubature_v( 2, F_Gamma_i0_2D_2_log, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
+        HCUBATURE_V( 2, F_Gamma_i0_2D_2_log, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
         Gamma_i0[i] = res2[0]/DeltalogE;
         Gamma_i0_prime[i] = res2[1]/pow(DeltalogE,2) - lnE_i__GeV[i]/DeltalogE * Gamma_i0[i];
     }
@@ -737,7 +762,7 @@ int CRe_steadystate_solve_number( int structure, double E_e_lim__GeV[2], int n_E
         xmax2D[0] = log(E__GeV[i+1]);
         xmin2D[1] = log(E__GeV[i]);
         xmax2D[1] = log(E__GeV[i+1]);
-        hcubature_v( 2, F_Gamma_ii_2D_2_log, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
+        HCUBATURE_V( 2, F_Gamma_ii_2D_2_log, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
         Gamma_ii[i] = res2[0]/DeltalogE / E_out__GeV[1+i];
         Gamma_ii_prime[i] = res2[1]/pow(DeltalogE,2) / E_out__GeV[1+i] - lnE_i__GeV[i]/DeltalogE * Gamma_ii[i];
     }
@@ -759,7 +784,7 @@ int CRe_steadystate_solve_number( int structure, double E_e_lim__GeV[2], int n_E
         {
             xmin2D[1] = log(E__GeV[j]);
             xmax2D[1] = log(E__GeV[j+1]);
-            hcubature_v( 2, F_Gamma_2D_2_log, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
+            HCUBATURE_V( 2, F_Gamma_2D_2_log, &fdata, 2, xmin2D, xmax2D, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
             Gamma_ji[i][j] = res2[0]/log(E__GeV[j+1]/E__GeV[j]);
             Gamma_ji_prime[i][j] = res2[1]/pow(log(E__GeV[j+1]/E__GeV[j]),2) - lnE_i__GeV[j]/log(E__GeV[j+1]/E__GeV[j]) * Gamma_ji[i][j];
         }
@@ -792,7 +817,7 @@ int CRe_steadystate_solve_number( int structure, double E_e_lim__GeV[2], int n_E
     {
         xmin[0] = log(E__GeV[i]);
         xmax[0] = log(E__GeV[i+1]);
-        hcubature_v( 2, F_D_2_log, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
+        HCUBATURE_V( 2, F_D_2_log, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, res2, abserr2 );
         D_i[i] = (res2[0]/pow(h__pc*pc__cm,2))/DeltalogE;
         D_i_prime[i] = (res2[1]/pow(h__pc*pc__cm,2))/pow(DeltalogE,2) - lnE_i__GeV[i]/DeltalogE * D_i[i];
     }
@@ -906,7 +931,7 @@ int CRe_steadystate_solve_number( int structure, double E_e_lim__GeV[2], int n_E
     {
         xmin[0] = log(E__GeV[i]);
         xmax[0] = log(E__GeV[i+1]);
-        hcubature_v( 1, F_Q_i_log, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_Q_i_log, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         Q_i_1[i] = -1.*res/DeltalogE; //-ve as on RHS of Eqn in linalg system
     }
 
@@ -916,7 +941,7 @@ int CRe_steadystate_solve_number( int structure, double E_e_lim__GeV[2], int n_E
     {
         xmin[0] = log(E__GeV[i]);
         xmax[0] = log(E__GeV[i+1]);
-        hcubature_v( 1, F_Q_i_log, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_Q_i_log, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
         Q_i_2[i] = -1.*res/DeltalogE; //-ve as on RHS of Eqn in linalg system
     }
 
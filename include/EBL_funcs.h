@@ -5,6 +5,7 @@
 // Berezniski and Kalashev 2016
 
 #include "physical_constants.h"
+#include "instrument.h"
 
 double eps_EBL( double z ){return 0.6695 * (1.+z)/1e9;} //GeV
 double eps_CMB( double z ){return 6.627e-4 * (1.+z)/1e9;} //GeV 2.795 K CMB
@@ -120,7 +121,7 @@ double norm_casc_C( double spec_gam[], double E_GeV[], int n_Esteps, double z, f
   double xmin[1] = { Emin_GeV };
   double xmax[1] = { Emax_GeV };
 
-  hcubature_v( 1, f_Ccasc_int, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-4, ERROR_INDIVIDUAL, &val, &err );
+  HCUBATURE_V( 1, f_Ccasc_int, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-4, ERROR_INDIVIDUAL, &val, &err );
   return val * norm_casc_C1( z, fdata_in );
   }
 
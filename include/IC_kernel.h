@@ -0,0 +1,172 @@
+#ifndef IC_kernel_h
+#define IC_kernel_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "data_objects.h"
+#include "gal_rad.h"
+
+/* Weighted multi-table IC kernel: the per-galaxy IC (or IC Gamma) table is the sum of the shared base tables of an
+   IC_object weighted by the galaxy's dilution factors, with the CMB and FIR fields interpolated between the two
+   temperature slices bracketing the galaxy's T_CMB and T_dust. Rather than materialising that sum on a new nx*ny
+   grid per galaxy the kernel keeps pointers to the base tables and the weights, and forms the weighted sum at
+   lookup time. The bilinear cell and weights are found once per lookup and shared by all components, which gives
+   the same result as interpolating the summed table since bilinear interpolation is linear in the table values. */
+
+#define IC_KERNEL_NCOMP 8
+
+typedef struct IC_kernels
+{
+    size_t nx, ny;
+    const double *x_data;
+    const double *y_data;
+    double x_lim[2], y_lim[2];
+    //CMB lower/upper slice, FIR lower/upper slice, 3000K, 4000K, 7500K, UV
+    const double *z[IC_KERNEL_NCOMP];
+    double w[IC_KERNEL_NCOMP];
+    //Pinned lower/upper temperature slices of the CMB [0] and FIR [1] tables, released in IC_kernel_free
+    data_object_3D do3D[2];
+    size_t slice[2][2];
+} IC_kernel;
+
+
+//Lower index of the grid cell containing x, clamped to [0, n-2]
+size_t IC_kernel_cell( size_t n, const double *grid, double x )
+{
+    size_t lo = 0, hi = n - 1, mid;
+    while (hi - lo > 1)
+    {
+        mid = (lo + hi)/2;
+        if (grid[mid] > x){ hi = mid; }
+        else { lo = mid; }
+    }
+    return lo;
+}
+
+//Position of T_FIELD__K on the temperature grid of a 3D table as slice index and fractional part,
+//frac = (T - T_k)/(T_k+1 - T_k); a table with a single slice gives k = 0 and frac = 0
+void IC_kernel_slice_pos( data_object_3D do3D, double T_FIELD__K, size_t *k, double *frac )
+{
+    if (do3D.nf < 2)
+    {
+        *k = 0;
+        *frac = 0.;
+        return;
+    }
+    double T = fmin( fmax( T_FIELD__K, do3D.f_data[0] ), do3D.f_data[do3D.nf-1] );
+    *k = IC_kernel_cell( do3D.nf, do3D.f_data, T );
+    *frac = (T - do3D.f_data[*k])/(do3D.f_data[*k+1] - do3D.f_data[*k]);
+}
+
+//intj is 0 for IC and 1 for IC_Gamma
+IC_kernel IC_kernel_init( unsigned short int intj, IC_object ICo, double * nphot_params )
+{
+    IC_kernel kern;
+    double frac;
+    unsigned short int j;
+
+    //Dilution factors: 3000K, 4000K, 7500K, UV, FIR
+    galaxy_radfield rf = galaxy_radfield_from_params( nphot_params );
+    double *C_dil_gal = rf.Cdil;
+
+    kern.nx = ICo.do_3D_IC[intj][0].nx;
+    kern.ny = ICo.do_3D_IC[intj][0].ny;
+    kern.x_data = ICo.do_3D_IC[intj][0].x_data;
+    kern.y_data = ICo.do_3D_IC[intj][0].y_data;
+    kern.x_lim[0] = kern.x_data[0];
+    kern.x_lim[1] = kern.x_data[kern.nx-1];
+    kern.y_lim[0] = kern.y_data[0];
+    kern.y_lim[1] = kern.y_data[kern.ny-1];
+
+    //CMB j = 0, FIR j = 1, the FIR field is diluted while the CMB is not
+    //Linear in temperature between the bracketing slices: (1 - frac) on slice k, frac on slice k+1
+    for (j = 0; j < 2; j++)
+    {
+        kern.do3D[j] = ICo.do_3D_IC[intj][j];
+        IC_kernel_slice_pos( kern.do3D[j], nphot_params[j], &(kern.slice[j][0]), &frac );
+        //A single-slice table has no upper neighbour, its zero-weight upper slot reuses the lower slice
+        kern.slice[j][1] = kern.do3D[j].nf < 2 ? kern.slice[j][0] : kern.slice[j][0]+1;
+        kern.z[2*j] = do3D_slice_acquire( kern.do3D[j], kern.slice[j][0] );
+        kern.z[2*j+1] = do3D_slice_acquire( kern.do3D[j], kern.slice[j][1] );
+        kern.w[2*j] = (j == 0 ? 1. : C_dil_gal[4]) * (1.-frac);
+        kern.w[2*j+1] = (j == 0 ? 1. : C_dil_gal[4]) * frac;
+    }
+
+    for (j = 0; j < 4; j++)
+    {
+        kern.z[4+j] = ICo.do_2D_IC[intj][j].z_data;
+        kern.w[4+j] = C_dil_gal[j];
+    }
+
+    return kern;
+}
+
+void IC_kernel_free( IC_kernel kern )
+{
+    unsigned short int j;
+    for (j = 0; j < 2; j++)
+    {
+        do3D_slice_release( kern.do3D[j], kern.slice[j][0] );
+        do3D_slice_release( kern.do3D[j], kern.slice[j][1] );
+    }
+}
+
+//Weighted sum of all components at (x, y), 0 outside the table
+double IC_kernel_eval( const IC_kernel *kern, double x, double y )
+{
+    if (x < kern->x_lim[0] || x > kern->x_lim[1] || y < kern->y_lim[0] || y > kern->y_lim[1])
+    {
+        return 0.;
+    }
+
+    size_t i = IC_kernel_cell( kern->nx, kern->x_data, x );
+    size_t j = IC_kernel_cell( kern->ny, kern->y_data, y );
+    double t = (x - kern->x_data[i])/(kern->x_data[i+1] - kern->x_data[i]);
+    double u = (y - kern->y_data[j])/(kern->y_data[j+1] - kern->y_data[j]);
+
+    size_t i11 = j * kern->nx + i;
+    size_t i12 = (j+1) * kern->nx + i;
+    double w11 = (1.-t)*(1.-u), w21 = t*(1.-u), w12 = (1.-t)*u, w22 = t*u;
+    double res = 0.;
+    unsigned short int c;
+
+    for (c = 0; c < IC_KERNEL_NCOMP; c++)
+    {
+        res += kern->w[c] * ( w11 * kern->z[c][i11] + w21 * kern->z[c][i11+1] + w12 * kern->z[c][i12] + w22 * kern->z[c][i12+1] );
+    }
+    return res;
+}
+
+//Materialise the weighted table on the base grid, z_data needs nx*ny entries
+void IC_kernel_fill( const IC_kernel *kern, double *z_data )
+{
+    size_t i;
+    unsigned short int c;
+    for (i = 0; i < kern->nx * kern->ny; i++)
+    {
+        z_data[i] = 0.;
+        for (c = 0; c < IC_KERNEL_NCOMP; c++)
+        {
+            z_data[i] += kern->w[c] * kern->z[c][i];
+        }
+    }
+}
+
+/* Gamma is d2N/(dE dt), as P_IC__GeVm1sm1 for a kernel built with intj = 1 */
+double P_IC_kernel__GeVm1sm1( double E_e__GeV, double E_f__GeV, const IC_kernel *kern )
+{
+    if (E_f__GeV < E_e__GeV)
+    {
+        return IC_kernel_eval( kern, E_e__GeV - E_f__GeV, E_e__GeV );
+    }
+    else
+    {
+        return 0.;
+    }
+}
+
+
+
+#endif
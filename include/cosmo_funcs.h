@@ -1,73 +1,129 @@
 #ifndef cosmo_funcs_h
 #define cosmo_funcs_h
 #include <math.h>
+#include <stdio.h>
 #include <gsl_integration.h>
 
 #include "cosmo_params.h"
 #include "astro_const.h"
+#include "integ_context.h"
 
-double E_z( double z ){
-  return sqrt(om_M * pow((1.+z),3) + om_k * pow((1.+z),2) + om_lam);
+/*
+ * Each function takes the cosmology explicitly (the _cosmo versions), so any number of cosmologies can be
+ * evaluated at once from different threads. The original versions use the global cosmology.
+ */
+
+double E_z_cosmo( const cosmology *c, double z ){
+  return sqrt(c->om_M * pow((1.+z),3) + c->om_k * pow((1.+z),2) + c->om_lam);
   }
 
 /* Comoving distance [MPc] */
-double d_c_MPc( double z_low, double z_high ){
+double d_c_MPc_cosmo( const cosmology *c, double z_low, double z_high ){
   if (z_low < 0.) return 0.;
   if (z_high <= z_low) return 0.; 
   double result;
   double abserr;
-  double f(double z, void* p){return 1./E_z( z );}
+  double f(double z, void* p){return 1./E_z_cosmo( c, z );}
   gsl_function F;
   F.function = &f;
-  gsl_integration_workspace * w;
-  w = gsl_integration_workspace_alloc(100000);
+  integ_context *ctx = integ_context_self();
+  gsl_integration_workspace * w = integ_gsl_acquire( ctx );
+  if (w == NULL){printf("Error in %s: no integration workspace\n", __func__); return 0.;}
   gsl_integration_qag( &F , z_low, z_high, 0., 1e-8, 10000, GSL_INTEG_GAUSS61, w, &result, &abserr );
-  gsl_integration_workspace_free(w);
-  return result * D_H_MPc;
+  integ_gsl_release( ctx );
+  return result * c->D_H_MPc;
   }
 
 /* Transverse comoving distance [MPc] */
-double d_m_MPc( double z ){
+double d_m_MPc_cosmo( const cosmology *c, double z ){
   if (z < 0.) return 0.;
-  if (om_k == 0.){return d_c_MPc( 0., z );}
-  else if (om_k > 0.){return D_H_MPc/sqrt(om_k) * sinh( sqrt(om_k) * d_c_MPc( 0., z )/D_H_MPc );}
-  else if (om_k < 0.){return D_H_MPc/sqrt(fabs(om_k)) * sin( sqrt(fabs(om_k)) * d_c_MPc( 0., z )/D_H_MPc );}
+  if (c->om_k == 0.){return d_c_MPc_cosmo( c, 0., z );}
+  else if (c->om_k > 0.){return c->D_H_MPc/sqrt(c->om_k) * sinh( sqrt(c->om_k) * d_c_MPc_cosmo( c, 0., z )/c->D_H_MPc );}
+  else if (c->om_k < 0.){return c->D_H_MPc/sqrt(fabs(c->om_k)) * sin( sqrt(fabs(c->om_k)) * d_c_MPc_cosmo( c, 0., z )/c->D_H_MPc );}
   return 0.;
   }
 
 /* Luminosity distance [MPc] */
-double d_l_MPc( double z ){
+double d_l_MPc_cosmo( const cosmology *c, double z ){
   if (z <= 0.) return 0.;
-  return d_m_MPc( z ) * (1. + z);
+  return d_m_MPc_cosmo( c, z ) * (1. + z);
   }
 
 /* Angular diameter distance [MPc] */
-double d_a_MPc( double z ){
+double d_a_MPc_cosmo( const cosmology *c, double z ){
   if (z < 0.) return 0.;
-  return d_m_MPc( z ) / (1. + z);
+  return d_m_MPc_cosmo( c, z ) / (1. + z);
   }
 
 /* Comoving volume element [MPc^3 d\Omega^-1 dz^-1] */
-double dV_c( double z ){
+double dV_c_cosmo( const cosmology *c, double z ){
   if (z < 0.) return 0.;
-  return D_H_MPc * pow( (1. + z) * d_a_MPc( z ), 2 )/E_z( z ) ;
+  return c->D_H_MPc * pow( (1. + z) * d_a_MPc_cosmo( c, z ), 2 )/E_z_cosmo( c, z ) ;
   }
 
 /* Comoving volume between z_low and z_high [MPc^3 d\Omega^-1] */
-double Vc_dOm_MPc3srm1( double z_low, double z_high ){
+double Vc_dOm_MPc3srm1_cosmo( const cosmology *c, double z_low, double z_high ){
   if ( (z_low < 0.) || (z_high <= z_low) ) return 0.;
   double result;
   double abserr;
-  double f(double z, void* p){return dV_c( z );}
+  double f(double z, void* p){return dV_c_cosmo( c, z );}
   gsl_function F;
   F.function = &f;
-  gsl_integration_workspace * w;
-  w = gsl_integration_workspace_alloc(100000);
+  integ_context *ctx = integ_context_self();
+  gsl_integration_workspace * w = integ_gsl_acquire( ctx );
+  if (w == NULL){printf("Error in %s: no integration workspace\n", __func__); return 0.;}
   gsl_integration_qag( &F , z_low, z_high, 0., 1e-8, 10000, GSL_INTEG_GAUSS61, w, &result, &abserr );
-  gsl_integration_workspace_free(w);
+  integ_gsl_release( ctx );
   return result;
   }
 
+/* Luminosity distance modulus 1/(4 pi d_l^2) [cm^-2], turns a luminosity into a flux */
+double distmod__cmm2_cosmo( const cosmology *c, double z ){
+  if (z <= 0.) return 0.;
+  return 1./(4. * M_PI * pow( d_l_MPc_cosmo( c, z ) * Mpc__cm, 2 ));
+  }
+
+
+double E_z( double z ){
+  cosmology c = cosmology_current();
+  return E_z_cosmo( &c, z );
+  }
+
+double d_c_MPc( double z_low, double z_high ){
+  cosmology c = cosmology_current();
+  return d_c_MPc_cosmo( &c, z_low, z_high );
+  }
+
+double d_m_MPc( double z ){
+  cosmology c = cosmology_current();
+  return d_m_MPc_cosmo( &c, z );
+  }
+
+double d_l_MPc( double z ){
+  cosmology c = cosmology_current();
+  return d_l_MPc_cosmo( &c, z );
+  }
+
+double d_a_MPc( double z ){
+  cosmology c = cosmology_current();
+  return d_a_MPc_cosmo( &c, z );
+  }
+
+double dV_c( double z ){
+  cosmology c = cosmology_current();
+  return dV_c_cosmo( &c, z );
+  }
+
+double Vc_dOm_MPc3srm1( double z_low, double z_high ){
+  cosmology c = cosmology_current();
+  return Vc_dOm_MPc3srm1_cosmo( &c, z_low, z_high );
+  }
+
+double distmod__cmm2( double z ){
+  cosmology c = cosmology_current();
+  return distmod__cmm2_cosmo( &c, z );
+  }
+
 
 
 
@@ -9,3 +9,15 @@ double om_M = 0.315;
 double om_k = 0.0;
 double om_lam = 0.685;
 double D_H_MPc = 2997.92458;
+
+cosmology cosmology_current(void)
+{
+    cosmology c = { om_M, om_k, om_lam, D_H_MPc };
+    return c;
+}
+
+cosmology cosmology_LCDM(double Omega_M, double Omega_lam, double h)
+{
+    cosmology c = { Omega_M, 1. - Omega_M - Omega_lam, Omega_lam, 2997.92458 / h };
+    return c;
+}
@@ -22,6 +22,25 @@ extern double om_lam;
 // Hubble constant in Mpc
 extern double D_H_MPc;
 
+/**
+ * Cosmological parameters as a value, for code that evaluates several
+ * cosmologies side by side (e.g. from parallel threads). The globals above
+ * remain the default cosmology.
+ */
+typedef struct cosmologies
+{
+    double om_M;
+    double om_k;
+    double om_lam;
+    double D_H_MPc;
+} cosmology;
+
+// The current global cosmology
+cosmology cosmology_current(void);
+
+// Lambda-CDM with om_k = 1 - Omega_M - Omega_lam, h = H_0 / (100 km/s/Mpc)
+cosmology cosmology_LCDM(double Omega_M, double Omega_lam, double h);
+
 #ifdef __cplusplus
 }
 #endif
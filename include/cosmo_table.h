@@ -0,0 +1,213 @@
+/**
+ * Tabulated Cosmological Distances
+ * The comoving distance is integrated once, cumulatively, on a uniform grid
+ * in x = ln(1+z) (8-point Gauss-Legendre on each interval), and stored with
+ * its exact derivative dD_C/dx = D_H (1+z)/E(z). Distances and volumes are
+ * then a cubic Hermite interpolation away, with relative errors well below
+ * 1e-10 for the default grid, instead of a full qag integration per call.
+ * A table holds the cosmology it was built from, so tables for different
+ * cosmologies can be built and queried side by side.
+ */
+
+#ifndef COSMO_TABLE_H
+#define COSMO_TABLE_H
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "cosmo_params.h"
+#include "astro_const.h"
+
+#define COSMO_TABLE_Z_MAX_DEFAULT 20.
+#define COSMO_TABLE_N_DEFAULT 4096
+
+typedef struct cosmo_tables
+{
+    cosmology cosmo;
+    unsigned int n;      // number of intervals
+    double x_max, dx;    // grid in x = ln(1+z)
+    double *D_C;         // comoving distance at the n+1 grid points [Mpc]
+    double *dD_C_dx;     // its derivative in x [Mpc]
+} cosmo_table;
+
+// 8-point Gauss-Legendre nodes and weights on [-1, 1], positive half
+static const double cosmo_gl8_x[4] = { 0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363 };
+static const double cosmo_gl8_w[4] = { 0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763 };
+
+/**
+ * Hubble expansion factor for the table's parameters
+ * @param tab Table
+ * @param z Redshift
+ * @return E(z)
+ */
+static inline double cosmo_table_E_z(const cosmo_table *tab, double z) {
+    double a = 1. + z;
+    return sqrt(tab->cosmo.om_M * a * a * a + tab->cosmo.om_k * a * a + tab->cosmo.om_lam);
+}
+
+// Integrand of the comoving distance in x, D_H (1+z)/E(z)
+static inline double cosmo_table_dD_C_dx(const cosmo_table *tab, double x) {
+    double z = expm1(x);
+    return tab->cosmo.D_H_MPc * (1. + z) / cosmo_table_E_z(tab, z);
+}
+
+// Comoving distance between x0 and x1 [Mpc], 8-point Gauss-Legendre
+static inline double cosmo_table_gl8(const cosmo_table *tab, double x0, double x1) {
+    double c = 0.5 * (x0 + x1), h = 0.5 * (x1 - x0), sum = 0.;
+    for (int k = 0; k < 4; k++) {
+        sum += cosmo_gl8_w[k] * (cosmo_table_dD_C_dx(tab, c - h * cosmo_gl8_x[k]) + cosmo_table_dD_C_dx(tab, c + h * cosmo_gl8_x[k]));
+    }
+    return h * sum;
+}
+
+/**
+ * Tabulate the comoving distance of a cosmology
+ * @param cosmo Cosmological parameters (copied)
+ * @param z_max Largest tabulated redshift, larger ones are integrated on demand
+ * @param n Number of grid intervals
+ * @return New table (free with cosmo_table_free), NULL if out of memory
+ */
+static inline cosmo_table *cosmo_table_alloc_cosmo(const cosmology *cosmo, double z_max, unsigned int n) {
+    cosmo_table *tab = (cosmo_table *) malloc(sizeof(cosmo_table));
+    if (tab == NULL) return NULL;
+    if (n < 1) n = 1;
+    tab->cosmo = *cosmo;
+    tab->n = n;
+    tab->x_max = log1p(z_max > 0. ? z_max : 0.);
+    tab->dx = tab->x_max / n;
+    tab->D_C = (double *) malloc(sizeof(double) * (n + 1));
+    tab->dD_C_dx = (double *) malloc(sizeof(double) * (n + 1));
+    if (tab->D_C == NULL || tab->dD_C_dx == NULL) {
+        free(tab->D_C);
+        free(tab->dD_C_dx);
+        free(tab);
+        return NULL;
+    }
+
+    tab->D_C[0] = 0.;
+    tab->dD_C_dx[0] = cosmo_table_dD_C_dx(tab, 0.);
+    for (unsigned int i = 1; i <= n; i++) {
+        tab->D_C[i] = tab->D_C[i - 1] + cosmo_table_gl8(tab, (i - 1) * tab->dx, i * tab->dx);
+        tab->dD_C_dx[i] = cosmo_table_dD_C_dx(tab, i * tab->dx);
+    }
+    return tab;
+}
+
+/**
+ * Tabulate the comoving distance for the current global cosmology (om_M, om_k, om_lam, D_H_MPc)
+ * @param z_max Largest tabulated redshift
+ * @param n Number of grid intervals
+ * @return New table (free with cosmo_table_free), NULL if out of memory
+ */
+static inline cosmo_table *cosmo_table_alloc(double z_max, unsigned int n) {
+    cosmology cosmo = cosmology_current();
+    return cosmo_table_alloc_cosmo(&cosmo, z_max, n);
+}
+
+static inline void cosmo_table_free(cosmo_table *tab) {
+    if (tab == NULL) return;
+    free(tab->D_C);
+    free(tab->dD_C_dx);
+    free(tab);
+}
+
+/**
+ * Whether the table was built from the current global cosmological parameters
+ * @param tab Table
+ * @return 1 if so, 0 otherwise
+ */
+static inline int cosmo_table_is_current(const cosmo_table *tab) {
+    return tab->cosmo.om_M == om_M && tab->cosmo.om_k == om_k && tab->cosmo.om_lam == om_lam &&
+           tab->cosmo.D_H_MPc == D_H_MPc;
+}
+
+/**
+ * Comoving distance from z = 0 [Mpc]
+ * @param tab Table
+ * @param z Redshift (>= 0)
+ * @return D_C(z)
+ */
+static inline double cosmo_table_D_C(const cosmo_table *tab, double z) {
+    double x = log1p(z);
+    if (x >= tab->x_max) {
+        // Beyond the table: continue the integral from its end in steps of the grid spacing
+        double D = tab->D_C[tab->n], x0 = tab->x_max;
+        double dx = (tab->dx > 0.) ? tab->dx : 0.01;
+        while (x0 < x) {
+            double x1 = (x0 + dx < x) ? x0 + dx : x;
+            D += cosmo_table_gl8(tab, x0, x1);
+            x0 = x1;
+        }
+        return D;
+    }
+
+    unsigned int i = (unsigned int) (x / tab->dx);
+    if (i >= tab->n) i = tab->n - 1;
+    double t = x / tab->dx - i, s = 1. - t;
+    return (1. + 2. * t) * s * s * tab->D_C[i] + t * s * s * tab->dx * tab->dD_C_dx[i]
+         + t * t * (3. - 2. * t) * tab->D_C[i + 1] - t * t * s * tab->dx * tab->dD_C_dx[i + 1];
+}
+
+/* The functions below follow the conventions of their counterparts in cosmo_funcs.h */
+
+/* Comoving distance [MPc] */
+static inline double cosmo_table_d_c_MPc(const cosmo_table *tab, double z_low, double z_high) {
+    if (z_low < 0.) return 0.;
+    if (z_high <= z_low) return 0.;
+    return cosmo_table_D_C(tab, z_high) - cosmo_table_D_C(tab, z_low);
+}
+
+/* Transverse comoving distance [MPc] */
+static inline double cosmo_table_d_m_MPc(const cosmo_table *tab, double z) {
+    if (z < 0.) return 0.;
+    double D_C = cosmo_table_D_C(tab, z), D_H = tab->cosmo.D_H_MPc, sk = sqrt(fabs(tab->cosmo.om_k));
+    if (tab->cosmo.om_k > 0.) return D_H / sk * sinh(sk * D_C / D_H);
+    if (tab->cosmo.om_k < 0.) return D_H / sk * sin(sk * D_C / D_H);
+    return D_C;
+}
+
+/* Luminosity distance [MPc] */
+static inline double cosmo_table_d_l_MPc(const cosmo_table *tab, double z) {
+    if (z <= 0.) return 0.;
+    return cosmo_table_d_m_MPc(tab, z) * (1. + z);
+}
+
+/* Angular diameter distance [MPc] */
+static inline double cosmo_table_d_a_MPc(const cosmo_table *tab, double z) {
+    if (z < 0.) return 0.;
+    return cosmo_table_d_m_MPc(tab, z) / (1. + z);
+}
+
+/* Comoving volume element [MPc^3 d\Omega^-1 dz^-1] */
+static inline double cosmo_table_dV_c(const cosmo_table *tab, double z) {
+    if (z < 0.) return 0.;
+    double d_m = cosmo_table_d_m_MPc(tab, z);
+    return tab->cosmo.D_H_MPc * d_m * d_m / cosmo_table_E_z(tab, z);
+}
+
+/* Comoving volume out to z [MPc^3 d\Omega^-1], closed form of the integral of dV_c (Hogg 1999, eq. 29) */
+static inline double cosmo_table_V_c(const cosmo_table *tab, double z) {
+    if (z <= 0.) return 0.;
+    double D_H = tab->cosmo.D_H_MPc, ok = tab->cosmo.om_k;
+    double y = cosmo_table_d_m_MPc(tab, z) / D_H, y2 = y * y;
+    // Series in om_k where the closed form would cancel
+    if (fabs(ok) * y2 < 1e-3) return D_H * D_H * D_H * y2 * y * (1. / 3. - ok * y2 / 10. + 3. * ok * ok * y2 * y2 / 56.);
+    double sk = sqrt(fabs(ok));
+    double f = (ok > 0.) ? asinh(sk * y) : asin(sk * y);
+    return D_H * D_H * D_H / (2. * ok) * (y * sqrt(1. + ok * y2) - f / sk);
+}
+
+/* Comoving volume between z_low and z_high [MPc^3 d\Omega^-1] */
+static inline double cosmo_table_Vc_dOm_MPc3srm1(const cosmo_table *tab, double z_low, double z_high) {
+    if ((z_low < 0.) || (z_high <= z_low)) return 0.;
+    return cosmo_table_V_c(tab, z_high) - cosmo_table_V_c(tab, z_low);
+}
+
+/* Luminosity distance modulus 1/(4 pi d_l^2) [cm^-2] */
+static inline double cosmo_table_distmod__cmm2(const cosmo_table *tab, double z) {
+    if (z <= 0.) return 0.;
+    double d_l = cosmo_table_d_l_MPc(tab, z) * Mpc__cm;
+    return 1. / (4. * M_PI * d_l * d_l);
+}
+
+#endif /* COSMO_TABLE_H */
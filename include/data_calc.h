@@ -12,6 +12,8 @@
 #include "bremsstrahlung.h"
 #include "gal_rad.h"
 #include "file_io.h"
+#include "table_store.h"
+#include "IC_kernel.h"
 
 int CMB_num( double T_CMB_min__K_dummy, double T_CMB_max__K, double Delta_T__K, size_t * num )
 {
@@ -52,6 +54,7 @@ data_object_3D do3D_FIELD_array( int (*FIELD_num)( double, double, double, size_
     FIELD_num( T_FIELD_min__K, T_FIELD_max__K, Delta_T__K, &(do3D.nf) );
     FIELD_lim( T_FIELD_min__K, T_FIELD_max__K, lim );
     do3D.f_data = malloc(sizeof(double) * do3D.nf);
+    do3D.slices = NULL;
     do3D.f_data[0] = lim[0];
     do3D.f_data[do3D.nf-1] = lim[1];
 //printf("%zu %le %le\n", do3D.nf, lim[0], lim[1] );
@@ -135,6 +138,69 @@ data_object_3D do3D_IC(
 
 
 
+/* Table store helpers: a table is read only if present under its fingerprinted name and consistent with the
+   requested grid, and is published with write-then-rename so readers never see a partially written file.
+   3D tables are stored in the binary do3D format and opened lazily, one temperature slice at a time */
+
+int store_read_do1D( char *filename, size_t nx, double x_lim[2], data_object_1D *do1D )
+{
+    if (!table_store_exists( filename )){ return 1; }
+    *do1D = read_do1D( filename );
+    if (check_do1D( nx, x_lim, *do1D ) == 0){ return 0; }
+    data_object_1D_free( *do1D );
+    return 1;
+}
+
+int store_read_do2D( char *filename, size_t n_pts[2], double x_lim[2], double y_lim[2], data_object_2D *do2D )
+{
+    if (!table_store_exists( filename )){ return 1; }
+    *do2D = read_do2D( filename );
+    if (check_do2D( n_pts[0], n_pts[1], x_lim, y_lim, *do2D ) == 0){ return 0; }
+    data_object_2D_free( *do2D );
+    return 1;
+}
+
+int store_read_do3D( char *filename, size_t n_pts[2], size_t nf, double x_lim[2], double y_lim[2], double f_lim[2], 
+                     data_object_3D *do3D )
+{
+    if (!table_store_exists( filename )){ return 1; }
+    *do3D = read_do3D_lazy( filename, DO3D_SLICE_CACHE_DEFAULT );
+    if (check_do3D( n_pts[0], n_pts[1], nf, x_lim, y_lim, f_lim, *do3D ) == 0){ return 0; }
+    data_object_3D_free( *do3D );
+    return 1;
+}
+
+int store_write_do1D( data_object_1D do1D, char *filename )
+{
+    int cfint = 1;
+    char *tmpname = table_store_tmp_path( filename );
+    if (write_do1D( do1D, tmpname ) == 0){ cfint = table_store_publish( tmpname, filename ); }
+    else { remove( tmpname ); }
+    free( tmpname );
+    return cfint;
+}
+
+int store_write_do2D( data_object_2D do2D, char *filename )
+{
+    int cfint = 1;
+    char *tmpname = table_store_tmp_path( filename );
+    if (write_do2D( do2D, tmpname ) == 0){ cfint = table_store_publish( tmpname, filename ); }
+    else { remove( tmpname ); }
+    free( tmpname );
+    return cfint;
+}
+
+int store_write_do3D( data_object_3D do3D, char *filename )
+{
+    int cfint = 1;
+    char *tmpname = table_store_tmp_path( filename );
+    if (write_do3D_bin( do3D, tmpname ) == 0){ cfint = table_store_publish( tmpname, filename ); }
+    else { remove( tmpname ); }
+    free( tmpname );
+    return cfint;
+}
+
+
 IC_object load_IC_do_files( size_t n_pts[2], double E_gam__GeV_lims[2], double E_e__GeV_lims[2], double E_phot__GeV_lims[2],
                             double T_CMB_max__K, double Delta_T_CMB__K, double T_FIR_min__K, double T_FIR_max__K, double Delta_T_FIR__K,
                             char * datadir )
@@ -143,35 +209,20 @@ IC_object load_IC_do_files( size_t n_pts[2], double E_gam__GeV_lims[2], double E
     unsigned short int i, j;
 //    char *datadir = "data/"
 
-    char files_do2D_strings[2][4][24] = { { "/IC_3000_do2D.txt", "/IC_4000_do2D.txt", "/IC_7500_do2D.txt", "/IC_UV_do2D.txt" },
-                                       { "/IC_3000_Gamma_do2D.txt", "/IC_4000_Gamma_do2D.txt", "/IC_7500_Gamma_do2D.txt", 
-                                         "/IC_UV_Gamma_do2D.txt" } };
-
-    char files_do3D_strings[2][2][23] = { { "/IC_CMB_do3D.txt", "/IC_FIR_do3D.txt" }, 
-                                          { "/IC_CMB_Gamma_do3D.txt", "/IC_FIR_Gamma_do3D.txt" } };
+    const char *IC_kind[2] = { "IC", "IC_Gamma" };
 
-    char files_IC_do2D[2][4][strlen(datadir)+23+1];
-    char files_IC_do3D[2][2][strlen(datadir)+22+1];
-
-    for (j = 0; j < 2; j++)
-    {
-        for (i = 0; i < 4; i++)
-        {
-            strcpy( files_IC_do2D[j][i], string_cat( datadir, files_do2D_strings[j][i] ) );
-        }
-    }
+    const char *files_do2D_stems[2][4] = { { "IC_3000_do2D", "IC_4000_do2D", "IC_7500_do2D", "IC_UV_do2D" },
+                                           { "IC_3000_Gamma_do2D", "IC_4000_Gamma_do2D", "IC_7500_Gamma_do2D", "IC_UV_Gamma_do2D" } };
 
-    for (j = 0; j < 2; j++)
-    {
-        for (i = 0; i < 2; i++)
-        {
-            strcpy( files_IC_do3D[j][i], string_cat( datadir, files_do3D_strings[j][i] ) );
-        }
-    }
+    const char *files_do3D_stems[2][2] = { { "IC_CMB_do3D", "IC_FIR_do3D" }, 
+                                           { "IC_CMB_Gamma_do3D", "IC_FIR_Gamma_do3D" } };
 
     typedef double (*PhotFuncArray)(double *, double);
     PhotFuncArray dndEphot2D[] = { dndEphot_BB__cmm3GeVm1, dndEphot_BB__cmm3GeVm1, dndEphot_BB__cmm3GeVm1, dndEphot_UVMattis__cmm3GeVm1 };
     PhotFuncArray dndEphot3D[] = { dndEphot_BB__cmm3GeVm1, dndEphot_modBB__cmm3GeVm1 };
+    //Names of the photon fields above, these enter the table fingerprints
+    const char *dndEphot2D_name[] = { "BB", "BB", "BB", "UVMattis" };
+    const char *dndEphot3D_name[] = { "BB", "modBB" };
     double T_comp__K[] = { 3000., 4000., 7500., 0. };
 
     typedef data_object_2D (*ICFuncArray)( double (*)(double *, double), double *, double *, double *, double *, size_t *);
@@ -186,7 +237,10 @@ IC_object load_IC_do_files( size_t n_pts[2], double E_gam__GeV_lims[2], double E
     double T_FIELD_max__K[] = { T_CMB_max__K, T_FIR_max__K };
     double Delta_T__K[] = { Delta_T_CMB__K, Delta_T_FIR__K };
 
-    unsigned short int cobjint;
+    size_t nf;
+    double f_lim[2];
+    table_key key;
+    int lockfd;
     char * filename;
 
     //IC do2D
@@ -194,47 +248,78 @@ IC_object load_IC_do_files( size_t n_pts[2], double E_gam__GeV_lims[2], double E
     {
         for (i = 0; i < 4; i++)
         {
-            filename = files_IC_do2D[j][i];
-            ICo.do_2D_IC[j][i] = read_do2D( filename );
-
-            cobjint = check_do2D( n_pts[0], n_pts[1], E_gam__GeV_lims, E_e__GeV_lims, ICo.do_2D_IC[j][i] );
-
-            if (cobjint == 1)
+            key = table_key_init( IC_kind[j], TABLE_KERNEL_VERSION_IC );
+            table_key_add_string( &key, dndEphot2D_name[i] );
+            table_key_add_doubles( &key, 1, &(T_comp__K[i]) );
+            table_key_add_size( &key, n_pts[0] );
+            table_key_add_size( &key, n_pts[1] );
+            table_key_add_doubles( &key, 2, E_gam__GeV_lims );
+            table_key_add_doubles( &key, 2, E_e__GeV_lims );
+            table_key_add_doubles( &key, 2, E_phot__GeV_lims );
+            filename = table_store_path( datadir, files_do2D_stems[j][i], key, ".txt" );
+
+            if (store_read_do2D( filename, n_pts, E_gam__GeV_lims, E_e__GeV_lims, &(ICo.do_2D_IC[j][i]) ) == 1)
             {
-                printf("Trying to calc/write file %s\n", filename);
-                fflush(stdout);
-                ICo.do_2D_IC[j][i] = init_do_2D_IC_version[j]( dndEphot2D[i], &(T_comp__K[i]), E_gam__GeV_lims, E_e__GeV_lims, E_phot__GeV_lims, n_pts );
-                write_do2D( ICo.do_2D_IC[j][i], filename );
+                //Another process may have generated the table while we waited for the lock
+                lockfd = table_store_lock( filename );
+                if (store_read_do2D( filename, n_pts, E_gam__GeV_lims, E_e__GeV_lims, &(ICo.do_2D_IC[j][i]) ) == 1)
+                {
+                    printf("Trying to calc/write file %s\n", filename);
+                    fflush(stdout);
+                    ICo.do_2D_IC[j][i] = init_do_2D_IC_version[j]( dndEphot2D[i], &(T_comp__K[i]), E_gam__GeV_lims, E_e__GeV_lims, E_phot__GeV_lims, n_pts );
+                    store_write_do2D( ICo.do_2D_IC[j][i], filename );
+                }
+                table_store_unlock( filename, lockfd );
             }
             else
             {
                 printf("Successfully read and imported file %s\n", filename);
                 fflush(stdout);
             }
+            free( filename );
         }
 
         //IC do3D
         for (i = 0; i < 2; i++)
         {
-            filename = files_IC_do3D[j][i];
-            ICo.do_3D_IC[j][i] = read_do3D( filename );
-
-            cobjint = check_do3D_FIELD( n_pts[0], n_pts[1], E_gam__GeV_lims, E_e__GeV_lims,
-                              FIELD_num[i], FIELD_lim[i], T_FIELD_min__K[i], T_FIELD_max__K[i], Delta_T__K[i], ICo.do_3D_IC[j][i] );
-
-            if (cobjint == 1)
+            FIELD_num[i]( T_FIELD_min__K[i], T_FIELD_max__K[i], Delta_T__K[i], &nf );
+            FIELD_lim[i]( T_FIELD_min__K[i], T_FIELD_max__K[i], f_lim );
+
+            key = table_key_init( IC_kind[j], TABLE_KERNEL_VERSION_IC );
+            table_key_add_string( &key, dndEphot3D_name[i] );
+            table_key_add_size( &key, nf );
+            table_key_add_doubles( &key, 2, f_lim );
+            table_key_add_size( &key, n_pts[0] );
+            table_key_add_size( &key, n_pts[1] );
+            table_key_add_doubles( &key, 2, E_gam__GeV_lims );
+            table_key_add_doubles( &key, 2, E_e__GeV_lims );
+            table_key_add_doubles( &key, 2, E_phot__GeV_lims );
+            filename = table_store_path( datadir, files_do3D_stems[j][i], key, ".bin" );
+
+            if (store_read_do3D( filename, n_pts, nf, E_gam__GeV_lims, E_e__GeV_lims, f_lim, &(ICo.do_3D_IC[j][i]) ) == 1)
             {
-                printf("Trying to calc/write file %s\n", filename);
-                fflush(stdout);
-                ICo.do_3D_IC[j][i] = do3D_IC( init_do_2D_IC_version[i], dndEphot3D[i], FIELD_num[i], FIELD_lim[i], 
-                    T_FIELD_min__K[i], T_FIELD_max__K[i], Delta_T__K[i], E_gam__GeV_lims, E_e__GeV_lims, E_phot__GeV_lims, n_pts );
-                write_do3D( ICo.do_3D_IC[j][i], filename );
+                lockfd = table_store_lock( filename );
+                if (store_read_do3D( filename, n_pts, nf, E_gam__GeV_lims, E_e__GeV_lims, f_lim, &(ICo.do_3D_IC[j][i]) ) == 1)
+                {
+                    printf("Trying to calc/write file %s\n", filename);
+                    fflush(stdout);
+                    ICo.do_3D_IC[j][i] = do3D_IC( init_do_2D_IC_version[j], dndEphot3D[i], FIELD_num[i], FIELD_lim[i], 
+                        T_FIELD_min__K[i], T_FIELD_max__K[i], Delta_T__K[i], E_gam__GeV_lims, E_e__GeV_lims, E_phot__GeV_lims, n_pts );
+                    //Reopen the published table lazily so only the slices in use stay resident
+                    if (store_write_do3D( ICo.do_3D_IC[j][i], filename ) == 0)
+                    {
+                        data_object_3D_free( ICo.do_3D_IC[j][i] );
+                        ICo.do_3D_IC[j][i] = read_do3D_lazy( filename, DO3D_SLICE_CACHE_DEFAULT );
+                    }
+                }
+                table_store_unlock( filename, lockfd );
             }
             else
             {
                 printf("Successfully read and imported file %s\n", filename);
                 fflush(stdout);
             }
+            free( filename );
         }
     }
 
@@ -245,24 +330,27 @@ data_object_2D load_BS_do_files( size_t n_pts[2], double E_gam__GeV_lims[2], dou
 {
     data_object_2D do_2D_BS;
 
-    char file_BS_do2D[1][strlen(datadir)+12+1];
-    strcpy( file_BS_do2D[0], string_cat(datadir, "/BS_do2D.txt") );
+    table_key key = table_key_init( "BS", TABLE_KERNEL_VERSION_BS );
+    table_key_add_size( &key, n_pts[0] );
+    table_key_add_size( &key, n_pts[1] );
+    table_key_add_doubles( &key, 2, E_gam__GeV_lims );
+    table_key_add_doubles( &key, 2, E_e__GeV_lims );
 
-    unsigned short int cobjint;
-    char * filename;
+    int lockfd;
+    char * filename = table_store_path( datadir, "BS_do2D", key, ".txt" );
 
     //BS
-    filename = file_BS_do2D[0];
-    do_2D_BS = read_do2D( filename );
-
-    cobjint = check_do2D( n_pts[0], n_pts[1], E_gam__GeV_lims, E_e__GeV_lims, do_2D_BS );
-
-    if (cobjint == 1)
+    if (store_read_do2D( filename, n_pts, E_gam__GeV_lims, E_e__GeV_lims, &do_2D_BS ) == 1)
     {
-        printf("Trying to calc/write file %s\n", filename);
-        fflush(stdout);
-        do_2D_BS = init_do_2D_BS( E_gam__GeV_lims, E_e__GeV_lims, n_pts );;
-        write_do2D( do_2D_BS, filename );
+        lockfd = table_store_lock( filename );
+        if (store_read_do2D( filename, n_pts, E_gam__GeV_lims, E_e__GeV_lims, &do_2D_BS ) == 1)
+        {
+            printf("Trying to calc/write file %s\n", filename);
+            fflush(stdout);
+            do_2D_BS = init_do_2D_BS( E_gam__GeV_lims, E_e__GeV_lims, n_pts );
+            store_write_do2D( do_2D_BS, filename );
+        }
+        table_store_unlock( filename, lockfd );
     }
     else
     {
@@ -270,6 +358,7 @@ data_object_2D load_BS_do_files( size_t n_pts[2], double E_gam__GeV_lims[2], dou
         fflush(stdout);
     }
 
+    free( filename );
     return do_2D_BS;
 }
 
@@ -277,24 +366,25 @@ data_object_1D load_SY_do_files( size_t n_pts[1], double x_sync_lims[2], char *d
 {
     data_object_1D do_1D_SY;
 
-    char file_SY_do1D[1][strlen(datadir)+12+1];
-    strcpy( file_SY_do1D[0], string_cat(datadir, "/SY_do1D.txt") );
+    table_key key = table_key_init( "SY", TABLE_KERNEL_VERSION_SY );
+    table_key_add_size( &key, n_pts[0] );
+    table_key_add_doubles( &key, 2, x_sync_lims );
 
-    unsigned short int cobjint;
-    char * filename;
+    int lockfd;
+    char * filename = table_store_path( datadir, "SY_do1D", key, ".txt" );
 
     //SY
-    filename = file_SY_do1D[0];
-    do_1D_SY = read_do1D( filename );
-
-    cobjint = check_do1D( n_pts[0], x_sync_lims, do_1D_SY );
-
-    if (cobjint == 1)
+    if (store_read_do1D( filename, n_pts[0], x_sync_lims, &do_1D_SY ) == 1)
     {
-        printf("Trying to calc/write file %s\n", filename);
-        fflush(stdout);
-        do_1D_SY = init_do_1D_sync( x_sync_lims, n_pts[0] );
-        write_do1D( do_1D_SY, filename );
+        lockfd = table_store_lock( filename );
+        if (store_read_do1D( filename, n_pts[0], x_sync_lims, &do_1D_SY ) == 1)
+        {
+            printf("Trying to calc/write file %s\n", filename);
+            fflush(stdout);
+            do_1D_SY = init_do_1D_sync( x_sync_lims, n_pts[0] );
+            store_write_do1D( do_1D_SY, filename );
+        }
+        table_store_unlock( filename, lockfd );
     }
     else
     {
@@ -302,80 +392,23 @@ data_object_1D load_SY_do_files( size_t n_pts[1], double x_sync_lims[2], char *d
         fflush(stdout);
     }
 
+    free( filename );
     return do_1D_SY;
 }
 
 //intj is 0 for IC and 1 for IC_Gamma
+//Materialises the galaxy's IC table as a spline, for callers that need a gsl_spline_object_2D (the steady-state
+//solver); spectra can use IC_kernel directly and skip the per-galaxy copy
 gsl_spline_object_2D construct_IC_gso2D( unsigned short int intj, IC_object ICo, double * nphot_params )
 {
+    IC_kernel kern = IC_kernel_init( intj, ICo, nphot_params );
 
-    double C_dil_gal[5];
-
-    //Draine 3000K
-    C_dil_gal[0] = C_dil( u_rad_BB__GeVcmm3( 3000. ), L3000K__Lsol( nphot_params[2] ), nphot_params[4], nphot_params[5] );
-    //Draine 4000K
-    C_dil_gal[1] = C_dil( u_rad_BB__GeVcmm3( 4000. ),  L4000K__Lsol( nphot_params[2] ), nphot_params[4], nphot_params[5] );
-    //Draine 7500K
-    C_dil_gal[2] = C_dil( u_rad_BB__GeVcmm3( 7500. ), L7500K__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-    //Draine UV Mattis field
-    C_dil_gal[3] = C_dil( u_rad_UVMattis__GeVcmm3(), LUV__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-    //FIR field from dust
-    C_dil_gal[4] = C_dil( u_rad_modBB__GeVcmm3( nphot_params[1] ),  LFIR__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-
+    double * z_data = malloc(sizeof(double) * kern.nx * kern.ny);
+    IC_kernel_fill( &kern, z_data );
 
-    unsigned int i, j;
-
-    //CMB j = 0, FIR j = 1
-
-    double **z_data_CF = malloc(sizeof( *z_data_CF ) * 2);
-    if ( z_data_CF ){ for (i = 0; i < 2; i++){ z_data_CF[i] = malloc(sizeof( * z_data_CF[i] ) * ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny); } }
-
-
-    double *doub_int_array;
-    gsl_spline_object_1D gso1D_FIELD_array;
-    double posTFIELD;
-    int intTFIELD;
-    double fracTFIELD;
-
-    for (j = 0; j < 2; j++)
-    {
-        doub_int_array = malloc( sizeof(double) * ICo.do_3D_IC[intj][j].nf);
-        double_integer_array( 0, ICo.do_3D_IC[intj][j].nf-1, doub_int_array );
-
-        gso1D_FIELD_array = gsl_so1D( ICo.do_3D_IC[intj][j].nf, ICo.do_3D_IC[intj][j].f_data, doub_int_array );
-
-        posTFIELD = gsl_so1D_eval( gso1D_FIELD_array, nphot_params[j] );
-
-        intTFIELD = (int) floor(posTFIELD);
-        fracTFIELD = posTFIELD - (double) intTFIELD;
-
-    
-
-        for (i = 0; i < ICo.do_3D_IC[intj][j].nx * ICo.do_3D_IC[intj][j].ny; i++)
-        {
-            z_data_CF[j][i] = ICo.do_3D_IC[intj][j].z_data[intTFIELD][i] * fracTFIELD + 
-                           ICo.do_3D_IC[intj][j].z_data[intTFIELD+1][i] * (1.-fracTFIELD);
-        }
-        gsl_so1D_free( gso1D_FIELD_array );
-        free( doub_int_array );
-    }
-
-    double * z_data = malloc(sizeof(double) * ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny);
-
-
-    for (i = 0; i < ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny; i++)
-    {
-        z_data[i] = z_data_CF[0][i] + 
-                    C_dil_gal[4] * z_data_CF[1][i] + 
-                    C_dil_gal[0] * ICo.do_2D_IC[intj][0].z_data[i] + 
-                    C_dil_gal[1] * ICo.do_2D_IC[intj][1].z_data[i] + 
-                    C_dil_gal[2] * ICo.do_2D_IC[intj][2].z_data[i] + 
-                    C_dil_gal[3] * ICo.do_2D_IC[intj][3].z_data[i];
-    }
-
-    free2D( 2, z_data_CF );
-    gsl_spline_object_2D gso2D_out = gsl_so2D( ICo.do_3D_IC[intj][0].nx, ICo.do_3D_IC[intj][0].ny, ICo.do_3D_IC[intj][0].x_data, ICo.do_3D_IC[intj][0].y_data, z_data );
+    gsl_spline_object_2D gso2D_out = gsl_so2D( kern.nx, kern.ny, kern.x_data, kern.y_data, z_data );
     free( z_data );
+    IC_kernel_free( kern );
     return gso2D_out;
 }
 
@@ -384,99 +417,34 @@ void return_IC_gso2D( IC_object ICo, double * nphot_params,
                       gsl_spline_object_2D* gso2D_3000, gsl_spline_object_2D* gso2D_4000, gsl_spline_object_2D* gso2D_7500, 
                       gsl_spline_object_2D* gso2D_UV, gsl_spline_object_2D* gso2D_FIR, gsl_spline_object_2D* gso2D_CMB )
 {
-
-    double C_dil_gal[5];
-
-    //Draine 3000K
-    C_dil_gal[0] = C_dil( u_rad_BB__GeVcmm3( 3000. ), L3000K__Lsol( nphot_params[2] ), nphot_params[4], nphot_params[5] );
-    //Draine 4000K
-    C_dil_gal[1] = C_dil( u_rad_BB__GeVcmm3( 4000. ),  L4000K__Lsol( nphot_params[2] ), nphot_params[4], nphot_params[5] );
-    //Draine 7500K
-    C_dil_gal[2] = C_dil( u_rad_BB__GeVcmm3( 7500. ), L7500K__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-    //Draine UV Mattis field
-    C_dil_gal[3] = C_dil( u_rad_UVMattis__GeVcmm3(), LUV__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-    //FIR field from dust
-    C_dil_gal[4] = C_dil( u_rad_modBB__GeVcmm3( nphot_params[1] ),  LFIR__Lsol( nphot_params[3] ), nphot_params[4], nphot_params[5] );
-
-
-    unsigned int i, j;
     unsigned short int intj = 0;
-    //CMB j = 0, FIR j = 1
+    IC_kernel kern = IC_kernel_init( intj, ICo, nphot_params );
 
-    double **z_data_CF = malloc(sizeof( *z_data_CF ) * 2);
-    if ( z_data_CF ){ for (i = 0; i < 2; i++){ z_data_CF[i] = malloc(sizeof( * z_data_CF[i] ) * ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny); } }
+    //Kernel components making up each field: CMB and FIR are two temperature slices each
+    gsl_spline_object_2D* gso2D_field[6] = { gso2D_CMB, gso2D_FIR, gso2D_3000, gso2D_4000, gso2D_7500, gso2D_UV };
+    unsigned short int c_first[6] = { 0, 2, 4, 5, 6, 7 };
+    unsigned short int c_num[6] = { 2, 2, 1, 1, 1, 1 };
 
+    unsigned int i;
+    unsigned short int f, c;
 
-    double *doub_int_array;
-    gsl_spline_object_1D gso1D_FIELD_array;
-    double posTFIELD;
-    int intTFIELD;
-    double fracTFIELD;
+    double * z_data = malloc(sizeof(double) * kern.nx * kern.ny);
 
-    for (j = 0; j < 2; j++)
+    for (f = 0; f < 6; f++)
     {
-        doub_int_array = malloc( sizeof(double) * ICo.do_3D_IC[intj][j].nf);
-        double_integer_array( 0, ICo.do_3D_IC[intj][j].nf-1, doub_int_array );
-
-        gso1D_FIELD_array = gsl_so1D( ICo.do_3D_IC[intj][j].nf, ICo.do_3D_IC[intj][j].f_data, doub_int_array );
-
-        posTFIELD = gsl_so1D_eval( gso1D_FIELD_array, nphot_params[j] );
-
-        intTFIELD = (int) floor(posTFIELD);
-        fracTFIELD = posTFIELD - (double) intTFIELD;
-
-    
-
-        for (i = 0; i < ICo.do_3D_IC[intj][j].nx * ICo.do_3D_IC[intj][j].ny; i++)
+        for (i = 0; i < kern.nx * kern.ny; i++)
         {
-            z_data_CF[j][i] = ICo.do_3D_IC[intj][j].z_data[intTFIELD][i] * fracTFIELD + 
-                           ICo.do_3D_IC[intj][j].z_data[intTFIELD+1][i] * (1.-fracTFIELD);
+            z_data[i] = 0.;
+            for (c = c_first[f]; c < c_first[f] + c_num[f]; c++)
+            {
+                z_data[i] += kern.w[c] * kern.z[c][i];
+            }
         }
-        gsl_so1D_free( gso1D_FIELD_array );
-        free( doub_int_array );
-    }
-
-    double * z_data = malloc(sizeof(double) * ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny);
-
-    for (i = 0; i < ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny; i++)
-    {
-        z_data[i] = z_data_CF[0][i];
-    }
-    *gso2D_CMB = gsl_so2D( ICo.do_3D_IC[intj][0].nx, ICo.do_3D_IC[intj][0].ny, ICo.do_3D_IC[intj][0].x_data, ICo.do_3D_IC[intj][0].y_data, z_data );
-
-    for (i = 0; i < ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny; i++)
-    {
-        z_data[i] = C_dil_gal[4] * z_data_CF[1][i];
+        *(gso2D_field[f]) = gsl_so2D( kern.nx, kern.ny, kern.x_data, kern.y_data, z_data );
     }
-    *gso2D_FIR = gsl_so2D( ICo.do_3D_IC[intj][0].nx, ICo.do_3D_IC[intj][0].ny, ICo.do_3D_IC[intj][0].x_data, ICo.do_3D_IC[intj][0].y_data, z_data );
-
-    for (i = 0; i < ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny; i++)
-    {
-        z_data[i] = C_dil_gal[0] * ICo.do_2D_IC[intj][0].z_data[i];
-    }
-    *gso2D_3000 = gsl_so2D( ICo.do_3D_IC[intj][0].nx, ICo.do_3D_IC[intj][0].ny, ICo.do_3D_IC[intj][0].x_data, ICo.do_3D_IC[intj][0].y_data, z_data );
-
-    for (i = 0; i < ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny; i++)
-    {
-        z_data[i] = C_dil_gal[1] * ICo.do_2D_IC[intj][1].z_data[i];
-    }
-    *gso2D_4000 = gsl_so2D( ICo.do_3D_IC[intj][0].nx, ICo.do_3D_IC[intj][0].ny, ICo.do_3D_IC[intj][0].x_data, ICo.do_3D_IC[intj][0].y_data, z_data );
-
-    for (i = 0; i < ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny; i++)
-    {
-        z_data[i] = C_dil_gal[2] * ICo.do_2D_IC[intj][2].z_data[i];
-    }
-    *gso2D_7500 = gsl_so2D( ICo.do_3D_IC[intj][0].nx, ICo.do_3D_IC[intj][0].ny, ICo.do_3D_IC[intj][0].x_data, ICo.do_3D_IC[intj][0].y_data, z_data );
-
-    for (i = 0; i < ICo.do_3D_IC[intj][0].nx * ICo.do_3D_IC[intj][0].ny; i++)
-    {
-        z_data[i] = C_dil_gal[3] * ICo.do_2D_IC[intj][3].z_data[i];
-    }
-    *gso2D_UV = gsl_so2D( ICo.do_3D_IC[intj][0].nx, ICo.do_3D_IC[intj][0].ny, ICo.do_3D_IC[intj][0].x_data, ICo.do_3D_IC[intj][0].y_data, z_data );
-
 
-    free2D( 2, z_data_CF );
     free( z_data );
+    IC_kernel_free( kern );
     return;
 }
 
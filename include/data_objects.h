@@ -4,7 +4,13 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "astro_const.h"
 #include "CR_spectra/gal_rad.h"
@@ -40,6 +46,10 @@ void data_object_2D_free( data_object_2D do2D )
     free( do2D.z_data );
 }
 
+struct do3D_slice_caches;
+
+//z_data holds all nf slices when the object is fully in memory. Objects opened with read_do3D_lazy have
+//z_data NULL and page slices in on demand through slices; use do3D_slice_acquire/release to access either kind
 typedef struct data_obj_3Ds
 {
     size_t nx, ny, nf;
@@ -48,15 +58,147 @@ typedef struct data_obj_3Ds
     double *y_data;
     double *f_data;
     double **z_data;
+    struct do3D_slice_caches *slices;
 } data_object_3D;
 
 
+//Default number of decoded slices kept per lazily loaded 3D object. Pinned slices are never evicted, so the
+//cache can temporarily hold more than this when many threads are working on different temperatures
+#define DO3D_SLICE_CACHE_DEFAULT 8
+
+//Binary do3D layout: magic, nx ny nf (uint64), x_lim y_lim f_lim, x_data, y_data, f_data, then nf slices of nx*ny
+#define DO3D_BIN_MAGIC "CRDO3D01"
+
+typedef struct do3D_slice_caches
+{
+    int fd;
+    void *map;
+    size_t map_size;
+    size_t z_offset;
+    size_t n_slice;
+    size_t nf;
+    size_t capacity;
+    size_t n_resident;
+    double **slot;
+    unsigned int *pins;
+    unsigned long *last_use;
+    unsigned long clock;
+    pthread_mutex_t lock;
+} do3D_slice_cache;
+
+void do3D_slice_cache_free( do3D_slice_cache *cache )
+{
+    size_t k;
+    for (k = 0; k < cache->nf; k++)
+    {
+        free( cache->slot[k] );
+    }
+    free( cache->slot );
+    free( cache->pins );
+    free( cache->last_use );
+    munmap( cache->map, cache->map_size );
+    close( cache->fd );
+    pthread_mutex_destroy( &(cache->lock) );
+    free( cache );
+}
+
+//Returns slice k (nx*ny values, z[j*nx+i]) and pins it until the matching do3D_slice_release
+const double *do3D_slice_acquire( data_object_3D do3D, size_t k )
+{
+    if (k >= do3D.nf)
+    {
+        printf("Error: slice %zu out of range for 3D object with %zu slices\n", k, do3D.nf);
+        return NULL;
+    }
+    if (do3D.slices == NULL)
+    {
+        return do3D.z_data[k];
+    }
+
+    do3D_slice_cache *cache = do3D.slices;
+    size_t m, victim;
+    long page = sysconf(_SC_PAGESIZE);
+    uintptr_t start, end;
+    double *slice;
+
+    pthread_mutex_lock( &(cache->lock) );
+
+    if (cache->slot[k] == NULL)
+    {
+        //Evict the least recently used unpinned slices to stay within capacity
+        while (cache->n_resident >= cache->capacity)
+        {
+            victim = cache->nf;
+            for (m = 0; m < cache->nf; m++)
+            {
+                if (cache->slot[m] != NULL && cache->pins[m] == 0 && (victim == cache->nf || cache->last_use[m] < cache->last_use[victim]))
+                {
+                    victim = m;
+                }
+            }
+            if (victim == cache->nf){ break; }
+            free( cache->slot[victim] );
+            cache->slot[victim] = NULL;
+            cache->n_resident--;
+        }
+
+        slice = malloc( sizeof(double) * cache->n_slice );
+        memcpy( slice, (char *)cache->map + cache->z_offset + sizeof(double) * cache->n_slice * k, sizeof(double) * cache->n_slice );
+
+        //Drop the mapped pages again so only the decoded copies count towards resident memory
+        start = (uintptr_t)cache->map + cache->z_offset + sizeof(double) * cache->n_slice * k;
+        end = start + sizeof(double) * cache->n_slice;
+        start = (start + page - 1) & ~((uintptr_t)page - 1);
+        end = end & ~((uintptr_t)page - 1);
+        if (end > start){ madvise( (void *)start, end - start, MADV_DONTNEED ); }
+
+        cache->slot[k] = slice;
+        cache->n_resident++;
+    }
+
+    cache->pins[k]++;
+    cache->last_use[k] = ++(cache->clock);
+    slice = cache->slot[k];
+
+    pthread_mutex_unlock( &(cache->lock) );
+    return slice;
+}
+
+void do3D_slice_release( data_object_3D do3D, size_t k )
+{
+    if (do3D.slices == NULL || k >= do3D.nf){ return; }
+    pthread_mutex_lock( &(do3D.slices->lock) );
+    if (do3D.slices->pins[k] > 0){ do3D.slices->pins[k]--; }
+    pthread_mutex_unlock( &(do3D.slices->lock) );
+}
+
+//Number of decoded slices currently held, 0 for fully loaded objects
+size_t do3D_resident_slices( data_object_3D do3D )
+{
+    size_t n;
+    if (do3D.slices == NULL){ return 0; }
+    pthread_mutex_lock( &(do3D.slices->lock) );
+    n = do3D.slices->n_resident;
+    pthread_mutex_unlock( &(do3D.slices->lock) );
+    return n;
+}
+
+void do3D_set_slice_capacity( data_object_3D do3D, size_t capacity )
+{
+    if (do3D.slices == NULL){ return; }
+    pthread_mutex_lock( &(do3D.slices->lock) );
+    do3D.slices->capacity = capacity > 0 ? capacity : 1;
+    pthread_mutex_unlock( &(do3D.slices->lock) );
+}
+
+
 void data_object_3D_free( data_object_3D do3D )
 {
     free( do3D.x_data );
     free( do3D.y_data );
     free( do3D.f_data );
-    free2D( do3D.nf, do3D.z_data );
+    if (do3D.z_data != NULL){ free2D( do3D.nf, do3D.z_data ); }
+    if (do3D.slices != NULL){ do3D_slice_cache_free( do3D.slices ); }
 }
 
 
@@ -87,7 +229,7 @@ void IC_object_free( IC_object ICo )
 int write_do1D( data_object_1D do1D, char * filename )
 {
     FILE * outfile;
-    short int cfint;
+    short int cfint = 0;
 //    unsigned short int fw;
     unsigned int i;
      
@@ -113,7 +255,11 @@ int write_do1D( data_object_1D do1D, char * filename )
         }
         fprintf( outfile, "\n" );
 
-        fclose( outfile );
+        if (fclose( outfile ) != 0)
+        {
+            printf("Error writing file %s: can't flush output file\n", filename);
+            cfint = 1;
+        }
     }
 
     return cfint;
@@ -123,7 +269,7 @@ int write_do1D( data_object_1D do1D, char * filename )
 int write_do2D( data_object_2D do2D, char * filename )
 {
     FILE * outfile;
-    short int cfint;
+    short int cfint = 0;
 //    unsigned short int fw;
     unsigned int i;
      
@@ -156,7 +302,11 @@ int write_do2D( data_object_2D do2D, char * filename )
         }
         fprintf( outfile, "\n" );
 
-        fclose( outfile );
+        if (fclose( outfile ) != 0)
+        {
+            printf("Error writing file %s: can't flush output file\n", filename);
+            cfint = 1;
+        }
     }
 
     return cfint;
@@ -166,7 +316,7 @@ int write_do2D( data_object_2D do2D, char * filename )
 int write_do3D( data_object_3D do3D, char * filename )
 {
     FILE * outfile;
-    short int cfint;
+    short int cfint = 0;
 //    unsigned short int fw;
     unsigned int i,j;
      
@@ -202,14 +352,20 @@ int write_do3D( data_object_3D do3D, char * filename )
         fprintf( outfile, "\n" );
         for (j = 0; j < do3D.nf; j++)
         {
+            const double *slice = do3D_slice_acquire( do3D, j );
             for (i = 0; i < do3D.nx * do3D.ny; i++)
             {
-                fprintf( outfile, "%le ", do3D.z_data[j][i] );
+                fprintf( outfile, "%le ", slice[i] );
             }
+            do3D_slice_release( do3D, j );
         }
         fprintf( outfile, "\n" );
 
-        fclose( outfile );
+        if (fclose( outfile ) != 0)
+        {
+            printf("Error writing file %s: can't flush output file\n", filename);
+            cfint = 1;
+        }
     }
     return cfint;
 }
@@ -356,6 +512,7 @@ data_object_3D read_do3D( char * filename )
             do3D.f_data = malloc(sizeof(double) * do3D.nf);
             do3D.z_data = malloc(sizeof *do3D.z_data * do3D.nf);
             if (do3D.z_data){for (i = 0; i < do3D.nf; i++){do3D.z_data[i] = malloc(sizeof *do3D.z_data[i] * do3D.nx * do3D.ny);}}
+            do3D.slices = NULL;
 
             for (i = 0; i < do3D.nx; i++)
             {
@@ -391,6 +548,132 @@ data_object_3D read_do3D( char * filename )
     return do3D;
 }
 
+int write_do3D_bin( data_object_3D do3D, char * filename )
+{
+    FILE * outfile;
+    short int cfint = 0;
+    uint64_t dims[3] = { do3D.nx, do3D.ny, do3D.nf };
+    const double *slice;
+    size_t k;
+
+    outfile = fopen( filename, "wb" );
+    if (outfile == NULL)
+    {
+        printf("Error writing file %s: can't open output file\n", filename);
+        return 1;
+    }
+
+    fwrite( DO3D_BIN_MAGIC, 1, 8, outfile );
+    fwrite( dims, sizeof(uint64_t), 3, outfile );
+    fwrite( do3D.x_lim, sizeof(double), 2, outfile );
+    fwrite( do3D.y_lim, sizeof(double), 2, outfile );
+    fwrite( do3D.f_lim, sizeof(double), 2, outfile );
+    fwrite( do3D.x_data, sizeof(double), do3D.nx, outfile );
+    fwrite( do3D.y_data, sizeof(double), do3D.ny, outfile );
+    fwrite( do3D.f_data, sizeof(double), do3D.nf, outfile );
+    for (k = 0; k < do3D.nf; k++)
+    {
+        slice = do3D_slice_acquire( do3D, k );
+        if (slice == NULL || fwrite( slice, sizeof(double), do3D.nx * do3D.ny, outfile ) != do3D.nx * do3D.ny){ cfint = 1; }
+        do3D_slice_release( do3D, k );
+    }
+
+    if (ferror( outfile ) || fclose( outfile ) != 0 || cfint != 0)
+    {
+        printf("Error writing file %s: incomplete output\n", filename);
+        cfint = 1;
+    }
+    return cfint;
+}
+
+//Opens a binary do3D file written by write_do3D_bin. Axes are read straight away, the nf temperature
+//slices stay on disk (mmap) and are decoded on first use, keeping at most max_slices unpinned ones
+data_object_3D read_do3D_lazy( char * filename, size_t max_slices )
+{
+    data_object_3D do3D;
+    struct stat st;
+    uint64_t dims[3];
+    const char *p;
+    size_t header, k;
+    int fd;
+    void *map;
+
+    memset( &do3D, 0, sizeof(do3D) );
+
+    fd = open( filename, O_RDONLY );
+    if (fd < 0)
+    {
+        printf( "File %s doesn't exist\n", filename);
+        return do3D;
+    }
+    if (fstat( fd, &st ) != 0 || (size_t)st.st_size < 8 + 3 * sizeof(uint64_t) + 6 * sizeof(double))
+    {
+        printf( "Error opening file %s: truncated header\n", filename);
+        close( fd );
+        return do3D;
+    }
+    map = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    if (map == MAP_FAILED)
+    {
+        printf( "Error opening file %s: can't map file\n", filename);
+        close( fd );
+        return do3D;
+    }
+
+    p = (const char *)map;
+    memcpy( dims, p + 8, sizeof(dims) );
+    header = 8 + sizeof(dims) + 6 * sizeof(double) + sizeof(double) * (dims[0] + dims[1] + dims[2]);
+    if (memcmp( p, DO3D_BIN_MAGIC, 8 ) != 0 || (size_t)st.st_size != header + sizeof(double) * dims[0] * dims[1] * dims[2])
+    {
+        printf( "Error opening file %s: not a binary do3D file or wrong size\n", filename);
+        munmap( map, st.st_size );
+        close( fd );
+        return do3D;
+    }
+
+    do3D.nx = dims[0];
+    do3D.ny = dims[1];
+    do3D.nf = dims[2];
+    p += 8 + sizeof(dims);
+    memcpy( do3D.x_lim, p, 2 * sizeof(double) ); p += 2 * sizeof(double);
+    memcpy( do3D.y_lim, p, 2 * sizeof(double) ); p += 2 * sizeof(double);
+    memcpy( do3D.f_lim, p, 2 * sizeof(double) ); p += 2 * sizeof(double);
+
+    do3D.x_data = malloc( sizeof(double) * do3D.nx );
+    do3D.y_data = malloc( sizeof(double) * do3D.ny );
+    do3D.f_data = malloc( sizeof(double) * do3D.nf );
+    memcpy( do3D.x_data, p, sizeof(double) * do3D.nx ); p += sizeof(double) * do3D.nx;
+    memcpy( do3D.y_data, p, sizeof(double) * do3D.ny ); p += sizeof(double) * do3D.ny;
+    memcpy( do3D.f_data, p, sizeof(double) * do3D.nf );
+    do3D.z_data = NULL;
+
+    do3D_slice_cache *cache = malloc( sizeof(do3D_slice_cache) );
+    cache->fd = fd;
+    cache->map = map;
+    cache->map_size = st.st_size;
+    cache->z_offset = header;
+    cache->n_slice = do3D.nx * do3D.ny;
+    cache->nf = do3D.nf;
+    cache->capacity = max_slices > 0 ? max_slices : 1;
+    cache->n_resident = 0;
+    cache->slot = malloc( sizeof(double *) * do3D.nf );
+    cache->pins = malloc( sizeof(unsigned int) * do3D.nf );
+    cache->last_use = malloc( sizeof(unsigned long) * do3D.nf );
+    for (k = 0; k < do3D.nf; k++)
+    {
+        cache->slot[k] = NULL;
+        cache->pins[k] = 0;
+        cache->last_use[k] = 0;
+    }
+    cache->clock = 0;
+    pthread_mutex_init( &(cache->lock), NULL );
+    //The slices are read once each, in no particular order
+    madvise( map, st.st_size, MADV_RANDOM );
+    do3D.slices = cache;
+
+    return do3D;
+}
+
 int check_do1D( size_t nx, double x_lim[2], data_object_1D do1D )
 {
     if ( do1D.nx == nx && abs(1. - do1D.x_lim[0]/x_lim[0]) < 1.e-6 && abs(1. - do1D.x_lim[1]/x_lim[1]) < 1.e-6 )
@@ -6,6 +6,8 @@
 //#include <stdlib.h>
 #include <math.h>
 
+#include "npy_io.h"
+
 //#include "astro_const.h"
 //#include "gal_rad.h"
 
@@ -119,8 +121,93 @@ void write_2D_spec_file( unsigned int n_gal, unsigned int n_E, double **data, do
 }
 
 
+/*
+ * Binary versions of write_2D_file and write_2D_spec_file: a (nx, ny) .npy array, written a row at a time
+ * through a large stdio buffer instead of one fprintf per value. single_precision writes float32 ("<f4")
+ */
+
+#define NPY_WRITE_BUFSIZE (1 << 22)
+
+static FILE *open_npy_2D( unsigned int nx, unsigned int ny, int single_precision, char *filepath )
+{
+    size_t shape[2] = { nx, ny };
+    FILE *outfile = fopen( filepath, "wb" );
+    if (outfile == NULL)
+    {
+        printf("Error writing file %s: can't open output file\n", filepath);
+        return NULL;
+    }
+    setvbuf( outfile, NULL, _IOFBF, NPY_WRITE_BUFSIZE );
+    if (npy_write_header( outfile, single_precision ? "<f4" : "<f8", 2, shape ))
+    {
+        fclose( outfile );
+        printf("Error writing file %s: incomplete output\n", filepath);
+        return NULL;
+    }
+    return outfile;
+}
+
+// Write one row of n values from row, as float32 if single_precision (row_f is scratch space for n floats)
+static int write_npy_row( FILE *outfile, unsigned int n, const double *row, float *row_f, int single_precision )
+{
+    unsigned int j;
+    if (!single_precision){ return fwrite( row, sizeof(double), n, outfile ) != n; }
+    for (j = 0; j < n; j++){ row_f[j] = (float) row[j]; }
+    return fwrite( row_f, sizeof(float), n, outfile ) != n;
+}
 
+static int close_npy_2D( FILE *outfile, int err, char *filepath )
+{
+    if (fclose( outfile ) != 0){ err = 1; }
+    if (err){ printf("Error writing file %s: incomplete output\n", filepath); }
+    else { printf("Successfully written file %s\n", filepath); }
+    free( filepath );
+    return err;
+}
 
+int write_2D_npy( unsigned int nx, unsigned int ny, double **data, int single_precision, char *filepath )
+{
+    unsigned int i;
+    int err = 0;
+    FILE *outfile = open_npy_2D( nx, ny, single_precision, filepath );
+    if (outfile == NULL){ free( filepath ); return 1; }
+
+    float *row_f = malloc( sizeof(float) * ny );
+    for (i = 0; i < nx && err == 0; i++)
+    {
+        err = write_npy_row( outfile, ny, data[i], row_f, single_precision );
+    }
+    free( row_f );
+    return close_npy_2D( outfile, err, filepath );
+}
+
+int write_2D_spec_npy( unsigned int n_gal, unsigned int n_E, double **data, double *E__GeV, double **tau_gg, double **tau_EBL, double *distmod, int single_precision, char *filepath )
+{
+    unsigned int i, j;
+    int err = 0;
+    FILE *outfile = open_npy_2D( n_gal, n_E, single_precision, filepath );
+    if (outfile == NULL){ free( filepath ); return 1; }
+
+    double *E2 = malloc( sizeof(double) * n_E );
+    double *row = malloc( sizeof(double) * n_E );
+    float *row_f = malloc( sizeof(float) * n_E );
+    for (j = 0; j < n_E; j++){ E2[j] = E__GeV[j] * E__GeV[j]; }
+
+    for (i = 0; i < n_gal && err == 0; i++)
+    {
+        // One exp for both attenuations
+        for (j = 0; j < n_E; j++)
+        {
+            row[j] = data[i][j] * exp( -(tau_gg[i][j] + tau_EBL[i][j]) ) * distmod[i] * E2[j];
+        }
+        err = write_npy_row( outfile, n_E, row, row_f, single_precision );
+    }
+
+    free( E2 );
+    free( row );
+    free( row_f );
+    return close_npy_2D( outfile, err, filepath );
+}
 
 
 
@@ -75,6 +75,18 @@ static inline void gsl_so1D_free(gsl_spline_object_1D so) {
     if (so.acc) gsl_interp_accel_free(so.acc);
 }
 
+/**
+ * Accelerator-free copy of a 1D spline object, for evaluating one spline from
+ * several threads at once (GSL accelerators cache the last interval and are not
+ * thread-safe). Lookups fall back to bisection. Shares the spline, do not free.
+ * @param so Spline object
+ * @return Copy without accelerator
+ */
+static inline gsl_spline_object_1D gsl_so1D_shared(gsl_spline_object_1D so) {
+    so.acc = NULL;
+    return so;
+}
+
 /**
  * Create a 2D GSL spline object from arrays
  * @param nx Number of x data points
@@ -132,4 +144,15 @@ static inline void gsl_so2D_free(gsl_spline_object_2D so) {
     if (so.yacc) gsl_interp_accel_free(so.yacc);
 }
 
+/**
+ * Accelerator-free copy of a 2D spline object, as gsl_so1D_shared
+ * @param so Spline object
+ * @return Copy without accelerators
+ */
+static inline gsl_spline_object_2D gsl_so2D_shared(gsl_spline_object_2D so) {
+    so.xacc = NULL;
+    so.yacc = NULL;
+    return so;
+}
+
 #endif /* GSL_DECS_H */
@@ -0,0 +1,296 @@
+/**
+ * Hot-path instrumentation: site and stage registries, per-thread counters
+ */
+
+#include "instrument.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct instr_threads
+{
+    int id;
+    instr_site_counters sites[INSTR_MAX_SITES];
+    instr_stage_counters stages[INSTR_MAX_STAGES];
+    instr_trace_event *trace;
+    size_t n_trace, trace_capacity;
+    uint64_t dropped;
+    struct instr_threads *next;
+} instr_thread;
+
+static pthread_mutex_t instr_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *site_func[INSTR_MAX_SITES];
+static const char *site_integrand[INSTR_MAX_SITES];
+static int n_sites = 0;
+
+static const char *stage_name[INSTR_MAX_STAGES];
+static int n_stages = 0;
+
+static instr_thread *threads = NULL;
+static int n_threads = 0;
+static size_t trace_capacity = INSTR_TRACE_CAPACITY_DEFAULT;
+
+static __thread instr_thread *self = NULL;
+
+uint64_t instr_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// This thread's counters, created and linked into the list on first use
+static instr_thread *instr_self(void)
+{
+    if (self == NULL)
+    {
+        instr_thread *t = calloc( 1, sizeof(instr_thread) );
+        if (t == NULL){ abort(); }
+        pthread_mutex_lock( &instr_lock );
+        t->id = n_threads++;
+        t->trace_capacity = trace_capacity;
+        t->next = threads;
+        threads = t;
+        pthread_mutex_unlock( &instr_lock );
+        self = t;
+    }
+    return self;
+}
+
+int instr_site_register(const char *func, const char *integrand)
+{
+    int i;
+    pthread_mutex_lock( &instr_lock );
+    for (i = 0; i < n_sites; i++)
+    {
+        if (strcmp( site_func[i], func ) == 0 && strcmp( site_integrand[i], integrand ) == 0){ break; }
+    }
+    if (i == n_sites)
+    {
+        if (n_sites < INSTR_MAX_SITES - 1)
+        {
+            site_func[i] = func;
+            site_integrand[i] = integrand;
+            n_sites++;
+        }
+        else
+        {
+            i = INSTR_MAX_SITES - 1;
+            site_func[i] = "(other)";
+            site_integrand[i] = "(other)";
+            n_sites = INSTR_MAX_SITES;
+        }
+    }
+    pthread_mutex_unlock( &instr_lock );
+    return i;
+}
+
+int instr_stage_register(const char *name)
+{
+    int i;
+    pthread_mutex_lock( &instr_lock );
+    for (i = 0; i < n_stages; i++)
+    {
+        if (strcmp( stage_name[i], name ) == 0){ break; }
+    }
+    if (i == n_stages)
+    {
+        if (n_stages < INSTR_MAX_STAGES - 1)
+        {
+            stage_name[i] = name;
+            n_stages++;
+        }
+        else
+        {
+            i = INSTR_MAX_STAGES - 1;
+            stage_name[i] = "(other)";
+            n_stages = INSTR_MAX_STAGES;
+        }
+    }
+    pthread_mutex_unlock( &instr_lock );
+    return i;
+}
+
+// Integrand wrapper: counts the points of one integral before handing them on
+typedef struct instr_integrands
+{
+    integrand_v f;
+    void *fdata;
+    uint64_t points, batches;
+} instr_integrand;
+
+static int instr_integrand_v( unsigned ndim, size_t npts, const double *x, void *fdata, unsigned fdim, double *fval )
+{
+    instr_integrand *w = (instr_integrand *) fdata;
+    w->points += npts;
+    w->batches++;
+    return w->f( ndim, npts, x, w->fdata, fdim, fval );
+}
+
+// Points per region of hcubature's rules: 15-point Gauss-Kronrod in 1D, degree 7/5 Genz-Malik otherwise
+static uint64_t instr_rule_points( unsigned dim )
+{
+    if (dim <= 1){ return 15; }
+    return 1 + 4 * dim + 2 * dim * (dim - 1) + ((uint64_t) 1 << dim);
+}
+
+int instr_hcubature_v(int site, unsigned fdim, integrand_v f, void *fdata, unsigned dim, const double *xmin,
+                      const double *xmax, size_t maxEval, double reqAbsError, double reqRelError, error_norm norm,
+                      double *val, double *err)
+{
+    instr_integrand w = { f, fdata, 0, 0 };
+    precision_profile p = precision_current();
+    uint64_t t0 = instr_now_ns();
+    int status = precision_hcubature_v( fdim, instr_integrand_v, &w, dim, xmin, xmax, maxEval, reqAbsError,
+                                        reqRelError, norm, val, err );
+    uint64_t dt = instr_now_ns() - t0;
+
+    if (p.fixed_panels > 0)
+    {
+        instr_site_record( site, w.points, w.batches, 1, 0, dt );
+    }
+    else
+    {
+        size_t cap = (p.max_eval > 0) ? p.max_eval : maxEval;
+        instr_site_record( site, w.points, w.batches, w.points / instr_rule_points( dim ), cap > 0 && w.points >= cap,
+                           dt );
+    }
+    return status;
+}
+
+void instr_site_record(int site, uint64_t points, uint64_t batches, uint64_t regions, int capped, uint64_t ns)
+{
+    instr_site_counters *c = &instr_self()->sites[site];
+    c->integrals++;
+    c->points += points;
+    c->batches += batches;
+    c->regions += regions;
+    if (capped){ c->capped++; }
+    c->ns += ns;
+}
+
+instr_stage_timer instr_stage_begin(int stage)
+{
+    instr_stage_timer timer = { stage, instr_now_ns() };
+    return timer;
+}
+
+void instr_stage_end(const instr_stage_timer *timer)
+{
+    uint64_t dt = instr_now_ns() - timer->begin_ns;
+    instr_thread *t = instr_self();
+    t->stages[timer->stage].calls++;
+    t->stages[timer->stage].ns += dt;
+
+    if (t->trace_capacity == 0){ return; }
+    if (t->trace == NULL)
+    {
+        t->trace = malloc( sizeof(instr_trace_event) * t->trace_capacity );
+        if (t->trace == NULL){ t->trace_capacity = 0; t->dropped++; return; }
+    }
+    if (t->n_trace == t->trace_capacity){ t->dropped++; return; }
+    instr_trace_event ev = { timer->stage, t->id, timer->begin_ns, dt };
+    t->trace[t->n_trace++] = ev;
+}
+
+int instr_n_sites(void)
+{
+    return n_sites;
+}
+
+const char *instr_site_func(int site)
+{
+    return site_func[site];
+}
+
+const char *instr_site_integrand(int site)
+{
+    return site_integrand[site];
+}
+
+void instr_site_totals(int site, instr_site_counters *out)
+{
+    instr_thread *t;
+    memset( out, 0, sizeof(*out) );
+    pthread_mutex_lock( &instr_lock );
+    for (t = threads; t != NULL; t = t->next)
+    {
+        out->integrals += t->sites[site].integrals;
+        out->points += t->sites[site].points;
+        out->batches += t->sites[site].batches;
+        out->regions += t->sites[site].regions;
+        out->capped += t->sites[site].capped;
+        out->ns += t->sites[site].ns;
+    }
+    pthread_mutex_unlock( &instr_lock );
+}
+
+int instr_n_stages(void)
+{
+    return n_stages;
+}
+
+const char *instr_stage_name(int stage)
+{
+    return stage_name[stage];
+}
+
+void instr_stage_totals(int stage, instr_stage_counters *out)
+{
+    instr_thread *t;
+    memset( out, 0, sizeof(*out) );
+    pthread_mutex_lock( &instr_lock );
+    for (t = threads; t != NULL; t = t->next)
+    {
+        out->calls += t->stages[stage].calls;
+        out->ns += t->stages[stage].ns;
+    }
+    pthread_mutex_unlock( &instr_lock );
+}
+
+size_t instr_trace_events(instr_trace_event *out, size_t n_max)
+{
+    instr_thread *t;
+    size_t n = 0, k;
+    pthread_mutex_lock( &instr_lock );
+    for (t = threads; t != NULL; t = t->next)
+    {
+        for (k = 0; k < t->n_trace; k++, n++)
+        {
+            if (out != NULL && n < n_max){ out[n] = t->trace[k]; }
+        }
+    }
+    pthread_mutex_unlock( &instr_lock );
+    return n;
+}
+
+uint64_t instr_trace_dropped(void)
+{
+    instr_thread *t;
+    uint64_t n = 0;
+    pthread_mutex_lock( &instr_lock );
+    for (t = threads; t != NULL; t = t->next){ n += t->dropped; }
+    pthread_mutex_unlock( &instr_lock );
+    return n;
+}
+
+void instr_reset(size_t capacity)
+{
+    instr_thread *t;
+    pthread_mutex_lock( &instr_lock );
+    trace_capacity = capacity;
+    for (t = threads; t != NULL; t = t->next)
+    {
+        memset( t->sites, 0, sizeof(t->sites) );
+        memset( t->stages, 0, sizeof(t->stages) );
+        free( t->trace );
+        t->trace = NULL;
+        t->n_trace = 0;
+        t->trace_capacity = capacity;
+        t->dropped = 0;
+    }
+    pthread_mutex_unlock( &instr_lock );
+}
@@ -0,0 +1,151 @@
+/**
+ * Hot-path instrumentation
+ * Compiled in with -DSPECTRA_INSTRUMENT; otherwise HCUBATURE_V is plain
+ * precision_hcubature_v (precision.h) and the stage macros expand to nothing.
+ *
+ * Every HCUBATURE_V call site (enclosing function and integrand) counts its
+ * integrals, integrand points and batches, cubature regions, the integrals
+ * that ran into their maxEval cap, and the time spent in them. Stages named
+ * with INSTR_STAGE_BEGIN/END are timed, and each run of a stage is kept as a
+ * trace event for a Chrome trace. Counters live in per-thread blocks that
+ * are written without locks and summed when read.
+ */
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cubature.h>
+#include "precision.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INSTR_MAX_SITES 256
+#define INSTR_MAX_STAGES 128
+#define INSTR_TRACE_CAPACITY_DEFAULT (1 << 18)
+
+typedef struct instr_site_counters
+{
+    uint64_t integrals;  // hcubature_v calls
+    uint64_t points;     // integrand points
+    uint64_t batches;    // integrand calls, each on a batch of points
+    uint64_t regions;    // cubature regions evaluated (the first one plus two per subdivision, one for a fixed-order rule)
+    uint64_t capped;     // integrals that stopped at their maxEval (after the profile) instead of converging
+    uint64_t ns;         // time in the integrals, including nested ones
+} instr_site_counters;
+
+typedef struct instr_stage_counters
+{
+    uint64_t calls;
+    uint64_t ns;
+} instr_stage_counters;
+
+typedef struct instr_trace_event
+{
+    int stage;
+    int thread;
+    uint64_t begin_ns;
+    uint64_t dur_ns;
+} instr_trace_event;
+
+typedef struct instr_stage_timer
+{
+    int stage;
+    uint64_t begin_ns;
+} instr_stage_timer;
+
+// Monotonic clock [ns]
+uint64_t instr_now_ns(void);
+
+/**
+ * Index of a call site, registered on first use
+ * @param func Enclosing function
+ * @param integrand Integrand name
+ * @return Site index, the last site collects any beyond INSTR_MAX_SITES
+ */
+int instr_site_register(const char *func, const char *integrand);
+
+/**
+ * Index of a stage, registered on first use
+ * @param name Stage name
+ * @return Stage index, the last stage collects any beyond INSTR_MAX_STAGES
+ */
+int instr_stage_register(const char *name);
+
+// precision_hcubature_v, counted against site
+int instr_hcubature_v(int site, unsigned fdim, integrand_v f, void *fdata, unsigned dim, const double *xmin,
+                      const double *xmax, size_t maxEval, double reqAbsError, double reqRelError, error_norm norm,
+                      double *val, double *err);
+
+/**
+ * Count one integral computed without instr_hcubature_v (the templated engine, integrate.h) against site
+ * @param site Site index
+ * @param points Integrand points
+ * @param batches Integrand calls or rule evaluations
+ * @param regions Regions evaluated
+ * @param capped Nonzero if the integral stopped at its maxEval
+ * @param ns Time in the integral
+ */
+void instr_site_record(int site, uint64_t points, uint64_t batches, uint64_t regions, int capped, uint64_t ns);
+
+instr_stage_timer instr_stage_begin(int stage);
+void instr_stage_end(const instr_stage_timer *timer);
+
+/*
+ * Reading the counters. Totals are summed over every thread that has recorded anything, including threads that
+ * have since exited; read and reset them while no computation is running
+ */
+int instr_n_sites(void);
+const char *instr_site_func(int site);
+const char *instr_site_integrand(int site);
+void instr_site_totals(int site, instr_site_counters *out);
+
+int instr_n_stages(void);
+const char *instr_stage_name(int stage);
+void instr_stage_totals(int stage, instr_stage_counters *out);
+
+/**
+ * Copy the recorded trace events of all threads
+ * @param out Destination, may be NULL
+ * @param n_max Room in out
+ * @return Number of recorded events (copies the first n_max)
+ */
+size_t instr_trace_events(instr_trace_event *out, size_t n_max);
+// Events not recorded because a thread's trace buffer was full
+uint64_t instr_trace_dropped(void);
+
+/**
+ * Zero every counter and empty the trace buffers
+ * @param trace_capacity Trace events kept per thread from now on (0 turns tracing off)
+ */
+void instr_reset(size_t trace_capacity);
+
+#ifdef SPECTRA_INSTRUMENT
+
+// Site or stage index, looked up once per call site
+#define INSTR_ID_(register_call) __extension__ ({ \
+    static int instr_id_ = -1; \
+    int id_ = __atomic_load_n(&instr_id_, __ATOMIC_RELAXED); \
+    if (id_ < 0) { id_ = (register_call); __atomic_store_n(&instr_id_, id_, __ATOMIC_RELAXED); } \
+    id_; })
+
+#define HCUBATURE_V(fdim, f, ...) instr_hcubature_v(INSTR_ID_(instr_site_register(__func__, #f)), fdim, f, __VA_ARGS__)
+#define INSTR_STAGE_BEGIN(timer, name) instr_stage_timer timer = instr_stage_begin(INSTR_ID_(instr_stage_register(name)))
+#define INSTR_STAGE_END(timer) instr_stage_end(&timer)
+
+#else
+
+#define HCUBATURE_V precision_hcubature_v
+#define INSTR_STAGE_BEGIN(timer, name) ((void) 0)
+#define INSTR_STAGE_END(timer) ((void) 0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INSTRUMENT_H */
@@ -0,0 +1,166 @@
+/**
+ * Per-thread integration context: arena blocks and GSL workspaces
+ */
+
+#include "integ_context.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+struct integ_contexts
+{
+    double **blocks;
+    size_t *block_size;
+    size_t n_blocks, blocks_capacity;
+    size_t cur, used;    // top of the arena: block and doubles taken in it
+
+    gsl_integration_workspace **gsl;
+    size_t n_gsl, gsl_capacity, gsl_depth;
+
+    uint64_t allocations;
+};
+
+static pthread_key_t context_key;
+static pthread_once_t context_key_once = PTHREAD_ONCE_INIT;
+static __thread integ_context *self = NULL;
+
+// Frees a thread's context when it exits
+static void context_free(void *p)
+{
+    integ_context *ctx = p;
+    size_t i;
+    for (i = 0; i < ctx->n_blocks; i++){ free( ctx->blocks[i] ); }
+    for (i = 0; i < ctx->n_gsl; i++){ gsl_integration_workspace_free( ctx->gsl[i] ); }
+    free( ctx->blocks );
+    free( ctx->block_size );
+    free( ctx->gsl );
+    free( ctx );
+}
+
+static void context_key_init(void)
+{
+    pthread_key_create( &context_key, context_free );
+}
+
+integ_context *integ_context_self(void)
+{
+    if (self == NULL)
+    {
+        integ_context *ctx = calloc( 1, sizeof(integ_context) );
+        if (ctx == NULL){ abort(); }
+        pthread_once( &context_key_once, context_key_init );
+        pthread_setspecific( context_key, ctx );
+        self = ctx;
+    }
+    return self;
+}
+
+// Append a block of at least n doubles
+static int arena_grow( integ_context *ctx, size_t n )
+{
+    if (ctx->n_blocks == ctx->blocks_capacity)
+    {
+        size_t cap = (ctx->blocks_capacity > 0) ? 2 * ctx->blocks_capacity : 8;
+        double **blocks = realloc( ctx->blocks, sizeof(double *) * cap );
+        if (blocks == NULL){ return 1; }
+        ctx->blocks = blocks;
+        size_t *block_size = realloc( ctx->block_size, sizeof(size_t) * cap );
+        if (block_size == NULL){ return 1; }
+        ctx->block_size = block_size;
+        ctx->blocks_capacity = cap;
+    }
+
+    size_t size = (ctx->n_blocks > 0) ? 2 * ctx->block_size[ctx->n_blocks - 1] : INTEG_ARENA_BLOCK_MIN;
+    if (size < n){ size = n; }
+    double *block = malloc( sizeof(double) * size );
+    if (block == NULL){ return 1; }
+
+    ctx->blocks[ctx->n_blocks] = block;
+    ctx->block_size[ctx->n_blocks] = size;
+    ctx->n_blocks++;
+    ctx->allocations++;
+    return 0;
+}
+
+static int gsl_grow( integ_context *ctx )
+{
+    if (ctx->n_gsl == ctx->gsl_capacity)
+    {
+        size_t cap = (ctx->gsl_capacity > 0) ? 2 * ctx->gsl_capacity : 4;
+        gsl_integration_workspace **gsl = realloc( ctx->gsl, sizeof(gsl_integration_workspace *) * cap );
+        if (gsl == NULL){ return 1; }
+        ctx->gsl = gsl;
+        ctx->gsl_capacity = cap;
+    }
+
+    gsl_integration_workspace *w = gsl_integration_workspace_alloc( INTEG_GSL_LIMIT );
+    if (w == NULL){ return 1; }
+    ctx->gsl[ctx->n_gsl++] = w;
+    ctx->allocations++;
+    return 0;
+}
+
+int integ_context_reserve(integ_context *ctx, size_t arena_doubles, size_t gsl_depth)
+{
+    size_t i, largest = 0;
+    for (i = 0; i < ctx->n_blocks; i++)
+    {
+        if (ctx->block_size[i] > largest){ largest = ctx->block_size[i]; }
+    }
+    if (arena_doubles > largest && arena_grow( ctx, arena_doubles )){ return 1; }
+    while (ctx->n_gsl < gsl_depth)
+    {
+        if (gsl_grow( ctx )){ return 1; }
+    }
+    return 0;
+}
+
+void integ_context_stats_get(const integ_context *ctx, integ_context_stats *out)
+{
+    size_t i;
+    out->arena_bytes = 0;
+    for (i = 0; i < ctx->n_blocks; i++){ out->arena_bytes += sizeof(double) * ctx->block_size[i]; }
+    out->gsl_workspaces = ctx->n_gsl;
+    out->allocations = ctx->allocations;
+}
+
+integ_arena_mark integ_arena_mark_get(const integ_context *ctx)
+{
+    integ_arena_mark mark = { ctx->cur, ctx->used };
+    return mark;
+}
+
+double *integ_arena_alloc(integ_context *ctx, size_t n)
+{
+    // First block from the top with room for n, blocks skipped on the way come back on release
+    while (ctx->cur < ctx->n_blocks && ctx->block_size[ctx->cur] - ctx->used < n)
+    {
+        ctx->cur++;
+        ctx->used = 0;
+    }
+    if (ctx->cur == ctx->n_blocks)
+    {
+        if (arena_grow( ctx, n )){ return NULL; }
+        ctx->used = 0;
+    }
+    double *p = ctx->blocks[ctx->cur] + ctx->used;
+    ctx->used += n;
+    return p;
+}
+
+void integ_arena_release(integ_context *ctx, integ_arena_mark mark)
+{
+    ctx->cur = mark.block;
+    ctx->used = mark.used;
+}
+
+gsl_integration_workspace *integ_gsl_acquire(integ_context *ctx)
+{
+    if (ctx->gsl_depth == ctx->n_gsl && gsl_grow( ctx )){ return NULL; }
+    return ctx->gsl[ctx->gsl_depth++];
+}
+
+void integ_gsl_release(integ_context *ctx)
+{
+    ctx->gsl_depth--;
+}
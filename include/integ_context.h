@@ -0,0 +1,86 @@
+/**
+ * Per-thread integration context
+ * Holds the scratch memory of the integrations a thread runs, so that it is
+ * allocated the first few times and reused from then on:
+ *   - an arena of double buffers, taken and given back in stack order
+ *     (integ_arena_mark / integ_arena_alloc / integ_arena_release), for
+ *     point, weight and value buffers;
+ *   - GSL integration workspaces, one per nesting depth, for the qag calls
+ *     (a comoving volume integrates a comoving distance inside it).
+ * Arena blocks and workspaces are kept until the thread exits, so once every
+ * integral of a run has been seen once, steady-state operation allocates
+ * nothing. The context of a thread is created on its first use.
+ */
+
+#ifndef INTEG_CONTEXT_H
+#define INTEG_CONTEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <gsl_integration.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Intervals of each GSL workspace, the size the qag call sites have always allocated
+#define INTEG_GSL_LIMIT 100000
+// Doubles in the first arena block, each further block is twice the size of the last
+#define INTEG_ARENA_BLOCK_MIN (1 << 16)
+
+typedef struct integ_contexts integ_context;
+
+// Position in a thread's arena, to give back everything taken after it
+typedef struct integ_arena_marks
+{
+    size_t block;
+    size_t used;
+} integ_arena_mark;
+
+typedef struct integ_context_stats
+{
+    size_t arena_bytes;       // held in arena blocks
+    size_t gsl_workspaces;    // GSL workspaces held, the deepest nesting seen
+    uint64_t allocations;     // blocks and workspaces allocated so far
+} integ_context_stats;
+
+// The calling thread's context
+integ_context *integ_context_self(void);
+
+/**
+ * Allocate up front
+ * @param ctx Context
+ * @param arena_doubles Arena room to have in one block
+ * @param gsl_depth GSL workspaces to have
+ * @return 0, 1 if an allocation failed
+ */
+int integ_context_reserve(integ_context *ctx, size_t arena_doubles, size_t gsl_depth);
+
+void integ_context_stats_get(const integ_context *ctx, integ_context_stats *out);
+
+integ_arena_mark integ_arena_mark_get(const integ_context *ctx);
+
+/**
+ * Buffer from the arena, valid until the arena is released to a mark taken before it
+ * @param ctx Context
+ * @param n Doubles
+ * @return Buffer, NULL if an allocation failed
+ */
+double *integ_arena_alloc(integ_context *ctx, size_t n);
+
+void integ_arena_release(integ_context *ctx, integ_arena_mark mark);
+
+/**
+ * GSL workspace of INTEG_GSL_LIMIT intervals for the next nesting depth
+ * Every successful acquire is paired with an integ_gsl_release.
+ * @param ctx Context
+ * @return Workspace, NULL if an allocation failed
+ */
+gsl_integration_workspace *integ_gsl_acquire(integ_context *ctx);
+void integ_gsl_release(integ_context *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INTEG_CONTEXT_H */
@@ -0,0 +1,81 @@
+/**
+ * NumPy .npy Output
+ * Minimal writer for the NumPy .npy format (version 1.0), so that large
+ * arrays can be written as raw little-endian binary and read back with
+ * numpy.load without any text parsing.
+ */
+
+#ifndef NPY_IO_H
+#define NPY_IO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Write a .npy header for a C-ordered array
+ * @param outfile Open output file, positioned at the start
+ * @param descr NumPy dtype string, e.g. "<f8" or "<f4"
+ * @param ndim Number of dimensions (at most 8)
+ * @param shape Array shape
+ * @return 0 on success, 1 on error
+ */
+static inline int npy_write_header(FILE *outfile, const char *descr, int ndim, const size_t *shape) {
+    char dict[256];
+    char magic[8] = { (char) 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0 };
+    int len, i;
+    size_t total;
+    unsigned char hlen[2];
+
+    if (ndim < 1 || ndim > 8) return 1;
+
+    len = snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (", descr);
+    for (i = 0; i < ndim; i++) {
+        len += snprintf(dict + len, sizeof(dict) - len, (i < ndim - 1) ? "%zu, " : "%zu", shape[i]);
+    }
+    if (ndim == 1) len += snprintf(dict + len, sizeof(dict) - len, ",");
+    len += snprintf(dict + len, sizeof(dict) - len, "), }");
+
+    // Pad with spaces so that the data starts on a 64-byte boundary, header ends in '\n'
+    total = 10 + len + 1;
+    total = (total + 63) / 64 * 64;
+    hlen[0] = (unsigned char) ((total - 10) & 0xff);
+    hlen[1] = (unsigned char) (((total - 10) >> 8) & 0xff);
+
+    if (fwrite(magic, 1, 8, outfile) != 8) return 1;
+    if (fwrite(hlen, 1, 2, outfile) != 2) return 1;
+    if (fwrite(dict, 1, len, outfile) != (size_t) len) return 1;
+    for (i = 10 + len; i < (int) total - 1; i++) {
+        fputc(' ', outfile);
+    }
+    fputc('\n', outfile);
+    return ferror(outfile) ? 1 : 0;
+}
+
+/**
+ * Write a whole C-ordered double array to a .npy file
+ * @param filepath Output path
+ * @param ndim Number of dimensions
+ * @param shape Array shape
+ * @param data Array data (product of shape entries)
+ * @return 0 on success, 1 on error
+ */
+static inline int npy_write_double(const char *filepath, int ndim, const size_t *shape, const double *data) {
+    FILE *outfile = fopen(filepath, "wb");
+    size_t n = 1;
+    int i, err;
+
+    if (outfile == NULL) {
+        printf("Error writing file %s: can't open output file\n", filepath);
+        return 1;
+    }
+    for (i = 0; i < ndim; i++) n *= shape[i];
+
+    err = npy_write_header(outfile, "<f8", ndim, shape);
+    if (err == 0 && fwrite(data, sizeof(double), n, outfile) != n) err = 1;
+    if (fclose(outfile) != 0) err = 1;
+    if (err) printf("Error writing file %s: incomplete output\n", filepath);
+    return err;
+}
+
+#endif /* NPY_IO_H */
@@ -0,0 +1,191 @@
+/**
+ * Precision profiles and the fixed-order cubature rule
+ */
+
+#include "precision.h"
+#include "integ_context.h"
+
+#include <math.h>
+#include <string.h>
+
+const precision_profile precision_preview = { 1., 0, 4 };
+const precision_profile precision_production = { 1., 0, 0 };
+const precision_profile precision_reference = { 1e-2, 10000000, 0 };
+
+static precision_profile global = { 1., 0, 0 };
+static __thread const precision_profile *thread_profile = NULL;
+
+// 8-point Gauss-Legendre nodes and weights on [-1, 1], positive half
+static const double gl8_x[4] = { 0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363 };
+static const double gl8_w[4] = { 0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763 };
+
+const precision_profile *precision_profile_named(const char *name)
+{
+    if (strcmp( name, "preview" ) == 0){ return &precision_preview; }
+    if (strcmp( name, "production" ) == 0){ return &precision_production; }
+    if (strcmp( name, "reference" ) == 0){ return &precision_reference; }
+    return NULL;
+}
+
+void precision_set_global(const precision_profile *p)
+{
+    global = *p;
+}
+
+precision_profile precision_global(void)
+{
+    return global;
+}
+
+const precision_profile *precision_set_thread(const precision_profile *p)
+{
+    const precision_profile *prev = thread_profile;
+    thread_profile = p;
+    return prev;
+}
+
+const precision_profile *precision_thread(void)
+{
+    return thread_profile;
+}
+
+precision_profile precision_current(void)
+{
+    return (thread_profile != NULL) ? *thread_profile : global;
+}
+
+/*
+ * Tensor product of composite Gauss-Legendre rules, at least panels intervals of PRECISION_GL_ORDER points in
+ * every dimension. A dimension over a positive range of more than PRECISION_LOG_RATIO is integrated in ln x with
+ * at least PRECISION_LOG_PANELS_PER_DECADE panels per decade, so a power law spread over many decades is sampled
+ * where it is large rather than only in its last panel. If that comes to more than max_eval points (0 for no limit),
+ * panels are taken off the dimension with the most until it fits, down to one panel per dimension, so the rule never
+ * costs more than the call site allows. The points are handed to the integrand PRECISION_FIXED_BATCH at a time
+ */
+static int precision_fixed_v( unsigned fdim, integrand_v f, void *fdata, unsigned dim, const double *xmin,
+                              const double *xmax, unsigned panels, size_t max_eval, double *val, double *err )
+{
+    unsigned m[dim], d, j, k, q;
+    unsigned short int log_x[dim];
+    size_t off[dim + 1];
+    size_t n = 1, start, p;
+    int status = 0;
+
+    off[0] = 0;
+    for (d = 0; d < dim; d++)
+    {
+        unsigned panels_d = panels;
+        log_x[d] = xmin[d] > 0. && xmax[d] > PRECISION_LOG_RATIO * xmin[d];
+        if (log_x[d])
+        {
+            unsigned panels_log = PRECISION_LOG_PANELS_PER_DECADE * (unsigned) ceil( log10( xmax[d]/xmin[d] ) );
+            if (panels_log > panels_d){ panels_d = panels_log; }
+        }
+        m[d] = panels_d * PRECISION_GL_ORDER;
+        n *= m[d];
+    }
+    while (max_eval > 0 && n > max_eval)
+    {
+        unsigned widest = 0;
+        for (d = 1; d < dim; d++)
+        {
+            if (m[d] > m[widest]){ widest = d; }
+        }
+        if (m[widest] == PRECISION_GL_ORDER){ break; }
+        n = n / m[widest] * (m[widest] - PRECISION_GL_ORDER);
+        m[widest] -= PRECISION_GL_ORDER;
+    }
+    for (d = 0; d < dim; d++)
+    {
+        off[d + 1] = off[d] + m[d];
+    }
+    size_t batch = (n < PRECISION_FIXED_BATCH) ? n : PRECISION_FIXED_BATCH;
+
+    // From the thread's arena, given back on return (the integrand may take its own buffers after these)
+    integ_context *ctx = integ_context_self();
+    integ_arena_mark mark = integ_arena_mark_get( ctx );
+    double *nodes = integ_arena_alloc( ctx, 2 * off[dim] );
+    double *x = integ_arena_alloc( ctx, batch * dim );
+    double *w = integ_arena_alloc( ctx, batch );
+    double *fval = integ_arena_alloc( ctx, batch * fdim );
+    if (nodes == NULL || x == NULL || w == NULL || fval == NULL)
+    {
+        integ_arena_release( ctx, mark );
+        return 1;
+    }
+    double *weights = nodes + off[dim];
+
+    for (d = 0; d < dim; d++)
+    {
+        unsigned panels_d = m[d] / PRECISION_GL_ORDER;
+        double lo = log_x[d] ? log( xmin[d] ) : xmin[d];
+        double hi = log_x[d] ? log( xmax[d] ) : xmax[d];
+        double h = 0.5 * (hi - lo) / panels_d;
+        for (q = 0; q < panels_d; q++)
+        {
+            double c = lo + (2 * q + 1) * h;
+            for (j = 0; j < PRECISION_GL_ORDER / 2; j++)
+            {
+                size_t i = off[d] + q * PRECISION_GL_ORDER + 2 * j;
+                nodes[i] = c - h * gl8_x[j];
+                nodes[i + 1] = c + h * gl8_x[j];
+                weights[i] = h * gl8_w[j];
+                weights[i + 1] = h * gl8_w[j];
+                if (log_x[d])
+                {
+                    // dx = x du
+                    nodes[i] = exp( nodes[i] );
+                    nodes[i + 1] = exp( nodes[i + 1] );
+                    weights[i] *= nodes[i];
+                    weights[i + 1] *= nodes[i + 1];
+                }
+            }
+        }
+    }
+
+    for (k = 0; k < fdim; k++){ val[k] = 0.; err[k] = 0.; }
+
+    for (start = 0; start < n; start += batch)
+    {
+        size_t nb = (n - start < batch) ? n - start : batch;
+        for (p = 0; p < nb; p++)
+        {
+            size_t idx = start + p;
+            double wt = 1.;
+            for (d = dim; d-- > 0;)
+            {
+                j = idx % m[d];
+                idx /= m[d];
+                x[p * dim + d] = nodes[off[d] + j];
+                wt *= weights[off[d] + j];
+            }
+            w[p] = wt;
+        }
+        if (f( dim, nb, x, fdata, fdim, fval ))
+        {
+            status = 1;
+            break;
+        }
+        for (p = 0; p < nb; p++)
+        {
+            for (k = 0; k < fdim; k++){ val[k] += w[p] * fval[p * fdim + k]; }
+        }
+    }
+
+    integ_arena_release( ctx, mark );
+    return status;
+}
+
+int precision_hcubature_v(unsigned fdim, integrand_v f, void *fdata, unsigned dim, const double *xmin,
+                          const double *xmax, size_t maxEval, double reqAbsError, double reqRelError,
+                          error_norm norm, double *val, double *err)
+{
+    precision_profile p = precision_current();
+    size_t cap = (p.max_eval > 0) ? p.max_eval : maxEval;
+    if (p.fixed_panels > 0)
+    {
+        return precision_fixed_v( fdim, f, fdata, dim, xmin, xmax, p.fixed_panels, cap, val, err );
+    }
+    return hcubature_v( fdim, f, fdata, dim, xmin, xmax, cap, reqAbsError,
+                        reqRelError * p.rel_tol_scale, norm, val, err );
+}
@@ -0,0 +1,77 @@
+/**
+ * Accuracy-vs-speed precision profiles for the adaptive integrations
+ * Every HCUBATURE_V call goes through precision_hcubature_v, which applies
+ * the current profile to the tolerance and evaluation cap written at the
+ * call site. Those literals are the production settings: a profile scales
+ * the relative tolerance, replaces the cap, or swaps the adaptive cubature
+ * for a fixed-order composite Gauss-Legendre rule.
+ *
+ * The current profile is the calling thread's own if it has one, the global
+ * one otherwise. The named profiles are
+ *   preview     fixed-order rule, 4 panels of 8 points per dimension, in ln x
+ *               with 2 panels per decade over wide positive ranges, fewer
+ *               where that would pass the call site's cap
+ *   production  the call sites' own tolerances and caps (the default)
+ *   reference   tolerances 100 times tighter, up to 1e7 points per integral
+ */
+
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#include <stddef.h>
+#include <cubature.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRECISION_GL_ORDER 8
+// Points evaluated per integrand call by the fixed-order rule
+#define PRECISION_FIXED_BATCH 1024
+// Ratio xmax/xmin above which the fixed-order rule integrates a positive range in ln x, and its panels per decade
+#define PRECISION_LOG_RATIO 100.
+#define PRECISION_LOG_PANELS_PER_DECADE 2
+
+typedef struct precision_profiles
+{
+    double rel_tol_scale;   // factor on each call site's relative tolerance
+    size_t max_eval;        // integrand points allowed per integral, 0 keeps each call site's cap
+    unsigned fixed_panels;  // > 0: no adaptivity, PRECISION_GL_ORDER-point Gauss-Legendre on this many panels per dimension (see precision_fixed_v)
+} precision_profile;
+
+extern const precision_profile precision_preview;
+extern const precision_profile precision_production;
+extern const precision_profile precision_reference;
+
+/**
+ * Named profile
+ * @param name "preview", "production" or "reference"
+ * @return Profile, NULL for an unknown name
+ */
+const precision_profile *precision_profile_named(const char *name);
+
+// Global profile, used by threads without their own. Set it while no integration is running
+void precision_set_global(const precision_profile *p);
+precision_profile precision_global(void);
+
+/**
+ * Profile of the calling thread
+ * @param p Profile, must stay valid while it is set; NULL to follow the global profile again
+ * @return The thread's previous profile, NULL if it had none
+ */
+const precision_profile *precision_set_thread(const precision_profile *p);
+const precision_profile *precision_thread(void);
+
+// Profile in effect on the calling thread
+precision_profile precision_current(void);
+
+// hcubature_v under the current profile; the fixed-order rule sets err to 0
+int precision_hcubature_v(unsigned fdim, integrand_v f, void *fdata, unsigned dim, const double *xmin,
+                          const double *xmax, size_t maxEval, double reqAbsError, double reqRelError,
+                          error_norm norm, double *val, double *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PRECISION_H */
@@ -6,6 +6,7 @@
 #include <math.h>
 #include <gsl_spline.h>
 #include <cubature.h>
+#include "instrument.h"
 
 #include "gsl_decs.h"
 
@@ -37,9 +38,8 @@ double spec_integrate_gso1D( gsl_spline_object_1D qess_so )
 
     fdata.spec_so = qess_so;
 
-    hcubature_v( 1, F, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
-
-    gsl_so1D_free( fdata.spec_so );
+    // The spline stays the caller's to free
+    HCUBATURE_V( 1, F, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
 
     return res;
 }
@@ -71,7 +71,7 @@ double spec_integrate_gso1D_lim( gsl_spline_object_1D qess_so, double xlow, doub
     xmax[0] = log(xhigh);
 
     fdata.spec_so = qess_so;
-    hcubature_v( 1, F, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
     return res;
 }
 
@@ -103,7 +103,7 @@ double spec_integrate( int n_E, double * E__GeV, double * dNdE__GeVm1 )
 
     fdata.spec_so = gsl_so1D( n_E, E__GeV, dNdE__GeVm1 );
 
-    hcubature_v( 1, F, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
 
     gsl_so1D_free( fdata.spec_so );
 
@@ -140,7 +140,7 @@ double ISRF_integrate__GeVcmm3( double (*n_phot)(double *, double), double *n_ph
     fdata.n_phot = n_phot;
     fdata.n_phot_params = n_phot_params;
 
-    hcubature_v( 1, F, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
 
     return res;
 }
@@ -9,12 +9,14 @@
 #include <gsl_spline.h>
 #include <gsl_roots.h>
 #include <cubature.h>
+#include "instrument.h"
 
 #include "math_funcs.h"
 #include "cosmo_funcs.h"
 #include "inverse_Compton.h"
 #include "physical_constants.h"
 #include "gal_rad.h"
+#include "IC_kernel.h"
 #include "gsl_decs.h"
 #include "physical_constants.h"
 //#include "CR_steadystate_3.h"
@@ -611,7 +613,7 @@ double C_norm_E( double q, double m, double T_cutoff )
 
 
 
-    hcubature_v( 1, f, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
+    HCUBATURE_V( 1, f, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
 
     return result;
 }
@@ -639,7 +641,7 @@ double C_norm_E_tot_E( double E_cut ){
   fdata.E_cut = E_cut;
   struct hcub_data *fdata_ptr = &fdata;
 
-  hcubature_v( 1, f, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
+  HCUBATURE_V( 1, f, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
 
   return result;
   }
@@ -672,7 +674,7 @@ double C_norm_E_e( double T_cutoff ){
   fdata.E_cut = E_cut_e;
   struct hcub_data *fdata_ptr = &fdata;
 
-  hcubature_v( 1, f, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
+  HCUBATURE_V( 1, f, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
 
   return result;
   }
@@ -700,7 +702,7 @@ double C_norm_E_e_1GeV( double E_cut_e ){
   fdata.E_cut = E_cut_e;
   struct hcub_data *fdata_ptr = &fdata;
 
-  hcubature_v( 1, f, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
+  HCUBATURE_V( 1, f, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
 
   return result;
   }
@@ -754,9 +756,9 @@ struct Phi_out Phi( double E_gam, double n_H, double C, double E_cut, gsl_spline
   struct hcub_data *fdata_ptr = &fdata;
 
 
-  hcubature_v( 1, f, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
+  HCUBATURE_V( 1, f, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
   Phi_out.Phi = result;
-  hcubature_v( 1, f_fcal1, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
+  HCUBATURE_V( 1, f_fcal1, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &result, &abserr );
   Phi_out.Phi_fcal1 = result;
 
   return Phi_out;
@@ -765,8 +767,22 @@ struct Phi_out Phi( double E_gam, double n_H, double C, double E_cut, gsl_spline
 
 */
 
+/*
+ * Integrands shared by the C integrals below and their fused counterparts in emission_kernels.cpp, one point each
+ */
+
+//eps_pi and eps_pi_fcal1 at proton kinetic energy T_p__GeV, for the f_cal there
+static inline double eps_pi_integrand( double T_p__GeV, double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                                       double f_cal )
+{
+    double beta_p = sqrt( 1. - pow(m_p__GeV,2)/pow( T_p__GeV + m_p__GeV, 2) );
+    return dsig_dEg( T_p__GeV, E_gam__GeV ) * J( T_p__GeV, C_p, q_p_inject, m_p__GeV, T_p_cutoff__GeV ) *
+           c__cmsm1 * beta_p * f_cal * n_H__cmm3;
+}
+
 double eps_pi( double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV, gsl_spline_object_1D gso1D_fcal )
 {
+    INSTR_STAGE_BEGIN(t_stage, "eps_pi");
     double res;
     double abserr;
 
@@ -784,13 +800,10 @@ double eps_pi( double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutof
     {
         unsigned j;
         struct fdata_PI fdata_in = *((struct fdata_PI *)fdata);
-        double beta_p[npts], f_cal[npts];
         for (j = 0; j < npts; ++j)
         {
-            beta_p[j] = sqrt( 1. - pow(m_p__GeV,2)/pow( x[j*ndim+0] + m_p__GeV, 2) );
-            f_cal[j] = gsl_so1D_eval( gso1D_fcal, x[j*ndim+0] );
-            fval[j] = dsig_dEg( x[j*ndim+0], fdata_in.E_gam__GeV ) * J( x[j*ndim+0], fdata_in.C_p, q_p_inject, m_p__GeV, fdata_in.T_p_cutoff__GeV ) * 
-                      c__cmsm1 * beta_p[j] * f_cal[j] * fdata_in.n_H__cmm3;
+            fval[j] = eps_pi_integrand( x[j*ndim+0], fdata_in.E_gam__GeV, fdata_in.n_H__cmm3, fdata_in.C_p, fdata_in.T_p_cutoff__GeV,
+                                        gsl_so1D_eval( fdata_in.gso1D_fcal, x[j*ndim+0] ) );
         }
         return 0;
     }
@@ -805,13 +818,15 @@ double eps_pi( double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutof
     double xmin[1] = { T_CR_lims__GeV[0] };
     double xmax[1] = { T_CR_lims__GeV[1] };
 
-    hcubature_v( 1, f, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, f, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
 
+    INSTR_STAGE_END(t_stage);
     return res;
 }
 
 double eps_pi_fcal1( double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV, gsl_spline_object_1D gso1D_fcal )
 {
+    INSTR_STAGE_BEGIN(t_stage, "eps_pi_fcal1");
     double res;
     double abserr;
 
@@ -828,12 +843,9 @@ double eps_pi_fcal1( double E_gam__GeV, double n_H__cmm3, double C_p, double T_p
     {
         unsigned j;
         struct fdata_PI fdata_in = *((struct fdata_PI *)fdata);
-        double beta_p[npts];
         for (j = 0; j < npts; ++j)
         {
-            beta_p[j] = sqrt( 1. - pow(m_p__GeV,2)/pow( x[j*ndim+0] + m_p__GeV, 2) );
-            fval[j] = dsig_dEg( x[j*ndim+0], fdata_in.E_gam__GeV ) * J( x[j*ndim+0], fdata_in.C_p, q_p_inject, m_p__GeV, fdata_in.T_p_cutoff__GeV ) * 
-                      c__cmsm1 * beta_p[j] * fdata_in.n_H__cmm3;
+            fval[j] = eps_pi_integrand( x[j*ndim+0], fdata_in.E_gam__GeV, fdata_in.n_H__cmm3, fdata_in.C_p, fdata_in.T_p_cutoff__GeV, 1. );
         }
         return 0;
     }
@@ -848,8 +860,9 @@ double eps_pi_fcal1( double E_gam__GeV, double n_H__cmm3, double C_p, double T_p
     double xmin[1] = { T_CR_lims__GeV[0] };
     double xmax[1] = { T_CR_lims__GeV[1] };
 
-    hcubature_v( 1, f_fcal1, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, f_fcal1, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
 
+    INSTR_STAGE_END(t_stage);
     return res;
 }
 
@@ -938,6 +951,7 @@ double sigma_gg_BW__mb( double E1__GeV, double E2__GeV )
 
 double tau_gg_gal_BW( double E_gam__GeV, double (*n_phot)(double *, double), double *n_phot_params, double E_phot__GeV_lims[2], double h_pc )
 {
+    INSTR_STAGE_BEGIN(t_stage, "tau_gg_gal_BW");
 
     double res = 0.;
     double abserr;
@@ -974,8 +988,65 @@ double tau_gg_gal_BW( double E_gam__GeV, double (*n_phot)(double *, double), dou
     xmin[0] = log(E_phot__GeV_lims[0]);
     xmax[0] = log(E_phot__GeV_lims[1]);
 
-    hcubature_v( 1, F_taugg, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F_taugg, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+
+    INSTR_STAGE_END(t_stage);
+    return h_pc * pc__cm * mb__cm2 * res;
+}
+
+//tau_gg_gal_BW_radfield at npts values ln E_phot (ln_E_phot[j*ndim]), the photon density of the batch evaluated at once
+static inline void tau_gg_radfield_integrand( size_t npts, unsigned ndim, const double *ln_E_phot, double E_gam__GeV,
+                                              const galaxy_radfield *rf, double *fval )
+{
+    size_t j;
+    double E_phot__GeV[npts];
+
+    for (j = 0; j < npts; ++j)
+    {
+        E_phot__GeV[j] = exp(ln_E_phot[j*ndim]);
+    }
+    galaxy_radfield_eval( rf, npts, E_phot__GeV, NULL, fval );
+    for (j = 0; j < npts; ++j)
+    {
+        fval[j] *= E_phot__GeV[j] * sigma_gg_BW__mb( E_gam__GeV, E_phot__GeV[j] );
+    }
+}
+
+//As tau_gg_gal_BW for the total field of a galaxy, evaluating the photon density for each batch of points at once
+double tau_gg_gal_BW_radfield( double E_gam__GeV, const galaxy_radfield *rf, double E_phot__GeV_lims[2], double h_pc )
+{
+    INSTR_STAGE_BEGIN(t_stage, "tau_gg_gal_BW_radfield");
+
+    double res = 0.;
+    double abserr;
+
+    struct fdata_taugg
+    {
+        double E_gam__GeV;
+        const galaxy_radfield *rf;
+    };
+
+    int F_taugg( unsigned ndim, size_t npts, const double *x, void *fdata, unsigned fdim, double *fval )
+    {
+        struct fdata_taugg *fdata_in = (struct fdata_taugg *)fdata;
+        tau_gg_radfield_integrand( npts, ndim, x, fdata_in->E_gam__GeV, fdata_in->rf, fval );
+        return 0;
+    }
+
+
+    struct fdata_taugg fdata;
+
+    fdata.E_gam__GeV = E_gam__GeV;
+    fdata.rf = rf;
+
+    double xmin[1], xmax[1];
+
+    xmin[0] = log(E_phot__GeV_lims[0]);
+    xmax[0] = log(E_phot__GeV_lims[1]);
+
+    HCUBATURE_V( 1, F_taugg, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
 
+    INSTR_STAGE_END(t_stage);
     return h_pc * pc__cm * mb__cm2 * res;
 }
 
@@ -1239,9 +1310,24 @@ double q_nu( double E_nu_GeV, double n_H, double C, gsl_spline spline, gsl_inter
   }
 */
 
+//q_nu at x = E_nu/E_pi: the muon-neutrino (second) and electron-neutrino term, and the first muon-neutrino term
+static inline double q_nu_numu2_nue_integrand( double x, double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                                               gsl_spline_object_1D gso1D_fcal )
+{
+    return 2. * ( f_nu_e(x) + f_nu_mu2(x) ) * q_pi( E_nu__GeV/x, n_H__cmm3, C_p, T_p_cutoff__GeV, gso1D_fcal )/x;
+}
+
+static inline double q_nu_numu1_integrand( double x, double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                                           gsl_spline_object_1D gso1D_fcal )
+{
+    double lambda = 1. - pow( m_mu__GeV/m_piC__GeV, 2 );
+    return 2./lambda * q_pi( E_nu__GeV/x, n_H__cmm3, C_p, T_p_cutoff__GeV, gso1D_fcal )/x;
+}
+
 //Neutrino spectrum function
 double q_nu( double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV, gsl_spline_object_1D gso1D_fcal )
 {
+    INSTR_STAGE_BEGIN(t_stage, "q_nu");
     double res_numu2_nue, res_numu1;
     double abserr_numu2_nue, abserr_numu1;
 
@@ -1261,8 +1347,8 @@ double q_nu( double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__
         struct fdata_nu fdata_in = *((struct fdata_nu *)fdata);
         for (j = 0; j < npts; ++j)
         {
-            fval[j] = 2. *  ( f_nu_e(x[j*ndim+0]) + f_nu_mu2(x[j*ndim+0]) ) * q_pi( fdata_in.E_nu__GeV/x[j*ndim+0], 
-                      fdata_in.n_H__cmm3, fdata_in.C_p, fdata_in.T_p_cutoff__GeV, fdata_in.gso1D_fcal )/x[j*ndim+0];
+            fval[j] = q_nu_numu2_nue_integrand( x[j*ndim+0], fdata_in.E_nu__GeV, fdata_in.n_H__cmm3, fdata_in.C_p,
+                                                fdata_in.T_p_cutoff__GeV, fdata_in.gso1D_fcal );
         }
         return 0;
     }
@@ -1272,12 +1358,11 @@ double q_nu( double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__
     {
         unsigned j;
         struct fdata_nu fdata_in = *((struct fdata_nu *)fdata);
-        double lambda = 1. - pow( m_mu__GeV/m_piC__GeV, 2 );
 
         for (j = 0; j < npts; ++j)
         {
-            fval[j] = 2./lambda * q_pi( fdata_in.E_nu__GeV/x[j*ndim+0], 
-                      fdata_in.n_H__cmm3, fdata_in.C_p, fdata_in.T_p_cutoff__GeV, fdata_in.gso1D_fcal )/x[j*ndim+0];
+            fval[j] = q_nu_numu1_integrand( x[j*ndim+0], fdata_in.E_nu__GeV, fdata_in.n_H__cmm3, fdata_in.C_p,
+                                            fdata_in.T_p_cutoff__GeV, fdata_in.gso1D_fcal );
         }
         return 0;
     }
@@ -1296,7 +1381,7 @@ double q_nu( double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__
 
     if (xmin[0] < xmax[0])
     {
-        hcubature_v( 1, F_numu2_nue, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res_numu2_nue, &abserr_numu2_nue );
+        HCUBATURE_V( 1, F_numu2_nue, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res_numu2_nue, &abserr_numu2_nue );
     }
     else
     {
@@ -1312,7 +1397,7 @@ double q_nu( double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__
 
     if (xmin[0] < xmax[0])
     {
-        hcubature_v( 1, F_numu1, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res_numu1, &abserr_numu1 );
+        HCUBATURE_V( 1, F_numu1, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res_numu1, &abserr_numu1 );
     }
     else
     {
@@ -1320,12 +1405,21 @@ double q_nu( double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__
         abserr_numu1 = 0.;
     }
 
+    INSTR_STAGE_END(t_stage);
     return res_numu2_nue + res_numu1;
 }
 
+//q_e at x = E_e/E_pi, for total electron energy E_e__GeV
+static inline double q_e_integrand( double x, double E_e__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                                    gsl_spline_object_1D gso1D_fcal )
+{
+    return fmax( 2. * f_nu_mu2(x) * q_pi( E_e__GeV/x, n_H__cmm3, C_p, T_p_cutoff__GeV, gso1D_fcal )/x, 0. );
+}
+
 //Electron spectrum function
 double q_e( double T_e__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV, gsl_spline_object_1D gso1D_fcal )
 {
+    INSTR_STAGE_BEGIN(t_stage, "q_e");
     double res;
     double abserr;
 
@@ -1344,8 +1438,8 @@ double q_e( double T_e__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__Ge
         struct fdata_qe fdata_in = *((struct fdata_qe *)fdata);
         for (j = 0; j < npts; ++j)
         {
-            fval[j] = fmax( 2. * f_nu_mu2(x[j*ndim+0])  * q_pi( fdata_in.E_e__GeV/x[j*ndim+0] , fdata_in.n_H__cmm3, fdata_in.C_p, 
-                      fdata_in.T_p_cutoff__GeV, fdata_in.gso1D_fcal )/x[j*ndim+0], 0.);
+            fval[j] = q_e_integrand( x[j*ndim+0], fdata_in.E_e__GeV, fdata_in.n_H__cmm3, fdata_in.C_p, fdata_in.T_p_cutoff__GeV,
+                                     fdata_in.gso1D_fcal );
         }
         return 0;
     }
@@ -1364,13 +1458,14 @@ double q_e( double T_e__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__Ge
 
     if (xmin[0] < xmax[0])
     {
-        hcubature_v( 1, F_e, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_e, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
     }
     else
     {
         res = 0.;
         abserr = 0.;
     }
+    INSTR_STAGE_END(t_stage);
     return res;
 }
 
@@ -1659,9 +1754,19 @@ double eps_FF( double E_gam__GeV, double Re__kpc, double T_e__K, double tau_ff )
 }
 
 
+//eps_BS_3 at ln E_e
+static inline double eps_BS_3_integrand( double ln_E_e, double E_gam__GeV, double n_H__cmm3, gsl_spline_object_2D gso2D_BS,
+                                         gsl_spline_object_1D qess_so )
+{
+    double E_e__GeV = exp(ln_E_e);
+    return E_e__GeV * gsl_so2D_eval( gso2D_BS, E_gam__GeV, E_e__GeV ) * mb__cm2 * c__cmsm1 * n_H__cmm3 *
+           gsl_so1D_eval( qess_so, E_e__GeV );
+}
+
 //Stecker 1971
 double eps_BS_3( double E_gam__GeV, double n_H__cmm3, gsl_spline_object_2D gso2D_BS, gsl_spline_object_1D qess_so )
 {
+    INSTR_STAGE_BEGIN(t_stage, "eps_BS_3");
 
     struct fdata_BS
     {
@@ -1681,8 +1786,7 @@ double eps_BS_3( double E_gam__GeV, double n_H__cmm3, gsl_spline_object_2D gso2D
         struct fdata_BS fdata_in = *((struct fdata_BS *)fdata);
         for (j = 0; j < npts; ++j)
         {
-            fval[j] = exp(x[j*ndim+0]) * gsl_so2D_eval( fdata_in.gso2D_BS, fdata_in.E_gam__GeV, exp(x[j*ndim+0]) ) * mb__cm2 * 
-                      c__cmsm1 * fdata_in.n_H__cmm3 * gsl_so1D_eval( fdata_in.qess_so, exp(x[j*ndim+0]) );
+            fval[j] = eps_BS_3_integrand( x[j*ndim+0], fdata_in.E_gam__GeV, fdata_in.n_H__cmm3, fdata_in.gso2D_BS, fdata_in.qess_so );
         }
         return 0;
     }
@@ -1701,12 +1805,13 @@ double eps_BS_3( double E_gam__GeV, double n_H__cmm3, gsl_spline_object_2D gso2D
 
     if (xmin[0] < xmax[0])
     {
-        hcubature_v( 1, F_BS, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_BS, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
     }
     else
     {
         res = 0.;
     }
+    INSTR_STAGE_END(t_stage);
     return res;
 }
 
@@ -1753,13 +1858,14 @@ double eps_IC_3( double E_gam__GeV, gsl_spline_object_2D gso_2D_so, gsl_spline_o
 
     if (xmin[0] < xmax[0])
     {
-        hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
     }
     return res;
 }
 */
 double eps_IC_3( double E_gam__GeV, gsl_spline_object_2D gso2D_IC, gsl_spline_object_1D qess_so )
 {
+    INSTR_STAGE_BEGIN(t_stage, "eps_IC_3");
     struct fdata_IC
     {
         double E_gam__GeV;
@@ -1794,8 +1900,59 @@ double eps_IC_3( double E_gam__GeV, gsl_spline_object_2D gso2D_IC, gsl_spline_ob
 
     if (xmin[0] < xmax[0])
     {
-        hcubature_v( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+        HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    }
+    INSTR_STAGE_END(t_stage);
+    return res;
+}
+
+//eps_IC_3_kernel at ln E_e
+static inline double eps_IC_3_kernel_integrand( double ln_E_e, double E_gam__GeV, const IC_kernel *IC_kern, gsl_spline_object_1D qess_so )
+{
+    double E_e__GeV = exp(ln_E_e);
+    return E_e__GeV * gsl_so1D_eval( qess_so, E_e__GeV ) * IC_kernel_eval( IC_kern, E_gam__GeV, E_e__GeV );
+}
+
+//As eps_IC_3 but evaluating the galaxy's IC table as a weighted sum of the shared base tables
+double eps_IC_3_kernel( double E_gam__GeV, const IC_kernel *IC_kern, gsl_spline_object_1D qess_so )
+{
+    INSTR_STAGE_BEGIN(t_stage, "eps_IC_3_kernel");
+    struct fdata_IC
+    {
+        double E_gam__GeV;
+        gsl_spline_object_1D qess_so;
+        const IC_kernel *IC_kern;
+    };
+
+    int F_IC( unsigned ndim, size_t npts, const double *x, void *fdata, unsigned fdim, double *fval )
+    {
+        unsigned j;
+        struct fdata_IC fdata_in = *((struct fdata_IC *)fdata);
+
+        for (j = 0; j < npts; ++j)
+        {
+            fval[j] = eps_IC_3_kernel_integrand( x[j*ndim+0], fdata_in.E_gam__GeV, fdata_in.IC_kern, fdata_in.qess_so );
+        }
+        return 0;
+    }
+
+    double res = 0.;
+    double abserr;
+    struct fdata_IC fdata;
+
+    fdata.IC_kern = IC_kern;
+    fdata.E_gam__GeV = E_gam__GeV;
+    fdata.qess_so = qess_so;
+
+    double xmin[1], xmax[1];
+    xmin[0] = log(E_CRe_lims__GeV[0]);
+    xmax[0] = log(E_CRe_lims__GeV[1]);
+
+    if (xmin[0] < xmax[0])
+    {
+        HCUBATURE_V( 1, F_IC, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
     }
+    INSTR_STAGE_END(t_stage);
     return res;
 }
 
@@ -1840,15 +1997,35 @@ double eps_sync_3( double E_gam__GeV, double B__G, gsl_spline_object_1D sync_x_s
     xmax[0] = log(E_CRe_lims__GeV[1]);
 
 
-    hcubature_v( 1, F_sync, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F_sync, &fdata, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
 
 //    return 2. * sqrt(3./M_PI) * pow(e__esu,3) * B__G/m_e__GeV * pow(erg__GeV,2)/h__GeVs/E_gam__GeV * res;
     return (M_PI * sqrt(3.) * pow(e__esu,3) * B__G)/(2. * h__ergs * m_e__g * pow(c__cmsm1,2)) * res/E_gam__GeV;
 }
 */
 
+//x E_e^2 of eps_SY_4: the synchrotron x at photon energy E_gam__GeV is xE2/E_e^2
+static inline double eps_SY_4_xE2( double E_gam__GeV, double B__G )
+{
+    return (2.*pow(M_PI,2)*pow(m_e__g,2)*pow(c__cmsm1,3))/(3.*e__esu*B__G*h__ergs) * E_gam__GeV*m_e__GeV;
+}
+
+//eps_SY_4 at ln E_e
+static inline double eps_SY_4_integrand( double ln_E_e, double xE2, gsl_spline_object_1D sync_x_so, gsl_spline_object_1D qess_so )
+{
+    double E_e__GeV = exp(ln_E_e);
+    return E_e__GeV * gsl_so1D_eval( qess_so, E_e__GeV ) * gsl_so1D_eval( sync_x_so, xE2/(E_e__GeV*E_e__GeV) );
+}
+
+//eps_SY_4 from the integral over ln E_e
+static inline double eps_SY_4_from_integral( double E_gam__GeV, double B__G, double res )
+{
+    return (2. * sqrt(3.) * pow(e__esu,3) * B__G)/(M_PI * h__ergs * m_e__g * pow(c__cmsm1,2)) * res/E_gam__GeV;
+}
+
 double eps_SY_4( double E_gam__GeV, double B__G, gsl_spline_object_1D sync_x_so, gsl_spline_object_1D qess_so )
 {
+    INSTR_STAGE_BEGIN(t_stage, "eps_SY_4");
     struct fdata_sync
     {
         double xE2;
@@ -1860,12 +2037,10 @@ double eps_SY_4( double E_gam__GeV, double B__G, gsl_spline_object_1D sync_x_so,
     {
         unsigned j;
         struct fdata_sync fdata_in = *((struct fdata_sync *)fdata);
-        double t;
 
         for (j = 0; j < npts; ++j)
         {
-            t = fdata_in.xE2/pow(exp(x[j*ndim+0]),2);
-            fval[j] = exp(x[j*ndim+0]) * gsl_so1D_eval( fdata_in.qess_so, exp(x[j*ndim+0]) ) * gsl_so1D_eval( fdata_in.sync_x_so, t );
+            fval[j] = eps_SY_4_integrand( x[j*ndim+0], fdata_in.xE2, fdata_in.sync_x_so, fdata_in.qess_so );
         }
         return 0;
     }
@@ -1875,7 +2050,7 @@ double eps_SY_4( double E_gam__GeV, double B__G, gsl_spline_object_1D sync_x_so,
     double abserr;
     struct fdata_sync fdata;
 
-    fdata.xE2 = (2.*pow(M_PI,2)*pow(m_e__g,2)*pow(c__cmsm1,3))/(3.*e__esu*B__G*h__ergs) * E_gam__GeV*m_e__GeV;
+    fdata.xE2 = eps_SY_4_xE2( E_gam__GeV, B__G );
     fdata.qess_so = qess_so;
     fdata.sync_x_so = sync_x_so;
 
@@ -1884,9 +2059,10 @@ double eps_SY_4( double E_gam__GeV, double B__G, gsl_spline_object_1D sync_x_so,
     xmin[0] = log(E_CRe_lims__GeV[0]);
     xmax[0] = log(E_CRe_lims__GeV[1]);
 
-    hcubature_v( 1, F_SY, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F_SY, &fdata, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &res, &abserr );
 
-    return (2. * sqrt(3.) * pow(e__esu,3) * B__G)/(M_PI * h__ergs * m_e__g * pow(c__cmsm1,2)) * res/E_gam__GeV;
+    INSTR_STAGE_END(t_stage);
+    return eps_SY_4_from_integral( E_gam__GeV, B__G, res );
 }
 
 
@@ -1974,7 +2150,7 @@ double eps_brems( double E_gam_GeV, double z, double B_G, double SFR__Msolyrm1,
   struct hcub_data *fdata_ptr = &fdata;
 
   if (xmin[0] < xmax[0]){
-    hcubature_v( 1, F_brems, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F_brems, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
     }
 
   return res;
@@ -2035,7 +2211,7 @@ double eps_IC_2( double E_gam_GeV, double z, double B_G, double SFR__Msolyrm1, d
 
   if (xmin[0] < xmax[0])
     {
-    hcubature_v( 1, F_IC, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+    HCUBATURE_V( 1, F_IC, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
     resout += res;
     }
 
@@ -2108,7 +2284,7 @@ double eps_IC( double E_gam_GeV, double z, double B_G, double SFR__Msolyrm1, dou
     xmax[0] = Emax_e_GeV;
 
     if (xmin[0] < xmax[0]){
-      hcubature_v( 1, F_IC, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
+      HCUBATURE_V( 1, F_IC, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res, &abserr );
       resout += res;
       }
     }
@@ -2150,7 +2326,7 @@ double q_nu_norm_fcal1( double E_nu_GeV, double E_cut ){
   struct hcub_data *fdata_ptr = &fdata;
 
   if (xmin[0] < xmax[0]){
-    hcubature_v( 1, F_numu2_nue, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res_numu2_nue, &abserr_numu2_nue );
+    HCUBATURE_V( 1, F_numu2_nue, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &res_numu2_nue, &abserr_numu2_nue );
     }
   else {
     res_numu2_nue = 0.;
@@ -2272,7 +2448,7 @@ double q_gam_IC( double E_gam_GeV, double z, double n_H, double C, double E_cut,
   struct hcub_data *fdata_ptr = &fdata;
   double val, err;
 
-  hcubature_v( 1, f_int_q, fdata_ptr, 3, xmin, xmax, 100000, 0., 1e-3, ERROR_INDIVIDUAL, &val, &err );
+  HCUBATURE_V( 1, f_int_q, fdata_ptr, 3, xmin, xmax, 100000, 0., 1e-3, ERROR_INDIVIDUAL, &val, &err );
   return val;
   }
 */
@@ -2357,7 +2533,7 @@ double q_gam_IC2( double E_gam_GeV, double z, double h_pc, double Sigstar, doubl
   struct hcub_data *fdata_ptr = &fdata;
   double val, err;
 
-  hcubature_v( 1, f_int_q2, fdata_ptr, 2, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &val, &err );
+  HCUBATURE_V( 1, f_int_q2, fdata_ptr, 2, xmin, xmax, 100000, 0., 1e-6, ERROR_INDIVIDUAL, &val, &err );
   return val;
   }
 */
@@ -2385,7 +2561,7 @@ double N_gam_tot_obs( gsl_spline_object_1D gso1D_spec, double Emin, double Emax
   struct Ngt_int *fdata_ptr = &fdata;
   double val, err;
 
-  hcubature_v( 1, f_int_Ngt, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &val, &err );
+  HCUBATURE_V( 1, f_int_Ngt, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &val, &err );
   return val;
   }
 
@@ -2414,7 +2590,7 @@ double E_gam_tot( gsl_spline spline, gsl_interp_accel acc, double Emin, double E
   struct Ngt_int *fdata_ptr = &fdata;
   double val, err;
 
-  hcubature_v( 1, f_int_Ngt, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &val, &err );
+  HCUBATURE_V( 1, f_int_Ngt, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &val, &err );
   return val;
   }
 
@@ -2442,7 +2618,7 @@ double N_gam_tot( gsl_spline spline, gsl_interp_accel acc, double Emin, double E
   struct Ngt_int *fdata_ptr = &fdata;
   double val, err;
 
-  hcubature_v( 1, f_int_Ngt, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &val, &err );
+  HCUBATURE_V( 1, f_int_Ngt, fdata_ptr, 1, xmin, xmax, 100000, 0., 1e-8, ERROR_INDIVIDUAL, &val, &err );
   return val;
   }
 
@@ -0,0 +1,208 @@
+/**
+ * Content-Addressed Table Store
+ * Generated lookup tables (IC, BS, SY) are stored under file names tagged
+ * with a fingerprint of every input that went into building them, so that
+ * several variants can live side by side in one data directory and a
+ * table is only ever reused for exactly the inputs it was built from.
+ */
+
+#ifndef TABLE_STORE_H
+#define TABLE_STORE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+/**
+ * Kernel versions of the table builders. Bump the relevant one whenever the
+ * physics in init_do_2D_IC*, init_do_2D_BS or init_do_1D_sync changes, so
+ * that tables generated by the old code are no longer picked up.
+ */
+#define TABLE_KERNEL_VERSION_IC 1
+#define TABLE_KERNEL_VERSION_BS 1
+#define TABLE_KERNEL_VERSION_SY 1
+
+/**
+ * Running fingerprint of the generation inputs of a table (64-bit FNV-1a)
+ */
+typedef struct table_keys
+{
+    uint64_t hash;
+} table_key;
+
+/**
+ * Feed raw bytes into a fingerprint
+ * @param key Fingerprint to update
+ * @param data Bytes to hash
+ * @param n Number of bytes
+ */
+static inline void table_key_add_bytes(table_key *key, const void *data, size_t n) {
+    const unsigned char *p = (const unsigned char *) data;
+    for (size_t i = 0; i < n; i++) {
+        key->hash ^= (uint64_t) p[i];
+        key->hash *= 1099511628211ULL;
+    }
+}
+
+/**
+ * Feed a string (including its terminator, so "ab"+"c" != "a"+"bc")
+ * @param key Fingerprint to update
+ * @param s String to hash
+ */
+static inline void table_key_add_string(table_key *key, const char *s) {
+    table_key_add_bytes(key, s, strlen(s) + 1);
+}
+
+/**
+ * Feed a size
+ * @param key Fingerprint to update
+ * @param n Value to hash
+ */
+static inline void table_key_add_size(table_key *key, size_t n) {
+    uint64_t v = (uint64_t) n;
+    table_key_add_bytes(key, &v, sizeof(v));
+}
+
+/**
+ * Feed an array of doubles by bit pattern
+ * @param key Fingerprint to update
+ * @param n Number of values
+ * @param x Values to hash
+ */
+static inline void table_key_add_doubles(table_key *key, size_t n, const double *x) {
+    table_key_add_bytes(key, x, sizeof(double) * n);
+}
+
+/**
+ * Start a fingerprint for one kind of table
+ * @param kind Table kind, e.g. "IC" or "IC_Gamma"
+ * @param kernel_version Kernel version of the builder (TABLE_KERNEL_VERSION_*)
+ * @return Initialized fingerprint
+ */
+static inline table_key table_key_init(const char *kind, unsigned int kernel_version) {
+    table_key key;
+    key.hash = 14695981039346656037ULL;
+    table_key_add_string(&key, kind);
+    table_key_add_size(&key, (size_t) kernel_version);
+    return key;
+}
+
+/**
+ * Build the path of a table in the store: <datadir>/<stem>_<hash><ext>
+ * @param datadir Data directory
+ * @param stem File name stem, e.g. "IC_3000_do2D"
+ * @param key Fingerprint of the table
+ * @param ext File extension, e.g. ".txt" or ".bin"
+ * @return Newly allocated path (caller frees)
+ */
+static inline char *table_store_path(const char *datadir, const char *stem, table_key key, const char *ext) {
+    size_t n = strlen(datadir) + strlen(stem) + strlen(ext) + 20;
+    char *path = (char *) malloc(n);
+    snprintf(path, n, "%s/%s_%016llx%s", datadir, stem, (unsigned long long) key.hash, ext);
+    return path;
+}
+
+/**
+ * Build a process-unique temporary path next to a table path
+ * @param path Final table path
+ * @return Newly allocated path (caller frees)
+ */
+static inline char *table_store_tmp_path(const char *path) {
+    size_t n = strlen(path) + 32;
+    char *tmp = (char *) malloc(n);
+    snprintf(tmp, n, "%s.tmp.%ld", path, (long) getpid());
+    return tmp;
+}
+
+/**
+ * Check whether a table exists in the store
+ * @param path Table path
+ * @return 1 if present, 0 otherwise
+ */
+static inline int table_store_exists(const char *path) {
+    return access(path, F_OK) == 0;
+}
+
+/**
+ * Lock file of a table, <path>.lock
+ * @param path Table path
+ * @return Lock file path (free after use)
+ */
+static inline char *table_store_lock_path(const char *path) {
+    size_t n = strlen(path) + 6;
+    char *lockpath = (char *) malloc(n);
+    snprintf(lockpath, n, "%s.lock", path);
+    return lockpath;
+}
+
+/**
+ * Take the exclusive generation lock of a table (<path>.lock). Blocks until
+ * any other process generating the same table has published it. The holder
+ * deletes the lock file on release, so a lock taken on a file that has been
+ * deleted meanwhile is dropped and taken again on the current one.
+ * @param path Table path
+ * @return Lock descriptor, or -1 if locking is unavailable (then proceed unlocked)
+ */
+static inline int table_store_lock(const char *path) {
+    char *lockpath = table_store_lock_path(path);
+    int fd;
+    for (;;) {
+        struct stat st_fd, st_path;
+        fd = open(lockpath, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            printf("Warning: can't open lock file %s, generating unlocked\n", lockpath);
+            break;
+        }
+        if (flock(fd, LOCK_EX) != 0) {
+            printf("Warning: can't lock %s, generating unlocked\n", lockpath);
+            close(fd);
+            fd = -1;
+            break;
+        }
+        if (fstat(fd, &st_fd) == 0 && stat(lockpath, &st_path) == 0
+            && st_fd.st_dev == st_path.st_dev && st_fd.st_ino == st_path.st_ino) {
+            break;
+        }
+        close(fd);
+    }
+    free(lockpath);
+    return fd;
+}
+
+/**
+ * Release a generation lock taken with table_store_lock and delete its lock file
+ * @param path Table path
+ * @param fd Lock descriptor (-1 is ignored)
+ */
+static inline void table_store_unlock(const char *path, int fd) {
+    if (fd >= 0) {
+        // Delete while still holding the lock, so no one can have locked the file being deleted
+        char *lockpath = table_store_lock_path(path);
+        unlink(lockpath);
+        free(lockpath);
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+}
+
+/**
+ * Atomically publish a fully written temporary file under its final path
+ * @param tmp Temporary path the table was written to
+ * @param path Final table path
+ * @return 0 on success, 1 on error (the temporary file is removed)
+ */
+static inline int table_store_publish(const char *tmp, const char *path) {
+    if (rename(tmp, path) != 0) {
+        printf("Error publishing table %s\n", path);
+        remove(tmp);
+        return 1;
+    }
+    return 0;
+}
+
+#endif /* TABLE_STORE_H */
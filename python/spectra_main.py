@@ -43,12 +43,26 @@ class SpectraCalculator:
             'beta': 0.25,
             'sigma_pp_cm2': 40e-27,
             'mu_H': 1.4,
-            'mu_p': 1.17,
             'n_SN_Msolm1': 1.321680e-2,
             'f_EtoCR': 0.1,
             'f_CRe_CRp': 0.2,
             'E_SN_erg': 1e51,
             'f_vAi': 1.0,
+            'D_0__cm2sm1': 3e27,
+            'D_0_halo__cm2sm1': 3e27,
+            'delta': 0.5,
+            'h_halo_h_disc': 10.,
+            'n_H_halo_n_H_disc': 1e-2,
+            'chunk_size': 100000,
+            'E_phot_lims__GeV': [1e-16, 1e-5],
+            'n_pts_tables': [100, 100],
+            'T_CMB_max__K': 30.,
+            'Delta_T_CMB__K': 1.,
+            'T_FIR_min__K': 20.,
+            'T_FIR_max__K': 100.,
+            'Delta_T_FIR__K': 5.,
+            'n_pts_sync': 500,
+            'x_sync_lims': [1e-6, 1e2],
         }
     
     def read_tau_ebl(self, filename):
@@ -69,6 +83,14 @@ class SpectraCalculator:
         
         return nx_E, ny_z, xa_E, ya_z, za_tau
     
+    def load_tau_ebl(self, filename):
+        """EBL optical depth table (text or binary) as a spectra_core.EBLTable
+        
+        Its attenuate() applies exp(-tau_EBL), the internal gamma-gamma absorption and the
+        distance modulus to a whole (n_gal, n_E_gam) block of spectra at once.
+        """
+        return spectra_core.EBLTable(filename)
+    
     def read_galaxies(self, filename):
         """Read galaxy data from file"""
         with open(filename, 'r') as f:
@@ -87,9 +109,21 @@ class SpectraCalculator:
         
         return n_gal, np.array(data)
     
-    def calculate_calorimetry(self, gal_data):
-        """Calculate calorimetry fraction and related quantities"""
-        n_gal = len(gal_data)
+    def read_galaxy_chunks(self, filename, chunk_size=None):
+        """Iterate over (offset, gal_data) chunks of a text or binary galaxy catalog
+        
+        Only one chunk is held in memory at a time. Chunks of a binary catalog
+        (see spectra_core.catalog_text_to_bin) are read-only views of the file.
+        """
+        return spectra_core.CatalogFile(filename, chunk_size or self.params['chunk_size'])
+    
+    def calculate_calorimetry(self, gal_data, splines=True):
+        """Calculate calorimetry fraction and related quantities
+        
+        f_cal has one row per galaxy; the diffusion coefficients do not depend on the galaxy
+        and are single rows. With splines the returned 'calorimetry' also holds a Spline1D per
+        galaxy of f_cal and one of D_e and of D_e_halo, ready for GalaxySpectraPipeline.run.
+        """
         z, M_star, Re, SFR = gal_data.T
         
         n_T_CR = self.params['n_T_CR']
@@ -107,83 +141,56 @@ class SpectraCalculator:
             n_T_CR
         )
         
-        # Initialize output arrays
-        f_cal = np.zeros((n_gal, n_T_CR))
-        D__cm2sm1 = np.zeros((n_gal, n_T_CR))
-        D_e__cm2sm1 = np.zeros((n_gal, n_T_CR))
-        D_e_z2__cm2sm1 = np.zeros((n_gal, n_T_CR))
+        # Disc and halo structure of the whole catalog in one native pass
+        config = spectra_core.StructureConfig()
+        for key in ('mu_H', 'chi', 'M_A', 'h_halo_h_disc', 'n_H_halo_n_H_disc'):
+            setattr(config, key, self.params[key])
+        structure = spectra_core.galaxy_structure(z, M_star, Re, SFR, config)
         
-        h__pc = np.zeros(n_gal)
-        n_H__cmm3 = np.zeros(n_gal)
-        B__G = np.zeros(n_gal)
-        B_halo__G = np.zeros(n_gal)
-        
-        # Calculate for each galaxy
-        for i in range(n_gal):
-            # Calculate basic properties using wrapped functions
-            A_Re__pc2 = np.pi * (Re[i] * 1e3)**2
-            Sig_star__Msolpcm2 = M_star[i] / (2. * A_Re__pc2)
-            Sig_SFR__Msolyrm1pcm2 = SFR[i] / (2. * A_Re__pc2)
-            
-            Sig_gas__Msolpcm2 = spectra_core.Sigma_gas_Shi_iKS(
-                Sig_SFR__Msolyrm1pcm2,
-                Sig_star__Msolpcm2
-            )
-            
-            sig_gas__kmsm1 = spectra_core.sigma_gas_Yu(SFR[i])
-            T_dust__K = spectra_core.Tdust(z[i], SFR[i], M_star[i])
-            
-            # Calculate scale height and density
-            sig_star = spectra_core.sigma_star_Bezanson(M_star[i], Re[i])
-            h__pc[i] = (sig_gas__kmsm1**2) / (
-                np.pi * 4.302e-3 * (
-                    Sig_gas__Msolpcm2 +
-                    (sig_gas__kmsm1 / sig_star) * Sig_star__Msolpcm2
-                )
-            )
-            
-            n_H__cmm3[i] = Sig_gas__Msolpcm2 / (
-                self.params['mu_H'] * 1.673e-27 * 2. * h__pc[i]
-            ) * 1.989e30 / (3.086e18)**3
-            
-            # Calculate magnetic field
-            u_LA = sig_gas__kmsm1 / np.sqrt(2.)
-            v_Ai = 1000. * (u_LA / 10.) / (
-                np.sqrt(self.params['chi'] / 1e-4) * self.params['M_A']
-            )
-            L_A = h__pc[i] / (self.params['M_A']**3)
-            
-            n__cmm3 = n_H__cmm3[i] * self.params['mu_H'] / self.params['mu_p']
-            B__G[i] = np.sqrt(
-                4. * np.pi * self.params['chi'] * n__cmm3 *
-                self.params['mu_p'] * 1.673e-27 * 1e3
-            ) * v_Ai * 1e5
-            
-            if np.log10(SFR[i] / M_star[i]) > -10.:
-                B_halo__G[i] = B__G[i] / 3.
-            else:
-                B_halo__G[i] = B__G[i] / 1.5
-            
-            # Calculate calorimetry fraction (simplified - full implementation needed)
-            # TODO: Implement full calorimetry calculation using C functions
+        # f_cal of every galaxy and energy, the diffusion coefficients of every energy
+        cal_config = spectra_core.CalorimetryConfig()
+        for key in ('sigma_pp_cm2', 'beta', 'f_vAi', 'D_0__cm2sm1', 'D_0_halo__cm2sm1', 'delta'):
+            setattr(cal_config, key, self.params[key])
+        calorimetry = spectra_core.Calorimetry(structure, T_CR__GeV, E_CRe__GeV, cal_config, splines)
         
         return {
-            'f_cal': f_cal,
-            'D__cm2sm1': D__cm2sm1,
-            'D_e__cm2sm1': D_e__cm2sm1,
-            'D_e_z2__cm2sm1': D_e_z2__cm2sm1,
-            'h__pc': h__pc,
-            'n_H__cmm3': n_H__cmm3,
-            'B__G': B__G,
-            'B_halo__G': B_halo__G,
+            'f_cal': calorimetry.f_cal,
+            'D__cm2sm1': calorimetry.D__cm2sm1,
+            'D_e__cm2sm1': calorimetry.D_e__cm2sm1,
+            'D_e_z2__cm2sm1': calorimetry.D_e_halo__cm2sm1,
+            'calorimetry': calorimetry,
+            'structure': structure,
+            'h__pc': structure.h__pc,
+            'n_H__cmm3': structure.n_H__cmm3,
+            'B__G': structure.B__G,
+            'B_halo__G': structure.B_halo__G,
+            'h_halo__pc': structure.h_halo__pc,
+            'n_H_halo__cmm3': structure.n_H_halo__cmm3,
+            'T_dust__K': structure.T_dust__K,
             'T_CR__GeV': T_CR__GeV,
             'E_CRe__GeV': E_CRe__GeV,
         }
     
     def compute_galaxy_spectra(self, i, gal_data, cal_data, interp_objects=None):
-        """Compute spectra for a single galaxy"""
+        """Compute spectra for a single galaxy
+        
+        With interp_objects['pipeline'] (a spectra_core.GalaxySpectraPipeline) the whole
+        chain runs natively in one call.
+        """
         z, M_star, Re, SFR = gal_data[i]
         
+        if interp_objects is not None and 'pipeline' in interp_objects:
+            gal = spectra_core.GalaxyParams(
+                z, M_star, Re, SFR,
+                cal_data['T_dust__K'][i],
+                cal_data['h__pc'][i], cal_data['n_H__cmm3'][i], cal_data['B__G'][i],
+                cal_data['h_halo__pc'][i], cal_data['n_H_halo__cmm3'][i], cal_data['B_halo__G'][i]
+            )
+            cal = cal_data['calorimetry']
+            return interp_objects['pipeline'].run(
+                gal, cal.f_cal_spline(i), cal.D_e_spline(), cal.D_e_halo_spline()
+            ).as_dict()
+        
         n_E_gam = self.params['n_E_gam']
         E_gam__GeV = np.logspace(
             np.log10(self.params['E_gam_lims__GeV'][0]),
@@ -216,15 +223,88 @@ class SpectraCalculator:
         
         return result
     
-    def write_output(self, results, output_dir):
-        """Write output files"""
+    def build_pipeline(self, datadir):
+        """Native per-galaxy pipeline over the E_gam grid of the parameters
+        
+        The IC, bremsstrahlung and synchrotron tables are read from datadir, or generated
+        there on first use, and are shared by every galaxy the pipeline runs.
+        """
+        E_gam__GeV = np.logspace(
+            np.log10(self.params['E_gam_lims__GeV'][0]),
+            np.log10(self.params['E_gam_lims__GeV'][1]),
+            self.params['n_E_gam']
+        )
+        E_e__GeV_lims = self.params['E_CRe_lims__GeV']
+        
+        config = spectra_core.PipelineConfig()
+        for key in ('E_CRe_lims__GeV', 'E_phot_lims__GeV', 'T_p_cutoff__GeV', 'T_e_cutoff__GeV', 'f_EtoCR',
+                    'f_CRe_CRp', 'E_SN_erg', 'n_SN_Msolm1', 'sigma_pp_cm2'):
+            setattr(config, key, self.params[key])
+        
+        IC_tables = spectra_core.ICTables(
+            self.params['n_pts_tables'], self.params['E_gam_lims__GeV'], E_e__GeV_lims,
+            self.params['E_phot_lims__GeV'], self.params['T_CMB_max__K'], self.params['Delta_T_CMB__K'],
+            self.params['T_FIR_min__K'], self.params['T_FIR_max__K'], self.params['Delta_T_FIR__K'], datadir
+        )
+        BS_table = spectra_core.BSTable(self.params['n_pts_tables'], self.params['E_gam_lims__GeV'],
+                                        E_e__GeV_lims, datadir)
+        sync_table = spectra_core.SyncTable(self.params['n_pts_sync'], self.params['x_sync_lims'], datadir)
+        return spectra_core.GalaxySpectraPipeline(IC_tables, BS_table, sync_table, E_gam__GeV, config)
+    
+    def compute_catalog_spectra(self, gal_data, cal_data, pipeline, n_workers=0, callback=None, cost_model=None,
+                                writer=None, offset=0):
+        """Compute spectra for every galaxy natively, spread over worker threads
+        
+        Returns an (n_gal, 16, n_E_gam) array ordered as spectra_core.GalaxySpectra.names,
+        or None if callback(offset + i, spectra) is given and receives each galaxy as it finishes,
+        or a spectra_core.SpectraWriter is given and writes galaxy i at row offset + i.
+        """
+        return spectra_core.run_catalog(
+            pipeline, cal_data['structure'].as_dict(),
+            cal_data['T_CR__GeV'], cal_data['f_cal'],
+            cal_data['E_CRe__GeV'], cal_data['D_e__cm2sm1'], cal_data['D_e_z2__cm2sm1'],
+            n_workers=n_workers, callback=callback, cost_model=cost_model, writer=writer, offset=offset
+        )
+    
+    def process_catalog(self, filename, pipeline, callback=None, chunk_size=None, n_workers=0, cost_model=None,
+                        outdir=None, single_precision=False):
+        """Compute the spectra of every galaxy in a catalog, a chunk at a time
+        
+        callback(i, spectra) receives each galaxy with i its index in the whole catalog, or with
+        outdir the spectra are written there by a spectra_core.SpectraWriter (one <name>.npy of
+        shape (n_gal, n_E_gam) per spectrum), so memory use is bounded by the chunk size.
+        """
+        catalog = self.read_galaxy_chunks(filename, chunk_size)
+        writer = None
+        if outdir is not None:
+            Path(outdir).mkdir(parents=True, exist_ok=True)
+            writer = spectra_core.SpectraWriter(outdir, pipeline.E_gam__GeV, catalog.n_gal,
+                                                single_precision=single_precision)
+        try:
+            for offset, gal_data in catalog:
+                cal_data = self.calculate_calorimetry(gal_data, splines=False)
+                self.compute_catalog_spectra(
+                    gal_data, cal_data, pipeline, n_workers=n_workers, callback=callback,
+                    cost_model=cost_model, writer=writer, offset=offset
+                )
+        finally:
+            if writer is not None:
+                writer.close()
+        return catalog.n_gal
+    
+    def write_output(self, results, output_dir, binary=True, dtype=np.float64):
+        """Write output files, as .npy (in dtype) or as text"""
         Path(output_dir).mkdir(parents=True, exist_ok=True)
         
         # Write spectra files
         for key, data in results.items():
             if isinstance(data, np.ndarray):
-                filename = os.path.join(output_dir, f"{key}.txt")
-                np.savetxt(filename, data)
+                if binary:
+                    filename = os.path.join(output_dir, f"{key}.npy")
+                    np.save(filename, data.astype(dtype, copy=False))
+                else:
+                    filename = os.path.join(output_dir, f"{key}.txt")
+                    np.savetxt(filename, data)
                 print(f"Written {filename}")
 
 
@@ -241,22 +321,12 @@ def main():
     print("Initializing spectra calculator...")
     calc = SpectraCalculator()
     
-    print(f"Reading galaxies from {infile}...")
-    n_gal, gal_data = calc.read_galaxies(infile)
-    print(f"Processing {n_gal} galaxies")
-    
-    print("Calculating calorimetry...")
-    cal_data = calc.calculate_calorimetry(gal_data)
-    
-    print("Computing spectra...")
-    results = []
-    for i in range(min(n_gal, 10)):  # Limit to 10 for testing
-        print(f"  Galaxy {i+1}/{min(n_gal, 10)}")
-        result = calc.compute_galaxy_spectra(i, gal_data, cal_data)
-        results.append(result)
+    print(f"Loading tables from {datadir}...")
+    pipeline = calc.build_pipeline(datadir)
     
-    print("Writing output...")
-    calc.write_output({'gal_data': gal_data, 'cal_data': cal_data}, outdir)
+    print(f"Computing spectra of {infile} in chunks of {calc.params['chunk_size']}...")
+    n_gal = calc.process_catalog(infile, pipeline, outdir=outdir)
+    print(f"Written the spectra of {n_gal} galaxies to {outdir}")
     
     print("Done!")
 
@@ -26,7 +26,7 @@ include_dirs = [
 # Library directories and libraries
 # Adjust these based on your system's GSL installation
 library_dirs = []
-libraries = ['gsl', 'gslcblas', 'm']
+libraries = ['gsl', 'gslcblas', 'm', 'pthread']
 
 # Check for OpenMP
 extra_compile_args = ['-std=c++11', '-O3']
@@ -43,6 +43,11 @@ try:
 except:
     pass
 
+# Hot-path instrumentation: SPECTRA_INSTRUMENT=1 python setup.py build_ext --inplace
+define_macros = []
+if os.environ.get('SPECTRA_INSTRUMENT', '0') not in ('', '0'):
+    define_macros.append(('SPECTRA_INSTRUMENT', '1'))
+
 # Source files
 sources = [
     os.path.join(src_dir, "spectra_core.cpp"),
@@ -52,6 +57,23 @@ sources = [
     os.path.join(src_dir, "wrappers_steadystate.cpp"),
     os.path.join(src_dir, "wrappers_data.cpp"),
     os.path.join(src_dir, "wrappers_utils.cpp"),
+    os.path.join(src_dir, "wrappers_handles.cpp"),
+    os.path.join(src_dir, "wrappers_pool.cpp"),
+    os.path.join(src_dir, "emission_kernels.cpp"),
+    os.path.join(src_dir, "wrappers_pipeline.cpp"),
+    os.path.join(src_dir, "wrappers_catalog.cpp"),
+    os.path.join(src_dir, "wrappers_catalog_io.cpp"),
+    os.path.join(src_dir, "wrappers_writer.cpp"),
+    os.path.join(src_dir, "wrappers_instrument.cpp"),
+    os.path.join(src_dir, "wrappers_precision.cpp"),
+    os.path.join(src_dir, "wrappers_ebl.cpp"),
+    os.path.join(src_dir, "wrappers_redshift.cpp"),
+    os.path.join(src_dir, "wrappers_bands.cpp"),
+    os.path.join(src_dir, "wrappers_structure.cpp"),
+    os.path.join(src_dir, "wrappers_calorimetry.cpp"),
+    os.path.join(include_dir, "instrument.c"),
+    os.path.join(include_dir, "precision.c"),
+    os.path.join(include_dir, "integ_context.c"),
 ]
 
 # Add C source files if they exist
@@ -72,6 +94,7 @@ ext_modules = [
         library_dirs=library_dirs,
         libraries=libraries,
         language='c++',
+        define_macros=define_macros,
         extra_compile_args=extra_compile_args,
         extra_link_args=extra_link_args,
     ),
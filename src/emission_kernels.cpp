@@ -0,0 +1,153 @@
+/**
+ * Implementation of the emission integrals on the templated cubature engine
+ */
+
+#include "emission_kernels.h"
+#include "integrate.h"
+
+double fused_eps_pi(double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                    const gsl_spline_object_1D &gso1D_fcal) {
+    INSTR_STAGE_BEGIN(t_stage, "eps_pi");
+    double res, abserr;
+    double xmin[1] = { T_CR_lims__GeV[0] };
+    double xmax[1] = { T_CR_lims__GeV[1] };
+
+    auto f = [&](const double *x, double *fval) {
+        fval[0] = eps_pi_integrand(x[0], E_gam__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, gsl_so1D_eval(gso1D_fcal, x[0]));
+    };
+    integrate_cubature<1, 1>(f, xmin, xmax, 100000, 0., 1e-6, &res, &abserr, INTEGRATE_SITE("f"));
+
+    INSTR_STAGE_END(t_stage);
+    return res;
+}
+
+double fused_eps_pi_fcal1(double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV) {
+    INSTR_STAGE_BEGIN(t_stage, "eps_pi_fcal1");
+    double res, abserr;
+    double xmin[1] = { T_CR_lims__GeV[0] };
+    double xmax[1] = { T_CR_lims__GeV[1] };
+
+    auto f_fcal1 = [&](const double *x, double *fval) {
+        fval[0] = eps_pi_integrand(x[0], E_gam__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, 1.);
+    };
+    integrate_cubature<1, 1>(f_fcal1, xmin, xmax, 100000, 0., 1e-6, &res, &abserr, INTEGRATE_SITE("f_fcal1"));
+
+    INSTR_STAGE_END(t_stage);
+    return res;
+}
+
+double fused_q_nu(double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                  const gsl_spline_object_1D &gso1D_fcal) {
+    INSTR_STAGE_BEGIN(t_stage, "q_nu");
+    double res_numu2_nue = 0., res_numu1 = 0., abserr;
+    double lambda = 1. - pow(m_mu__GeV / m_piC__GeV, 2);
+    double xmin[1] = { E_nu__GeV / (T_p_norm__GeV[1] * K_pi) };
+    double xmax[1] = { 1. };
+
+    auto F_numu2_nue = [&](const double *x, double *fval) {
+        fval[0] = q_nu_numu2_nue_integrand(x[0], E_nu__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, gso1D_fcal);
+    };
+    if (xmin[0] < xmax[0]) {
+        integrate_cubature<1, 1>(F_numu2_nue, xmin, xmax, 100000, 0., 1e-6, &res_numu2_nue, &abserr,
+                                 INTEGRATE_SITE("F_numu2_nue"));
+    }
+
+    auto F_numu1 = [&](const double *x, double *fval) {
+        fval[0] = q_nu_numu1_integrand(x[0], E_nu__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, gso1D_fcal);
+    };
+    xmax[0] = lambda;
+    if (xmin[0] < xmax[0]) {
+        integrate_cubature<1, 1>(F_numu1, xmin, xmax, 100000, 0., 1e-6, &res_numu1, &abserr,
+                                 INTEGRATE_SITE("F_numu1"));
+    }
+
+    INSTR_STAGE_END(t_stage);
+    return res_numu2_nue + res_numu1;
+}
+
+double fused_q_e(double T_e__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                 const gsl_spline_object_1D &gso1D_fcal) {
+    INSTR_STAGE_BEGIN(t_stage, "q_e");
+    double res = 0., abserr;
+    double E_e__GeV = T_e__GeV + m_e__GeV;
+    double xmin[1] = { E_e__GeV / (T_p_norm__GeV[1] * K_pi) };
+    double xmax[1] = { 1. };
+
+    auto F_e = [&](const double *x, double *fval) {
+        fval[0] = q_e_integrand(x[0], E_e__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, gso1D_fcal);
+    };
+    if (xmin[0] < xmax[0]) {
+        integrate_cubature<1, 1>(F_e, xmin, xmax, 100000, 0., 1e-6, &res, &abserr, INTEGRATE_SITE("F_e"));
+    }
+
+    INSTR_STAGE_END(t_stage);
+    return res;
+}
+
+double fused_eps_IC_3_kernel(double E_gam__GeV, const IC_kernel *IC_kern, const gsl_spline_object_1D &qess_so) {
+    INSTR_STAGE_BEGIN(t_stage, "eps_IC_3_kernel");
+    double res = 0., abserr;
+    double xmin[1] = { log(E_CRe_lims__GeV[0]) };
+    double xmax[1] = { log(E_CRe_lims__GeV[1]) };
+
+    auto F_IC = [&](const double *x, double *fval) {
+        fval[0] = eps_IC_3_kernel_integrand(x[0], E_gam__GeV, IC_kern, qess_so);
+    };
+    if (xmin[0] < xmax[0]) {
+        integrate_cubature<1, 1>(F_IC, xmin, xmax, 100000, 0., 1e-6, &res, &abserr, INTEGRATE_SITE("F_IC"));
+    }
+
+    INSTR_STAGE_END(t_stage);
+    return res;
+}
+
+double fused_eps_BS_3(double E_gam__GeV, double n_H__cmm3, const gsl_spline_object_2D &gso2D_BS,
+                      const gsl_spline_object_1D &qess_so) {
+    INSTR_STAGE_BEGIN(t_stage, "eps_BS_3");
+    double res = 0., abserr;
+    double xmin[1] = { log(fmax(E_CRe_lims__GeV[0], E_gam__GeV)) };
+    double xmax[1] = { log(E_CRe_lims__GeV[1]) };
+
+    auto F_BS = [&](const double *x, double *fval) {
+        fval[0] = eps_BS_3_integrand(x[0], E_gam__GeV, n_H__cmm3, gso2D_BS, qess_so);
+    };
+    if (xmin[0] < xmax[0]) {
+        integrate_cubature<1, 1>(F_BS, xmin, xmax, 100000, 0., 1e-6, &res, &abserr, INTEGRATE_SITE("F_BS"));
+    }
+
+    INSTR_STAGE_END(t_stage);
+    return res;
+}
+
+double fused_eps_SY_4(double E_gam__GeV, double B__G, const gsl_spline_object_1D &sync_x_so,
+                      const gsl_spline_object_1D &qess_so) {
+    INSTR_STAGE_BEGIN(t_stage, "eps_SY_4");
+    double res = 0., abserr;
+    double xE2 = eps_SY_4_xE2(E_gam__GeV, B__G);
+    double xmin[1] = { log(E_CRe_lims__GeV[0]) };
+    double xmax[1] = { log(E_CRe_lims__GeV[1]) };
+
+    auto F_SY = [&](const double *x, double *fval) {
+        fval[0] = eps_SY_4_integrand(x[0], xE2, sync_x_so, qess_so);
+    };
+    integrate_cubature<1, 1>(F_SY, xmin, xmax, 100000, 0., 1e-8, &res, &abserr, INTEGRATE_SITE("F_SY"));
+
+    INSTR_STAGE_END(t_stage);
+    return eps_SY_4_from_integral(E_gam__GeV, B__G, res);
+}
+
+double fused_tau_gg_gal_BW_radfield(double E_gam__GeV, const galaxy_radfield *rf, const double E_phot__GeV_lims[2],
+                                    double h_pc) {
+    INSTR_STAGE_BEGIN(t_stage, "tau_gg_gal_BW_radfield");
+    double res = 0., abserr;
+    double xmin[1] = { log(E_phot__GeV_lims[0]) };
+    double xmax[1] = { log(E_phot__GeV_lims[1]) };
+
+    auto F_taugg = [&](const double *x, double *fval) {
+        tau_gg_radfield_integrand(1, 1, x, E_gam__GeV, rf, fval);
+    };
+    integrate_cubature<1, 1>(F_taugg, xmin, xmax, 100000, 0., 1e-6, &res, &abserr, INTEGRATE_SITE("F_taugg"));
+
+    INSTR_STAGE_END(t_stage);
+    return h_pc * pc__cm * mb__cm2 * res;
+}
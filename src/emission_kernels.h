@@ -0,0 +1,48 @@
+/**
+ * Per-photon-energy emission integrals on the templated cubature engine
+ * The same integrals, limits and tolerances as eps_pi, eps_pi_fcal1, q_nu,
+ * q_e, eps_IC_3_kernel, eps_BS_3, eps_SY_4 and tau_gg_gal_BW_radfield
+ * (spectra_funcs.h), and the same integrands: both call the *_integrand
+ * functions there, here from a lambda that integrate.h inlines into the
+ * rule instead of a nested function called through hcubature_v. These are what the pipeline evaluates once per
+ * photon energy, zone and electron population; the steady-state solve and
+ * the table generators, which run once per galaxy or table, stay on the C
+ * integrals.
+ */
+
+#ifndef EMISSION_KERNELS_H
+#define EMISSION_KERNELS_H
+
+#include "spectra_funcs.h"
+
+// Pion-decay gamma-ray emissivity, as eps_pi
+double fused_eps_pi(double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                    const gsl_spline_object_1D &gso1D_fcal);
+
+// As fused_eps_pi for f_cal = 1, as eps_pi_fcal1
+double fused_eps_pi_fcal1(double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV);
+
+// Neutrino spectrum, as q_nu
+double fused_q_nu(double E_nu__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                  const gsl_spline_object_1D &gso1D_fcal);
+
+// Secondary electron injection spectrum, as q_e
+double fused_q_e(double T_e__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                 const gsl_spline_object_1D &gso1D_fcal);
+
+// Inverse-Compton emissivity from the galaxy's IC kernel, as eps_IC_3_kernel
+double fused_eps_IC_3_kernel(double E_gam__GeV, const IC_kernel *IC_kern, const gsl_spline_object_1D &qess_so);
+
+// Bremsstrahlung emissivity, as eps_BS_3
+double fused_eps_BS_3(double E_gam__GeV, double n_H__cmm3, const gsl_spline_object_2D &gso2D_BS,
+                      const gsl_spline_object_1D &qess_so);
+
+// Synchrotron emissivity, as eps_SY_4
+double fused_eps_SY_4(double E_gam__GeV, double B__G, const gsl_spline_object_1D &sync_x_so,
+                      const gsl_spline_object_1D &qess_so);
+
+// Gamma-gamma optical depth through the galaxy's radiation field, as tau_gg_gal_BW_radfield
+double fused_tau_gg_gal_BW_radfield(double E_gam__GeV, const galaxy_radfield *rf, const double E_phot__GeV_lims[2],
+                                    double h_pc);
+
+#endif
@@ -0,0 +1,435 @@
+/**
+ * Templated cubature engine
+ * The integrand is a functor or lambda f(const double *x, double *fval)
+ * taking DIM coordinates and writing FDIM values, with DIM and FDIM fixed
+ * at compile time. It is inlined into the rule's loop over its nodes, so
+ * there are no trampolines, no function-pointer call per batch and no copy
+ * of an fdata struct; the captured state is read in place.
+ *
+ * Regions are refined adaptively with the rules of hcubature (15-point
+ * Gauss-Kronrod with the QUADPACK error estimate in 1D, degree 7/5
+ * Genz-Malik otherwise) and its ERROR_INDIVIDUAL convergence test, or a
+ * fixed-order composite Gauss-Legendre rule is used instead, as selected by
+ * the current precision profile (precision.h). The region heap and the
+ * Gauss-Legendre nodes live in per-thread workspaces, one per nesting depth,
+ * that are reused from one integral to the next.
+ */
+
+#ifndef INTEGRATE_H
+#define INTEGRATE_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "precision.h"
+#include "instrument.h"
+
+// Call site of an integral for the instrumentation counters, -1 when they are compiled out
+#ifdef SPECTRA_INSTRUMENT
+#define INTEGRATE_SITE(integrand) INSTR_ID_(instr_site_register(__func__, integrand))
+#else
+#define INTEGRATE_SITE(integrand) (-1)
+#endif
+
+template <unsigned DIM, unsigned FDIM>
+struct CubatureRegion {
+    double c[DIM], h[DIM];      // centre and half-widths
+    double val[FDIM], err[FDIM];
+    double err_max;             // largest error over the components, the heap key
+    unsigned split;             // dimension to halve next
+};
+
+template <unsigned DIM, unsigned FDIM>
+struct CubatureRegionLess {
+    bool operator()(const CubatureRegion<DIM, FDIM> &a, const CubatureRegion<DIM, FDIM> &b) const {
+        return a.err_max < b.err_max;
+    }
+};
+
+// Region heap and Gauss-Legendre nodes, kept between integrals
+template <unsigned DIM, unsigned FDIM>
+struct CubatureWorkspace {
+    std::vector<CubatureRegion<DIM, FDIM>> heap;
+    std::vector<double> nodes, weights;
+};
+
+// A thread's workspaces for integrals of one shape, one per nesting depth (an integrand may integrate too)
+template <unsigned DIM, unsigned FDIM>
+struct CubatureWorkspaceStack {
+    std::deque<CubatureWorkspace<DIM, FDIM>> levels;  // a deque, so that deeper levels don't move the ones in use
+    size_t depth = 0;
+};
+
+// The calling thread's workspaces for integrals of this shape
+template <unsigned DIM, unsigned FDIM>
+CubatureWorkspaceStack<DIM, FDIM> &cubature_workspaces() {
+    static thread_local CubatureWorkspaceStack<DIM, FDIM> stack;
+    return stack;
+}
+
+// Degree 7/5 Genz-Malik rule, the rule of hcubature in two or more dimensions
+template <unsigned DIM>
+struct CubatureRule {
+    static const unsigned n_points = 1 + 4 * DIM + 2 * DIM * (DIM - 1) + (1u << DIM);
+
+    template <unsigned FDIM, typename F>
+    static void eval(const F &f, CubatureRegion<DIM, FDIM> &r) {
+        const double l2 = 0.3585685828003180919906451539079374954541;  // sqrt(9/70)
+        const double l4 = 0.9486832980505137995996680633298155601160;  // sqrt(9/10)
+        const double l5 = 0.6882472016116852977216287342936235251269;  // sqrt(9/19)
+        const double w1 = (12824. - 9120. * DIM + 400. * DIM * DIM) / 19683.;
+        const double w2 = 980. / 6561.;
+        const double w3 = (1820. - 400. * DIM) / 19683.;
+        const double w4 = 200. / 19683.;
+        const double w5 = 6859. / 19683. / (1u << DIM);
+        const double wE1 = (729. - 950. * DIM + 50. * DIM * DIM) / 729.;
+        const double wE2 = 245. / 486.;
+        const double wE3 = (265. - 100. * DIM) / 1458.;
+        const double wE4 = 25. / 729.;
+        const double ratio = (l2 * l2) / (l4 * l4);
+
+        // Nodes: centre; -l2, +l2, -l4, +l4 along each axis; (+-l4, +-l4) in each pair of axes; (+-l5, ...)
+        double x[n_points][DIM];
+        unsigned n = 0, i, j, k, d;
+        for (d = 0; d < DIM; d++) x[0][d] = r.c[d];
+        n = 1;
+        for (i = 0; i < DIM; i++) {
+            const double off[4] = { -l2, l2, -l4, l4 };
+            for (k = 0; k < 4; k++, n++) {
+                for (d = 0; d < DIM; d++) x[n][d] = r.c[d];
+                x[n][i] += off[k] * r.h[i];
+            }
+        }
+        for (i = 0; i < DIM; i++) {
+            for (j = i + 1; j < DIM; j++) {
+                for (k = 0; k < 4; k++, n++) {
+                    for (d = 0; d < DIM; d++) x[n][d] = r.c[d];
+                    x[n][i] += ((k & 1) ? l4 : -l4) * r.h[i];
+                    x[n][j] += ((k & 2) ? l4 : -l4) * r.h[j];
+                }
+            }
+        }
+        for (k = 0; k < (1u << DIM); k++, n++) {
+            for (d = 0; d < DIM; d++) x[n][d] = r.c[d] + (((k >> d) & 1) ? l5 : -l5) * r.h[d];
+        }
+
+        double fv[n_points][FDIM];
+        for (k = 0; k < n_points; k++) f(x[k], fv[k]);
+
+        double vol = 1.;
+        for (d = 0; d < DIM; d++) vol *= 2. * r.h[d];
+
+        double diff[DIM] = { 0. };
+        r.err_max = 0.;
+        for (unsigned c = 0; c < FDIM; c++) {
+            double f0 = fv[0][c], sum2 = 0., sum3 = 0., sum4 = 0., sum5 = 0.;
+            for (i = 0; i < DIM; i++) {
+                double s2 = fv[1 + 4 * i][c] + fv[2 + 4 * i][c];
+                double s3 = fv[3 + 4 * i][c] + fv[4 + 4 * i][c];
+                sum2 += s2;
+                sum3 += s3;
+                // Fourth difference along the axis, which picks the dimension to split
+                diff[i] += std::fabs(s2 - 2. * f0 - ratio * (s3 - 2. * f0));
+            }
+            for (k = 1 + 4 * DIM; k < 1 + 4 * DIM + 2 * DIM * (DIM - 1); k++) sum4 += fv[k][c];
+            for (; k < n_points; k++) sum5 += fv[k][c];
+
+            double res7 = vol * (w1 * f0 + w2 * sum2 + w3 * sum3 + w4 * sum4 + w5 * sum5);
+            double res5 = vol * (wE1 * f0 + wE2 * sum2 + wE3 * sum3 + wE4 * sum4);
+            r.val[c] = res7;
+            r.err[c] = std::fabs(res5 - res7);
+            r.err_max = std::max(r.err_max, r.err[c]);
+        }
+
+        // Largest fourth difference, the widest dimension among (nearly) equal ones
+        r.split = 0;
+        for (i = 1; i < DIM; i++) {
+            if (diff[i] > diff[r.split] * (1. + 1e-10)) {
+                r.split = i;
+            } else if (diff[i] >= diff[r.split] * (1. - 1e-10) && r.h[i] > r.h[r.split]) {
+                r.split = i;
+            }
+        }
+    }
+};
+
+// 15-point Gauss-Kronrod with its embedded 7-point Gauss rule, the rule of hcubature in 1D
+template <>
+struct CubatureRule<1> {
+    static const unsigned n_points = 15;
+
+    template <unsigned FDIM, typename F>
+    static void eval(const F &f, CubatureRegion<1, FDIM> &r) {
+        static const double xgk[8] = {
+            0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+            0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+            0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+            0.207784955007898467600689403773245, 0.
+        };
+        static const double wgk[8] = {
+            0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+            0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+            0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+            0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+        };
+        // Gauss weights of the nodes xgk[1], xgk[3], xgk[5] and the centre
+        static const double wg[4] = {
+            0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+            0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+        };
+
+        const double c = r.c[0], h = r.h[0];
+        double x[n_points];
+        x[0] = c;
+        for (unsigned j = 0; j < 7; j++) {
+            x[1 + 2 * j] = c - h * xgk[j];
+            x[2 + 2 * j] = c + h * xgk[j];
+        }
+
+        double fv[n_points][FDIM];
+        for (unsigned k = 0; k < n_points; k++) f(&x[k], fv[k]);
+
+        r.err_max = 0.;
+        for (unsigned cp = 0; cp < FDIM; cp++) {
+            double f0 = fv[0][cp];
+            double res_k = wgk[7] * f0, res_g = wg[3] * f0, res_abs = std::fabs(res_k);
+            for (unsigned j = 0; j < 7; j++) {
+                double fm = fv[1 + 2 * j][cp], fp = fv[2 + 2 * j][cp];
+                res_k += wgk[j] * (fm + fp);
+                res_abs += wgk[j] * (std::fabs(fm) + std::fabs(fp));
+                if (j & 1) res_g += wg[j / 2] * (fm + fp);
+            }
+            double mean = 0.5 * res_k;
+            double res_asc = wgk[7] * std::fabs(f0 - mean);
+            for (unsigned j = 0; j < 7; j++) {
+                res_asc += wgk[j] * (std::fabs(fv[1 + 2 * j][cp] - mean) + std::fabs(fv[2 + 2 * j][cp] - mean));
+            }
+
+            double err = std::fabs((res_k - res_g) * h);
+            res_abs *= h;
+            res_asc *= h;
+            if (res_asc != 0. && err != 0.) {
+                double scale = std::pow(200. * err / res_asc, 1.5);
+                err = (scale < 1.) ? res_asc * scale : res_asc;
+            }
+            if (res_abs > DBL_MIN / (50. * DBL_EPSILON)) {
+                err = std::max(err, 50. * DBL_EPSILON * res_abs);
+            }
+
+            r.val[cp] = res_k * h;
+            r.err[cp] = err;
+            r.err_max = std::max(r.err_max, err);
+        }
+        r.split = 0;
+    }
+};
+
+/**
+ * Adaptive cubature over [xmin, xmax]
+ * @param f Integrand, f(x, fval)
+ * @param maxEval Integrand points allowed (0 for no cap)
+ * @param reqAbsError, reqRelError Tolerances, met by every component (ERROR_INDIVIDUAL)
+ * @param val, err Integrals and error estimates (FDIM each)
+ * @param ws Workspace
+ * @param n_regions If not NULL, receives the number of regions evaluated
+ * @return Integrand points used
+ */
+template <unsigned DIM, unsigned FDIM, typename F>
+size_t integrate_adaptive(const F &f, const double *xmin, const double *xmax, size_t maxEval, double reqAbsError,
+                          double reqRelError, double *val, double *err, CubatureWorkspace<DIM, FDIM> &ws,
+                          size_t *n_regions = NULL) {
+    typedef CubatureRule<DIM> Rule;
+    CubatureRegionLess<DIM, FDIM> less;
+    std::vector<CubatureRegion<DIM, FDIM>> &heap = ws.heap;
+    heap.clear();
+
+    CubatureRegion<DIM, FDIM> r;
+    for (unsigned d = 0; d < DIM; d++) {
+        r.c[d] = 0.5 * (xmin[d] + xmax[d]);
+        r.h[d] = 0.5 * (xmax[d] - xmin[d]);
+    }
+    Rule::eval(f, r);
+    heap.push_back(r);
+    size_t n_eval = Rule::n_points, n_reg = 1;
+
+    for (unsigned c = 0; c < FDIM; c++) {
+        val[c] = r.val[c];
+        err[c] = r.err[c];
+    }
+
+    for (;;) {
+        bool converged = true;
+        for (unsigned c = 0; c < FDIM; c++) {
+            if (err[c] > reqAbsError && err[c] > std::fabs(val[c]) * reqRelError) converged = false;
+        }
+        if (converged || (maxEval > 0 && n_eval >= maxEval)) break;
+
+        // Halve the region with the largest error
+        std::pop_heap(heap.begin(), heap.end(), less);
+        CubatureRegion<DIM, FDIM> parent = heap.back();
+        heap.pop_back();
+
+        CubatureRegion<DIM, FDIM> a = parent, b = parent;
+        unsigned s = parent.split;
+        a.h[s] = b.h[s] = 0.5 * parent.h[s];
+        a.c[s] = parent.c[s] - a.h[s];
+        b.c[s] = parent.c[s] + b.h[s];
+        Rule::eval(f, a);
+        Rule::eval(f, b);
+        n_eval += 2 * Rule::n_points;
+        n_reg += 2;
+
+        for (unsigned c = 0; c < FDIM; c++) {
+            val[c] += a.val[c] + b.val[c] - parent.val[c];
+            err[c] += a.err[c] + b.err[c] - parent.err[c];
+        }
+        heap.push_back(a);
+        std::push_heap(heap.begin(), heap.end(), less);
+        heap.push_back(b);
+        std::push_heap(heap.begin(), heap.end(), less);
+    }
+
+    // Sum again over the final regions, free of the round-off of the running updates
+    for (unsigned c = 0; c < FDIM; c++) val[c] = err[c] = 0.;
+    for (size_t k = 0; k < heap.size(); k++) {
+        for (unsigned c = 0; c < FDIM; c++) {
+            val[c] += heap[k].val[c];
+            err[c] += heap[k].err[c];
+        }
+    }
+
+    if (n_regions != NULL) *n_regions = n_reg;
+    return n_eval;
+}
+
+/**
+ * Fixed-order cubature: tensor product of composite 8-point Gauss-Legendre rules, the rule of precision_fixed_v.
+ * A dimension over a positive range wider than PRECISION_LOG_RATIO is integrated in ln x with at least
+ * PRECISION_LOG_PANELS_PER_DECADE panels per decade; panels come off the dimension with the most while the
+ * points would pass max_eval
+ * @param f Integrand, f(x, fval)
+ * @param panels Panels per dimension, at least while within max_eval
+ * @param max_eval Largest number of integrand points, 0 for no limit
+ * @param val Integrals (FDIM)
+ * @param ws Workspace
+ * @return Integrand points used
+ */
+template <unsigned DIM, unsigned FDIM, typename F>
+size_t integrate_fixed(const F &f, const double *xmin, const double *xmax, unsigned panels, size_t max_eval,
+                       double *val, CubatureWorkspace<DIM, FDIM> &ws) {
+    static const double gl8_x[4] = { 0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363 };
+    static const double gl8_w[4] = { 0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763 };
+
+    unsigned m[DIM];
+    bool log_x[DIM];
+    size_t off[DIM + 1];
+    size_t n = 1;
+    off[0] = 0;
+    for (unsigned d = 0; d < DIM; d++) {
+        unsigned panels_d = panels;
+        log_x[d] = xmin[d] > 0. && xmax[d] > PRECISION_LOG_RATIO * xmin[d];
+        if (log_x[d]) {
+            unsigned decades = (unsigned) std::ceil(std::log10(xmax[d] / xmin[d]));
+            panels_d = std::max(panels_d, PRECISION_LOG_PANELS_PER_DECADE * decades);
+        }
+        m[d] = panels_d * PRECISION_GL_ORDER;
+        n *= m[d];
+    }
+    while (max_eval > 0 && n > max_eval) {
+        unsigned widest = 0;
+        for (unsigned d = 1; d < DIM; d++) {
+            if (m[d] > m[widest]) widest = d;
+        }
+        if (m[widest] == PRECISION_GL_ORDER) break;
+        n = n / m[widest] * (m[widest] - PRECISION_GL_ORDER);
+        m[widest] -= PRECISION_GL_ORDER;
+    }
+    for (unsigned d = 0; d < DIM; d++) off[d + 1] = off[d] + m[d];
+
+    ws.nodes.resize(off[DIM]);
+    ws.weights.resize(off[DIM]);
+    double *nodes = ws.nodes.data(), *weights = ws.weights.data();
+    for (unsigned d = 0; d < DIM; d++) {
+        unsigned panels_d = m[d] / PRECISION_GL_ORDER;
+        double lo = log_x[d] ? std::log(xmin[d]) : xmin[d];
+        double hi = log_x[d] ? std::log(xmax[d]) : xmax[d];
+        double h = 0.5 * (hi - lo) / panels_d;
+        for (unsigned q = 0; q < panels_d; q++) {
+            double c = lo + (2 * q + 1) * h;
+            for (unsigned j = 0; j < 4; j++) {
+                size_t i = off[d] + q * 8 + 2 * j;
+                nodes[i] = c - h * gl8_x[j];
+                nodes[i + 1] = c + h * gl8_x[j];
+                weights[i] = weights[i + 1] = h * gl8_w[j];
+                if (log_x[d]) {
+                    // dx = x du
+                    nodes[i] = std::exp(nodes[i]);
+                    nodes[i + 1] = std::exp(nodes[i + 1]);
+                    weights[i] *= nodes[i];
+                    weights[i + 1] *= nodes[i + 1];
+                }
+            }
+        }
+    }
+
+    for (unsigned c = 0; c < FDIM; c++) val[c] = 0.;
+    double x[DIM], fv[FDIM];
+    for (size_t p = 0; p < n; p++) {
+        size_t idx = p;
+        double w = 1.;
+        for (unsigned d = DIM; d-- > 0;) {
+            size_t j = idx % m[d];
+            idx /= m[d];
+            x[d] = nodes[off[d] + j];
+            w *= weights[off[d] + j];
+        }
+        f(x, fv);
+        for (unsigned c = 0; c < FDIM; c++) val[c] += w * fv[c];
+    }
+    return n;
+}
+
+/**
+ * Integral under the calling thread's precision profile, the counterpart of HCUBATURE_V
+ * The call site's maxEval and reqRelError are its production settings, which the profile scales or replaces.
+ * A fixed-order rule sets err to 0. Uses the thread's workspace for its nesting depth, which keeps its memory for
+ * the next integral, so that repeated integrals allocate nothing once the heap has grown to their size.
+ * @param site Instrumentation call site (INTEGRATE_SITE), -1 for none
+ * @return Integrand points used
+ */
+template <unsigned DIM, unsigned FDIM, typename F>
+size_t integrate_cubature(const F &f, const double *xmin, const double *xmax, size_t maxEval, double reqAbsError,
+                          double reqRelError, double *val, double *err, int site = -1) {
+    precision_profile p = precision_current();
+    CubatureWorkspaceStack<DIM, FDIM> &stack = cubature_workspaces<DIM, FDIM>();
+    if (stack.depth == stack.levels.size()) stack.levels.emplace_back();
+    CubatureWorkspace<DIM, FDIM> &ws = stack.levels[stack.depth];
+
+    // Steps back out of the level even if the integrand throws
+    struct Level {
+        size_t &depth;
+        explicit Level(size_t &d) : depth(d) { depth++; }
+        ~Level() { depth--; }
+    } level(stack.depth);
+
+    uint64_t t0 = (site >= 0) ? instr_now_ns() : 0;
+    size_t n_eval, n_regions = 1, cap = (p.max_eval > 0) ? p.max_eval : maxEval;
+    if (p.fixed_panels > 0) {
+        n_eval = integrate_fixed<DIM, FDIM>(f, xmin, xmax, p.fixed_panels, cap, val, ws);
+        for (unsigned c = 0; c < FDIM; c++) err[c] = 0.;
+    } else {
+        n_eval = integrate_adaptive<DIM, FDIM>(f, xmin, xmax, cap, reqAbsError, reqRelError * p.rel_tol_scale,
+                                               val, err, ws, &n_regions);
+    }
+    if (site >= 0) {
+        bool capped = p.fixed_panels == 0 && cap > 0 && n_eval >= cap;
+        instr_site_record(site, n_eval, n_regions, n_regions, capped, instr_now_ns() - t0);
+    }
+    return n_eval;
+}
+
+#endif
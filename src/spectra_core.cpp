@@ -41,6 +41,19 @@ namespace py = pybind11;
 #include "wrappers_steadystate.h"
 #include "wrappers_data.h"
 #include "wrappers_utils.h"
+#include "wrappers_handles.h"
+#include "wrappers_pool.h"
+#include "wrappers_pipeline.h"
+#include "wrappers_catalog.h"
+#include "wrappers_catalog_io.h"
+#include "wrappers_writer.h"
+#include "wrappers_instrument.h"
+#include "wrappers_precision.h"
+#include "wrappers_ebl.h"
+#include "wrappers_redshift.h"
+#include "wrappers_bands.h"
+#include "wrappers_structure.h"
+#include "wrappers_calorimetry.h"
 
 PYBIND11_MODULE(spectra_core, m) {
     m.doc() = "High-performance C/C++ physics code exposed to Python via pybind11";
@@ -52,4 +65,18 @@ PYBIND11_MODULE(spectra_core, m) {
     bind_steadystate_functions(m);
     bind_data_functions(m);
     bind_utility_functions(m);
+    // Handle classes and the handle overloads of the functions bound above
+    bind_handle_functions(m);
+    bind_pool_functions(m);
+    bind_pipeline_functions(m);
+    bind_catalog_functions(m);
+    bind_catalog_io_functions(m);
+    bind_writer_functions(m);
+    bind_instrument_functions(m);
+    bind_precision_functions(m);
+    bind_ebl_functions(m);
+    bind_redshift_functions(m);
+    bind_band_functions(m);
+    bind_structure_functions(m);
+    bind_calorimetry_functions(m);
 }
@@ -0,0 +1,161 @@
+/**
+ * Implementation of the band photometry
+ */
+
+#include "wrappers_bands.h"
+#include "wrappers_handles.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Nodes and weights of 4-point Gauss-Legendre on [0, 1]
+static const double gl4_x[4] = { 0.0694318442029737, 0.3300094782075719, 0.6699905217924281, 0.9305681557970263 };
+static const double gl4_w[4] = { 0.1739274225687269, 0.3260725774312731, 0.3260725774312731, 0.1739274225687269 };
+
+// An increasing grid of positive energies, as the power-law segments work in log E
+static void check_energy_grid(const double *E, size_t n) {
+    check_grid("E__GeV", E, (py::ssize_t) n);
+    if (!(E[0] > 0.)) {
+        throw std::runtime_error("E__GeV must be positive");
+    }
+}
+
+CumulativeIntegral::CumulativeIntegral(const double *E__GeV, size_t n_E, double k)
+    : E_(E__GeV, E__GeV + n_E), log_E_(n_E), f_(n_E), slope_(n_E > 0 ? n_E - 1 : 0), cum_(n_E), k_(k) {
+    check_energy_grid(E__GeV, n_E);
+    if (!(k >= 0.)) {
+        throw std::runtime_error("k must be non-negative");
+    }
+    for (size_t i = 0; i < n_E; i++) log_E_[i] = log(E_[i]);
+}
+
+void CumulativeIntegral::build(const double *dNdE) {
+    size_t n = E_.size();
+    std::copy(dNdE, dNdE + n, f_.begin());
+    cum_[0] = 0.;
+    for (size_t i = 0; i + 1 < n; i++) {
+        // NaN marks an interval taken as linear in E
+        slope_[i] = (f_[i] > 0. && f_[i + 1] > 0.) ? log(f_[i + 1] / f_[i]) / (log_E_[i + 1] - log_E_[i]) : NAN;
+        cum_[i + 1] = at(i, E_[i + 1]);
+    }
+}
+
+size_t CumulativeIntegral::locate(double E_GeV) const {
+    size_t i = std::upper_bound(E_.begin(), E_.end(), E_GeV) - E_.begin();
+    return std::min(std::max(i, (size_t) 1), E_.size() - 1) - 1;
+}
+
+double CumulativeIntegral::at(size_t i, double E_GeV) const {
+    double E = std::fmin(std::fmax(E_GeV, E_[i]), E_[i + 1]);
+    double part;
+    if (!std::isnan(slope_[i])) {
+        // f_i E_i^(k+1) int_0^x exp(a u) du, x = log(E/E_i), a = s + k + 1
+        double a = slope_[i] + k_ + 1., x = log(E) - log_E_[i];
+        double ax = a * x;
+        part = f_[i] * exp((k_ + 1.) * log_E_[i]) * (fabs(ax) < 1e-8 ? x * (1. + 0.5 * ax) : expm1(ax) / a);
+    } else {
+        double b = (f_[i + 1] - f_[i]) / (E_[i + 1] - E_[i]), h = E - E_[i];
+        part = 0.;
+        for (int q = 0; q < 4; q++) {
+            double t = E_[i] + gl4_x[q] * h;
+            part += gl4_w[q] * pow(t, k_) * (f_[i] + b * (t - E_[i]));
+        }
+        part *= h;
+    }
+    return cum_[i] + part;
+}
+
+double CumulativeIntegral::at(double E_GeV) const {
+    return at(locate(E_GeV), E_GeV);
+}
+
+BandPhotometry::BandPhotometry(const std::vector<double> &E__GeV, const std::vector<double> &E_lo__GeV,
+                               const std::vector<double> &E_hi__GeV)
+    : E_(E__GeV), lo_(E_lo__GeV), hi_(E_hi__GeV) {
+    check_energy_grid(E_.data(), E_.size());
+    if (lo_.size() != hi_.size()) {
+        throw std::runtime_error("E_lo__GeV and E_hi__GeV must have the same length");
+    }
+    // The intervals depend only on the grid, so a zero spectrum serves to locate the edges
+    CumulativeIntegral c(E_.data(), E_.size(), 0.);
+    i_lo_.resize(lo_.size());
+    i_hi_.resize(hi_.size());
+    for (size_t b = 0; b < lo_.size(); b++) {
+        if (!(lo_[b] <= hi_[b])) {
+            throw std::runtime_error("Band " + std::to_string(b) + " has E_lo__GeV > E_hi__GeV");
+        }
+        i_lo_[b] = c.locate(lo_[b]);
+        i_hi_[b] = c.locate(hi_[b]);
+    }
+}
+
+void BandPhotometry::integrate(size_t n_spec, const double *dNdE, double k, double *out) const {
+    size_t n = E_.size(), n_b = lo_.size();
+    CumulativeIntegral proto(E_.data(), n, k);
+
+    #pragma omp parallel
+    {
+        // One running integral per thread, rebuilt for each of its spectra
+        CumulativeIntegral c(proto);
+        #pragma omp for schedule(static)
+        for (long s = 0; s < (long) n_spec; s++) {
+            c.build(dNdE + s * n);
+            double *o = out + s * n_b;
+            for (size_t b = 0; b < n_b; b++) o[b] = c.at(i_hi_[b], hi_[b]) - c.at(i_lo_[b], lo_[b]);
+        }
+    }
+}
+
+// Python bindings
+
+void bind_band_functions(py::module &m) {
+    py::class_<CumulativeIntegral>(m, "CumulativeIntegral", "Running integral of E^k dN/dE of one spectrum")
+        .def(py::init([](c_array_d E__GeV, c_array_d dNdE, double k) {
+                 if (dNdE.size() != E__GeV.size()) {
+                     throw std::runtime_error("dNdE must have the length of E__GeV");
+                 }
+                 CumulativeIntegral *c = new CumulativeIntegral(E__GeV.data(), E__GeV.size(), k);
+                 c->build(dNdE.data());
+                 return c;
+             }),
+             "k = 0 for photon counts, k = 1 for energy fluxes",
+             py::arg("E__GeV"), py::arg("dNdE"), py::arg("k") = 0.)
+        .def_property_readonly("k", &CumulativeIntegral::k)
+        .def_property_readonly("total", &CumulativeIntegral::total, "Integral over the whole grid")
+        .def("integral", [](const CumulativeIntegral &c, c_array_d E_lo__GeV, c_array_d E_hi__GeV) {
+            return vectorize_broadcast({ E_lo__GeV, E_hi__GeV }, [&c](const double *v) {
+                return c.integral(v[0], v[1]);
+            });
+        }, "Integral from E_lo__GeV to E_hi__GeV, broadcast", py::arg("E_lo__GeV"), py::arg("E_hi__GeV"));
+
+    py::class_<BandPhotometry>(m, "BandPhotometry", "Integrals of E^k dN/dE over fixed bands of a fixed grid")
+        .def(py::init([](c_array_d E__GeV, c_array_d E_lo__GeV, c_array_d E_hi__GeV) {
+                 std::vector<double> E(E__GeV.data(), E__GeV.data() + E__GeV.size());
+                 std::vector<double> lo(E_lo__GeV.data(), E_lo__GeV.data() + E_lo__GeV.size());
+                 std::vector<double> hi(E_hi__GeV.data(), E_hi__GeV.data() + E_hi__GeV.size());
+                 return new BandPhotometry(E, lo, hi);
+             }),
+             "Bands [E_lo__GeV[b], E_hi__GeV[b]] over the grid E__GeV",
+             py::arg("E__GeV"), py::arg("E_lo__GeV"), py::arg("E_hi__GeV"))
+        .def_property_readonly("n_band", &BandPhotometry::n_band)
+        .def("integrate", [](const BandPhotometry &p, c_array_d dNdE, double k) {
+            if ((dNdE.ndim() != 1 && dNdE.ndim() != 2) || (size_t) dNdE.shape(dNdE.ndim() - 1) != p.n_E()) {
+                throw std::runtime_error("dNdE must have shape (n_E,) or (n_spec, n_E)");
+            }
+            size_t n_spec = dNdE.ndim() == 2 ? dNdE.shape(0) : 1;
+            std::vector<py::ssize_t> shape = { (py::ssize_t) p.n_band() };
+            if (dNdE.ndim() == 2) shape.insert(shape.begin(), (py::ssize_t) n_spec);
+            py::array_t<double> out(shape);
+            {
+                py::gil_scoped_release release;
+                p.integrate(n_spec, dNdE.data(), k, out.mutable_data());
+            }
+            return out;
+        }, "Band integrals of E^k dNdE, shape (n_band,) for one spectrum or (n_spec, n_band) for a block; "
+           "k = 0 for photon counts, k = 1 for energy fluxes",
+           py::arg("dNdE"), py::arg("k") = 0.);
+}
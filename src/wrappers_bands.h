@@ -0,0 +1,79 @@
+/**
+ * Band photometry
+ * Integrals of E^k dN/dE over energy bands (k = 0 for photon counts, k = 1
+ * for energy fluxes) from a spectrum tabulated on a grid. Between knots the
+ * spectrum is taken as a power law, linear in (log E, log dN/dE), so each
+ * interval integrates in closed form; an interval with a knot that is not
+ * positive is taken as linear in E and integrated by 4-point Gauss-Legendre.
+ * The running integral from the first knot is built once per spectrum, after
+ * which a band is the difference of its values at the band's edges: a binary
+ * search and one closed-form partial interval per edge, in place of an
+ * adaptive integration per band. Band edges outside the grid are clamped to
+ * it, the spectrum being zero outside.
+ */
+
+#ifndef WRAPPERS_BANDS_H
+#define WRAPPERS_BANDS_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <vector>
+#include "wrappers_vectorize.h"
+
+namespace py = pybind11;
+
+// Running integral of E^k dN/dE over a fixed grid, rebuilt for each spectrum
+class CumulativeIntegral {
+public:
+    // k >= 0
+    CumulativeIntegral(const double *E__GeV, size_t n_E, double k);
+
+    // Integrate dNdE (n_E) from the first knot to every knot
+    void build(const double *dNdE);
+
+    size_t n_E() const { return E_.size(); }
+    double k() const { return k_; }
+    const std::vector<double> &E__GeV() const { return E_; }
+    // Integral over the whole grid
+    double total() const { return cum_.back(); }
+
+    // Interval i with E[i] <= E_GeV <= E[i + 1], for E_GeV clamped into the grid
+    size_t locate(double E_GeV) const;
+    // Integral from the first knot to E_GeV, which lies in interval i
+    double at(size_t i, double E_GeV) const;
+    double at(double E_GeV) const;
+    double integral(double E_lo__GeV, double E_hi__GeV) const { return at(E_hi__GeV) - at(E_lo__GeV); }
+
+private:
+    std::vector<double> E_, log_E_, f_, slope_, cum_;
+    double k_;
+};
+
+// A fixed set of bands over a fixed grid, with the edges located once for every spectrum
+class BandPhotometry {
+public:
+    BandPhotometry(const std::vector<double> &E__GeV, const std::vector<double> &E_lo__GeV,
+                   const std::vector<double> &E_hi__GeV);
+
+    size_t n_E() const { return E_.size(); }
+    size_t n_band() const { return lo_.size(); }
+    const std::vector<double> &E__GeV() const { return E_; }
+
+    /**
+     * Band integrals of a block of spectra
+     * @param n_spec Spectra in the block
+     * @param dNdE Spectra (n_spec, n_E)
+     * @param k Power of E in the integrand
+     * @param out Integrals (n_spec, n_band)
+     */
+    void integrate(size_t n_spec, const double *dNdE, double k, double *out) const;
+
+private:
+    std::vector<double> E_, lo_, hi_;
+    std::vector<size_t> i_lo_, i_hi_;  // intervals of the clamped edges
+};
+
+// Bind to Python module
+void bind_band_functions(py::module &m);
+
+#endif
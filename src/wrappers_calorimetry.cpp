@@ -0,0 +1,166 @@
+/**
+ * Implementation of the proton calorimetry
+ */
+
+#include "wrappers_calorimetry.h"
+#include "wrappers_data.h"
+#include "physical_constants.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+double hyp0f1(double b, double x) {
+    double term = 1., sum = 1.;
+    for (int k = 0; term > 1e-16 * sum; k++) {
+        term *= x / ((b + k) * (k + 1.));
+        sum += term;
+        if (sum > 1e300) return INFINITY;
+    }
+    return sum;
+}
+
+// D_0 (p c / GeV)^delta over a grid of momenta p c [GeV]
+static void diffusion_row(size_t n, const double *pc__GeV, double D_0, double delta, double *D) {
+    for (size_t j = 0; j < n; j++) D[j] = D_0 * pow(pc__GeV[j], delta);
+}
+
+Calorimetry::Calorimetry(const GalaxyStructure &structure, const std::vector<double> &T_CR__GeV,
+                         const std::vector<double> &E_CRe__GeV, const CalorimetryConfig &config, bool splines)
+    : n_gal_(structure.n_gal()), T_CR__GeV_(T_CR__GeV), E_CRe__GeV_(E_CRe__GeV) {
+    check_grid("T_CR__GeV", T_CR__GeV_.data(), T_CR__GeV_.size());
+    check_grid("E_CRe__GeV", E_CRe__GeV_.data(), E_CRe__GeV_.size());
+    if (!(config.beta > 0.)) {
+        throw std::runtime_error("beta must be positive");
+    }
+    size_t n_T = T_CR__GeV_.size(), n_E = E_CRe__GeV_.size();
+
+    // Everything over the energy grids that does not depend on the galaxy, the diffusion coefficients included
+    std::vector<double> pc_p(n_T), beta_p(n_T), pc_e(n_E);
+    D_.resize(n_T);
+    D_e_.resize(n_E);
+    D_e_halo_.resize(n_E);
+    for (size_t j = 0; j < n_T; j++) {
+        double T = T_CR__GeV_[j];
+        pc_p[j] = sqrt(T * (T + 2. * m_p__GeV));
+        beta_p[j] = pc_p[j] / (T + m_p__GeV);
+    }
+    for (size_t j = 0; j < n_E; j++) {
+        double E = E_CRe__GeV_[j];
+        pc_e[j] = sqrt(fmax(E * E - m_e__GeV * m_e__GeV, 0.));
+    }
+    diffusion_row(n_T, pc_p.data(), config.D_0__cm2sm1, config.delta, D_.data());
+    diffusion_row(n_E, pc_e.data(), config.D_0__cm2sm1, config.delta, D_e_.data());
+    diffusion_row(n_E, pc_e.data(), config.D_0_halo__cm2sm1, config.delta, D_e_halo_.data());
+
+    f_cal_.resize(n_gal_ * n_T);
+    const double *h__pc = structure.column(STRUCT_H), *n_H__cmm3 = structure.column(STRUCT_N_H);
+    const double *v_Ai__kmsm1 = structure.column(STRUCT_V_AI);
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long) n_gal_; i++) {
+        double h__cm = h__pc[i] * pc__cm;
+        double pp_rate = n_H__cmm3[i] * config.sigma_pp_cm2 * c__cmsm1;
+        double stream_rate = config.f_vAi * v_Ai__kmsm1[i] * 1e5 / h__cm;
+        double *f = f_cal_.data() + i * n_T;
+        for (size_t j = 0; j < n_T; j++) {
+            double tau_eff = pp_rate * beta_p[j] / (D_[j] / (h__cm * h__cm) + stream_rate);
+            f[j] = 1. - 1. / hyp0f1(config.beta, tau_eff);
+        }
+    }
+
+    if (splines) {
+        // The spline objects are allocated in parallel and handed to their owners in order
+        std::vector<gsl_spline_object_1D> so(n_gal_);
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < (long) n_gal_; i++) {
+            so[i] = gsl_so1D(n_T, T_CR__GeV_.data(), f_cal_.data() + i * n_T);
+        }
+        f_cal_so_.reserve(n_gal_);
+        for (size_t i = 0; i < n_gal_; i++) f_cal_so_.emplace_back(so[i]);
+        D_e_so_.reset(new Spline1D(gsl_so1D(n_E, E_CRe__GeV_.data(), D_e_.data())));
+        D_e_halo_so_.reset(new Spline1D(gsl_so1D(n_E, E_CRe__GeV_.data(), D_e_halo_.data())));
+    }
+}
+
+void Calorimetry::fill_columns(CatalogColumns &cols) const {
+    cols.n_T_CR = n_T_CR();
+    cols.T_CR__GeV = T_CR__GeV_.data();
+    cols.f_cal = f_cal_.data();
+    cols.n_E_CRe = n_E_CRe();
+    cols.E_CRe__GeV = E_CRe__GeV_.data();
+    cols.D_e__cm2sm1 = D_e_.data();
+    cols.D_e_halo__cm2sm1 = D_e_halo_.data();
+    cols.D_e_stride = 0;
+}
+
+// Python bindings
+
+void bind_calorimetry_functions(py::module &m) {
+    py::class_<CalorimetryConfig>(m, "CalorimetryConfig", "Settings of the proton calorimetry")
+        .def(py::init<>())
+        .def_readwrite("sigma_pp_cm2", &CalorimetryConfig::sigma_pp_cm2)
+        .def_readwrite("beta", &CalorimetryConfig::beta)
+        .def_readwrite("f_vAi", &CalorimetryConfig::f_vAi)
+        .def_readwrite("D_0__cm2sm1", &CalorimetryConfig::D_0__cm2sm1)
+        .def_readwrite("D_0_halo__cm2sm1", &CalorimetryConfig::D_0_halo__cm2sm1)
+        .def_readwrite("delta", &CalorimetryConfig::delta);
+
+    m.def("hyp0f1", py::vectorize(hyp0f1), "Confluent hypergeometric limit function 0F1(; b; x), x >= 0",
+          py::arg("b"), py::arg("x"));
+
+    // The tables are read-only views into the object, the splines references to it; the diffusion coefficients are
+    // single rows shared by every galaxy
+    py::class_<Calorimetry>(m, "Calorimetry", "f_cal and diffusion coefficients of every galaxy of a structure")
+        .def(py::init([](const GalaxyStructure &structure, c_array_d T_CR__GeV, c_array_d E_CRe__GeV,
+                         const CalorimetryConfig &config, bool splines) {
+                 std::vector<double> T(T_CR__GeV.data(), T_CR__GeV.data() + T_CR__GeV.size());
+                 std::vector<double> E(E_CRe__GeV.data(), E_CRe__GeV.data() + E_CRe__GeV.size());
+                 py::gil_scoped_release release;
+                 return new Calorimetry(structure, T, E, config, splines);
+             }),
+             "f_cal of every galaxy and the shared D over T_CR__GeV, the shared D_e and D_e_halo over E_CRe__GeV; "
+             "with splines=True also one Spline1D per galaxy of f_cal and one of D_e and of D_e_halo",
+             py::arg("structure"), py::arg("T_CR__GeV"), py::arg("E_CRe__GeV"),
+             py::arg("config") = CalorimetryConfig(), py::arg("splines") = true)
+        .def_property_readonly("n_gal", &Calorimetry::n_gal)
+        .def_property_readonly("T_CR__GeV", [](py::object self) {
+            const std::vector<double> &T = self.cast<const Calorimetry &>().T_CR__GeV();
+            return readonly_view({(py::ssize_t) T.size()}, T.data(), self);
+        })
+        .def_property_readonly("E_CRe__GeV", [](py::object self) {
+            const std::vector<double> &E = self.cast<const Calorimetry &>().E_CRe__GeV();
+            return readonly_view({(py::ssize_t) E.size()}, E.data(), self);
+        })
+        .def_property_readonly("f_cal", [](py::object self) {
+            const Calorimetry &c = self.cast<const Calorimetry &>();
+            return readonly_view({(py::ssize_t) c.n_gal(), (py::ssize_t) c.n_T_CR()}, c.f_cal(), self);
+        }, "Shape (n_gal, n_T_CR)")
+        .def_property_readonly("D__cm2sm1", [](py::object self) {
+            const Calorimetry &c = self.cast<const Calorimetry &>();
+            return readonly_view({(py::ssize_t) c.n_T_CR()}, c.D__cm2sm1(), self);
+        }, "Proton diffusion coefficients of every galaxy, shape (n_T_CR,)")
+        .def_property_readonly("D_e__cm2sm1", [](py::object self) {
+            const Calorimetry &c = self.cast<const Calorimetry &>();
+            return readonly_view({(py::ssize_t) c.n_E_CRe()}, c.D_e__cm2sm1(), self);
+        }, "Electron diffusion coefficients in the disc of every galaxy, shape (n_E_CRe,)")
+        .def_property_readonly("D_e_halo__cm2sm1", [](py::object self) {
+            const Calorimetry &c = self.cast<const Calorimetry &>();
+            return readonly_view({(py::ssize_t) c.n_E_CRe()}, c.D_e_halo__cm2sm1(), self);
+        }, "Electron diffusion coefficients in the halo of every galaxy, shape (n_E_CRe,)")
+        .def("f_cal_spline", [](const Calorimetry &c, size_t i) -> const Spline1D & {
+            if (!c.has_splines()) throw std::runtime_error("The splines were not built (splines=False)");
+            if (i >= c.n_gal()) throw py::index_error("Galaxy index out of range");
+            return c.f_cal_spline(i);
+        }, py::return_value_policy::reference_internal, py::arg("i"))
+        .def("D_e_spline", [](const Calorimetry &c) -> const Spline1D & {
+            if (!c.has_splines()) throw std::runtime_error("The splines were not built (splines=False)");
+            return c.D_e_spline();
+        }, py::return_value_policy::reference_internal, "Shared by every galaxy")
+        .def("D_e_halo_spline", [](const Calorimetry &c) -> const Spline1D & {
+            if (!c.has_splines()) throw std::runtime_error("The splines were not built (splines=False)");
+            return c.D_e_halo_spline();
+        }, py::return_value_policy::reference_internal, "Shared by every galaxy");
+}
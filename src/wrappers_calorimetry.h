@@ -0,0 +1,94 @@
+/**
+ * Proton calorimetry
+ * Computes, for every galaxy of a GalaxyStructure, the fraction f_cal(T) of
+ * the cosmic-ray proton energy lost to pp collisions before the protons
+ * escape the disc, and the diffusion coefficients of the protons and of the
+ * electrons in the disc and the halo.
+ *
+ * Diffusion follows D(p) = D_0 (p c / GeV)^delta, by default the Milky Way
+ * estimate noted in CR_spectra/diffusion.h, with D_0 set separately for the
+ * halo. Protons interact on t_pp = 1/(n_H sigma_pp c beta_p) and escape by
+ * diffusion over the scale height and by streaming at f_vAi v_Ai:
+ *   1/t_esc = D/h^2 + f_vAi v_Ai/h,   tau_eff = t_esc/t_pp
+ *   f_cal = 1 - 1/0F1(; beta; tau_eff)
+ * so f_cal goes as tau_eff/beta in escape-dominated galaxies and to 1 in
+ * calorimetric ones; beta is the parameter of that name in spectra_main.py.
+ *
+ * f_cal is kept as an (n_gal, n_T_CR) block for run_catalog, and optionally as
+ * one Spline1D per galaxy for GalaxySpectraPipeline.run. The diffusion
+ * coefficients do not depend on the galaxy, so each is a single row (and one
+ * Spline1D) shared by all of them.
+ */
+
+#ifndef WRAPPERS_CALORIMETRY_H
+#define WRAPPERS_CALORIMETRY_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <memory>
+#include <vector>
+#include "wrappers_handles.h"
+#include "wrappers_structure.h"
+
+namespace py = pybind11;
+
+// Settings of the calorimetry, the defaults of spectra_main.py and the pipeline
+struct CalorimetryConfig {
+    double sigma_pp_cm2 = 40e-27;
+    double beta = 0.25;
+    // Streaming speed in units of the ion Alfven speed
+    double f_vAi = 1.;
+    // D at p c = 1 GeV in the disc and the halo, and its momentum index
+    double D_0__cm2sm1 = 3e27;
+    double D_0_halo__cm2sm1 = 3e27;
+    double delta = 0.5;
+};
+
+// 0F1(; b; x) for x >= 0, infinite once it passes 1e300
+double hyp0f1(double b, double x);
+
+class Calorimetry {
+public:
+    /**
+     * @param structure Galaxies
+     * @param T_CR__GeV Proton kinetic energies of f_cal and D
+     * @param E_CRe__GeV Electron energies of D_e and D_e_halo
+     * @param config Settings
+     * @param splines Also build a Spline1D per galaxy of f_cal, and one of D_e and of D_e_halo
+     */
+    Calorimetry(const GalaxyStructure &structure, const std::vector<double> &T_CR__GeV,
+                const std::vector<double> &E_CRe__GeV, const CalorimetryConfig &config, bool splines);
+
+    size_t n_gal() const { return n_gal_; }
+    size_t n_T_CR() const { return T_CR__GeV_.size(); }
+    size_t n_E_CRe() const { return E_CRe__GeV_.size(); }
+    bool has_splines() const { return D_e_so_ != nullptr; }
+    const std::vector<double> &T_CR__GeV() const { return T_CR__GeV_; }
+    const std::vector<double> &E_CRe__GeV() const { return E_CRe__GeV_; }
+
+    // f_cal of shape (n_gal, n_T_CR); D over T_CR and D_e, D_e_halo over E_CRe, shared by every galaxy
+    const double *f_cal() const { return f_cal_.data(); }
+    const double *D__cm2sm1() const { return D_.data(); }
+    const double *D_e__cm2sm1() const { return D_e_.data(); }
+    const double *D_e_halo__cm2sm1() const { return D_e_halo_.data(); }
+
+    // Splines of f_cal of galaxy i and of the shared D_e, D_e_halo, when built
+    const Spline1D &f_cal_spline(size_t i) const { return f_cal_so_[i]; }
+    const Spline1D &D_e_spline() const { return *D_e_so_; }
+    const Spline1D &D_e_halo_spline() const { return *D_e_halo_so_; }
+
+    // Point the grids and tables of cols at these
+    void fill_columns(CatalogColumns &cols) const;
+
+private:
+    size_t n_gal_;
+    std::vector<double> T_CR__GeV_, E_CRe__GeV_;
+    std::vector<double> f_cal_, D_, D_e_, D_e_halo_;
+    std::vector<Spline1D> f_cal_so_;
+    std::unique_ptr<Spline1D> D_e_so_, D_e_halo_so_;
+};
+
+// Bind to Python module
+void bind_calorimetry_functions(py::module &m);
+
+#endif
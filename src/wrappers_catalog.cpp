@@ -0,0 +1,417 @@
+/**
+ * Implementation of the catalog driver
+ */
+
+#include "wrappers_catalog.h"
+#include "wrappers_writer.h"
+#include "wrappers_precision.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+GalaxyParams CatalogColumns::galaxy(size_t i) const {
+    GalaxyParams gal;
+    gal.z = z[i];
+    gal.M_star__Msol = M_star__Msol[i];
+    gal.Re__kpc = Re__kpc[i];
+    gal.SFR__Msolyrm1 = SFR__Msolyrm1[i];
+    gal.T_dust__K = T_dust__K[i];
+    gal.h__pc = h__pc[i];
+    gal.n_H__cmm3 = n_H__cmm3[i];
+    gal.B__G = B__G[i];
+    gal.h_halo__pc = h_halo__pc[i];
+    gal.n_H_halo__cmm3 = n_H_halo__cmm3[i];
+    gal.B_halo__G = B_halo__G[i];
+    return gal;
+}
+
+// CostModel
+
+CostModel::CostModel() : n_obs_(0), fitted_(false) {
+    std::fill(XtX_, XtX_ + COST_MODEL_NFEAT * COST_MODEL_NFEAT, 0.);
+    std::fill(Xty_, Xty_ + COST_MODEL_NFEAT, 0.);
+    std::fill(coef_, coef_ + COST_MODEL_NFEAT, 0.);
+}
+
+CostModel::CostModel(const std::string &filename) : CostModel() {
+    FILE *fp = fopen(filename.c_str(), "r");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't read cost model " + filename);
+    }
+    unsigned long n_obs;
+    bool ok = fscanf(fp, "%lu", &n_obs) == 1;
+    for (int k = 0; ok && k < COST_MODEL_NFEAT * COST_MODEL_NFEAT; k++) ok = fscanf(fp, "%lf", &XtX_[k]) == 1;
+    for (int k = 0; ok && k < COST_MODEL_NFEAT; k++) ok = fscanf(fp, "%lf", &Xty_[k]) == 1;
+    fclose(fp);
+    if (!ok) {
+        throw std::runtime_error("Malformed cost model " + filename);
+    }
+    n_obs_ = n_obs;
+}
+
+void CostModel::features(const GalaxyParams &gal, double x[COST_MODEL_NFEAT]) {
+    x[0] = 1.;
+    x[1] = log(fmax(gal.n_H__cmm3, 1e-300));
+    x[2] = log(fmax(gal.B__G, 1e-300));
+    x[3] = log(fmax(gal.SFR__Msolyrm1, 1e-300));
+    x[4] = log(fmax(gal.h__pc, 1e-300));
+    x[5] = log(1. + gal.z);
+}
+
+// Solve the normal equations by Gaussian elimination, with a small ridge for catalogs that don't span every feature
+void CostModel::refit() const {
+    const int n = COST_MODEL_NFEAT;
+    double A[n][n + 1];
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < n; c++) A[r][c] = XtX_[r * n + c] + (r == c ? 1e-6 * (1. + XtX_[r * n + c]) : 0.);
+        A[r][n] = Xty_[r];
+    }
+    for (int p = 0; p < n; p++) {
+        int piv = p;
+        for (int r = p + 1; r < n; r++) {
+            if (fabs(A[r][p]) > fabs(A[piv][p])) piv = r;
+        }
+        for (int c = 0; c <= n; c++) std::swap(A[p][c], A[piv][c]);
+        for (int r = p + 1; r < n; r++) {
+            double f = A[r][p] / A[p][p];
+            for (int c = p; c <= n; c++) A[r][c] -= f * A[p][c];
+        }
+    }
+    for (int r = n - 1; r >= 0; r--) {
+        double s = A[r][n];
+        for (int c = r + 1; c < n; c++) s -= A[r][c] * coef_[c];
+        coef_[r] = s / A[r][r];
+    }
+    fitted_ = true;
+}
+
+double CostModel::predict(const GalaxyParams &gal) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (n_obs_ < 2 * COST_MODEL_NFEAT) return 1.;
+    if (!fitted_) refit();
+    double x[COST_MODEL_NFEAT];
+    features(gal, x);
+    double log_t = 0.;
+    for (int k = 0; k < COST_MODEL_NFEAT; k++) log_t += coef_[k] * x[k];
+    return exp(log_t);
+}
+
+void CostModel::observe(const GalaxyParams &gal, double seconds) {
+    double x[COST_MODEL_NFEAT];
+    features(gal, x);
+    double y = log(fmax(seconds, 1e-9));
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int r = 0; r < COST_MODEL_NFEAT; r++) {
+        for (int c = 0; c < COST_MODEL_NFEAT; c++) XtX_[r * COST_MODEL_NFEAT + c] += x[r] * x[c];
+        Xty_[r] += x[r] * y;
+    }
+    n_obs_++;
+    fitted_ = false;
+}
+
+size_t CostModel::n_observations() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return n_obs_;
+}
+
+void CostModel::save(const std::string &filename) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FILE *fp = fopen(filename.c_str(), "w");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't write cost model " + filename);
+    }
+    fprintf(fp, "%lu\n", (unsigned long) n_obs_);
+    for (int k = 0; k < COST_MODEL_NFEAT * COST_MODEL_NFEAT; k++) fprintf(fp, "%.17g\n", XtX_[k]);
+    for (int k = 0; k < COST_MODEL_NFEAT; k++) fprintf(fp, "%.17g\n", Xty_[k]);
+    if (fclose(fp) != 0) {
+        throw std::runtime_error("Error writing cost model " + filename);
+    }
+}
+
+// Work-stealing run
+
+namespace {
+
+struct WorkerDeque {
+    std::mutex mutex;
+    std::deque<size_t> galaxies;
+};
+
+struct Finished {
+    size_t i;
+    GalaxySpectra spectra;
+};
+
+class CatalogRun {
+public:
+    CatalogRun(const GalaxySpectraPipeline &pipeline, const CatalogColumns &cols, size_t n_workers,
+               CostModel *cost_model)
+        : pipeline_(pipeline), cols_(cols), cost_model_(cost_model), precision_(precision_current()),
+          deques_(n_workers), abort_(false) {
+        // Longest expected first, dealt round-robin so every worker starts with a similar share
+        std::vector<double> cost(cols.n_gal, 1.);
+        if (cost_model != NULL) {
+            for (size_t i = 0; i < cols.n_gal; i++) cost[i] = cost_model->predict(cols.galaxy(i));
+        }
+        std::vector<size_t> order(cols.n_gal);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&cost](size_t a, size_t b) { return cost[a] > cost[b]; });
+        for (size_t k = 0; k < order.size(); k++) {
+            deques_[k % n_workers].galaxies.push_back(order[k]);
+        }
+
+        for (size_t w = 0; w < n_workers; w++) {
+            workers_.emplace_back(&CatalogRun::worker_loop, this, w);
+        }
+    }
+
+    ~CatalogRun() {
+        stop();
+    }
+
+    // Hand finished galaxies to the sink until all are done (GIL held)
+    void drain(SpectraSink &sink) {
+        size_t n_done = 0;
+        while (n_done < cols_.n_gal) {
+            std::deque<Finished> batch;
+            {
+                py::gil_scoped_release release;
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return !finished_.empty() || !error_.empty(); });
+                if (!error_.empty()) break;
+                batch.swap(finished_);
+            }
+            for (Finished &f : batch) {
+                sink.consume(f.i, std::move(f.spectra));
+                n_done++;
+            }
+        }
+        stop();
+        if (!error_.empty()) {
+            throw std::runtime_error(error_);
+        }
+    }
+
+    // Stop taking galaxies and join the workers (GIL held)
+    void stop() {
+        abort_ = true;
+        py::gil_scoped_release release;
+        for (std::thread &w : workers_) {
+            if (w.joinable()) w.join();
+        }
+    }
+
+private:
+    // Next galaxy of worker w: its own largest remaining, otherwise the largest remaining of another worker
+    bool take(size_t w, size_t &i) {
+        size_t n = deques_.size();
+        for (size_t k = 0; k < n; k++) {
+            WorkerDeque &d = deques_[(w + k) % n];
+            std::lock_guard<std::mutex> lock(d.mutex);
+            if (!d.galaxies.empty()) {
+                i = d.galaxies.front();
+                d.galaxies.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(size_t w) {
+        // The workers run under the profile of the thread that started the run
+        PrecisionScope worker_precision(precision_);
+        size_t i;
+        while (!abort_ && take(w, i)) {
+            try {
+                GalaxyParams gal = cols_.galaxy(i);
+                Spline1D f_cal(gsl_so1D(cols_.n_T_CR, cols_.T_CR__GeV, cols_.f_cal + i * cols_.n_T_CR));
+                Spline1D D_e(gsl_so1D(cols_.n_E_CRe, cols_.E_CRe__GeV, cols_.D_e__cm2sm1 + i * cols_.D_e_stride));
+                Spline1D D_e_halo(gsl_so1D(cols_.n_E_CRe, cols_.E_CRe__GeV,
+                                           cols_.D_e_halo__cm2sm1 + i * cols_.D_e_stride));
+
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                GalaxySpectra spectra = pipeline_.run(gal, f_cal, D_e, D_e_halo);
+                std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+                if (cost_model_ != NULL) cost_model_->observe(gal, dt.count());
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    finished_.push_back(Finished{i, std::move(spectra)});
+                }
+                cv_.notify_one();
+            } catch (const std::exception &e) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (error_.empty()) error_ = "Galaxy " + std::to_string(i) + ": " + e.what();
+                }
+                abort_ = true;
+                cv_.notify_one();
+                return;
+            }
+        }
+    }
+
+    const GalaxySpectraPipeline &pipeline_;
+    const CatalogColumns &cols_;
+    CostModel *cost_model_;
+    precision_profile precision_;
+    std::vector<WorkerDeque> deques_;
+    std::vector<std::thread> workers_;
+    std::atomic<bool> abort_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Finished> finished_;
+    std::string error_;
+};
+
+// Copies each galaxy into its slot of an (n_gal, N_GALAXY_SPECTRA, n_E) block
+class ArraySink : public SpectraSink {
+public:
+    ArraySink(double *out, size_t n_E) : out_(out), n_E_(n_E) {}
+    void consume(size_t i, GalaxySpectra &&spectra) override {
+        size_t n = N_GALAXY_SPECTRA * n_E_;
+        std::memcpy(out_ + i * n, spectra.row(0), sizeof(double) * n);
+    }
+
+private:
+    double *out_;
+    size_t n_E_;
+};
+
+// Shifts the indices passed on to another sink, for catalogs run a chunk at a time
+class OffsetSink : public SpectraSink {
+public:
+    OffsetSink(SpectraSink &sink, size_t offset) : sink_(sink), offset_(offset) {}
+    void consume(size_t i, GalaxySpectra &&spectra) override {
+        sink_.consume(offset_ + i, std::move(spectra));
+    }
+
+private:
+    SpectraSink &sink_;
+    size_t offset_;
+};
+
+class CallbackSink : public SpectraSink {
+public:
+    explicit CallbackSink(py::object callback) : callback_(callback) {}
+    void consume(size_t i, GalaxySpectra &&spectra) override {
+        callback_(i, py::cast(std::move(spectra)));
+    }
+
+private:
+    py::object callback_;
+};
+
+}
+
+void run_catalog(const GalaxySpectraPipeline &pipeline, const CatalogColumns &cols, SpectraSink &sink,
+                 size_t n_workers, CostModel *cost_model) {
+    if (cols.n_gal == 0) return;
+    if (n_workers == 0) n_workers = std::max(1u, std::thread::hardware_concurrency());
+    n_workers = std::min(n_workers, cols.n_gal);
+
+    CatalogRun run(pipeline, cols, n_workers, cost_model);
+    run.drain(sink);
+}
+
+py::object run_catalog_wrapper(const GalaxySpectraPipeline &pipeline, py::dict galaxies, c_array_d T_CR__GeV,
+                               c_array_d f_cal, c_array_d E_CRe__GeV, c_array_d D_e__cm2sm1,
+                               c_array_d D_e_halo__cm2sm1, size_t n_workers, py::object callback,
+                               CostModel *cost_model, SpectraWriter *writer, size_t offset) {
+    static const char *names[] = {
+        "z", "M_star__Msol", "Re__kpc", "SFR__Msolyrm1", "T_dust__K", "h__pc", "n_H__cmm3", "B__G",
+        "h_halo__pc", "n_H_halo__cmm3", "B_halo__G",
+    };
+    const size_t n_cols = sizeof(names) / sizeof(names[0]);
+
+    // The converted columns must stay alive for the whole run
+    std::vector<c_array_d> columns;
+    for (size_t k = 0; k < n_cols; k++) {
+        if (!galaxies.contains(names[k])) {
+            throw std::runtime_error(std::string("galaxies is missing column ") + names[k]);
+        }
+        columns.push_back(galaxies[names[k]].cast<c_array_d>());
+        if (columns[k].size() != columns[0].size()) {
+            throw std::runtime_error(std::string("Column ") + names[k] + " has the wrong length");
+        }
+    }
+
+    CatalogColumns cols;
+    cols.n_gal = columns[0].size();
+    const double **col_ptr[] = {
+        &cols.z, &cols.M_star__Msol, &cols.Re__kpc, &cols.SFR__Msolyrm1, &cols.T_dust__K, &cols.h__pc,
+        &cols.n_H__cmm3, &cols.B__G, &cols.h_halo__pc, &cols.n_H_halo__cmm3, &cols.B_halo__G,
+    };
+    for (size_t k = 0; k < n_cols; k++) *col_ptr[k] = columns[k].data();
+
+    check_grid("T_CR__GeV", T_CR__GeV.data(), T_CR__GeV.size());
+    check_grid("E_CRe__GeV", E_CRe__GeV.data(), E_CRe__GeV.size());
+    cols.n_T_CR = T_CR__GeV.size();
+    cols.n_E_CRe = E_CRe__GeV.size();
+    if ((size_t) f_cal.size() != cols.n_gal * cols.n_T_CR) {
+        throw std::runtime_error("f_cal must have shape (n_gal, len(T_CR__GeV))");
+    }
+    // One row shared by every galaxy, or one row per galaxy
+    if (D_e__cm2sm1.ndim() != D_e_halo__cm2sm1.ndim() ||
+        (D_e__cm2sm1.ndim() == 1 && ((size_t) D_e__cm2sm1.size() != cols.n_E_CRe ||
+                                     (size_t) D_e_halo__cm2sm1.size() != cols.n_E_CRe)) ||
+        (D_e__cm2sm1.ndim() != 1 && ((size_t) D_e__cm2sm1.size() != cols.n_gal * cols.n_E_CRe ||
+                                     (size_t) D_e_halo__cm2sm1.size() != cols.n_gal * cols.n_E_CRe))) {
+        throw std::runtime_error("D_e__cm2sm1 and D_e_halo__cm2sm1 must both have shape (len(E_CRe__GeV),) "
+                                 "or both (n_gal, len(E_CRe__GeV))");
+    }
+    cols.D_e_stride = D_e__cm2sm1.ndim() == 1 ? 0 : cols.n_E_CRe;
+    cols.T_CR__GeV = T_CR__GeV.data();
+    cols.f_cal = f_cal.data();
+    cols.E_CRe__GeV = E_CRe__GeV.data();
+    cols.D_e__cm2sm1 = D_e__cm2sm1.data();
+    cols.D_e_halo__cm2sm1 = D_e_halo__cm2sm1.data();
+
+    if (writer != nullptr && !callback.is_none()) {
+        throw std::runtime_error("Pass either callback or writer, not both");
+    }
+    if (writer != nullptr) {
+        OffsetSink sink(*writer, offset);
+        run_catalog(pipeline, cols, sink, n_workers, cost_model);
+        return py::none();
+    }
+    if (!callback.is_none()) {
+        CallbackSink callback_sink(callback);
+        OffsetSink sink(callback_sink, offset);
+        run_catalog(pipeline, cols, sink, n_workers, cost_model);
+        return py::none();
+    }
+
+    size_t n_E = pipeline.E_gam__GeV().size();
+    py::array_t<double> out({(py::ssize_t) cols.n_gal, (py::ssize_t) N_GALAXY_SPECTRA, (py::ssize_t) n_E});
+    ArraySink sink(out.mutable_data(), n_E);
+    run_catalog(pipeline, cols, sink, n_workers, cost_model);
+    return out;
+}
+
+void bind_catalog_functions(py::module &m) {
+    py::class_<CostModel>(m, "CostModel", "Expected per-galaxy run time, fitted to the timings of earlier runs")
+        .def(py::init<>())
+        .def(py::init<const std::string &>(), py::arg("filename"))
+        .def("predict", &CostModel::predict, "Expected seconds for a galaxy", py::arg("galaxy"))
+        .def("observe", &CostModel::observe, py::arg("galaxy"), py::arg("seconds"))
+        .def("save", &CostModel::save, py::arg("filename"))
+        .def_property_readonly("n_observations", &CostModel::n_observations);
+
+    m.def("run_catalog", &run_catalog_wrapper,
+          "Run a catalog through the pipeline on a work-stealing pool, longest expected galaxies first; D_e__cm2sm1 "
+          "and D_e_halo__cm2sm1 are a single row shared by every galaxy or one row per galaxy",
+          py::arg("pipeline"), py::arg("galaxies"), py::arg("T_CR__GeV"), py::arg("f_cal"),
+          py::arg("E_CRe__GeV"), py::arg("D_e__cm2sm1"), py::arg("D_e_halo__cm2sm1"),
+          py::arg("n_workers") = 0, py::arg("callback") = py::none(), py::arg("cost_model") = py::none(),
+          py::arg("writer") = py::none(), py::arg("offset") = 0);
+}
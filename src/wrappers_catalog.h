@@ -0,0 +1,95 @@
+/**
+ * Catalog-scale driver for the per-galaxy pipeline
+ * Spreads the galaxies of a catalog over worker threads that share one
+ * GalaxySpectraPipeline (and so one set of IC/BS/SY tables). Galaxies are
+ * dealt out longest-expected-first according to a cost model fitted to the
+ * timings of earlier runs, each worker works through its own deque and
+ * steals from the others when it runs dry. Finished galaxies are handed to
+ * a sink on the calling thread as they complete, in completion order.
+ */
+
+#ifndef WRAPPERS_CATALOG_H
+#define WRAPPERS_CATALOG_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <mutex>
+#include <string>
+#include "wrappers_pipeline.h"
+
+namespace py = pybind11;
+
+// Per-galaxy inputs of a catalog as columns (not owned). f_cal has one row of n_T_CR values over T_CR__GeV
+// per galaxy, the diffusion coefficients rows of n_E_CRe values over E_CRe__GeV D_e_stride apart, so a
+// D_e_stride of 0 shares a single row between all galaxies
+struct CatalogColumns {
+    size_t n_gal;
+    const double *z, *M_star__Msol, *Re__kpc, *SFR__Msolyrm1, *T_dust__K;
+    const double *h__pc, *n_H__cmm3, *B__G, *h_halo__pc, *n_H_halo__cmm3, *B_halo__G;
+    size_t n_T_CR;
+    const double *T_CR__GeV, *f_cal;
+    size_t n_E_CRe;
+    const double *E_CRe__GeV, *D_e__cm2sm1, *D_e_halo__cm2sm1;
+    size_t D_e_stride;
+
+    GalaxyParams galaxy(size_t i) const;
+};
+
+// Receives finished galaxies, called on the thread that runs the catalog with the GIL held
+class SpectraSink {
+public:
+    virtual ~SpectraSink() {}
+    virtual void consume(size_t i, GalaxySpectra &&spectra) = 0;
+};
+
+// Expected run time of a galaxy, a least-squares fit of log(seconds) against the log galaxy properties.
+// Observations accumulate over runs and can be saved, so a new run starts from the timings of earlier ones
+#define COST_MODEL_NFEAT 6
+
+class CostModel {
+public:
+    CostModel();
+    explicit CostModel(const std::string &filename);
+
+    // Expected seconds, 1 for every galaxy until the model has enough observations
+    double predict(const GalaxyParams &gal) const;
+    void observe(const GalaxyParams &gal, double seconds);
+    size_t n_observations() const;
+    void save(const std::string &filename) const;
+
+private:
+    static void features(const GalaxyParams &gal, double x[COST_MODEL_NFEAT]);
+    void refit() const;
+
+    mutable std::mutex mutex_;
+    double XtX_[COST_MODEL_NFEAT * COST_MODEL_NFEAT];
+    double Xty_[COST_MODEL_NFEAT];
+    size_t n_obs_;
+    mutable double coef_[COST_MODEL_NFEAT];
+    mutable bool fitted_;
+};
+
+/**
+ * Run every galaxy of a catalog through the pipeline (GIL held on entry, released while waiting)
+ * @param pipeline Pipeline shared by all workers, its config should use n_threads = 1
+ * @param cols Catalog columns
+ * @param sink Receives each galaxy as it completes
+ * @param n_workers Worker threads, 0 for one per hardware thread
+ * @param cost_model Orders the galaxies and records their timings, may be NULL
+ */
+void run_catalog(const GalaxySpectraPipeline &pipeline, const CatalogColumns &cols, SpectraSink &sink,
+                 size_t n_workers, CostModel *cost_model);
+
+class SpectraWriter;
+
+// Python entry point: galaxies is a dict of GalaxyParams columns. Returns the (n_gal, 16, n_E) spectra,
+// or None when every galaxy is passed to callback(offset + i, spectra) or to the writer at row offset + i instead
+py::object run_catalog_wrapper(const GalaxySpectraPipeline &pipeline, py::dict galaxies, c_array_d T_CR__GeV,
+                               c_array_d f_cal, c_array_d E_CRe__GeV, c_array_d D_e__cm2sm1,
+                               c_array_d D_e_halo__cm2sm1, size_t n_workers, py::object callback,
+                               CostModel *cost_model, SpectraWriter *writer, size_t offset);
+
+// Bind to Python module
+void bind_catalog_functions(py::module &m);
+
+#endif
@@ -0,0 +1,282 @@
+/**
+ * Implementation of the chunked catalog readers
+ */
+
+#include "wrappers_catalog_io.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::unique_ptr<CatalogReader> CatalogReader::open(const std::string &filename) {
+    char magic[8] = { 0 };
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't open catalog " + filename);
+    }
+    size_t n = fread(magic, 1, 8, fp);
+    fclose(fp);
+
+    if (n == 8 && memcmp(magic, CATALOG_BIN_MAGIC, 8) == 0) {
+        return std::unique_ptr<CatalogReader>(new BinaryCatalogReader(filename));
+    }
+    return std::unique_ptr<CatalogReader>(new TextCatalogReader(filename));
+}
+
+// Text catalogs
+
+// Next line of fp into line (grown as needed), false at the end of the file
+static bool read_line(FILE *fp, char **line, size_t *cap) {
+    return getline(line, cap, fp) != -1;
+}
+
+TextCatalogReader::TextCatalogReader(const std::string &filename) : filename_(filename) {
+    fp_ = fopen(filename.c_str(), "r");
+    if (fp_ == NULL) {
+        throw std::runtime_error("Can't open catalog " + filename);
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    char *end;
+    bool ok = read_line(fp_, &line, &cap) && read_line(fp_, &line, &cap);
+    long long n = ok ? strtoll(line, &end, 10) : -1;
+    ok = ok && end != line && n >= 0 && read_line(fp_, &line, &cap);
+    free(line);
+    if (!ok) {
+        fclose(fp_);
+        throw std::runtime_error("Malformed catalog header in " + filename);
+    }
+    n_gal_ = n;
+    pos_ = 0;
+}
+
+TextCatalogReader::~TextCatalogReader() {
+    fclose(fp_);
+}
+
+bool TextCatalogReader::next(size_t max_rows, CatalogChunk &chunk) {
+    size_t n = std::min(max_rows, n_gal_ - pos_);
+    if (n == 0) return false;
+
+    rows_.resize(n * CATALOG_NCOL);
+    char *line = NULL;
+    size_t cap = 0;
+    for (size_t j = 0; j < n; j++) {
+        if (!read_line(fp_, &line, &cap)) {
+            free(line);
+            throw std::runtime_error(filename_ + " ends after " + std::to_string(pos_ + j) + " of " +
+                                     std::to_string(n_gal_) + " galaxies");
+        }
+        const char *p = line;
+        for (int c = 0; c < CATALOG_NCOL; c++) {
+            char *end;
+            rows_[j * CATALOG_NCOL + c] = strtod(p, &end);
+            if (end == p) {
+                free(line);
+                throw std::runtime_error("Malformed row for galaxy " + std::to_string(pos_ + j) + " in " + filename_);
+            }
+            p = end;
+        }
+    }
+    free(line);
+
+    chunk.offset = pos_;
+    chunk.n = n;
+    for (int c = 0; c < CATALOG_NCOL; c++) chunk.col[c] = rows_.data() + c;
+    chunk.stride = CATALOG_NCOL;
+    pos_ += n;
+    return true;
+}
+
+// Binary catalogs
+
+static const size_t catalog_bin_header = 8 + 2 * sizeof(uint64_t);
+
+BinaryCatalogReader::BinaryCatalogReader(const std::string &filename) : prev_offset_(0), prev_n_(0) {
+    struct stat st;
+    uint64_t dims[2];
+
+    fd_ = ::open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Can't open catalog " + filename);
+    }
+    if (fstat(fd_, &st) != 0 || (size_t) st.st_size < catalog_bin_header) {
+        close(fd_);
+        throw std::runtime_error("Truncated catalog header in " + filename);
+    }
+    map_size_ = st.st_size;
+    map_ = mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        close(fd_);
+        throw std::runtime_error("Can't map catalog " + filename);
+    }
+
+    memcpy(dims, (const char *) map_ + 8, sizeof(dims));
+    if (dims[1] != CATALOG_NCOL || map_size_ != catalog_bin_header + sizeof(double) * dims[0] * dims[1]) {
+        munmap(map_, map_size_);
+        close(fd_);
+        throw std::runtime_error("Wrong size or number of columns in binary catalog " + filename);
+    }
+    n_gal_ = dims[0];
+    pos_ = 0;
+    data_ = (const double *) ((const char *) map_ + catalog_bin_header);
+    // Each column is read front to back
+    madvise(map_, map_size_, MADV_SEQUENTIAL);
+}
+
+BinaryCatalogReader::~BinaryCatalogReader() {
+    munmap(map_, map_size_);
+    close(fd_);
+}
+
+// Drop the whole pages holding rows [offset, offset + n) of every column. Views of them stay valid,
+// the pages are read back in if touched again
+void BinaryCatalogReader::drop(size_t offset, size_t n) {
+    long page = sysconf(_SC_PAGESIZE);
+    for (int c = 0; c < CATALOG_NCOL; c++) {
+        uintptr_t start = (uintptr_t) (data_ + c * n_gal_ + offset);
+        uintptr_t end = start + sizeof(double) * n;
+        start = (start + page - 1) & ~((uintptr_t) page - 1);
+        end = end & ~((uintptr_t) page - 1);
+        if (end > start) madvise((void *) start, end - start, MADV_DONTNEED);
+    }
+}
+
+bool BinaryCatalogReader::next(size_t max_rows, CatalogChunk &chunk) {
+    if (prev_n_ > 0) {
+        drop(prev_offset_, prev_n_);
+        prev_n_ = 0;
+    }
+    size_t n = std::min(max_rows, n_gal_ - pos_);
+    if (n == 0) return false;
+
+    chunk.offset = pos_;
+    chunk.n = n;
+    for (int c = 0; c < CATALOG_NCOL; c++) chunk.col[c] = data_ + c * n_gal_ + pos_;
+    chunk.stride = 1;
+    prev_offset_ = pos_;
+    prev_n_ = n;
+    pos_ += n;
+    return true;
+}
+
+// Writers
+
+// Open a binary catalog of n_gal galaxies for writing, with its header in place
+static FILE *open_catalog_bin(const std::string &filename, size_t n_gal) {
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't write catalog " + filename);
+    }
+    uint64_t dims[2] = { n_gal, CATALOG_NCOL };
+    fwrite(CATALOG_BIN_MAGIC, 1, 8, fp);
+    fwrite(dims, sizeof(uint64_t), 2, fp);
+    return fp;
+}
+
+static void close_catalog_bin(FILE *fp, const std::string &filename, bool ok) {
+    if (ferror(fp) || fclose(fp) != 0 || !ok) {
+        throw std::runtime_error("Error writing catalog " + filename + ": incomplete output");
+    }
+}
+
+void catalog_text_to_bin(const std::string &infile, const std::string &outfile, size_t chunk_size) {
+    if (chunk_size == 0) {
+        throw std::runtime_error("chunk_size must be positive");
+    }
+    TextCatalogReader reader(infile);
+    FILE *fp = open_catalog_bin(outfile, reader.n_gal());
+    size_t n_gal = reader.n_gal();
+    std::vector<double> column;
+    CatalogChunk chunk;
+    bool ok = true;
+
+    try {
+        // Each chunk goes to its slot in every column
+        while (ok && reader.next(chunk_size, chunk)) {
+            column.resize(chunk.n);
+            for (int c = 0; ok && c < CATALOG_NCOL; c++) {
+                for (size_t j = 0; j < chunk.n; j++) column[j] = chunk.col[c][j * chunk.stride];
+                ok = fseeko(fp, catalog_bin_header + sizeof(double) * (c * n_gal + chunk.offset), SEEK_SET) == 0 &&
+                     fwrite(column.data(), sizeof(double), chunk.n, fp) == chunk.n;
+            }
+        }
+    } catch (...) {
+        fclose(fp);
+        throw;
+    }
+    close_catalog_bin(fp, outfile, ok);
+}
+
+void write_catalog_bin(const std::string &filename, c_array_d gal_data) {
+    if (gal_data.ndim() != 2 || gal_data.shape(1) != CATALOG_NCOL) {
+        throw std::runtime_error("gal_data must have shape (n_gal, 4)");
+    }
+    size_t n_gal = gal_data.shape(0);
+    const double *rows = gal_data.data();
+    FILE *fp = open_catalog_bin(filename, n_gal);
+    std::vector<double> column(n_gal);
+    bool ok = true;
+    for (int c = 0; ok && c < CATALOG_NCOL; c++) {
+        for (size_t j = 0; j < n_gal; j++) column[j] = rows[j * CATALOG_NCOL + c];
+        ok = fwrite(column.data(), sizeof(double), n_gal, fp) == n_gal;
+    }
+    close_catalog_bin(fp, filename, ok);
+}
+
+// Python iterator
+
+CatalogFile::CatalogFile(const std::string &filename, size_t chunk_size)
+    : reader_(CatalogReader::open(filename)), chunk_size_(chunk_size) {
+    if (chunk_size == 0) {
+        throw std::runtime_error("chunk_size must be positive");
+    }
+}
+
+py::tuple CatalogFile::next(py::object self) {
+    CatalogChunk chunk;
+    bool more;
+    {
+        py::gil_scoped_release release;
+        more = reader_->next(chunk_size_, chunk);
+    }
+    if (!more) {
+        throw py::stop_iteration();
+    }
+
+    std::vector<py::ssize_t> shape = { (py::ssize_t) chunk.n, CATALOG_NCOL };
+    py::array_t<double> gal_data;
+    if (chunk.stride == 1) {
+        // Binary: a view across the four columns of the mapping, kept alive by the CatalogFile
+        std::vector<py::ssize_t> strides = { (py::ssize_t) sizeof(double),
+                                             (py::ssize_t) (sizeof(double) * reader_->n_gal()) };
+        gal_data = py::array_t<double>(shape, strides, chunk.col[0], self);
+        gal_data.attr("setflags")(py::arg("write") = false);
+    } else {
+        // Text: the row buffer is reused for the next chunk
+        gal_data = py::array_t<double>(shape, chunk.col[0]);
+    }
+    return py::make_tuple(chunk.offset, gal_data);
+}
+
+void bind_catalog_io_functions(py::module &m) {
+    py::class_<CatalogFile>(m, "CatalogFile", "Galaxy catalog (text or binary) read chunk by chunk")
+        .def(py::init<const std::string &, size_t>(), py::arg("filename"), py::arg("chunk_size") = 100000)
+        .def_property_readonly("n_gal", &CatalogFile::n_gal)
+        .def("__iter__", [](py::object self) { return self; })
+        .def("__next__", [](py::object self) { return self.cast<CatalogFile &>().next(self); });
+
+    m.def("catalog_text_to_bin", &catalog_text_to_bin,
+          "Convert a text galaxy catalog to the binary columnar format",
+          py::arg("infile"), py::arg("outfile"), py::arg("chunk_size") = 100000);
+
+    m.def("write_catalog_bin", &write_catalog_bin,
+          "Write (n_gal, 4) galaxy data (z, M_star, Re, SFR) as a binary columnar catalog",
+          py::arg("filename"), py::arg("gal_data"));
+}
@@ -0,0 +1,106 @@
+/**
+ * Chunked galaxy catalog readers
+ * Catalogs are read a fixed number of galaxies at a time, so the memory a
+ * run needs is set by the chunk size rather than the catalog size. Two
+ * formats are read:
+ *  - the text format of the original code: a comment line, the number of
+ *    galaxies, a comment line, then one "z M_star Re SFR" row per galaxy
+ *  - a binary columnar format, mapped with mmap: CATALOG_BIN_MAGIC, the
+ *    number of galaxies and of columns (uint64), then each column of
+ *    doubles in turn (z, M_star, Re, SFR)
+ * Chunks of a binary catalog are views into the mapping, and the pages of a
+ * chunk are dropped once the reader moves past it.
+ */
+
+#ifndef WRAPPERS_CATALOG_IO_H
+#define WRAPPERS_CATALOG_IO_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "wrappers_vectorize.h"
+
+namespace py = pybind11;
+
+#define CATALOG_BIN_MAGIC "CRCAT001"
+#define CATALOG_NCOL 4
+
+// Columns of one chunk: z, M_star__Msol, Re__kpc, SFR__Msolyrm1. Element j of column c is col[c][j * stride]
+struct CatalogChunk {
+    size_t offset;
+    size_t n;
+    const double *col[CATALOG_NCOL];
+    size_t stride;
+};
+
+class CatalogReader {
+public:
+    virtual ~CatalogReader() {}
+
+    size_t n_gal() const { return n_gal_; }
+    // Next chunk of at most max_rows galaxies, false once the catalog is exhausted.
+    // The chunk's data stays valid until the next call
+    virtual bool next(size_t max_rows, CatalogChunk &chunk) = 0;
+
+    // Text or binary reader, by the file's leading bytes
+    static std::unique_ptr<CatalogReader> open(const std::string &filename);
+
+protected:
+    size_t n_gal_;
+    size_t pos_;
+};
+
+class TextCatalogReader : public CatalogReader {
+public:
+    explicit TextCatalogReader(const std::string &filename);
+    ~TextCatalogReader();
+    bool next(size_t max_rows, CatalogChunk &chunk) override;
+
+private:
+    std::string filename_;
+    FILE *fp_;
+    // Row-major (n, CATALOG_NCOL) buffer of the current chunk
+    std::vector<double> rows_;
+};
+
+class BinaryCatalogReader : public CatalogReader {
+public:
+    explicit BinaryCatalogReader(const std::string &filename);
+    ~BinaryCatalogReader();
+    bool next(size_t max_rows, CatalogChunk &chunk) override;
+
+private:
+    int fd_;
+    void *map_;
+    size_t map_size_;
+    const double *data_;
+    size_t prev_offset_, prev_n_;
+
+    void drop(size_t offset, size_t n);
+};
+
+// Convert a text catalog to the binary format, chunk by chunk
+void catalog_text_to_bin(const std::string &infile, const std::string &outfile, size_t chunk_size);
+// Write (n_gal, CATALOG_NCOL) galaxy data in the binary format
+void write_catalog_bin(const std::string &filename, c_array_d gal_data);
+
+// Python iterator over the chunks of a catalog, yielding (offset, gal_data) with gal_data of shape (n, 4)
+class CatalogFile {
+public:
+    CatalogFile(const std::string &filename, size_t chunk_size);
+
+    size_t n_gal() const { return reader_->n_gal(); }
+    py::tuple next(py::object self);
+
+private:
+    std::unique_ptr<CatalogReader> reader_;
+    size_t chunk_size_;
+};
+
+// Bind to Python module
+void bind_catalog_io_functions(py::module &m);
+
+#endif
@@ -3,6 +3,8 @@
  */
 
 #include "wrappers_cosmo.h"
+#include <mutex>
+#include <stdexcept>
 
 // Direct wrappers - these functions are already simple enough
 double d_l_MPc_wrapper(double z) {
@@ -33,32 +35,193 @@ double E_z_wrapper(double z) {
     return E_z(z);
 }
 
+double distmod__cmm2_wrapper(double z) {
+    return distmod__cmm2(z);
+}
+
+static std::shared_ptr<const cosmo_table> make_cosmo_table(double z_max, unsigned int n) {
+    cosmo_table *tab = cosmo_table_alloc(z_max, n);
+    if (tab == NULL) {
+        throw std::runtime_error("Can't allocate cosmology table");
+    }
+    return std::shared_ptr<const cosmo_table>(tab, [](const cosmo_table *t) { cosmo_table_free((cosmo_table *) t); });
+}
+
+std::shared_ptr<const cosmo_table> default_cosmo_table() {
+    static std::mutex mutex;
+    static std::shared_ptr<const cosmo_table> tab;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!tab || !cosmo_table_is_current(tab.get())) {
+        tab = make_cosmo_table(COSMO_TABLE_Z_MAX_DEFAULT, COSMO_TABLE_N_DEFAULT);
+    }
+    return tab;
+}
+
+Cosmology::Cosmology(const cosmology &params, double z_max, unsigned int n) {
+    if (!(z_max > 0.) || n < 1) {
+        throw std::runtime_error("Cosmology needs z_max > 0 and n >= 1");
+    }
+    if (!(params.D_H_MPc > 0.) || !(E_z_cosmo(&params, 0.) > 0.)) {
+        throw std::runtime_error("Cosmology needs D_H_MPc > 0 and a positive expansion rate");
+    }
+    cosmo_table *tab = cosmo_table_alloc_cosmo(&params, z_max, n);
+    if (tab == NULL) {
+        throw std::runtime_error("Can't allocate cosmology table");
+    }
+    tab_ = std::shared_ptr<const cosmo_table>(tab, [](const cosmo_table *t) { cosmo_table_free((cosmo_table *) t); });
+}
+
+Cosmology Cosmology::current() {
+    return Cosmology(default_cosmo_table());
+}
+
+// The table is held for the duration of the call, even if the default is rebuilt meanwhile
+#define COSMO_TABLE_VEC1(fn) \
+    [](const cosmo_table *tab, c_array_d z) { \
+        return vectorize_broadcast({z}, [tab](const double* v) { return fn(tab, v[0]); }); \
+    }
+#define COSMO_TABLE_VEC2(fn) \
+    [](const cosmo_table *tab, c_array_d z_low, c_array_d z_high) { \
+        return vectorize_broadcast({z_low, z_high}, [tab](const double* v) { return fn(tab, v[0], v[1]); }); \
+    }
+
+py::array_t<double> d_l_MPc_vec(c_array_d z) {
+    return COSMO_TABLE_VEC1(cosmo_table_d_l_MPc)(default_cosmo_table().get(), z);
+}
+
+py::array_t<double> d_c_MPc_vec(c_array_d z_low, c_array_d z_high) {
+    return COSMO_TABLE_VEC2(cosmo_table_d_c_MPc)(default_cosmo_table().get(), z_low, z_high);
+}
+
+py::array_t<double> d_m_MPc_vec(c_array_d z) {
+    return COSMO_TABLE_VEC1(cosmo_table_d_m_MPc)(default_cosmo_table().get(), z);
+}
+
+py::array_t<double> d_a_MPc_vec(c_array_d z) {
+    return COSMO_TABLE_VEC1(cosmo_table_d_a_MPc)(default_cosmo_table().get(), z);
+}
+
+py::array_t<double> dV_c_vec(c_array_d z) {
+    return COSMO_TABLE_VEC1(cosmo_table_dV_c)(default_cosmo_table().get(), z);
+}
+
+py::array_t<double> Vc_dOm_MPc3srm1_vec(c_array_d z_low, c_array_d z_high) {
+    return COSMO_TABLE_VEC2(cosmo_table_Vc_dOm_MPc3srm1)(default_cosmo_table().get(), z_low, z_high);
+}
+
+py::array_t<double> E_z_vec(c_array_d z) {
+    return vectorize_broadcast({z}, [](const double* v) { return E_z(v[0]); });
+}
+
+py::array_t<double> distmod__cmm2_vec(c_array_d z) {
+    return COSMO_TABLE_VEC1(cosmo_table_distmod__cmm2)(default_cosmo_table().get(), z);
+}
+
 void bind_cosmo_functions(py::module &m) {
+    // The distance integrals run with the GIL released
     m.def("d_l_MPc", &d_l_MPc_wrapper, 
           "Luminosity distance in Mpc",
+          py::call_guard<py::gil_scoped_release>(),
           py::arg("z"));
     
     m.def("d_c_MPc", &d_c_MPc_wrapper,
           "Comoving distance in Mpc",
+          py::call_guard<py::gil_scoped_release>(),
           py::arg("z_low"), py::arg("z_high"));
     
     m.def("d_m_MPc", &d_m_MPc_wrapper,
           "Transverse comoving distance in Mpc",
+          py::call_guard<py::gil_scoped_release>(),
           py::arg("z"));
     
     m.def("d_a_MPc", &d_a_MPc_wrapper,
           "Angular diameter distance in Mpc",
+          py::call_guard<py::gil_scoped_release>(),
           py::arg("z"));
     
     m.def("dV_c", &dV_c_wrapper,
           "Comoving volume element",
+          py::call_guard<py::gil_scoped_release>(),
           py::arg("z"));
     
     m.def("Vc_dOm_MPc3srm1", &Vc_dOm_MPc3srm1_wrapper,
           "Comoving volume between z_low and z_high",
+          py::call_guard<py::gil_scoped_release>(),
           py::arg("z_low"), py::arg("z_high"));
     
     m.def("E_z", &E_z_wrapper,
           "Hubble expansion factor",
           py::arg("z"));
+    
+    m.def("distmod__cmm2", &distmod__cmm2_wrapper,
+          "Luminosity distance modulus 1/(4 pi d_l^2) in cm^-2",
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("z"));
+    
+    // Array overloads, tried after the scalar versions above
+    m.def("d_l_MPc", &d_l_MPc_vec, "Luminosity distance in Mpc", py::arg("z"));
+    m.def("d_c_MPc", &d_c_MPc_vec, "Comoving distance in Mpc", py::arg("z_low"), py::arg("z_high"));
+    m.def("d_m_MPc", &d_m_MPc_vec, "Transverse comoving distance in Mpc", py::arg("z"));
+    m.def("d_a_MPc", &d_a_MPc_vec, "Angular diameter distance in Mpc", py::arg("z"));
+    m.def("dV_c", &dV_c_vec, "Comoving volume element", py::arg("z"));
+    m.def("Vc_dOm_MPc3srm1", &Vc_dOm_MPc3srm1_vec, "Comoving volume between z_low and z_high",
+          py::arg("z_low"), py::arg("z_high"));
+    m.def("E_z", &E_z_vec, "Hubble expansion factor", py::arg("z"));
+    m.def("distmod__cmm2", &distmod__cmm2_vec, "Luminosity distance modulus 1/(4 pi d_l^2) in cm^-2", py::arg("z"));
+
+    py::class_<Cosmology>(m, "Cosmology",
+                          "Cosmological parameters with their own distance table, usable alongside other cosmologies")
+        .def(py::init([](py::object om_M_, py::object om_k_, py::object om_lam_, py::object D_H_MPc_, double z_max,
+                         unsigned int n) {
+                 // Unset parameters are taken from the global cosmology
+                 cosmology c = cosmology_current();
+                 if (!om_M_.is_none()) c.om_M = om_M_.cast<double>();
+                 if (!om_k_.is_none()) c.om_k = om_k_.cast<double>();
+                 if (!om_lam_.is_none()) c.om_lam = om_lam_.cast<double>();
+                 if (!D_H_MPc_.is_none()) c.D_H_MPc = D_H_MPc_.cast<double>();
+                 return Cosmology(c, z_max, n);
+             }),
+             py::arg("om_M") = py::none(), py::arg("om_k") = py::none(), py::arg("om_lam") = py::none(),
+             py::arg("D_H_MPc") = py::none(), py::arg("z_max") = COSMO_TABLE_Z_MAX_DEFAULT,
+             py::arg("n") = COSMO_TABLE_N_DEFAULT)
+        .def_static("LCDM", [](double Omega_M, double Omega_lam, double h, double z_max, unsigned int n) {
+                        return Cosmology(cosmology_LCDM(Omega_M, Omega_lam, h), z_max, n);
+                    },
+                    "Lambda-CDM with om_k = 1 - om_M - om_lam and D_H = c/H_0 for H_0 = 100 h km/s/Mpc",
+                    py::arg("om_M"), py::arg("om_lam"), py::arg("h"), py::arg("z_max") = COSMO_TABLE_Z_MAX_DEFAULT,
+                    py::arg("n") = COSMO_TABLE_N_DEFAULT)
+        .def_static("current", &Cosmology::current, "The global cosmology")
+        .def_property_readonly("om_M", [](const Cosmology &c) { return c.params().om_M; })
+        .def_property_readonly("om_k", [](const Cosmology &c) { return c.params().om_k; })
+        .def_property_readonly("om_lam", [](const Cosmology &c) { return c.params().om_lam; })
+        .def_property_readonly("D_H_MPc", [](const Cosmology &c) { return c.params().D_H_MPc; })
+        .def_property_readonly("z_max", &Cosmology::z_max)
+        .def_property_readonly("n", &Cosmology::n)
+        .def("d_c_MPc", [](const Cosmology &c, c_array_d z_low, c_array_d z_high) {
+                 return COSMO_TABLE_VEC2(cosmo_table_d_c_MPc)(c.table(), z_low, z_high);
+             }, "Comoving distance in Mpc", py::arg("z_low"), py::arg("z_high"))
+        .def("d_m_MPc", [](const Cosmology &c, c_array_d z) {
+                 return COSMO_TABLE_VEC1(cosmo_table_d_m_MPc)(c.table(), z);
+             }, "Transverse comoving distance in Mpc", py::arg("z"))
+        .def("d_l_MPc", [](const Cosmology &c, c_array_d z) {
+                 return COSMO_TABLE_VEC1(cosmo_table_d_l_MPc)(c.table(), z);
+             }, "Luminosity distance in Mpc", py::arg("z"))
+        .def("d_a_MPc", [](const Cosmology &c, c_array_d z) {
+                 return COSMO_TABLE_VEC1(cosmo_table_d_a_MPc)(c.table(), z);
+             }, "Angular diameter distance in Mpc", py::arg("z"))
+        .def("dV_c", [](const Cosmology &c, c_array_d z) {
+                 return COSMO_TABLE_VEC1(cosmo_table_dV_c)(c.table(), z);
+             }, "Comoving volume element", py::arg("z"))
+        .def("V_c", [](const Cosmology &c, c_array_d z) {
+                 return COSMO_TABLE_VEC1(cosmo_table_V_c)(c.table(), z);
+             }, "Comoving volume out to z per steradian", py::arg("z"))
+        .def("Vc_dOm_MPc3srm1", [](const Cosmology &c, c_array_d z_low, c_array_d z_high) {
+                 return COSMO_TABLE_VEC2(cosmo_table_Vc_dOm_MPc3srm1)(c.table(), z_low, z_high);
+             }, "Comoving volume between z_low and z_high", py::arg("z_low"), py::arg("z_high"))
+        .def("distmod__cmm2", [](const Cosmology &c, c_array_d z) {
+                 return COSMO_TABLE_VEC1(cosmo_table_distmod__cmm2)(c.table(), z);
+             }, "Luminosity distance modulus 1/(4 pi d_l^2) in cm^-2", py::arg("z"))
+        .def("E_z", [](const Cosmology &c, c_array_d z) {
+                 return COSMO_TABLE_VEC1(cosmo_table_E_z)(c.table(), z);
+             }, "Hubble expansion factor", py::arg("z"));
 }
@@ -7,7 +7,10 @@
 
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
+#include <memory>
 #include "cosmo_funcs.h"
+#include "cosmo_table.h"
+#include "wrappers_vectorize.h"
 
 namespace py = pybind11;
 
@@ -19,6 +22,43 @@ double d_a_MPc_wrapper(double z);
 double dV_c_wrapper(double z);
 double Vc_dOm_MPc3srm1_wrapper(double z_low, double z_high);
 double E_z_wrapper(double z);
+double distmod__cmm2_wrapper(double z);
+
+// Tabulated comoving distance for the current global cosmology, rebuilt whenever om_M, om_k, om_lam or
+// D_H_MPc have changed since the last call
+std::shared_ptr<const cosmo_table> default_cosmo_table();
+
+// Cosmological parameters together with their distance table. A value type: copies share the (immutable)
+// table, and any number of cosmologies can be queried from different threads at once
+class Cosmology {
+public:
+    Cosmology(const cosmology &params, double z_max, unsigned int n);
+    // The global cosmology, with the shared default table
+    static Cosmology current();
+
+    const cosmology &params() const { return tab_->cosmo; }
+    const cosmo_table *table() const { return tab_.get(); }
+    double z_max() const { return expm1(tab_->x_max); }
+    unsigned int n() const { return tab_->n; }
+
+    double d_l_MPc(double z) const { return cosmo_table_d_l_MPc(tab_.get(), z); }
+    double distmod__cmm2(double z) const { return cosmo_table_distmod__cmm2(tab_.get(), z); }
+
+private:
+    explicit Cosmology(std::shared_ptr<const cosmo_table> tab) : tab_(tab) {}
+    std::shared_ptr<const cosmo_table> tab_;
+};
+
+// Vectorized versions, arguments are broadcast against each other. They interpolate default_cosmo_table()
+// rather than integrating per element
+py::array_t<double> d_l_MPc_vec(c_array_d z);
+py::array_t<double> d_c_MPc_vec(c_array_d z_low, c_array_d z_high);
+py::array_t<double> d_m_MPc_vec(c_array_d z);
+py::array_t<double> d_a_MPc_vec(c_array_d z);
+py::array_t<double> dV_c_vec(c_array_d z);
+py::array_t<double> Vc_dOm_MPc3srm1_vec(c_array_d z_low, c_array_d z_high);
+py::array_t<double> E_z_vec(c_array_d z);
+py::array_t<double> distmod__cmm2_vec(c_array_d z);
 
 // Bind to Python module
 void bind_cosmo_functions(py::module &m);
@@ -5,24 +5,222 @@
 #include "wrappers_data.h"
 #include "gen_funcs.h"
 #include <cmath>
+#include <unistd.h>
+
+// Data objects
+
+DataObject1D::DataObject1D(data_object_1D do1D, bool owned) : do1D_(do1D), owned_(owned) {}
+
+DataObject1D::~DataObject1D() {
+    if (owned_) data_object_1D_free(do1D_);
+}
+
+DataObject1D::DataObject1D(DataObject1D &&other) noexcept : do1D_(other.do1D_), owned_(other.owned_) {
+    other.owned_ = false;
+}
+
+DataObject2D::DataObject2D(data_object_2D do2D, bool owned) : do2D_(do2D), owned_(owned) {}
+
+DataObject2D::~DataObject2D() {
+    if (owned_) data_object_2D_free(do2D_);
+}
+
+DataObject2D::DataObject2D(DataObject2D &&other) noexcept : do2D_(other.do2D_), owned_(other.owned_) {
+    other.owned_ = false;
+}
+
+DataObject3D::DataObject3D(data_object_3D do3D, bool owned) : do3D_(do3D), owned_(owned) {}
+
+DataObject3D::~DataObject3D() {
+    if (owned_) data_object_3D_free(do3D_);
+}
+
+DataObject3D::DataObject3D(DataObject3D &&other) noexcept : do3D_(other.do3D_), owned_(other.owned_) {
+    other.owned_ = false;
+}
+
+// Views
+
+py::array_t<double> readonly_view(std::vector<py::ssize_t> shape, const double* ptr, py::handle base) {
+    py::array_t<double> view(shape, ptr, base);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
+// A pinned slice of a 3D object: released when the last array viewing it goes away
+struct do3D_slice_pin {
+    data_object_3D do3D;
+    size_t k;
+    py::object owner;
+};
+
+py::array_t<double> do3D_slice_view(py::object self, size_t k) {
+    const data_object_3D &do3D = self.cast<const DataObject3D &>().obj();
+    if (k >= do3D.nf) {
+        throw py::index_error("Slice index out of range");
+    }
+
+    const double* z;
+    {
+        // Lazily loaded slices may have to be read from disk
+        py::gil_scoped_release release;
+        z = do3D_slice_acquire(do3D, k);
+    }
+    if (z == NULL) {
+        throw std::runtime_error("Failed to load slice");
+    }
+
+    do3D_slice_pin* pin = new do3D_slice_pin{do3D, k, self};
+    py::capsule base(pin, [](void* p) {
+        do3D_slice_pin* pin = static_cast<do3D_slice_pin*>(p);
+        do3D_slice_release(pin->do3D, pin->k);
+        delete pin;
+    });
+    return readonly_view({(py::ssize_t) do3D.ny, (py::ssize_t) do3D.nx}, z, base);
+}
+
+// Readers
+
+static void check_readable(const std::string &filename) {
+    if (access(filename.c_str(), R_OK) != 0) {
+        throw std::runtime_error("Can't read file " + filename);
+    }
+}
+
+DataObject1D read_do1D_wrapper(const std::string &filename) {
+    check_readable(filename);
+    py::gil_scoped_release release;
+    return DataObject1D(read_do1D(const_cast<char*>(filename.c_str())));
+}
+
+DataObject2D read_do2D_wrapper(const std::string &filename) {
+    check_readable(filename);
+    py::gil_scoped_release release;
+    return DataObject2D(read_do2D(const_cast<char*>(filename.c_str())));
+}
+
+DataObject3D read_do3D_wrapper(const std::string &filename) {
+    check_readable(filename);
+    py::gil_scoped_release release;
+    return DataObject3D(read_do3D(const_cast<char*>(filename.c_str())));
+}
+
+DataObject3D read_do3D_lazy_wrapper(const std::string &filename, size_t max_slices) {
+    data_object_3D do3D;
+    {
+        py::gil_scoped_release release;
+        do3D = read_do3D_lazy(const_cast<char*>(filename.c_str()), max_slices);
+    }
+    if (do3D.slices == NULL) {
+        throw std::runtime_error("Can't open binary 3D table " + filename);
+    }
+    return DataObject3D(do3D);
+}
 
 void logspace_array_wrapper(int n, double min, double max, py::array_t<double> output) {
     auto buf = output.request();
     if (buf.size != static_cast<size_t>(n)) {
         throw std::runtime_error("Output array size mismatch");
     }
-    
+
     double* ptr = static_cast<double*>(buf.ptr);
     double log_min = log10(min);
     double log_max = log10(max);
     double delta = (log_max - log_min) / (n - 1.0);
-    
+
     for (int i = 0; i < n; i++) {
         ptr[i] = pow(10.0, log_min + i * delta);
     }
 }
 
 void bind_data_functions(py::module &m) {
+    // The buffer protocol exposes the table values, so np.asarray(obj) views z without a copy
+    py::class_<DataObject1D>(m, "DataObject1D", py::buffer_protocol(), "1D table z(x)")
+        .def_buffer([](DataObject1D &d) {
+            const data_object_1D &o = d.obj();
+            return py::buffer_info(o.z_data, sizeof(double), py::format_descriptor<double>::format(),
+                                   1, {(py::ssize_t) o.nx}, {(py::ssize_t) sizeof(double)}, true);
+        })
+        .def_property_readonly("x", [](py::object self) {
+            const data_object_1D &o = self.cast<const DataObject1D &>().obj();
+            return readonly_view({(py::ssize_t) o.nx}, o.x_data, self);
+        })
+        .def_property_readonly("z", [](py::object self) {
+            const data_object_1D &o = self.cast<const DataObject1D &>().obj();
+            return readonly_view({(py::ssize_t) o.nx}, o.z_data, self);
+        })
+        .def_property_readonly("x_lim", [](const DataObject1D &d) {
+            return py::make_tuple(d.obj().x_lim[0], d.obj().x_lim[1]);
+        });
+
+    py::class_<DataObject2D>(m, "DataObject2D", py::buffer_protocol(), "2D table z(x, y), z has shape (ny, nx)")
+        .def_buffer([](DataObject2D &d) {
+            const data_object_2D &o = d.obj();
+            return py::buffer_info(o.z_data, sizeof(double), py::format_descriptor<double>::format(),
+                                   2, {(py::ssize_t) o.ny, (py::ssize_t) o.nx},
+                                   {(py::ssize_t) (sizeof(double) * o.nx), (py::ssize_t) sizeof(double)}, true);
+        })
+        .def_property_readonly("x", [](py::object self) {
+            const data_object_2D &o = self.cast<const DataObject2D &>().obj();
+            return readonly_view({(py::ssize_t) o.nx}, o.x_data, self);
+        })
+        .def_property_readonly("y", [](py::object self) {
+            const data_object_2D &o = self.cast<const DataObject2D &>().obj();
+            return readonly_view({(py::ssize_t) o.ny}, o.y_data, self);
+        })
+        .def_property_readonly("z", [](py::object self) {
+            const data_object_2D &o = self.cast<const DataObject2D &>().obj();
+            return readonly_view({(py::ssize_t) o.ny, (py::ssize_t) o.nx}, o.z_data, self);
+        })
+        .def_property_readonly("x_lim", [](const DataObject2D &d) {
+            return py::make_tuple(d.obj().x_lim[0], d.obj().x_lim[1]);
+        })
+        .def_property_readonly("y_lim", [](const DataObject2D &d) {
+            return py::make_tuple(d.obj().y_lim[0], d.obj().y_lim[1]);
+        });
+
+    // Slices of a 3D table are separate allocations (or paged in on demand), so they are viewed one at a time
+    py::class_<DataObject3D>(m, "DataObject3D", "3D table z(x, y) on a grid of f, one (ny, nx) slice per f")
+        .def_property_readonly("x", [](py::object self) {
+            const data_object_3D &o = self.cast<const DataObject3D &>().obj();
+            return readonly_view({(py::ssize_t) o.nx}, o.x_data, self);
+        })
+        .def_property_readonly("y", [](py::object self) {
+            const data_object_3D &o = self.cast<const DataObject3D &>().obj();
+            return readonly_view({(py::ssize_t) o.ny}, o.y_data, self);
+        })
+        .def_property_readonly("f", [](py::object self) {
+            const data_object_3D &o = self.cast<const DataObject3D &>().obj();
+            return readonly_view({(py::ssize_t) o.nf}, o.f_data, self);
+        })
+        .def("slice", &do3D_slice_view,
+             "View of slice k, pinned in memory for as long as the array lives",
+             py::arg("k"))
+        .def("__len__", [](const DataObject3D &d) { return d.obj().nf; })
+        .def_property_readonly("resident_slices", [](const DataObject3D &d) {
+            return do3D_resident_slices(d.obj());
+        })
+        .def("set_slice_capacity", [](const DataObject3D &d, size_t capacity) {
+            do3D_set_slice_capacity(d.obj(), capacity);
+        }, "Number of slices a lazily loaded table keeps in memory (pinned slices are never evicted)",
+           py::arg("capacity"));
+
+    m.def("read_do1D", &read_do1D_wrapper,
+          "Read a 1D table file",
+          py::arg("filename"));
+
+    m.def("read_do2D", &read_do2D_wrapper,
+          "Read a 2D table file",
+          py::arg("filename"));
+
+    m.def("read_do3D", &read_do3D_wrapper,
+          "Read a text 3D table file into memory",
+          py::arg("filename"));
+
+    m.def("read_do3D_lazy", &read_do3D_lazy_wrapper,
+          "Open a binary 3D table file, paging slices in on demand",
+          py::arg("filename"), py::arg("max_slices") = DO3D_SLICE_CACHE_DEFAULT);
+
     m.def("logspace_array", &logspace_array_wrapper,
           "Create logarithmically spaced array",
           py::arg("n"), py::arg("min"), py::arg("max"), py::arg("output"));
@@ -7,9 +7,79 @@
 
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
+#include <string>
+#include <vector>
+#include "data_objects.h"
 
 namespace py = pybind11;
 
+// Data objects exposed to NumPy without copies. An object either owns its C-side data (read from a file) or
+// borrows it from another object (a table of ICTables), which is then kept alive for as long as the view.
+// The arrays handed out are read-only views whose base keeps the Python object alive.
+
+class DataObject1D {
+public:
+    explicit DataObject1D(data_object_1D do1D, bool owned = true);
+    ~DataObject1D();
+
+    DataObject1D(const DataObject1D &) = delete;
+    DataObject1D &operator=(const DataObject1D &) = delete;
+    DataObject1D(DataObject1D &&other) noexcept;
+    DataObject1D &operator=(DataObject1D &&other) = delete;
+
+    const data_object_1D &obj() const { return do1D_; }
+
+private:
+    data_object_1D do1D_;
+    bool owned_;
+};
+
+class DataObject2D {
+public:
+    explicit DataObject2D(data_object_2D do2D, bool owned = true);
+    ~DataObject2D();
+
+    DataObject2D(const DataObject2D &) = delete;
+    DataObject2D &operator=(const DataObject2D &) = delete;
+    DataObject2D(DataObject2D &&other) noexcept;
+    DataObject2D &operator=(DataObject2D &&other) = delete;
+
+    const data_object_2D &obj() const { return do2D_; }
+
+private:
+    data_object_2D do2D_;
+    bool owned_;
+};
+
+class DataObject3D {
+public:
+    explicit DataObject3D(data_object_3D do3D, bool owned = true);
+    ~DataObject3D();
+
+    DataObject3D(const DataObject3D &) = delete;
+    DataObject3D &operator=(const DataObject3D &) = delete;
+    DataObject3D(DataObject3D &&other) noexcept;
+    DataObject3D &operator=(DataObject3D &&other) = delete;
+
+    const data_object_3D &obj() const { return do3D_; }
+
+private:
+    data_object_3D do3D_;
+    bool owned_;
+};
+
+// Read-only array over ptr with the given shape, kept alive by base
+py::array_t<double> readonly_view(std::vector<py::ssize_t> shape, const double* ptr, py::handle base);
+
+// Views of the data objects
+py::array_t<double> do3D_slice_view(py::object self, size_t k);
+
+// Readers
+DataObject1D read_do1D_wrapper(const std::string &filename);
+DataObject2D read_do2D_wrapper(const std::string &filename);
+DataObject3D read_do3D_wrapper(const std::string &filename);
+DataObject3D read_do3D_lazy_wrapper(const std::string &filename, size_t max_slices);
+
 // Utility functions
 void logspace_array_wrapper(int n, double min, double max, py::array_t<double> output);
 
@@ -0,0 +1,263 @@
+/**
+ * Implementation of the EBL attenuation tables
+ */
+
+#include "wrappers_ebl.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+GridIndex::GridIndex(const std::vector<double> &x) : x_(x), inv_h_(x.size() - 1) {
+    size_t n = x.size();
+    for (size_t i = 0; i + 1 < n; i++) inv_h_[i] = 1. / (x[i + 1] - x[i]);
+
+    size_t n_buckets = EBL_INDEX_BUCKETS * (n - 1);
+    x0_ = x[0];
+    inv_dx_ = n_buckets / (x[n - 1] - x[0]);
+    first_.resize(n_buckets);
+    size_t i = 0;
+    for (size_t b = 0; b < n_buckets; b++) {
+        double edge = x0_ + b / inv_dx_;
+        while (i + 2 < n && x[i + 1] <= edge) i++;
+        first_[b] = i;
+    }
+}
+
+// Tables
+
+// Next line of fp into line (grown as needed), false at the end of the file
+static bool read_line(FILE *fp, char **line, size_t *cap) {
+    return getline(line, cap, fp) != -1;
+}
+
+// The values of the next line of fp
+static bool read_values(FILE *fp, char **line, size_t *cap, size_t n, std::vector<double> &out) {
+    if (!read_line(fp, line, cap)) return false;
+    out.resize(n);
+    const char *p = *line;
+    for (size_t i = 0; i < n; i++) {
+        char *end;
+        out[i] = strtod(p, &end);
+        if (end == p) return false;
+        p = end;
+    }
+    return true;
+}
+
+static void read_text(const std::string &filename, std::vector<double> &E__GeV, std::vector<double> &z,
+                      std::vector<double> &tau) {
+    FILE *fp = fopen(filename.c_str(), "r");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't open EBL table " + filename);
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    long long n_z = -1, n_E = -1;
+    bool ok = read_line(fp, &line, &cap) && read_line(fp, &line, &cap) && read_line(fp, &line, &cap);
+    if (ok) n_z = strtoll(line, NULL, 10);
+    ok = ok && read_line(fp, &line, &cap) && read_line(fp, &line, &cap);
+    if (ok) n_E = strtoll(line, NULL, 10);
+    ok = ok && n_z >= 2 && n_E >= 2 && read_line(fp, &line, &cap) &&
+         read_values(fp, &line, &cap, n_z, z) && read_line(fp, &line, &cap) &&
+         read_values(fp, &line, &cap, n_E, E__GeV) && read_line(fp, &line, &cap) &&
+         read_values(fp, &line, &cap, n_z * n_E, tau);
+    free(line);
+    fclose(fp);
+    if (!ok) {
+        throw std::runtime_error("Malformed EBL table " + filename);
+    }
+    // The text tables give the energy in eV
+    for (double &E : E__GeV) E *= 1e-9;
+}
+
+static void read_bin(const std::string &filename, std::vector<double> &E__GeV, std::vector<double> &z,
+                     std::vector<double> &tau) {
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't open EBL table " + filename);
+    }
+    char magic[8];
+    uint64_t dims[2] = { 0, 0 };
+    bool ok = fread(magic, 1, 8, fp) == 8 && fread(dims, sizeof(uint64_t), 2, fp) == 2 && dims[0] >= 2 &&
+              dims[1] >= 2;
+    if (ok) {
+        E__GeV.resize(dims[0]);
+        z.resize(dims[1]);
+        tau.resize(dims[0] * dims[1]);
+        ok = fread(E__GeV.data(), sizeof(double), dims[0], fp) == dims[0] &&
+             fread(z.data(), sizeof(double), dims[1], fp) == dims[1] &&
+             fread(tau.data(), sizeof(double), tau.size(), fp) == tau.size();
+    }
+    fclose(fp);
+    if (!ok) {
+        throw std::runtime_error("Truncated binary EBL table " + filename);
+    }
+}
+
+EBLTable::EBLTable(const std::string &filename) {
+    char magic[8] = { 0 };
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't open EBL table " + filename);
+    }
+    size_t n = fread(magic, 1, 8, fp);
+    fclose(fp);
+
+    if (n == 8 && memcmp(magic, EBL_BIN_MAGIC, 8) == 0) {
+        read_bin(filename, E__GeV_, z_, tau_);
+    } else {
+        read_text(filename, E__GeV_, z_, tau_);
+    }
+    init();
+}
+
+EBLTable::EBLTable(const std::vector<double> &E__GeV, const std::vector<double> &z, const std::vector<double> &tau)
+    : E__GeV_(E__GeV), z_(z), tau_(tau) {
+    if (tau_.size() != E__GeV_.size() * z_.size()) {
+        throw std::runtime_error("tau must have shape (len(z), len(E__GeV))");
+    }
+    init();
+}
+
+void EBLTable::init() {
+    if (E__GeV_.size() < 2 || z_.size() < 2) {
+        throw std::runtime_error("An EBL table needs at least 2 energies and 2 redshifts");
+    }
+    log_E_.resize(E__GeV_.size());
+    for (size_t i = 0; i < E__GeV_.size(); i++) {
+        if (!(E__GeV_[i] > 0.) || (i > 0 && !(E__GeV_[i] > E__GeV_[i - 1]))) {
+            throw std::runtime_error("EBL table energies must be positive and strictly increasing");
+        }
+        log_E_[i] = log(E__GeV_[i]);
+    }
+    for (size_t k = 1; k < z_.size(); k++) {
+        if (!(z_[k] > z_[k - 1])) {
+            throw std::runtime_error("EBL table redshifts must be strictly increasing");
+        }
+    }
+    iE_ = GridIndex(log_E_);
+    iz_ = GridIndex(z_);
+}
+
+void EBLTable::save(const std::string &filename) const {
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't open " + filename + " for writing");
+    }
+    uint64_t dims[2] = { E__GeV_.size(), z_.size() };
+    bool ok = fwrite(EBL_BIN_MAGIC, 1, 8, fp) == 8 && fwrite(dims, sizeof(uint64_t), 2, fp) == 2 &&
+              fwrite(E__GeV_.data(), sizeof(double), E__GeV_.size(), fp) == E__GeV_.size() &&
+              fwrite(z_.data(), sizeof(double), z_.size(), fp) == z_.size() &&
+              fwrite(tau_.data(), sizeof(double), tau_.size(), fp) == tau_.size();
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) {
+        throw std::runtime_error("Error writing EBL table " + filename);
+    }
+}
+
+void EBLTable::attenuate(size_t n_gal, size_t n_E, const double *spec, const double *E_gam__GeV, const double *z,
+                         bool observed, const double *tau_gg, const double *distmod, const Cosmology *cosmo, bool E2,
+                         double *out) const {
+    std::vector<double> log_E(n_E), E2_w(n_E, 1.);
+    for (size_t j = 0; j < n_E; j++) {
+        log_E[j] = log(E_gam__GeV[j]);
+        if (E2) E2_w[j] = E_gam__GeV[j] * E_gam__GeV[j];
+    }
+
+    // Each row costs the same, a static split is enough
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long) n_gal; i++) {
+        double d = distmod ? distmod[i] : (cosmo ? cosmo->distmod__cmm2(z[i]) : 1.);
+        double shift = observed ? 0. : log1p(z[i]);
+        double u;
+        size_t k = iz_.locate(z[i], u);
+        const double *row0 = tau_.data() + k * E__GeV_.size(), *row1 = row0 + E__GeV_.size();
+        const double *s = spec + i * n_E;
+        const double *tg = tau_gg ? tau_gg + i * n_E : NULL;
+        double *o = out + i * n_E;
+        for (size_t j = 0; j < n_E; j++) {
+            double t;
+            size_t e = iE_.locate(log_E[j] - shift, t);
+            double tau = (1. - u) * ((1. - t) * row0[e] + t * row0[e + 1]) + u * ((1. - t) * row1[e] + t * row1[e + 1]);
+            if (tg) tau += tg[j];
+            o[j] = s[j] * exp(-tau) * d * E2_w[j];
+        }
+    }
+}
+
+void ebl_text_to_bin(const std::string &infile, const std::string &outfile) {
+    EBLTable(infile).save(outfile);
+}
+
+// Python bindings
+
+// A (n_gal, n_E) block, n_gal = n_rows
+static void check_block(const char *name, const c_array_d &a, size_t n_rows, size_t n_E) {
+    if (a.ndim() != 2 || (size_t) a.shape(0) != n_rows || (size_t) a.shape(1) != n_E) {
+        throw std::runtime_error(std::string(name) + " must have shape (n_gal, n_E)");
+    }
+}
+
+static py::array_t<double> to_array(const std::vector<double> &v) {
+    return py::array_t<double>(v.size(), v.data());
+}
+
+void bind_ebl_functions(py::module &m) {
+    py::class_<EBLTable>(m, "EBLTable", "EBL optical depth tau(E, z), interpolated in (log E, z)")
+        .def(py::init<const std::string &>(), "Load a text or binary table", py::arg("filename"))
+        .def(py::init([](c_array_d E__GeV, c_array_d z, c_array_d tau) {
+                 return new EBLTable(std::vector<double>(E__GeV.data(), E__GeV.data() + E__GeV.size()),
+                                     std::vector<double>(z.data(), z.data() + z.size()),
+                                     std::vector<double>(tau.data(), tau.data() + tau.size()));
+             }),
+             "Table from its grids, tau of shape (len(z), len(E__GeV))",
+             py::arg("E__GeV"), py::arg("z"), py::arg("tau"))
+        .def("save", &EBLTable::save, "Write in the binary format", py::arg("filename"))
+        .def_property_readonly("E__GeV", [](const EBLTable &t) { return to_array(t.E__GeV()); })
+        .def_property_readonly("z", [](const EBLTable &t) { return to_array(t.z()); })
+        .def_property_readonly("tau", [](const EBLTable &t) {
+            return py::array_t<double>({ (py::ssize_t) t.n_z(), (py::ssize_t) t.n_E() }, t.tau().data());
+        }, "Optical depth, shape (n_z, n_E)")
+        .def("tau_EBL", [](const EBLTable &t, c_array_d E_obs__GeV, c_array_d z) {
+            return vectorize_broadcast({ E_obs__GeV, z }, [&t](const double *v) { return t.tau_EBL(v[0], v[1]); });
+        }, "Optical depth at observed energy E_obs__GeV from redshift z, broadcast", py::arg("E_obs__GeV"),
+           py::arg("z"))
+        .def("attenuate", [](const EBLTable &t, c_array_d spec, c_array_d E_gam__GeV, c_array_d z, bool observed,
+                             py::object tau_gg, py::object distmod__cmm2, py::object cosmo, bool E2) {
+            size_t n_E = E_gam__GeV.size(), n_gal = z.size();
+            check_block("spec", spec, n_gal, n_E);
+            c_array_d tg, dm;
+            if (!tau_gg.is_none()) {
+                tg = tau_gg.cast<c_array_d>();
+                check_block("tau_gg", tg, n_gal, n_E);
+            }
+            if (!distmod__cmm2.is_none()) {
+                dm = distmod__cmm2.cast<c_array_d>();
+                if ((size_t) dm.size() != n_gal) throw std::runtime_error("distmod__cmm2 must have length n_gal");
+            }
+            const Cosmology *c = cosmo.is_none() ? NULL : &cosmo.cast<const Cosmology &>();
+
+            py::array_t<double> out({ (py::ssize_t) n_gal, (py::ssize_t) n_E });
+            {
+                py::gil_scoped_release release;
+                t.attenuate(n_gal, n_E, spec.data(), E_gam__GeV.data(), z.data(), observed,
+                            tau_gg.is_none() ? NULL : tg.data(), distmod__cmm2.is_none() ? NULL : dm.data(), c, E2,
+                            out.mutable_data());
+            }
+            return out;
+        }, "spec exp(-(tau_EBL + tau_gg)) distmod [E^2] for a (n_gal, n_E) block, in one pass. With "
+           "observed=False the energies are emitted ones and tau_EBL is taken at E_gam/(1 + z); the distance "
+           "moduli come from distmod__cmm2, or from cosmo if given instead",
+           py::arg("spec"), py::arg("E_gam__GeV"), py::arg("z"), py::arg("observed") = false,
+           py::arg("tau_gg") = py::none(), py::arg("distmod__cmm2") = py::none(), py::arg("cosmo") = py::none(),
+           py::arg("E2") = false);
+
+    m.def("ebl_text_to_bin", &ebl_text_to_bin, "Convert a text tau_EBL table to the binary format",
+          py::arg("infile"), py::arg("outfile"));
+}
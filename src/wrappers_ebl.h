@@ -0,0 +1,114 @@
+/**
+ * EBL attenuation
+ * The extragalactic-background optical depth tau(E, z) is loaded once into
+ * an EBLTable and interpolated bilinearly in (log E, z). Each axis has a
+ * uniform bucket index over its knots, so finding the interval of a point
+ * takes a multiply and at most a step or two, whether or not the table's
+ * grid is uniform. Two table formats are read:
+ *  - the text format of the original code (read_tau_ebl): two comment
+ *    lines, n_z, a comment line, n_E, a comment line, the z grid, a comment
+ *    line, the energy grid in eV, a comment line, then tau as n_z rows of
+ *    n_E values (gsl_interp2d order)
+ *  - a binary format: EBL_BIN_MAGIC, n_E and n_z (uint64), then the energy
+ *    grid in GeV, the z grid and tau (n_z, n_E), all doubles
+ * Points outside the table take the value at its edge.
+ */
+
+#ifndef WRAPPERS_EBL_H
+#define WRAPPERS_EBL_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "wrappers_cosmo.h"
+#include "wrappers_vectorize.h"
+
+namespace py = pybind11;
+
+#define EBL_BIN_MAGIC "CREBL001"
+// Buckets of an axis index per interval of its grid
+#define EBL_INDEX_BUCKETS 4
+
+// Interval of a point on an increasing grid, through a uniform index of buckets over it
+class GridIndex {
+public:
+    GridIndex() : x0_(0.), inv_dx_(0.) {}
+    explicit GridIndex(const std::vector<double> &x);
+
+    // i with x[i] <= v < x[i + 1], for v clamped into the grid, and t = (v - x[i]) / (x[i + 1] - x[i])
+    size_t locate(double v, double &t) const {
+        v = std::fmin(std::fmax(v, x_.front()), x_.back());
+        size_t i = first_[std::min((size_t) ((v - x0_) * inv_dx_), first_.size() - 1)];
+        while (i + 2 < x_.size() && v >= x_[i + 1]) i++;
+        while (i > 0 && v < x_[i]) i--;
+        t = (v - x_[i]) * inv_h_[i];
+        return i;
+    }
+
+private:
+    std::vector<double> x_, inv_h_;
+    std::vector<size_t> first_;  // interval holding the left edge of each bucket
+    double x0_, inv_dx_;
+};
+
+class EBLTable {
+public:
+    // Text or binary table, by the file's leading bytes
+    explicit EBLTable(const std::string &filename);
+    // tau of shape (n_z, n_E)
+    EBLTable(const std::vector<double> &E__GeV, const std::vector<double> &z, const std::vector<double> &tau);
+
+    // Write in the binary format
+    void save(const std::string &filename) const;
+
+    size_t n_E() const { return E__GeV_.size(); }
+    size_t n_z() const { return z_.size(); }
+    const std::vector<double> &E__GeV() const { return E__GeV_; }
+    const std::vector<double> &z() const { return z_; }
+    const std::vector<double> &tau() const { return tau_; }
+
+    // Optical depth at observed energy exp(log_E_obs) [GeV] from redshift z
+    double tau_log(double log_E_obs, double z) const {
+        double t, u;
+        size_t i = iE_.locate(log_E_obs, t);
+        size_t k = iz_.locate(z, u);
+        const double *row0 = tau_.data() + k * n_E(), *row1 = row0 + n_E();
+        return (1. - u) * ((1. - t) * row0[i] + t * row0[i + 1]) + u * ((1. - t) * row1[i] + t * row1[i + 1]);
+    }
+    double tau_EBL(double E_obs__GeV, double z) const { return tau_log(std::log(E_obs__GeV), z); }
+
+    /**
+     * Attenuate a block of spectra in one pass: out = spec exp(-(tau_EBL + tau_gg)) distmod [E^2]
+     * @param n_gal, n_E Block shape, one galaxy per row
+     * @param spec Spectra (n_gal, n_E)
+     * @param E_gam__GeV Photon energies of the spectra (n_E)
+     * @param z Redshifts of the galaxies (n_gal)
+     * @param observed E_gam__GeV are observed energies; otherwise they are emitted ones and tau_EBL is taken
+     *                 at E_gam/(1 + z)
+     * @param tau_gg Internal gamma-gamma optical depths (n_gal, n_E), NULL for none
+     * @param distmod Distance moduli (n_gal), NULL for none
+     * @param cosmo If not NULL (and distmod is NULL), the distance moduli are taken from it
+     * @param E2 Multiply by E_gam^2
+     * @param out Result (n_gal, n_E), may be spec
+     */
+    void attenuate(size_t n_gal, size_t n_E, const double *spec, const double *E_gam__GeV, const double *z,
+                   bool observed, const double *tau_gg, const double *distmod, const Cosmology *cosmo, bool E2,
+                   double *out) const;
+
+private:
+    void init();
+
+    std::vector<double> E__GeV_, log_E_, z_, tau_;
+    GridIndex iE_, iz_;
+};
+
+// Convert a text tau_EBL table to the binary format
+void ebl_text_to_bin(const std::string &infile, const std::string &outfile);
+
+// Bind to Python module
+void bind_ebl_functions(py::module &m);
+
+#endif
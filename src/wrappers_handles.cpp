@@ -0,0 +1,523 @@
+/**
+ * Implementation of the persistent handle objects
+ */
+
+#include "wrappers_handles.h"
+
+void check_grid(const char *name, const double *x, py::ssize_t n) {
+    if (n < 2) {
+        throw std::runtime_error(std::string(name) + " must have at least 2 points");
+    }
+    for (py::ssize_t i = 1; i < n; i++) {
+        if (!(x[i] > x[i-1])) {
+            throw std::runtime_error(std::string(name) + " must be strictly increasing");
+        }
+    }
+}
+
+// Spline1D
+
+Spline1D::Spline1D(c_array_d x, c_array_d y) {
+    if (x.size() != y.size()) {
+        throw std::runtime_error("x and y arrays must have same size");
+    }
+    check_grid("x", x.data(), x.size());
+    so_ = gsl_so1D(x.size(), x.data(), y.data());
+}
+
+Spline1D::Spline1D(gsl_spline_object_1D so) : so_(so) {}
+
+Spline1D::~Spline1D() {
+    gsl_so1D_free(so_);
+}
+
+Spline1D::Spline1D(Spline1D &&other) noexcept : so_(other.so_) {
+    other.so_.spline = NULL;
+    other.so_.acc = NULL;
+}
+
+Spline1D &Spline1D::operator=(Spline1D &&other) noexcept {
+    if (this != &other) {
+        gsl_so1D_free(so_);
+        so_ = other.so_;
+        other.so_.spline = NULL;
+        other.so_.acc = NULL;
+    }
+    return *this;
+}
+
+double Spline1D::operator()(double x) const {
+    if (so_.spline == NULL) {
+        throw std::runtime_error("Spline1D has been moved from");
+    }
+    return gsl_so1D_eval(so_, x);
+}
+
+std::array<double, 2> Spline1D::x_lim() const {
+    return {{so_.x_lim[0], so_.x_lim[1]}};
+}
+
+// Spline2D
+
+Spline2D::Spline2D(c_array_d x, c_array_d y, c_array_d z) {
+    py::ssize_t nx = x.size(), ny = y.size();
+    if (z.size() != nx * ny || (z.ndim() == 2 && (z.shape(0) != ny || z.shape(1) != nx))) {
+        throw std::runtime_error("z must have shape (len(y), len(x))");
+    }
+    check_grid("x", x.data(), nx);
+    check_grid("y", y.data(), ny);
+    so_ = gsl_so2D(nx, ny, x.data(), y.data(), z.data());
+}
+
+Spline2D::Spline2D(gsl_spline_object_2D so) : so_(so) {}
+
+Spline2D::~Spline2D() {
+    gsl_so2D_free(so_);
+}
+
+Spline2D::Spline2D(Spline2D &&other) noexcept : so_(other.so_) {
+    other.so_.spline = NULL;
+    other.so_.xacc = NULL;
+    other.so_.yacc = NULL;
+}
+
+Spline2D &Spline2D::operator=(Spline2D &&other) noexcept {
+    if (this != &other) {
+        gsl_so2D_free(so_);
+        so_ = other.so_;
+        other.so_.spline = NULL;
+        other.so_.xacc = NULL;
+        other.so_.yacc = NULL;
+    }
+    return *this;
+}
+
+double Spline2D::operator()(double x, double y) const {
+    if (so_.spline == NULL) {
+        throw std::runtime_error("Spline2D has been moved from");
+    }
+    return gsl_so2D_eval(so_, x, y);
+}
+
+std::array<double, 2> Spline2D::x_lim() const {
+    return {{so_.x_lim[0], so_.x_lim[1]}};
+}
+
+std::array<double, 2> Spline2D::y_lim() const {
+    return {{so_.y_lim[0], so_.y_lim[1]}};
+}
+
+// Tables from the data directory: the splines copy the table data, so the data objects are freed straight away
+
+static gsl_spline_object_2D load_BS_gso2D(std::array<size_t, 2> n_pts, std::array<double, 2> E_gam__GeV_lims,
+                                          std::array<double, 2> E_e__GeV_lims, const std::string &datadir) {
+    data_object_2D do2D = load_BS_do_files(n_pts.data(), E_gam__GeV_lims.data(), E_e__GeV_lims.data(),
+                                           const_cast<char*>(datadir.c_str()));
+    gsl_spline_object_2D so = do2D_to_gso2D(do2D);
+    data_object_2D_free(do2D);
+    return so;
+}
+
+static gsl_spline_object_1D load_SY_gso1D(size_t n_pts, std::array<double, 2> x_sync_lims, const std::string &datadir) {
+    data_object_1D do1D = load_SY_do_files(&n_pts, x_sync_lims.data(), const_cast<char*>(datadir.c_str()));
+    gsl_spline_object_1D so = do1D_to_gso1D(do1D);
+    data_object_1D_free(do1D);
+    return so;
+}
+
+BSTable::BSTable(std::array<size_t, 2> n_pts, std::array<double, 2> E_gam__GeV_lims,
+                 std::array<double, 2> E_e__GeV_lims, const std::string &datadir)
+    : Spline2D(load_BS_gso2D(n_pts, E_gam__GeV_lims, E_e__GeV_lims, datadir)) {}
+
+SyncTable::SyncTable(size_t n_pts, std::array<double, 2> x_sync_lims, const std::string &datadir)
+    : Spline1D(load_SY_gso1D(n_pts, x_sync_lims, datadir)) {}
+
+// ICTables
+
+ICTables::ICTables(std::array<size_t, 2> n_pts, std::array<double, 2> E_gam__GeV_lims,
+                   std::array<double, 2> E_e__GeV_lims, std::array<double, 2> E_phot__GeV_lims,
+                   double T_CMB_max__K, double Delta_T_CMB__K, double T_FIR_min__K,
+                   double T_FIR_max__K, double Delta_T_FIR__K, const std::string &datadir) : owned_(true) {
+    ico_ = load_IC_do_files(n_pts.data(), E_gam__GeV_lims.data(), E_e__GeV_lims.data(), E_phot__GeV_lims.data(),
+                            T_CMB_max__K, Delta_T_CMB__K, T_FIR_min__K, T_FIR_max__K, Delta_T_FIR__K,
+                            const_cast<char*>(datadir.c_str()));
+}
+
+ICTables::~ICTables() {
+    if (owned_) IC_object_free(ico_);
+}
+
+ICTables::ICTables(ICTables &&other) noexcept : ico_(other.ico_), owned_(other.owned_) {
+    other.owned_ = false;
+}
+
+// ICKernel
+
+ICKernel::ICKernel(const ICTables &tables, double z, double T_dust__K, double M_star__Msol,
+                   double SFR__Msolyrm1, double Re__kpc, double h__pc, bool gamma) : owned_(true) {
+    galaxy_radfield rf = galaxy_radfield_init(z, T_dust__K, M_star__Msol, SFR__Msolyrm1, Re__kpc, h__pc);
+    kern_ = IC_kernel_init(gamma ? 1 : 0, tables.ico(), rf.params);
+}
+
+ICKernel::~ICKernel() {
+    if (owned_) IC_kernel_free(kern_);
+}
+
+ICKernel::ICKernel(ICKernel &&other) noexcept : kern_(other.kern_), owned_(other.owned_) {
+    other.owned_ = false;
+}
+
+double ICKernel::operator()(double E_gam__GeV, double E_e__GeV) const {
+    if (!owned_) {
+        throw std::runtime_error("ICKernel has been moved from");
+    }
+    return IC_kernel_eval(&kern_, E_gam__GeV, E_e__GeV);
+}
+
+Spline2D ICKernel::to_spline() const {
+    if (!owned_) {
+        throw std::runtime_error("ICKernel has been moved from");
+    }
+    std::vector<double> z_data(kern_.nx * kern_.ny);
+    IC_kernel_fill(&kern_, z_data.data());
+    return Spline2D(gsl_so2D(kern_.nx, kern_.ny, kern_.x_data, kern_.y_data, z_data.data()));
+}
+
+// Compute functions. These run with the GIL released, so several Python threads may be evaluating the
+// same handle at once; they use accelerator-free copies of the splines
+
+double eps_pi_handle(double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                     const Spline1D &f_cal) {
+    return eps_pi(E_gam__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, gsl_so1D_shared(f_cal.so()));
+}
+
+double q_e_handle(double T_CR__GeV, double n_H__cmm3, double C, double T_p_cutoff__GeV,
+                  const Spline1D &f_cal) {
+    return q_e(T_CR__GeV, n_H__cmm3, C, T_p_cutoff__GeV, gsl_so1D_shared(f_cal.so()));
+}
+
+double eps_IC_3_handle(double E_gam__GeV, const Spline2D &IC_table, const Spline1D &qe) {
+    return eps_IC_3(E_gam__GeV, gsl_so2D_shared(IC_table.so()), gsl_so1D_shared(qe.so()));
+}
+
+double eps_IC_3_kernel_handle(double E_gam__GeV, const ICKernel &IC_kern, const Spline1D &qe) {
+    return eps_IC_3_kernel(E_gam__GeV, IC_kern.kern(), gsl_so1D_shared(qe.so()));
+}
+
+double eps_SY_4_handle(double E_gam__GeV, double B__G, const Spline1D &sync_table, const Spline1D &qe) {
+    return eps_SY_4(E_gam__GeV, B__G, gsl_so1D_shared(sync_table.so()), gsl_so1D_shared(qe.so()));
+}
+
+double eps_BS_3_handle(double E_gam__GeV, double n_H__cmm3, const Spline2D &BS_table, const Spline1D &qe) {
+    return eps_BS_3(E_gam__GeV, n_H__cmm3, gsl_so2D_shared(BS_table.so()), gsl_so1D_shared(qe.so()));
+}
+
+// Vectorized compute functions. The worker threads share each spline, so they get accelerator-free copies
+
+py::array_t<double> Spline1D_call_vec(const Spline1D &s, c_array_d x) {
+    gsl_spline_object_1D so = gsl_so1D_shared(s.so());
+    return vectorize_broadcast({x}, [so](const double* v) { return gsl_so1D_eval(so, v[0]); });
+}
+
+py::array_t<double> Spline2D_call_vec(const Spline2D &s, c_array_d x, c_array_d y) {
+    gsl_spline_object_2D so = gsl_so2D_shared(s.so());
+    return vectorize_broadcast({x, y}, [so](const double* v) { return gsl_so2D_eval(so, v[0], v[1]); });
+}
+
+py::array_t<double> ICKernel_call_vec(const ICKernel &k, c_array_d E_gam__GeV, c_array_d E_e__GeV) {
+    const IC_kernel *kern = k.kern();
+    return vectorize_broadcast({E_gam__GeV, E_e__GeV},
+                               [kern](const double* v) { return IC_kernel_eval(kern, v[0], v[1]); });
+}
+
+py::array_t<double> eps_pi_vec(c_array_d E_gam__GeV, c_array_d n_H__cmm3, c_array_d C_p, c_array_d T_p_cutoff__GeV,
+                               const Spline1D &f_cal) {
+    gsl_spline_object_1D fcal = gsl_so1D_shared(f_cal.so());
+    return vectorize_broadcast({E_gam__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV},
+                               [fcal](const double* v) { return eps_pi(v[0], v[1], v[2], v[3], fcal); },
+                               VECTORIZE_INTEGRAL);
+}
+
+py::array_t<double> q_e_vec(c_array_d T_CR__GeV, c_array_d n_H__cmm3, c_array_d C, c_array_d T_p_cutoff__GeV,
+                            const Spline1D &f_cal) {
+    gsl_spline_object_1D fcal = gsl_so1D_shared(f_cal.so());
+    return vectorize_broadcast({T_CR__GeV, n_H__cmm3, C, T_p_cutoff__GeV},
+                               [fcal](const double* v) { return q_e(v[0], v[1], v[2], v[3], fcal); },
+                               VECTORIZE_INTEGRAL);
+}
+
+py::array_t<double> eps_IC_3_vec(c_array_d E_gam__GeV, const Spline2D &IC_table, const Spline1D &qe) {
+    gsl_spline_object_2D IC = gsl_so2D_shared(IC_table.so());
+    gsl_spline_object_1D qe_so = gsl_so1D_shared(qe.so());
+    return vectorize_broadcast({E_gam__GeV},
+                               [IC, qe_so](const double* v) { return eps_IC_3(v[0], IC, qe_so); },
+                               VECTORIZE_INTEGRAL);
+}
+
+py::array_t<double> eps_IC_3_kernel_vec(c_array_d E_gam__GeV, const ICKernel &IC_kern, const Spline1D &qe) {
+    const IC_kernel *kern = IC_kern.kern();
+    gsl_spline_object_1D qe_so = gsl_so1D_shared(qe.so());
+    return vectorize_broadcast({E_gam__GeV},
+                               [kern, qe_so](const double* v) { return eps_IC_3_kernel(v[0], kern, qe_so); },
+                               VECTORIZE_INTEGRAL);
+}
+
+py::array_t<double> eps_SY_4_vec(c_array_d E_gam__GeV, c_array_d B__G, const Spline1D &sync_table, const Spline1D &qe) {
+    gsl_spline_object_1D sync_so = gsl_so1D_shared(sync_table.so());
+    gsl_spline_object_1D qe_so = gsl_so1D_shared(qe.so());
+    return vectorize_broadcast({E_gam__GeV, B__G},
+                               [sync_so, qe_so](const double* v) { return eps_SY_4(v[0], v[1], sync_so, qe_so); },
+                               VECTORIZE_INTEGRAL);
+}
+
+py::array_t<double> eps_BS_3_vec(c_array_d E_gam__GeV, c_array_d n_H__cmm3, const Spline2D &BS_table, const Spline1D &qe) {
+    gsl_spline_object_2D BS = gsl_so2D_shared(BS_table.so());
+    gsl_spline_object_1D qe_so = gsl_so1D_shared(qe.so());
+    return vectorize_broadcast({E_gam__GeV, n_H__cmm3},
+                               [BS, qe_so](const double* v) { return eps_BS_3(v[0], v[1], BS, qe_so); },
+                               VECTORIZE_INTEGRAL);
+}
+
+py::array_t<double> eps_pi_arrays_vec(c_array_d E_gam__GeV, c_array_d n_H__cmm3, c_array_d C_p,
+                                      c_array_d T_p_cutoff__GeV, c_array_d T_CR__GeV, c_array_d f_cal) {
+    Spline1D f_cal_so(T_CR__GeV, f_cal);
+    return eps_pi_vec(E_gam__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, f_cal_so);
+}
+
+py::array_t<double> q_e_arrays_vec(c_array_d T_CR__GeV, c_array_d n_H__cmm3, c_array_d C, c_array_d T_p_cutoff__GeV,
+                                   c_array_d T_CR_array, c_array_d f_cal_array) {
+    Spline1D f_cal_so(T_CR_array, f_cal_array);
+    return q_e_vec(T_CR__GeV, n_H__cmm3, C, T_p_cutoff__GeV, f_cal_so);
+}
+
+py::array_t<double> eps_IC_3_arrays_vec(c_array_d E_gam__GeV, c_array_d E_gam_table, c_array_d E_e_table,
+                                        c_array_d IC_table_2D, c_array_d E_e_spectrum, c_array_d qe_spectrum) {
+    Spline2D IC_so(E_gam_table, E_e_table, IC_table_2D);
+    Spline1D qe_so(E_e_spectrum, qe_spectrum);
+    return eps_IC_3_vec(E_gam__GeV, IC_so, qe_so);
+}
+
+py::array_t<double> eps_SY_4_arrays_vec(c_array_d E_gam__GeV, c_array_d B__G, c_array_d sync_freq_table,
+                                        c_array_d sync_table_1D, c_array_d E_e_spectrum, c_array_d qe_spectrum) {
+    Spline1D sync_so(sync_freq_table, sync_table_1D);
+    Spline1D qe_so(E_e_spectrum, qe_spectrum);
+    return eps_SY_4_vec(E_gam__GeV, B__G, sync_so, qe_so);
+}
+
+py::array_t<double> eps_BS_3_arrays_vec(c_array_d E_gam__GeV, c_array_d n_H__cmm3, c_array_d E_gam_table,
+                                        c_array_d E_e_table, c_array_d BS_table_2D, c_array_d E_e_spectrum,
+                                        c_array_d qe_spectrum) {
+    Spline2D BS_so(E_gam_table, E_e_table, BS_table_2D);
+    Spline1D qe_so(E_e_spectrum, qe_spectrum);
+    return eps_BS_3_vec(E_gam__GeV, n_H__cmm3, BS_so, qe_so);
+}
+
+py::tuple CRe_steadystate_solve_handle(
+    int structure,
+    std::array<double, 2> E_e_lims__GeV,
+    int n_E,
+    double n_H__cmm3,
+    double B__G,
+    double h__pc,
+    std::vector<const Spline2D *> IC_Gamma,
+    const Spline2D &BS_table,
+    const Spline1D &D_e__cm2sm1,
+    const Spline1D &Q_inject_1,
+    const Spline1D &Q_inject_2
+) {
+    if (IC_Gamma.empty()) {
+        throw std::runtime_error("IC_Gamma must hold at least one table");
+    }
+
+    // The solver only reads the input splines, so accelerator-free copies of the handles' objects will do
+    std::vector<gsl_spline_object_2D> gso2D_IC_Gamma;
+    for (const Spline2D *s : IC_Gamma) {
+        if (s == NULL) {
+            throw std::runtime_error("IC_Gamma entries must be Spline2D objects");
+        }
+        gso2D_IC_Gamma.push_back(gsl_so2D_shared(s->so()));
+    }
+
+    double E_e_lims[2] = { E_e_lims__GeV[0], E_e_lims__GeV[1] };
+    gsl_spline_object_1D qe_1_so, qe_2_so;
+    int result;
+
+    {
+        py::gil_scoped_release release;
+        result = CRe_steadystate_solve(
+            structure,
+            E_e_lims,
+            n_E,
+            n_H__cmm3,
+            B__G,
+            h__pc,
+            gso2D_IC_Gamma.size(),
+            gso2D_IC_Gamma.data(),
+            gsl_so2D_shared(BS_table.so()),
+            gsl_so1D_shared(D_e__cm2sm1.so()),
+            gsl_so1D_shared(Q_inject_1.so()),
+            gsl_so1D_shared(Q_inject_2.so()),
+            &qe_1_so,
+            &qe_2_so
+        );
+    }
+
+    if (result != 0) {
+        throw std::runtime_error("CRe_steadystate_solve failed");
+    }
+
+    return py::make_tuple(Spline1D(qe_1_so), Spline1D(qe_2_so));
+}
+
+void bind_handle_functions(py::module &m) {
+    py::class_<Spline1D>(m, "Spline1D", "Linear 1D spline, built once and reused across calls")
+        .def(py::init<c_array_d, c_array_d>(), py::arg("x"), py::arg("y"))
+        .def("__call__", &Spline1D::operator(), py::arg("x"))
+        .def("__call__", &Spline1D_call_vec, py::arg("x"))
+        .def_property_readonly("x_lim", &Spline1D::x_lim);
+
+    py::class_<Spline2D>(m, "Spline2D", "Bilinear 2D spline, z has shape (len(y), len(x))")
+        .def(py::init<c_array_d, c_array_d, c_array_d>(), py::arg("x"), py::arg("y"), py::arg("z"))
+        .def("__call__", &Spline2D::operator(), py::arg("x"), py::arg("y"))
+        .def("__call__", &Spline2D_call_vec, py::arg("x"), py::arg("y"))
+        .def_property_readonly("x_lim", &Spline2D::x_lim)
+        .def_property_readonly("y_lim", &Spline2D::y_lim);
+
+    py::class_<BSTable, Spline2D>(m, "BSTable", "Bremsstrahlung table over (E_gam, E_e)")
+        .def(py::init<std::array<size_t, 2>, std::array<double, 2>, std::array<double, 2>, const std::string &>(),
+             py::call_guard<py::gil_scoped_release>(),
+             py::arg("n_pts"), py::arg("E_gam__GeV_lims"), py::arg("E_e__GeV_lims"), py::arg("datadir"));
+
+    py::class_<SyncTable, Spline1D>(m, "SyncTable", "Synchrotron kernel table")
+        .def(py::init<size_t, std::array<double, 2>, const std::string &>(),
+             py::call_guard<py::gil_scoped_release>(),
+             py::arg("n_pts"), py::arg("x_sync_lims"), py::arg("datadir"));
+
+    py::class_<ICTables>(m, "ICTables", "Shared IC and IC Gamma base tables")
+        .def(py::init<std::array<size_t, 2>, std::array<double, 2>, std::array<double, 2>, std::array<double, 2>,
+                      double, double, double, double, double, const std::string &>(),
+             py::call_guard<py::gil_scoped_release>(),
+             py::arg("n_pts"), py::arg("E_gam__GeV_lims"), py::arg("E_e__GeV_lims"), py::arg("E_phot__GeV_lims"),
+             py::arg("T_CMB_max__K"), py::arg("Delta_T_CMB__K"), py::arg("T_FIR_min__K"),
+             py::arg("T_FIR_max__K"), py::arg("Delta_T_FIR__K"), py::arg("datadir"))
+        // Borrowed views of the base tables, which keep the ICTables alive
+        .def("IC_2D", [](const ICTables &t, size_t j, bool gamma) {
+            if (j >= 4) throw py::index_error("IC_2D index must be < 4");
+            return DataObject2D(t.ico().do_2D_IC[gamma ? 1 : 0][j], false);
+        }, py::keep_alive<0, 1>(), "2D base table j (IC Gamma table if gamma)",
+           py::arg("j"), py::arg("gamma") = false)
+        .def("IC_3D", [](const ICTables &t, size_t j, bool gamma) {
+            if (j >= 2) throw py::index_error("IC_3D index must be < 2");
+            return DataObject3D(t.ico().do_3D_IC[gamma ? 1 : 0][j], false);
+        }, py::keep_alive<0, 1>(), "3D base table j (IC Gamma table if gamma)",
+           py::arg("j"), py::arg("gamma") = false);
+
+    // The kernel points into the tables, so the tables are kept alive for as long as the kernel
+    py::class_<ICKernel>(m, "ICKernel", "Per-galaxy IC (or IC Gamma) kernel over ICTables")
+        .def(py::init<const ICTables &, double, double, double, double, double, double, bool>(),
+             py::keep_alive<1, 2>(), py::call_guard<py::gil_scoped_release>(),
+             py::arg("tables"), py::arg("z"), py::arg("T_dust__K"), py::arg("M_star__Msol"),
+             py::arg("SFR__Msolyrm1"), py::arg("Re__kpc"), py::arg("h__pc"), py::arg("gamma") = false)
+        .def("__call__", &ICKernel::operator(), py::arg("E_gam__GeV"), py::arg("E_e__GeV"))
+        .def("__call__", &ICKernel_call_vec, py::arg("E_gam__GeV"), py::arg("E_e__GeV"))
+        .def("to_spline", &ICKernel::to_spline, py::call_guard<py::gil_scoped_release>());
+
+    // Overloads of the array-based functions, registered after them. The integrations run with the GIL released
+    m.def("eps_pi", &eps_pi_handle,
+          "Pion decay gamma-ray spectrum",
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("E_gam__GeV"), py::arg("n_H__cmm3"), py::arg("C_p"), py::arg("T_p_cutoff__GeV"),
+          py::arg("f_cal"));
+
+    m.def("q_e", &q_e_handle,
+          "Secondary electron injection spectrum",
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("T_CR__GeV"), py::arg("n_H__cmm3"), py::arg("C"), py::arg("T_p_cutoff__GeV"),
+          py::arg("f_cal"));
+
+    m.def("eps_IC_3", &eps_IC_3_handle,
+          "Inverse Compton gamma-ray spectrum",
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("E_gam__GeV"), py::arg("IC_table"), py::arg("qe"));
+
+    m.def("eps_IC_3", &eps_IC_3_kernel_handle,
+          "Inverse Compton gamma-ray spectrum",
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("E_gam__GeV"), py::arg("IC_kernel"), py::arg("qe"));
+
+    m.def("eps_SY_4", &eps_SY_4_handle,
+          "Synchrotron gamma-ray spectrum",
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("E_gam__GeV"), py::arg("B__G"), py::arg("sync_table"), py::arg("qe"));
+
+    m.def("eps_BS_3", &eps_BS_3_handle,
+          "Bremsstrahlung gamma-ray spectrum",
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("E_gam__GeV"), py::arg("n_H__cmm3"), py::arg("BS_table"), py::arg("qe"));
+
+    // Array overloads: arrays are broadcast and evaluated in parallel with the GIL released
+    m.def("eps_pi", &eps_pi_vec,
+          "Pion decay gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("n_H__cmm3"), py::arg("C_p"), py::arg("T_p_cutoff__GeV"),
+          py::arg("f_cal"));
+
+    m.def("eps_pi", &eps_pi_arrays_vec,
+          "Pion decay gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("n_H__cmm3"), py::arg("C_p"), py::arg("T_p_cutoff__GeV"),
+          py::arg("T_CR__GeV"), py::arg("f_cal"));
+
+    m.def("q_e", &q_e_vec,
+          "Secondary electron injection spectrum",
+          py::arg("T_CR__GeV"), py::arg("n_H__cmm3"), py::arg("C"), py::arg("T_p_cutoff__GeV"),
+          py::arg("f_cal"));
+
+    m.def("q_e", &q_e_arrays_vec,
+          "Secondary electron injection spectrum",
+          py::arg("T_CR__GeV"), py::arg("n_H__cmm3"), py::arg("C"), py::arg("T_p_cutoff__GeV"),
+          py::arg("T_CR_array"), py::arg("f_cal_array"));
+
+    m.def("eps_IC_3", &eps_IC_3_vec,
+          "Inverse Compton gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("IC_table"), py::arg("qe"));
+
+    m.def("eps_IC_3", &eps_IC_3_kernel_vec,
+          "Inverse Compton gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("IC_kernel"), py::arg("qe"));
+
+    m.def("eps_IC_3", &eps_IC_3_arrays_vec,
+          "Inverse Compton gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("E_gam_table"), py::arg("E_e_table"), py::arg("IC_table_2D"),
+          py::arg("E_e_spectrum"), py::arg("qe_spectrum"));
+
+    m.def("eps_SY_4", &eps_SY_4_vec,
+          "Synchrotron gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("B__G"), py::arg("sync_table"), py::arg("qe"));
+
+    m.def("eps_SY_4", &eps_SY_4_arrays_vec,
+          "Synchrotron gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("B__G"), py::arg("sync_freq_table"), py::arg("sync_table_1D"),
+          py::arg("E_e_spectrum"), py::arg("qe_spectrum"));
+
+    m.def("eps_BS_3", &eps_BS_3_vec,
+          "Bremsstrahlung gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("n_H__cmm3"), py::arg("BS_table"), py::arg("qe"));
+
+    m.def("eps_BS_3", &eps_BS_3_arrays_vec,
+          "Bremsstrahlung gamma-ray spectrum",
+          py::arg("E_gam__GeV"), py::arg("n_H__cmm3"), py::arg("E_gam_table"), py::arg("E_e_table"),
+          py::arg("BS_table_2D"), py::arg("E_e_spectrum"), py::arg("qe_spectrum"));
+
+    m.def("CRe_steadystate_solve", &CRe_steadystate_solve_handle,
+          "Solve steady state cosmic ray electron spectrum, returns (qe_1, qe_2) as Spline1D",
+          py::arg("structure"),
+          py::arg("E_e_lims__GeV"),
+          py::arg("n_E"),
+          py::arg("n_H__cmm3"),
+          py::arg("B__G"),
+          py::arg("h__pc"),
+          py::arg("IC_Gamma"),
+          py::arg("BS_table"),
+          py::arg("D_e__cm2sm1"),
+          py::arg("Q_inject_1"),
+          py::arg("Q_inject_2"));
+}
@@ -0,0 +1,182 @@
+/**
+ * Persistent handle objects for splines and lookup tables
+ * Each handle owns its C-side object for its whole lifetime, so a spline or
+ * table built once in Python can be passed to any number of compute calls
+ * without being rebuilt. Handles are move-only.
+ */
+
+#ifndef WRAPPERS_HANDLES_H
+#define WRAPPERS_HANDLES_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <array>
+#include <string>
+#include <vector>
+#include "spectra_funcs.h"
+#include "CRe_steadystate.h"
+#include "data_calc.h"
+#include "gsl_decs.h"
+#include "wrappers_data.h"
+#include "wrappers_vectorize.h"
+
+namespace py = pybind11;
+
+// Throws unless x holds at least 2 strictly increasing points
+void check_grid(const char *name, const double *x, py::ssize_t n);
+
+// 1D spline over (x, y)
+class Spline1D {
+public:
+    Spline1D(c_array_d x, c_array_d y);
+    // Take ownership of an existing spline object
+    explicit Spline1D(gsl_spline_object_1D so);
+    ~Spline1D();
+
+    Spline1D(const Spline1D &) = delete;
+    Spline1D &operator=(const Spline1D &) = delete;
+    Spline1D(Spline1D &&other) noexcept;
+    Spline1D &operator=(Spline1D &&other) noexcept;
+
+    double operator()(double x) const;
+    std::array<double, 2> x_lim() const;
+    const gsl_spline_object_1D &so() const { return so_; }
+
+private:
+    gsl_spline_object_1D so_;
+};
+
+// 2D spline over (x, y) with z given as a (ny, nx) array
+class Spline2D {
+public:
+    Spline2D(c_array_d x, c_array_d y, c_array_d z);
+    // Take ownership of an existing spline object
+    explicit Spline2D(gsl_spline_object_2D so);
+    ~Spline2D();
+
+    Spline2D(const Spline2D &) = delete;
+    Spline2D &operator=(const Spline2D &) = delete;
+    Spline2D(Spline2D &&other) noexcept;
+    Spline2D &operator=(Spline2D &&other) noexcept;
+
+    double operator()(double x, double y) const;
+    std::array<double, 2> x_lim() const;
+    std::array<double, 2> y_lim() const;
+    const gsl_spline_object_2D &so() const { return so_; }
+
+private:
+    gsl_spline_object_2D so_;
+};
+
+// Bremsstrahlung table from the data directory (generated on first use)
+class BSTable : public Spline2D {
+public:
+    BSTable(std::array<size_t, 2> n_pts, std::array<double, 2> E_gam__GeV_lims,
+            std::array<double, 2> E_e__GeV_lims, const std::string &datadir);
+};
+
+// Synchrotron kernel table from the data directory (generated on first use)
+class SyncTable : public Spline1D {
+public:
+    SyncTable(size_t n_pts, std::array<double, 2> x_sync_lims, const std::string &datadir);
+};
+
+// Shared IC and IC Gamma base tables from the data directory
+class ICTables {
+public:
+    ICTables(std::array<size_t, 2> n_pts, std::array<double, 2> E_gam__GeV_lims,
+             std::array<double, 2> E_e__GeV_lims, std::array<double, 2> E_phot__GeV_lims,
+             double T_CMB_max__K, double Delta_T_CMB__K, double T_FIR_min__K,
+             double T_FIR_max__K, double Delta_T_FIR__K, const std::string &datadir);
+    ~ICTables();
+
+    ICTables(const ICTables &) = delete;
+    ICTables &operator=(const ICTables &) = delete;
+    ICTables(ICTables &&other) noexcept;
+    ICTables &operator=(ICTables &&other) = delete;
+
+    const IC_object &ico() const { return ico_; }
+
+private:
+    IC_object ico_;
+    bool owned_;
+};
+
+// Per-galaxy IC (or IC Gamma) kernel over a set of ICTables, which must outlive it
+class ICKernel {
+public:
+    ICKernel(const ICTables &tables, double z, double T_dust__K, double M_star__Msol,
+             double SFR__Msolyrm1, double Re__kpc, double h__pc, bool gamma);
+    ~ICKernel();
+
+    ICKernel(const ICKernel &) = delete;
+    ICKernel &operator=(const ICKernel &) = delete;
+    ICKernel(ICKernel &&other) noexcept;
+    ICKernel &operator=(ICKernel &&other) = delete;
+
+    double operator()(double E_gam__GeV, double E_e__GeV) const;
+    // Materialise the weighted table as a spline, as needed by the steady-state solver
+    Spline2D to_spline() const;
+    const IC_kernel *kern() const { return &kern_; }
+
+private:
+    IC_kernel kern_;
+    bool owned_;
+};
+
+// Compute functions taking handles
+double eps_pi_handle(double E_gam__GeV, double n_H__cmm3, double C_p, double T_p_cutoff__GeV,
+                     const Spline1D &f_cal);
+double q_e_handle(double T_CR__GeV, double n_H__cmm3, double C, double T_p_cutoff__GeV,
+                  const Spline1D &f_cal);
+double eps_IC_3_handle(double E_gam__GeV, const Spline2D &IC_table, const Spline1D &qe);
+double eps_IC_3_kernel_handle(double E_gam__GeV, const ICKernel &IC_kern, const Spline1D &qe);
+double eps_SY_4_handle(double E_gam__GeV, double B__G, const Spline1D &sync_table, const Spline1D &qe);
+double eps_BS_3_handle(double E_gam__GeV, double n_H__cmm3, const Spline2D &BS_table, const Spline1D &qe);
+
+// Vectorized versions of the above, scalar arguments are broadcast against each other
+py::array_t<double> Spline1D_call_vec(const Spline1D &s, c_array_d x);
+py::array_t<double> Spline2D_call_vec(const Spline2D &s, c_array_d x, c_array_d y);
+py::array_t<double> ICKernel_call_vec(const ICKernel &k, c_array_d E_gam__GeV, c_array_d E_e__GeV);
+py::array_t<double> eps_pi_vec(c_array_d E_gam__GeV, c_array_d n_H__cmm3, c_array_d C_p, c_array_d T_p_cutoff__GeV,
+                               const Spline1D &f_cal);
+py::array_t<double> q_e_vec(c_array_d T_CR__GeV, c_array_d n_H__cmm3, c_array_d C, c_array_d T_p_cutoff__GeV,
+                            const Spline1D &f_cal);
+py::array_t<double> eps_IC_3_vec(c_array_d E_gam__GeV, const Spline2D &IC_table, const Spline1D &qe);
+py::array_t<double> eps_IC_3_kernel_vec(c_array_d E_gam__GeV, const ICKernel &IC_kern, const Spline1D &qe);
+py::array_t<double> eps_SY_4_vec(c_array_d E_gam__GeV, c_array_d B__G, const Spline1D &sync_table, const Spline1D &qe);
+py::array_t<double> eps_BS_3_vec(c_array_d E_gam__GeV, c_array_d n_H__cmm3, const Spline2D &BS_table, const Spline1D &qe);
+
+// Vectorized versions of the array-based wrappers, the splines are built once per call
+py::array_t<double> eps_pi_arrays_vec(c_array_d E_gam__GeV, c_array_d n_H__cmm3, c_array_d C_p,
+                                      c_array_d T_p_cutoff__GeV, c_array_d T_CR__GeV, c_array_d f_cal);
+py::array_t<double> q_e_arrays_vec(c_array_d T_CR__GeV, c_array_d n_H__cmm3, c_array_d C, c_array_d T_p_cutoff__GeV,
+                                   c_array_d T_CR_array, c_array_d f_cal_array);
+py::array_t<double> eps_IC_3_arrays_vec(c_array_d E_gam__GeV, c_array_d E_gam_table, c_array_d E_e_table,
+                                        c_array_d IC_table_2D, c_array_d E_e_spectrum, c_array_d qe_spectrum);
+py::array_t<double> eps_SY_4_arrays_vec(c_array_d E_gam__GeV, c_array_d B__G, c_array_d sync_freq_table,
+                                        c_array_d sync_table_1D, c_array_d E_e_spectrum, c_array_d qe_spectrum);
+py::array_t<double> eps_BS_3_arrays_vec(c_array_d E_gam__GeV, c_array_d n_H__cmm3, c_array_d E_gam_table,
+                                        c_array_d E_e_table, c_array_d BS_table_2D, c_array_d E_e_spectrum,
+                                        c_array_d qe_spectrum);
+
+// Steady-state solver on handles, returns the (qe_1, qe_2) electron spectra as splines
+py::tuple CRe_steadystate_solve_handle(
+    int structure,
+    std::array<double, 2> E_e_lims__GeV,
+    int n_E,
+    double n_H__cmm3,
+    double B__G,
+    double h__pc,
+    std::vector<const Spline2D *> IC_Gamma,
+    const Spline2D &BS_table,
+    const Spline1D &D_e__cm2sm1,
+    const Spline1D &Q_inject_1,
+    const Spline1D &Q_inject_2
+);
+
+// Bind to Python module
+void bind_handle_functions(py::module &m);
+
+#endif
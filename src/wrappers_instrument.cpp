@@ -0,0 +1,107 @@
+/**
+ * Implementation of the Python access to the instrumentation
+ */
+
+#include "wrappers_instrument.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+bool instrument_enabled() {
+#ifdef SPECTRA_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+py::dict instrument_counters() {
+    py::dict sites, stages;
+    for (int i = 0; i < instr_n_sites(); i++) {
+        instr_site_counters c;
+        instr_site_totals(i, &c);
+        py::dict d;
+        d["integrals"] = c.integrals;
+        d["points"] = c.points;
+        d["batches"] = c.batches;
+        d["regions"] = c.regions;
+        // Each subdivision replaces one region by two, so adds two regions to the first one of each integral
+        d["subdivisions"] = c.regions > c.integrals ? (c.regions - c.integrals) / 2 : 0;
+        d["capped"] = c.capped;
+        d["seconds"] = 1e-9 * c.ns;
+        sites[py::str(std::string(instr_site_func(i)) + ":" + instr_site_integrand(i))] = d;
+    }
+    for (int i = 0; i < instr_n_stages(); i++) {
+        instr_stage_counters c;
+        instr_stage_totals(i, &c);
+        py::dict d;
+        d["calls"] = c.calls;
+        d["seconds"] = 1e-9 * c.ns;
+        stages[py::str(instr_stage_name(i))] = d;
+    }
+
+    py::dict out;
+    out["sites"] = sites;
+    out["stages"] = stages;
+    out["trace_events"] = instr_trace_events(NULL, 0);
+    out["trace_dropped"] = instr_trace_dropped();
+    return out;
+}
+
+void instrument_reset(size_t trace_capacity) {
+    instr_reset(trace_capacity);
+}
+
+// Stage name as a JSON string
+static std::string json_name(const char *s) {
+    std::string out = "\"";
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') out += '\\';
+        out += *s;
+    }
+    return out + "\"";
+}
+
+size_t write_chrome_trace(const std::string &filename) {
+    std::vector<instr_trace_event> events(instr_trace_events(NULL, 0));
+    events.resize(std::min(events.size(), instr_trace_events(events.data(), events.size())));
+    std::vector<std::string> names;
+    for (int i = 0; i < instr_n_stages(); i++) names.push_back(json_name(instr_stage_name(i)));
+
+    py::gil_scoped_release release;
+    // Times relative to the first event, in microseconds
+    uint64_t t0 = events.empty() ? 0 : events[0].begin_ns;
+    for (const instr_trace_event &ev : events) t0 = std::min(t0, ev.begin_ns);
+
+    FILE *fp = fopen(filename.c_str(), "w");
+    if (fp == NULL) {
+        throw std::runtime_error("Can't write " + filename);
+    }
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (size_t k = 0; k < events.size(); k++) {
+        const instr_trace_event &ev = events[k];
+        fprintf(fp, "{\"name\": %s, \"cat\": \"spectra_core\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                    "\"ts\": %.3f, \"dur\": %.3f}%s\n",
+                names[ev.stage].c_str(), ev.thread, 1e-3 * (ev.begin_ns - t0), 1e-3 * ev.dur_ns,
+                k + 1 < events.size() ? "," : "");
+    }
+    fprintf(fp, "]}\n");
+    if (ferror(fp) | fclose(fp)) {
+        throw std::runtime_error("Error writing " + filename + ": incomplete output");
+    }
+    return events.size();
+}
+
+void bind_instrument_functions(py::module &m) {
+    m.def("instrument_enabled", &instrument_enabled, "Whether the module was built with SPECTRA_INSTRUMENT");
+
+    m.def("instrument_counters", &instrument_counters,
+          "Integration counters per call site and timings per stage, summed over threads");
+
+    m.def("instrument_reset", &instrument_reset, "Zero the instrumentation counters and empty the trace",
+          py::arg("trace_capacity") = INSTR_TRACE_CAPACITY_DEFAULT);
+
+    m.def("write_chrome_trace", &write_chrome_trace,
+          "Write the recorded stages as Chrome trace JSON, returns the number of events", py::arg("filename"));
+}
@@ -0,0 +1,31 @@
+/**
+ * Python access to the hot-path instrumentation (instrument.h)
+ * The counters are only collected in builds with SPECTRA_INSTRUMENT defined;
+ * otherwise these functions report nothing.
+ */
+
+#ifndef WRAPPERS_INSTRUMENT_H
+#define WRAPPERS_INSTRUMENT_H
+
+#include <pybind11/pybind11.h>
+#include <string>
+#include "instrument.h"
+
+namespace py = pybind11;
+
+// Whether the module was built with SPECTRA_INSTRUMENT
+bool instrument_enabled();
+
+// {"sites": {"func:integrand": {...}}, "stages": {name: {...}}, "trace_events": n, "trace_dropped": n}
+py::dict instrument_counters();
+
+// Zero the counters and empty the trace, keeping up to trace_capacity events per thread from now on
+void instrument_reset(size_t trace_capacity);
+
+// Write the recorded stages as Chrome trace JSON (chrome://tracing, Perfetto), returns the number of events
+size_t write_chrome_trace(const std::string &filename);
+
+// Bind to Python module
+void bind_instrument_functions(py::module &m);
+
+#endif
@@ -0,0 +1,282 @@
+/**
+ * Implementation of the native per-galaxy spectrum pipeline
+ */
+
+#include "wrappers_pipeline.h"
+#include "emission_kernels.h"
+#include "math_funcs.h"
+#include "wrappers_precision.h"
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+const char *galaxy_spectrum_names[N_GALAXY_SPECTRA] = {
+    "spec_pi",
+    "spec_IC_1_z1",
+    "spec_IC_2_z1",
+    "spec_BS_1_z1",
+    "spec_BS_2_z1",
+    "spec_SY_1_z1",
+    "spec_SY_2_z1",
+    "spec_IC_1_z2",
+    "spec_IC_2_z2",
+    "spec_SY_1_z2",
+    "spec_SY_2_z2",
+    "spec_pi_fcal1",
+    "spec_nu",
+    "spec_FF",
+    "tau_gg",
+    "tau_FF",
+};
+
+GalaxySpectraPipeline::GalaxySpectraPipeline(const ICTables &IC_tables, const Spline2D &BS_table,
+                                             const Spline1D &sync_table, c_array_d E_gam__GeV,
+                                             const PipelineConfig &config, const Cosmology &cosmo)
+    : IC_tables_(IC_tables), BS_table_(BS_table), sync_table_(sync_table),
+      E_gam__GeV_(std::make_shared<const std::vector<double>>(E_gam__GeV.data(),
+                                                              E_gam__GeV.data() + E_gam__GeV.size())),
+      config_(config), cosmo_(cosmo) {
+    if (E_gam__GeV_->empty()) {
+        throw std::runtime_error("E_gam__GeV must not be empty");
+    }
+    if (config_.n_E_CRe < 2 || !(config_.E_CRe_lims__GeV[1] > config_.E_CRe_lims__GeV[0])) {
+        throw std::runtime_error("n_E_CRe must be at least 2 and E_CRe_lims__GeV increasing");
+    }
+    if (!(config_.E_CRe_lims__GeV[0] > m_e__GeV)) {
+        throw std::runtime_error("E_CRe_lims__GeV must lie above the electron mass");
+    }
+    if (!config_.precision.empty()) precision_profile_by_name(config_.precision);
+
+    // Energy normalisations of the injection spectra, the same for every galaxy
+    py::gil_scoped_release release;
+    C_norm_p_ = C_norm_E(q_p_inject, m_p__GeV, config_.T_p_cutoff__GeV);
+    C_norm_e_ = C_norm_E(q_e_inject, m_e__GeV, config_.T_e_cutoff__GeV);
+}
+
+// Steady-state electron spectra of one zone, primary (1) and secondary (2)
+static void solve_zone(int structure, const PipelineConfig &cfg, double n_H__cmm3, double B__G, double h__pc,
+                       const Spline2D &IC_Gamma, const Spline2D &BS_table, const Spline1D &D_e__cm2sm1,
+                       const Spline1D &Q_inject_1, const Spline1D &Q_inject_2,
+                       Spline1D &qe_1, Spline1D &qe_2) {
+    double E_e_lims[2] = { cfg.E_CRe_lims__GeV[0], cfg.E_CRe_lims__GeV[1] };
+    gsl_spline_object_2D IC_Gamma_so = gsl_so2D_shared(IC_Gamma.so());
+    gsl_spline_object_1D qe_1_so, qe_2_so;
+
+    int result = CRe_steadystate_solve(structure, E_e_lims, cfg.n_E_CRe, n_H__cmm3, B__G, h__pc,
+                                       1, &IC_Gamma_so, gsl_so2D_shared(BS_table.so()),
+                                       gsl_so1D_shared(D_e__cm2sm1.so()),
+                                       gsl_so1D_shared(Q_inject_1.so()), gsl_so1D_shared(Q_inject_2.so()),
+                                       &qe_1_so, &qe_2_so);
+    if (result != 0) {
+        throw std::runtime_error("CRe_steadystate_solve failed for zone " + std::to_string(structure));
+    }
+    qe_1 = Spline1D(qe_1_so);
+    qe_2 = Spline1D(qe_2_so);
+}
+
+GalaxySpectra GalaxySpectraPipeline::run(const GalaxyParams &gal, const Spline1D &f_cal,
+                                         const Spline1D &D_e__cm2sm1, const Spline1D &D_e_halo__cm2sm1) const {
+    const PipelineConfig &cfg = config_;
+    precision_profile precision = cfg.precision.empty() ? precision_current()
+                                                        : precision_profile_by_name(cfg.precision);
+    PrecisionScope run_precision(precision);
+
+    // CR injection: the proton spectrum is normalised to the calorimetric density, f_cal then sets how much of it
+    // the emission stages see; primary electrons are injected with a fraction f_CRe_CRp of the proton energy
+    double V__cm3 = 2. * M_PI * pow(gal.Re__kpc * 1e3 * pc__cm, 2) * gal.h__pc * pc__cm;
+    double Edot_CR__GeVsm1 = cfg.f_EtoCR * cfg.E_SN_erg / GeV__erg * cfg.n_SN_Msolm1 * gal.SFR__Msolyrm1 / yr__s;
+    double C_p = Edot_CR__GeVsm1 / (C_norm_p_ * V__cm3 * gal.n_H__cmm3 * cfg.sigma_pp_cm2 * c__cmsm1);
+    double C_e = cfg.f_CRe_CRp * Edot_CR__GeVsm1 / (C_norm_e_ * V__cm3);
+
+    // Injection spectra on the steady-state grid, shared by both zones
+    int n_inj = cfg.n_E_CRe + 1;
+    std::vector<double> E_e__GeV(n_inj), Q_1(n_inj), Q_2(n_inj);
+    logspace_array(n_inj, cfg.E_CRe_lims__GeV[0], cfg.E_CRe_lims__GeV[1], E_e__GeV.data());
+
+    gsl_spline_object_1D fcal = gsl_so1D_shared(f_cal.so());
+    for (int i = 0; i < n_inj; i++) {
+        double T_e__GeV = E_e__GeV[i] - m_e__GeV;
+        Q_1[i] = J(T_e__GeV, C_e, q_e_inject, m_e__GeV, cfg.T_e_cutoff__GeV);
+        Q_2[i] = fused_q_e(T_e__GeV, gal.n_H__cmm3, C_p, cfg.T_p_cutoff__GeV, fcal);
+    }
+    Spline1D Q_1_z1(gsl_so1D(n_inj, E_e__GeV.data(), Q_1.data()));
+    Spline1D Q_2_z1(gsl_so1D(n_inj, E_e__GeV.data(), Q_2.data()));
+
+    // Radiation fields and IC kernels of each zone, the halo fields are diluted over the halo scale height
+    ICKernel IC_z1(IC_tables_, gal.z, gal.T_dust__K, gal.M_star__Msol, gal.SFR__Msolyrm1, gal.Re__kpc, gal.h__pc, false);
+    ICKernel IC_z2(IC_tables_, gal.z, gal.T_dust__K, gal.M_star__Msol, gal.SFR__Msolyrm1, gal.Re__kpc, gal.h_halo__pc, false);
+    galaxy_radfield rf = galaxy_radfield_init(gal.z, gal.T_dust__K, gal.M_star__Msol, gal.SFR__Msolyrm1,
+                                              gal.Re__kpc, gal.h__pc);
+
+    // Disc
+    Spline1D qe_1_z1(gsl_spline_object_1D{}), qe_2_z1(gsl_spline_object_1D{});
+    {
+        ICKernel IC_Gamma(IC_tables_, gal.z, gal.T_dust__K, gal.M_star__Msol, gal.SFR__Msolyrm1, gal.Re__kpc,
+                          gal.h__pc, true);
+        solve_zone(1, cfg, gal.n_H__cmm3, gal.B__G, gal.h__pc, IC_Gamma.to_spline(), BS_table_, D_e__cm2sm1,
+                   Q_1_z1, Q_2_z1, qe_1_z1, qe_2_z1);
+    }
+
+    // Halo, fed by the electrons escaping the disc, per unit halo volume
+    gsl_spline_object_1D D_e = gsl_so1D_shared(D_e__cm2sm1.so());
+    for (int i = 0; i < n_inj; i++) {
+        double esc__sm1 = 1. / tau_diff__s(E_e__GeV[i], gal.h__pc, D_e) * gal.h__pc / gal.h_halo__pc;
+        Q_1[i] = qe_1_z1(E_e__GeV[i]) * esc__sm1;
+        Q_2[i] = qe_2_z1(E_e__GeV[i]) * esc__sm1;
+    }
+    Spline1D Q_1_z2(gsl_so1D(n_inj, E_e__GeV.data(), Q_1.data()));
+    Spline1D Q_2_z2(gsl_so1D(n_inj, E_e__GeV.data(), Q_2.data()));
+
+    Spline1D qe_1_z2(gsl_spline_object_1D{}), qe_2_z2(gsl_spline_object_1D{});
+    {
+        ICKernel IC_Gamma(IC_tables_, gal.z, gal.T_dust__K, gal.M_star__Msol, gal.SFR__Msolyrm1, gal.Re__kpc,
+                          gal.h_halo__pc, true);
+        solve_zone(2, cfg, gal.n_H_halo__cmm3, gal.B_halo__G, gal.h_halo__pc, IC_Gamma.to_spline(), BS_table_,
+                   D_e_halo__cm2sm1, Q_1_z2, Q_2_z2, qe_1_z2, qe_2_z2);
+    }
+
+    // Emission. Each photon energy is independent, the splines are shared between threads as accelerator-free copies
+    size_t n_E = E_gam__GeV_->size();
+    GalaxySpectra out(E_gam__GeV_, cosmo_.distmod__cmm2(gal.z));
+
+    gsl_spline_object_2D BS = gsl_so2D_shared(BS_table_.so());
+    gsl_spline_object_1D sync = gsl_so1D_shared(sync_table_.so());
+    gsl_spline_object_1D qe_z1[2] = { gsl_so1D_shared(qe_1_z1.so()), gsl_so1D_shared(qe_2_z1.so()) };
+    gsl_spline_object_1D qe_z2[2] = { gsl_so1D_shared(qe_1_z2.so()), gsl_so1D_shared(qe_2_z2.so()) };
+    const IC_kernel *kern_z1 = IC_z1.kern();
+    const IC_kernel *kern_z2 = IC_z2.kern();
+    double E_phot_lims[2] = { cfg.E_phot_lims__GeV[0], cfg.E_phot_lims__GeV[1] };
+    double Sigma_SFR__Msolyrm1pcm2 = gal.SFR__Msolyrm1 / (2. * M_PI * pow(gal.Re__kpc * 1e3, 2));
+    // An exception must not leave the parallel region, so the first one is kept and rethrown after it
+    std::exception_ptr error;
+    std::atomic<bool> failed(false);
+#ifdef _OPENMP
+    int n_threads = cfg.n_threads > 0 ? cfg.n_threads : omp_get_max_threads();
+    #pragma omp parallel num_threads(n_threads)
+#endif
+    {
+        // OpenMP threads don't inherit the calling thread's profile
+        PrecisionScope thread_precision(precision);
+        #pragma omp for schedule(dynamic)
+        for (long j = 0; j < (long) n_E; j++) {
+            if (failed) continue;
+            try {
+                double E = (*E_gam__GeV_)[j];
+                out.row(SPEC_PI)[j] = fused_eps_pi(E, gal.n_H__cmm3, C_p, cfg.T_p_cutoff__GeV, fcal);
+                out.row(SPEC_PI_FCAL1)[j] = fused_eps_pi_fcal1(E, gal.n_H__cmm3, C_p, cfg.T_p_cutoff__GeV);
+                out.row(SPEC_NU)[j] = fused_q_nu(E, gal.n_H__cmm3, C_p, cfg.T_p_cutoff__GeV, fcal);
+                for (int k = 0; k < 2; k++) {
+                    out.row(SPEC_IC_1_Z1 + k)[j] = fused_eps_IC_3_kernel(E, kern_z1, qe_z1[k]);
+                    out.row(SPEC_BS_1_Z1 + k)[j] = fused_eps_BS_3(E, gal.n_H__cmm3, BS, qe_z1[k]);
+                    out.row(SPEC_SY_1_Z1 + k)[j] = fused_eps_SY_4(E, gal.B__G, sync, qe_z1[k]);
+                    out.row(SPEC_IC_1_Z2 + k)[j] = fused_eps_IC_3_kernel(E, kern_z2, qe_z2[k]);
+                    out.row(SPEC_SY_1_Z2 + k)[j] = fused_eps_SY_4(E, gal.B_halo__G, sync, qe_z2[k]);
+                }
+                double tau_ff = tau_FF_MK(E, Sigma_SFR__Msolyrm1pcm2, cfg.T_e_FF__K);
+                out.row(SPEC_TAU_FF)[j] = tau_ff;
+                out.row(SPEC_FF)[j] = eps_FF(E, gal.Re__kpc, cfg.T_e_FF__K, tau_ff);
+                out.row(SPEC_TAU_GG)[j] = fused_tau_gg_gal_BW_radfield(E, &rf, E_phot_lims, gal.h__pc);
+            } catch (...) {
+                #pragma omp critical(pipeline_error)
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        }
+    }
+    if (error) std::rethrow_exception(error);
+
+    return out;
+}
+
+void bind_pipeline_functions(py::module &m) {
+    py::class_<PipelineConfig>(m, "PipelineConfig", "Settings shared by every galaxy of a pipeline run")
+        .def(py::init<>())
+        .def_readwrite("E_CRe_lims__GeV", &PipelineConfig::E_CRe_lims__GeV)
+        .def_readwrite("n_E_CRe", &PipelineConfig::n_E_CRe)
+        .def_readwrite("E_phot_lims__GeV", &PipelineConfig::E_phot_lims__GeV)
+        .def_readwrite("T_p_cutoff__GeV", &PipelineConfig::T_p_cutoff__GeV)
+        .def_readwrite("T_e_cutoff__GeV", &PipelineConfig::T_e_cutoff__GeV)
+        .def_readwrite("f_EtoCR", &PipelineConfig::f_EtoCR)
+        .def_readwrite("f_CRe_CRp", &PipelineConfig::f_CRe_CRp)
+        .def_readwrite("E_SN_erg", &PipelineConfig::E_SN_erg)
+        .def_readwrite("n_SN_Msolm1", &PipelineConfig::n_SN_Msolm1)
+        .def_readwrite("sigma_pp_cm2", &PipelineConfig::sigma_pp_cm2)
+        .def_readwrite("T_e_FF__K", &PipelineConfig::T_e_FF__K)
+        .def_readwrite("n_threads", &PipelineConfig::n_threads)
+        .def_readwrite("precision", &PipelineConfig::precision);
+
+    py::class_<GalaxyParams>(m, "GalaxyParams", "Catalog values and disc/halo structure of one galaxy")
+        .def(py::init<double, double, double, double, double, double, double, double, double, double, double>(),
+             py::arg("z"), py::arg("M_star__Msol"), py::arg("Re__kpc"), py::arg("SFR__Msolyrm1"),
+             py::arg("T_dust__K"), py::arg("h__pc"), py::arg("n_H__cmm3"), py::arg("B__G"),
+             py::arg("h_halo__pc"), py::arg("n_H_halo__cmm3"), py::arg("B_halo__G"))
+        .def_readwrite("z", &GalaxyParams::z)
+        .def_readwrite("M_star__Msol", &GalaxyParams::M_star__Msol)
+        .def_readwrite("Re__kpc", &GalaxyParams::Re__kpc)
+        .def_readwrite("SFR__Msolyrm1", &GalaxyParams::SFR__Msolyrm1)
+        .def_readwrite("T_dust__K", &GalaxyParams::T_dust__K)
+        .def_readwrite("h__pc", &GalaxyParams::h__pc)
+        .def_readwrite("n_H__cmm3", &GalaxyParams::n_H__cmm3)
+        .def_readwrite("B__G", &GalaxyParams::B__G)
+        .def_readwrite("h_halo__pc", &GalaxyParams::h_halo__pc)
+        .def_readwrite("n_H_halo__cmm3", &GalaxyParams::n_H_halo__cmm3)
+        .def_readwrite("B_halo__G", &GalaxyParams::B_halo__G);
+
+    // Every spectrum is a read-only view into the one block, which stays alive as long as any view of it
+    py::class_<GalaxySpectra> spectra(m, "GalaxySpectra", "All spectra of one galaxy");
+    spectra
+        .def_property_readonly("distmod__cmm2", &GalaxySpectra::distmod__cmm2,
+                               "1/(4 pi d_l^2) of the galaxy in the pipeline's cosmology, cm^-2")
+        .def_property_readonly("E__GeV", [](py::object self) {
+            const std::vector<double> &E = self.cast<const GalaxySpectra &>().E__GeV();
+            return readonly_view({(py::ssize_t) E.size()}, E.data(), self);
+        }, "Photon energies of the spectra, GeV")
+        .def_property_readonly("array", [](py::object self) {
+            const GalaxySpectra &s = self.cast<const GalaxySpectra &>();
+            return readonly_view({(py::ssize_t) N_GALAXY_SPECTRA, (py::ssize_t) s.n_E()}, s.row(0), self);
+        })
+        .def_property_readonly_static("names", [](py::object) {
+            return std::vector<std::string>(galaxy_spectrum_names, galaxy_spectrum_names + N_GALAXY_SPECTRA);
+        })
+        .def("as_dict", [](py::object self) {
+            const GalaxySpectra &s = self.cast<const GalaxySpectra &>();
+            py::dict d;
+            for (int k = 0; k < N_GALAXY_SPECTRA; k++) {
+                d[galaxy_spectrum_names[k]] = readonly_view({(py::ssize_t) s.n_E()}, s.row(k), self);
+            }
+            return d;
+        });
+    for (int k = 0; k < N_GALAXY_SPECTRA; k++) {
+        spectra.def_property_readonly(galaxy_spectrum_names[k], [k](py::object self) {
+            const GalaxySpectra &s = self.cast<const GalaxySpectra &>();
+            return readonly_view({(py::ssize_t) s.n_E()}, s.row(k), self);
+        });
+    }
+
+    // The pipeline refers to the tables, which are kept alive for as long as it
+    py::class_<GalaxySpectraPipeline>(m, "GalaxySpectraPipeline", "Full per-galaxy spectrum chain over shared tables")
+        .def(py::init([](const ICTables &IC_tables, const Spline2D &BS_table, const Spline1D &sync_table,
+                         c_array_d E_gam__GeV, const PipelineConfig &config, py::object cosmology) {
+                 // Without an explicit cosmology the pipeline takes the global one at construction
+                 return new GalaxySpectraPipeline(IC_tables, BS_table, sync_table, E_gam__GeV, config,
+                                                  cosmology.is_none() ? Cosmology::current()
+                                                                      : cosmology.cast<Cosmology>());
+             }),
+             py::keep_alive<1, 2>(), py::keep_alive<1, 3>(), py::keep_alive<1, 4>(),
+             py::arg("IC_tables"), py::arg("BS_table"), py::arg("sync_table"), py::arg("E_gam__GeV"),
+             py::arg("config") = PipelineConfig(), py::arg("cosmology") = py::none())
+        .def("run", &GalaxySpectraPipeline::run, py::call_guard<py::gil_scoped_release>(),
+             "Spectra of one galaxy, f_cal over T_CR and the diffusion coefficients over E_e",
+             py::arg("galaxy"), py::arg("f_cal"), py::arg("D_e__cm2sm1"), py::arg("D_e_halo__cm2sm1"))
+        .def_property_readonly("E_gam__GeV", [](py::object self) {
+            const std::vector<double> &E = self.cast<const GalaxySpectraPipeline &>().E_gam__GeV();
+            return readonly_view({(py::ssize_t) E.size()}, E.data(), self);
+        })
+        .def_property_readonly("config", [](const GalaxySpectraPipeline &p) { return p.config(); })
+        .def_property_readonly("cosmology", [](const GalaxySpectraPipeline &p) { return p.cosmology(); });
+}
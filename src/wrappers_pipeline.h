@@ -0,0 +1,133 @@
+/**
+ * Native per-galaxy spectrum pipeline
+ * Runs the whole chain for one galaxy without returning to Python: primary
+ * and secondary electron injection, the disc and halo steady-state solves,
+ * the pion, IC, bremsstrahlung, synchrotron, free-free and neutrino
+ * emission, and the gamma-gamma and free-free optical depths. The shared
+ * tables are held by handle, and the per-galaxy intermediates (the f_cal
+ * spline, the electron injection and steady-state spectra, the radiation
+ * fields) are built once and used by every stage that needs them.
+ */
+
+#ifndef WRAPPERS_PIPELINE_H
+#define WRAPPERS_PIPELINE_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include "wrappers_handles.h"
+#include "wrappers_cosmo.h"
+
+namespace py = pybind11;
+
+// Spectra returned by the pipeline, in this order
+enum GalaxySpectrum {
+    SPEC_PI,
+    SPEC_IC_1_Z1,
+    SPEC_IC_2_Z1,
+    SPEC_BS_1_Z1,
+    SPEC_BS_2_Z1,
+    SPEC_SY_1_Z1,
+    SPEC_SY_2_Z1,
+    SPEC_IC_1_Z2,
+    SPEC_IC_2_Z2,
+    SPEC_SY_1_Z2,
+    SPEC_SY_2_Z2,
+    SPEC_PI_FCAL1,
+    SPEC_NU,
+    SPEC_FF,
+    SPEC_TAU_GG,
+    SPEC_TAU_FF,
+    N_GALAXY_SPECTRA
+};
+
+extern const char *galaxy_spectrum_names[N_GALAXY_SPECTRA];
+
+// Settings shared by every galaxy of a run
+struct PipelineConfig {
+    std::array<double, 2> E_CRe_lims__GeV = {{1e-3 + 0.511e-3, 1e8 + 0.511e-3}};
+    int n_E_CRe = 100;
+    std::array<double, 2> E_phot_lims__GeV = {{1e-16, 1e-5}};
+    double T_p_cutoff__GeV = 1e8;
+    double T_e_cutoff__GeV = 1e5;
+    double f_EtoCR = 0.1;
+    double f_CRe_CRp = 0.2;
+    double E_SN_erg = 1e51;
+    double n_SN_Msolm1 = 1.321680e-2;
+    double sigma_pp_cm2 = 40e-27;
+    double T_e_FF__K = 1e4;
+    // Threads used over the photon energies of one galaxy (0 for the OpenMP default)
+    int n_threads = 1;
+    // Precision profile of the integrations ("preview", "production", "reference"), empty for the caller's
+    std::string precision;
+};
+
+// Galaxy properties: catalog values, disc (zone 1) and halo (zone 2) structure
+struct GalaxyParams {
+    double z;
+    double M_star__Msol;
+    double Re__kpc;
+    double SFR__Msolyrm1;
+    double T_dust__K;
+    double h__pc;
+    double n_H__cmm3;
+    double B__G;
+    double h_halo__pc;
+    double n_H_halo__cmm3;
+    double B_halo__G;
+};
+
+// All spectra of one galaxy as a single (N_GALAXY_SPECTRA, n_E) block over the pipeline's energy grid
+class GalaxySpectra {
+public:
+    explicit GalaxySpectra(std::shared_ptr<const std::vector<double>> E__GeV, double distmod__cmm2 = 0.)
+        : n_E_(E__GeV->size()), distmod__cmm2_(distmod__cmm2), E__GeV_(std::move(E__GeV)),
+          data_(N_GALAXY_SPECTRA * n_E_) {}
+
+    size_t n_E() const { return n_E_; }
+    // Photon energies of the rows, shared with the pipeline [GeV]
+    const std::vector<double> &E__GeV() const { return *E__GeV_; }
+    // 1/(4 pi d_l^2) of the galaxy in the pipeline's cosmology [cm^-2]
+    double distmod__cmm2() const { return distmod__cmm2_; }
+    double *row(int k) { return data_.data() + k * n_E_; }
+    const double *row(int k) const { return data_.data() + k * n_E_; }
+
+private:
+    size_t n_E_;
+    double distmod__cmm2_;
+    std::shared_ptr<const std::vector<double>> E__GeV_;
+    std::vector<double> data_;
+};
+
+class GalaxySpectraPipeline {
+public:
+    // The tables must outlive the pipeline
+    GalaxySpectraPipeline(const ICTables &IC_tables, const Spline2D &BS_table, const Spline1D &sync_table,
+                          c_array_d E_gam__GeV, const PipelineConfig &config, const Cosmology &cosmo);
+
+    // f_cal over T_CR, D_e and D_e_halo over E_e
+    GalaxySpectra run(const GalaxyParams &gal, const Spline1D &f_cal, const Spline1D &D_e__cm2sm1,
+                      const Spline1D &D_e_halo__cm2sm1) const;
+
+    const std::vector<double> &E_gam__GeV() const { return *E_gam__GeV_; }
+    const PipelineConfig &config() const { return config_; }
+    const Cosmology &cosmology() const { return cosmo_; }
+
+private:
+    const ICTables &IC_tables_;
+    const Spline2D &BS_table_;
+    const Spline1D &sync_table_;
+    std::shared_ptr<const std::vector<double>> E_gam__GeV_;
+    PipelineConfig config_;
+    Cosmology cosmo_;
+    // Normalisations of the injection spectra, fixed by the config
+    double C_norm_p_, C_norm_e_;
+};
+
+// Bind to Python module
+void bind_pipeline_functions(py::module &m);
+
+#endif
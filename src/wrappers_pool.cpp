@@ -0,0 +1,151 @@
+/**
+ * Implementation of the native task pool
+ */
+
+#include "wrappers_pool.h"
+#include "wrappers_precision.h"
+#include <stdexcept>
+
+TaskPool::TaskPool(size_t n_workers) : stopping_(false) {
+    if (n_workers == 0) n_workers = 1;
+    for (size_t i = 0; i < n_workers; i++) {
+        workers_.emplace_back(&TaskPool::worker_loop, this);
+    }
+}
+
+TaskPool::~TaskPool() {
+    // shutdown() joins the workers; a pool is only destroyed after it
+    for (std::thread &w : workers_) {
+        if (w.joinable()) w.detach();
+    }
+}
+
+py::object TaskPool::submit(py::object fn, py::args args, py::kwargs kwargs) {
+    py::object future = py::module::import("concurrent.futures").attr("Future")();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            throw std::runtime_error("Task pool has been shut down");
+        }
+        queue_.push_back(Task{fn, args, kwargs, future, precision_current()});
+    }
+    cv_.notify_one();
+    return future;
+}
+
+void TaskPool::shutdown() {
+    for (const std::thread &w : workers_) {
+        if (w.get_id() == std::this_thread::get_id()) {
+            throw std::runtime_error("The task pool can't be shut down from one of its own tasks");
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+
+    // The workers need the GIL to finish the queued tasks
+    py::gil_scoped_release release;
+    for (std::thread &w : workers_) {
+        if (w.joinable()) w.join();
+    }
+}
+
+void TaskPool::worker_loop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+        }
+
+        // Tasks hold Python objects, so they are taken off the queue and destroyed with the GIL held
+        py::gil_scoped_acquire gil;
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty()) continue;
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        try {
+            if (!task.future.attr("set_running_or_notify_cancel")().cast<bool>()) continue;
+            PrecisionScope task_precision(task.precision);
+            try {
+                py::object result = task.fn(*task.args, **task.kwargs);
+                task.future.attr("set_result")(result);
+            } catch (py::error_already_set &e) {
+                task.future.attr("set_exception")(e.value());
+            } catch (const std::exception &e) {
+                task.future.attr("set_exception")(py::module::import("builtins").attr("RuntimeError")(e.what()));
+            }
+        } catch (py::error_already_set &e) {
+            // The future itself failed, there is nobody left to report to
+            e.discard_as_unraisable(task.future);
+        }
+    }
+}
+
+// Module-level pool
+
+static TaskPool *pool = NULL;
+static size_t pool_workers = 0;
+
+static size_t default_num_workers() {
+    size_t n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+py::object submit_wrapper(py::object fn, py::args args, py::kwargs kwargs) {
+    if (pool == NULL) {
+        pool = new TaskPool(pool_workers > 0 ? pool_workers : default_num_workers());
+    }
+    return pool->submit(fn, args, kwargs);
+}
+
+void shutdown_pool_wrapper() {
+    // Detach the pool first (under the GIL), so a concurrent call can't join the same workers
+    TaskPool *p = pool;
+    if (p != NULL) {
+        pool = NULL;
+        try {
+            p->shutdown();
+        } catch (...) {
+            pool = p;
+            throw;
+        }
+        delete p;
+    }
+}
+
+void set_num_workers_wrapper(size_t n_workers) {
+    pool_workers = n_workers;
+    // The running pool finishes its queue, the next submit starts one of the new size
+    shutdown_pool_wrapper();
+}
+
+size_t num_workers_wrapper() {
+    if (pool != NULL) return pool->num_workers();
+    return pool_workers > 0 ? pool_workers : default_num_workers();
+}
+
+void bind_pool_functions(py::module &m) {
+    m.def("submit", &submit_wrapper,
+          "Run fn(*args, **kwargs) on the native task pool, returns a concurrent.futures.Future",
+          py::arg("fn"));
+
+    m.def("set_num_workers", &set_num_workers_wrapper,
+          "Set the number of task pool workers (0 for one per hardware thread), waits for queued tasks",
+          py::arg("n_workers"));
+
+    m.def("num_workers", &num_workers_wrapper,
+          "Number of task pool workers");
+
+    m.def("shutdown", &shutdown_pool_wrapper,
+          "Run the queued tasks to completion and stop the task pool workers");
+
+    // Workers must be joined while the interpreter is still alive
+    py::module::import("atexit").attr("register")(py::cpp_function(&shutdown_pool_wrapper));
+}
@@ -0,0 +1,61 @@
+/**
+ * Native task pool
+ * Worker threads owned by the module run submitted Python callables and
+ * report through concurrent.futures.Future objects. Workers only hold the
+ * GIL while calling into Python, so tasks that spend their time in the
+ * compute bindings (which release the GIL) run concurrently.
+ */
+
+#ifndef WRAPPERS_POOL_H
+#define WRAPPERS_POOL_H
+
+#include <pybind11/pybind11.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "precision.h"
+
+namespace py = pybind11;
+
+class TaskPool {
+public:
+    explicit TaskPool(size_t n_workers);
+    ~TaskPool();
+
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    // Queue fn(*args, **kwargs), returns its concurrent.futures.Future (GIL held)
+    py::object submit(py::object fn, py::args args, py::kwargs kwargs);
+    // Run the queued tasks to completion and stop the workers (GIL held)
+    void shutdown();
+    size_t num_workers() const { return workers_.size(); }
+
+private:
+    struct Task {
+        py::object fn, args, kwargs, future;
+        // Profile of the submitting thread, the task runs under it
+        precision_profile precision;
+    };
+
+    void worker_loop();
+
+    std::vector<std::thread> workers_;
+    std::deque<Task> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_;
+};
+
+// Module-level pool, started on first use
+py::object submit_wrapper(py::object fn, py::args args, py::kwargs kwargs);
+void set_num_workers_wrapper(size_t n_workers);
+size_t num_workers_wrapper();
+void shutdown_pool_wrapper();
+
+// Bind to Python module
+void bind_pool_functions(py::module &m);
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * Implementation of the precision profile bindings
+ */
+
+#include "wrappers_precision.h"
+#include <cstdio>
+#include <stdexcept>
+
+static const char *profile_names[] = { "preview", "production", "reference" };
+
+precision_profile precision_profile_by_name(const std::string &name) {
+    const precision_profile *p = precision_profile_named(name.c_str());
+    if (p == NULL) {
+        throw std::runtime_error("Unknown precision profile '" + name +
+                                 "', expected 'preview', 'production' or 'reference'");
+    }
+    return *p;
+}
+
+precision_profile precision_profile_from(py::object profile) {
+    if (py::isinstance<py::str>(profile)) {
+        return precision_profile_by_name(profile.cast<std::string>());
+    }
+    return profile.cast<precision_profile>();
+}
+
+namespace {
+
+// Behind precision(): the profile is the calling thread's inside the with block
+class PrecisionContext {
+public:
+    explicit PrecisionContext(const precision_profile &p) : profile_(p), prev_(NULL), active_(false) {}
+
+    void enter() {
+        if (active_) {
+            throw std::runtime_error("precision() context is already entered");
+        }
+        prev_ = precision_set_thread(&profile_);
+        active_ = true;
+    }
+
+    void exit() {
+        if (!active_) return;
+        precision_set_thread(prev_);
+        active_ = false;
+    }
+
+    const precision_profile &profile() const { return profile_; }
+
+private:
+    precision_profile profile_;
+    const precision_profile *prev_;
+    bool active_;
+};
+
+}
+
+void bind_precision_functions(py::module &m) {
+    py::class_<precision_profile>(m, "PrecisionProfile",
+                                  "Tolerance, evaluation cap and rule of the adaptive integrations")
+        .def(py::init([](double rel_tol_scale, size_t max_eval, unsigned fixed_panels) {
+                 if (!(rel_tol_scale > 0.)) {
+                     throw std::runtime_error("rel_tol_scale must be positive");
+                 }
+                 return precision_profile{ rel_tol_scale, max_eval, fixed_panels };
+             }),
+             py::arg("rel_tol_scale") = 1., py::arg("max_eval") = 0, py::arg("fixed_panels") = 0)
+        .def_readonly("rel_tol_scale", &precision_profile::rel_tol_scale,
+                      "Factor on each integral's relative tolerance")
+        .def_readonly("max_eval", &precision_profile::max_eval,
+                      "Integrand points allowed per integral, 0 keeps each integral's own cap")
+        .def_readonly("fixed_panels", &precision_profile::fixed_panels,
+                      "Gauss-Legendre panels per dimension of the fixed-order rule, 0 for adaptive cubature")
+        .def("__repr__", [](const precision_profile &p) {
+            char buf[128];
+            snprintf(buf, sizeof(buf), "PrecisionProfile(rel_tol_scale=%g, max_eval=%zu, fixed_panels=%u)",
+                     p.rel_tol_scale, p.max_eval, p.fixed_panels);
+            return std::string(buf);
+        });
+
+    py::class_<PrecisionContext>(m, "PrecisionContext")
+        .def("__enter__", [](PrecisionContext &self) { self.enter(); return self.profile(); })
+        .def("__exit__", [](PrecisionContext &self, py::object, py::object, py::object) { self.exit(); });
+
+    m.def("precision_profiles", []() {
+        py::dict d;
+        for (const char *name : profile_names) d[name] = *precision_profile_named(name);
+        return d;
+    }, "Named precision profiles");
+
+    m.def("set_precision", [](py::object profile) {
+        precision_profile p = precision_profile_from(profile);
+        precision_set_global(&p);
+    }, "Set the global precision profile, by name or as a PrecisionProfile", py::arg("profile"));
+
+    m.def("get_precision", []() { return precision_current(); },
+          "Precision profile in effect on the calling thread");
+
+    m.def("precision", [](py::object profile) { return PrecisionContext(precision_profile_from(profile)); },
+          "Context manager selecting a precision profile for the calls inside it", py::arg("profile"));
+}
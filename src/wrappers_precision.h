@@ -0,0 +1,41 @@
+/**
+ * Precision profiles (precision.h) from C++ and Python
+ * A profile is selected for the whole module with set_precision, or for a
+ * block of calls with the precision() context manager. The profile of the
+ * calling thread is handed on to the threads the bindings compute on (the
+ * OpenMP loops, catalog workers and pool tasks).
+ */
+
+#ifndef WRAPPERS_PRECISION_H
+#define WRAPPERS_PRECISION_H
+
+#include <pybind11/pybind11.h>
+#include <string>
+#include "precision.h"
+
+namespace py = pybind11;
+
+// Sets the calling thread's profile for its lifetime and restores the previous one after
+class PrecisionScope {
+public:
+    explicit PrecisionScope(const precision_profile &p) : profile_(p), prev_(precision_set_thread(&profile_)) {}
+    ~PrecisionScope() { precision_set_thread(prev_); }
+
+    PrecisionScope(const PrecisionScope &) = delete;
+    PrecisionScope &operator=(const PrecisionScope &) = delete;
+
+private:
+    precision_profile profile_;
+    const precision_profile *prev_;
+};
+
+// Named profile, throws for an unknown name
+precision_profile precision_profile_by_name(const std::string &name);
+
+// A profile name or a PrecisionProfile
+precision_profile precision_profile_from(py::object profile);
+
+// Bind to Python module
+void bind_precision_functions(py::module &m);
+
+#endif
@@ -28,23 +28,26 @@ double eps_IC_3_wrapper(
     double* qe_ptr = static_cast<double*>(qe_spec_buf.ptr);
     gsl_spline_object_1D qe_so = gsl_so1D(E_e_spec_buf.size, E_e_ptr, qe_ptr);
     
-    // Create 2D spline for IC table
-    // Note: This is simplified - actual implementation may need more complex handling
+    // Create 2D spline for IC table, IC_table_2D has shape (len(E_e_table), len(E_gam_table))
+    if (IC_buf.size != E_gam_buf.size * E_e_buf.size) {
+        gsl_so1D_free(qe_so);
+        throw std::runtime_error("IC_table_2D must have len(E_gam_table) * len(E_e_table) entries");
+    }
     double* E_gam_tbl = static_cast<double*>(E_gam_buf.ptr);
     double* E_e_tbl = static_cast<double*>(E_e_buf.ptr);
     double* IC_tbl = static_cast<double*>(IC_buf.ptr);
+    gsl_spline_object_2D gso2D_IC = gsl_so2D(E_gam_buf.size, E_e_buf.size, E_gam_tbl, E_e_tbl, IC_tbl);
     
-    // For now, we'll need to create the 2D spline properly
-    // This is a placeholder - actual implementation depends on your data structure
-    gsl_spline_object_2D gso2D_IC;
-    // TODO: Initialize gso2D_IC from arrays
-    
-    // Call original function
-    double result = eps_IC_3(E_gam__GeV, gso2D_IC, qe_so);
+    // Call original function, without holding the GIL
+    double result;
+    {
+        py::gil_scoped_release release;
+        result = eps_IC_3(E_gam__GeV, gso2D_IC, qe_so);
+    }
     
     // Clean up
     gsl_so1D_free(qe_so);
-    // gsl_so2D_free(gso2D_IC);
+    gsl_so2D_free(gso2D_IC);
     
     return result;
 }
@@ -76,8 +79,12 @@ double eps_SY_4_wrapper(
     double* qe_ptr = static_cast<double*>(qe_spec_buf.ptr);
     gsl_spline_object_1D qe_so = gsl_so1D(E_e_spec_buf.size, E_e_ptr, qe_ptr);
     
-    // Call original function
-    double result = eps_SY_4(E_gam__GeV, B__G, sync_so, qe_so);
+    // Call original function, without holding the GIL
+    double result;
+    {
+        py::gil_scoped_release release;
+        result = eps_SY_4(E_gam__GeV, B__G, sync_so, qe_so);
+    }
     
     // Clean up
     gsl_so1D_free(sync_so);
@@ -108,15 +115,29 @@ double eps_BS_3_wrapper(
     double* qe_ptr = static_cast<double*>(qe_spec_buf.ptr);
     gsl_spline_object_1D qe_so = gsl_so1D(E_e_spec_buf.size, E_e_ptr, qe_ptr);
     
-    // Create 2D spline for BS table
-    // TODO: Proper initialization
-    gsl_spline_object_2D gso2D_BS;
-    
-    // Call original function
-    double result = eps_BS_3(E_gam__GeV, n_H__cmm3, gso2D_BS, qe_so);
+    // Create 2D spline for BS table, BS_table_2D has shape (len(E_e_table), len(E_gam_table))
+    auto E_gam_buf = E_gam_table.request();
+    auto E_e_buf = E_e_table.request();
+    auto BS_buf = BS_table_2D.request();
+    if (BS_buf.size != E_gam_buf.size * E_e_buf.size) {
+        gsl_so1D_free(qe_so);
+        throw std::runtime_error("BS_table_2D must have len(E_gam_table) * len(E_e_table) entries");
+    }
+    gsl_spline_object_2D gso2D_BS = gsl_so2D(E_gam_buf.size, E_e_buf.size,
+                                             static_cast<double*>(E_gam_buf.ptr),
+                                             static_cast<double*>(E_e_buf.ptr),
+                                             static_cast<double*>(BS_buf.ptr));
+    
+    // Call original function, without holding the GIL
+    double result;
+    {
+        py::gil_scoped_release release;
+        result = eps_BS_3(E_gam__GeV, n_H__cmm3, gso2D_BS, qe_so);
+    }
     
     // Clean up
     gsl_so1D_free(qe_so);
+    gsl_so2D_free(gso2D_BS);
     
     return result;
 }
@@ -125,6 +146,11 @@ double eps_FF_wrapper(double E_gam__GeV, double Re__kpc, double T_e__K, double t
     return eps_FF(E_gam__GeV, Re__kpc, T_e__K, tau_ff);
 }
 
+py::array_t<double> eps_FF_vec(c_array_d E_gam__GeV, c_array_d Re__kpc, c_array_d T_e__K, c_array_d tau_ff) {
+    return vectorize_broadcast({E_gam__GeV, Re__kpc, T_e__K, tau_ff},
+                               [](const double* v) { return eps_FF(v[0], v[1], v[2], v[3]); });
+}
+
 void bind_radiative_functions(py::module &m) {
     m.def("eps_IC_3", &eps_IC_3_wrapper,
           "Inverse Compton gamma-ray spectrum",
@@ -160,4 +186,12 @@ void bind_radiative_functions(py::module &m) {
           py::arg("Re__kpc"),
           py::arg("T_e__K"),
           py::arg("tau_ff"));
+    
+    // Array overload, tried after the scalar version above
+    m.def("eps_FF", &eps_FF_vec,
+          "Free-free spectrum",
+          py::arg("E_gam__GeV"),
+          py::arg("Re__kpc"),
+          py::arg("T_e__K"),
+          py::arg("tau_ff"));
 }
@@ -12,6 +12,7 @@
 #include "CR_spectra/synchrotron.h"
 #include "CR_spectra/bremsstrahlung.h"
 #include "gsl_decs.h"
+#include "wrappers_vectorize.h"
 
 namespace py = pybind11;
 
@@ -54,6 +55,10 @@ double eps_FF_wrapper(
     double tau_ff
 );
 
+// Vectorized free-free spectrum, arguments are broadcast against each other
+// (the spline-based functions are vectorized in wrappers_handles)
+py::array_t<double> eps_FF_vec(c_array_d E_gam__GeV, c_array_d Re__kpc, c_array_d T_e__K, c_array_d tau_ff);
+
 // Bind to Python module
 void bind_radiative_functions(py::module &m);
 
@@ -0,0 +1,201 @@
+/**
+ * Implementation of the rest-frame to observer-frame redshift stage
+ */
+
+#include "wrappers_redshift.h"
+#include "wrappers_pipeline.h"
+#include "wrappers_data.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+RedshiftEngine::RedshiftEngine(const std::vector<double> &E_obs__GeV, double z_max, const Cosmology &cosmo,
+                               const EBLTable *ebl, int oversample)
+    : E_obs__GeV_(E_obs__GeV), z_max_(z_max), cosmo_(cosmo), ebl_(ebl) {
+    size_t n = E_obs__GeV_.size();
+    if (n < 2) {
+        throw std::runtime_error("The observed grid needs at least 2 energies");
+    }
+    if (!(z_max >= 0.)) {
+        throw std::runtime_error("z_max must be non-negative");
+    }
+    if (oversample < 1) {
+        throw std::runtime_error("oversample must be at least 1");
+    }
+
+    // The rest step is the smallest observed step, so resampling loses nothing the observed grid resolves
+    double dlog = std::numeric_limits<double>::infinity();
+    for (size_t j = 0; j < n; j++) {
+        if (!(E_obs__GeV_[j] > 0.) || (j > 0 && !(E_obs__GeV_[j] > E_obs__GeV_[j - 1]))) {
+            throw std::runtime_error("Observed energies must be positive and strictly increasing");
+        }
+        if (j > 0) dlog = std::min(dlog, log(E_obs__GeV_[j] / E_obs__GeV_[j - 1]));
+    }
+    dlog /= oversample;
+
+    log_E0_ = log(E_obs__GeV_[0]);
+    double span = log(E_obs__GeV_[n - 1]) + log1p(z_max) - log_E0_;
+    size_t n_rest = (size_t) ceil(span / dlog - 1e-9) + 1;
+    // Spread the span evenly over the steps, so the grid ends exactly at E_obs_max (1 + z_max)
+    dlog = span / (n_rest - 1);
+    inv_dlog_ = 1. / dlog;
+
+    E_rest__GeV_.resize(n_rest);
+    for (size_t i = 0; i < n_rest; i++) E_rest__GeV_[i] = exp(log_E0_ + i * dlog);
+    pos_obs_.resize(n);
+    for (size_t j = 0; j < n; j++) pos_obs_[j] = (log(E_obs__GeV_[j]) - log_E0_) * inv_dlog_;
+}
+
+void RedshiftEngine::observe(size_t n_spec, const double *rest, const double *tau_int, bool tau_shared,
+                             bool attenuate, size_t n_z, const double *z, bool E2, double *out) const {
+    size_t n_r = n_rest(), n_o = n_obs();
+    for (size_t k = 0; k < n_z; k++) {
+        if (!(z[k] >= 0. && z[k] <= z_max_)) {
+            throw std::runtime_error("Redshifts must lie in [0, z_max] = [0, " + std::to_string(z_max_) + "]");
+        }
+    }
+
+    // Everything that depends only on (z, E_obs) is shared by the spectra: the rest-grid interval, the
+    // distance and k-correction factor, exp(-tau_EBL) and E_obs^2
+    std::vector<size_t> idx(n_z * n_o);
+    std::vector<double> frac(n_z * n_o), w(n_z * n_o);
+    #pragma omp parallel for schedule(static)
+    for (long k = 0; k < (long) n_z; k++) {
+        double shift = log1p(z[k]) * inv_dlog_;
+        double d = (1. + z[k]) * (1. + z[k]) * cosmo_.distmod__cmm2(z[k]);
+        for (size_t j = 0; j < n_o; j++) {
+            double p = pos_obs_[j] + shift;
+            size_t i = std::min((size_t) p, n_r - 2);
+            idx[k * n_o + j] = i;
+            frac[k * n_o + j] = std::fmin(p - i, 1.);
+            double wj = d;
+            if (attenuate && ebl_) wj *= exp(-ebl_->tau_log(log(E_obs__GeV_[j]), z[k]));
+            if (E2) wj *= E_obs__GeV_[j] * E_obs__GeV_[j];
+            w[k * n_o + j] = wj;
+        }
+    }
+
+    // Logs of the rest spectra, taken once for all redshifts
+    std::vector<double> log_rest(n_spec * n_r);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long) (n_spec * n_r); i++) {
+        log_rest[i] = rest[i] > 0. ? log(rest[i]) : 0.;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long r = 0; r < (long) (n_spec * n_z); r++) {
+        size_t s = r / n_z, k = r % n_z;
+        const double *q = rest + s * n_r, *lq = log_rest.data() + s * n_r;
+        const double *ti = (attenuate && tau_int) ? tau_int + (tau_shared ? 0 : s * n_r) : NULL;
+        const size_t *ik = idx.data() + k * n_o;
+        const double *tk = frac.data() + k * n_o, *wk = w.data() + k * n_o;
+        double *o = out + r * n_o;
+        for (size_t j = 0; j < n_o; j++) {
+            size_t i = ik[j];
+            double t = tk[j];
+            double v = (q[i] > 0. && q[i + 1] > 0.) ? exp((1. - t) * lq[i] + t * lq[i + 1])
+                                                     : (1. - t) * q[i] + t * q[i + 1];
+            if (ti) v *= exp(-((1. - t) * ti[i] + t * ti[i + 1]));
+            o[j] = v * wk[j];
+        }
+    }
+}
+
+// Python bindings
+
+// Spectra given on the rest grid, as (n_spec, n_rest)
+static size_t check_rest(const char *name, const c_array_d &a, size_t n_rest) {
+    if ((a.ndim() != 1 && a.ndim() != 2) || (size_t) a.shape(a.ndim() - 1) != n_rest) {
+        throw std::runtime_error(std::string(name) + " must have shape (n_rest,) or (n_spec, n_rest), "
+                                 "n_rest = len(E_rest__GeV)");
+    }
+    return a.ndim() == 2 ? a.shape(0) : 1;
+}
+
+void bind_redshift_functions(py::module &m) {
+    py::class_<RedshiftEngine>(m, "RedshiftEngine",
+                               "Observer-frame spectra at many redshifts from one rest-frame spectrum")
+        .def(py::init([](c_array_d E_obs__GeV, double z_max, py::object cosmology, py::object ebl, int oversample) {
+                 std::vector<double> E(E_obs__GeV.data(), E_obs__GeV.data() + E_obs__GeV.size());
+                 return new RedshiftEngine(E, z_max,
+                                           cosmology.is_none() ? Cosmology::current() : cosmology.cast<Cosmology>(),
+                                           ebl.is_none() ? NULL : &ebl.cast<const EBLTable &>(), oversample);
+             }),
+             py::keep_alive<1, 5>(),
+             "The engine's rest grid reaches E_obs__GeV[-1] (1 + z_max); without an explicit cosmology it takes "
+             "the global one at construction, without an EBL table there is no EBL attenuation",
+             py::arg("E_obs__GeV"), py::arg("z_max"), py::arg("cosmology") = py::none(), py::arg("ebl") = py::none(),
+             py::arg("oversample") = 1)
+        .def_property_readonly("E_rest__GeV", [](py::object self) {
+            const std::vector<double> &E = self.cast<const RedshiftEngine &>().E_rest__GeV();
+            return readonly_view({(py::ssize_t) E.size()}, E.data(), self);
+        }, "Grid to compute the rest-frame spectra on")
+        .def_property_readonly("E_obs__GeV", [](py::object self) {
+            const std::vector<double> &E = self.cast<const RedshiftEngine &>().E_obs__GeV();
+            return readonly_view({(py::ssize_t) E.size()}, E.data(), self);
+        })
+        .def_property_readonly("z_max", &RedshiftEngine::z_max)
+        .def_property_readonly("cosmology", [](const RedshiftEngine &e) { return e.cosmology(); })
+        .def("observe", [](const RedshiftEngine &e, c_array_d spec, c_array_d z, py::object tau_int, bool E2) {
+            size_t n_spec = check_rest("spec", spec, e.n_rest());
+            c_array_d ti;
+            if (!tau_int.is_none()) {
+                ti = tau_int.cast<c_array_d>();
+                if (ti.ndim() != spec.ndim() || check_rest("tau_int", ti, e.n_rest()) != n_spec) {
+                    throw std::runtime_error("tau_int must have the shape of spec");
+                }
+            }
+            size_t n_z = z.size();
+            std::vector<py::ssize_t> shape = { (py::ssize_t) n_z, (py::ssize_t) e.n_obs() };
+            if (spec.ndim() == 2) shape.insert(shape.begin(), (py::ssize_t) n_spec);
+            py::array_t<double> out(shape);
+            {
+                py::gil_scoped_release release;
+                e.observe(n_spec, spec.data(), tau_int.is_none() ? NULL : ti.data(), false, true, n_z, z.data(), E2,
+                          out.mutable_data());
+            }
+            return out;
+        }, "Observed photon flux Q(E_obs (1 + z)) (1 + z)^2 distmod exp(-(tau_int + tau_EBL)) [E_obs^2] of "
+           "rest-frame spectra on E_rest__GeV, shape (n_z, n_obs), or (n_spec, n_z, n_obs) for a (n_spec, n_rest) "
+           "block; tau_int is the internal optical depth on the rest grid",
+           py::arg("spec"), py::arg("z"), py::arg("tau_int") = py::none(), py::arg("E2") = false)
+        .def("observe_galaxy", [](const RedshiftEngine &e, const GalaxySpectra &spectra, c_array_d z, bool E2) {
+            const std::vector<double> &E = spectra.E__GeV(), &E_rest = e.E_rest__GeV();
+            bool same_grid = E.size() == E_rest.size();
+            for (size_t j = 0; same_grid && j < E.size(); j++) {
+                same_grid = fabs(E[j] - E_rest[j]) <= 1e-12 * E_rest[j];
+            }
+            if (!same_grid) {
+                throw std::runtime_error("The spectra must be computed on E_rest__GeV");
+            }
+            size_t n_E = E.size(), n_z = z.size(), n_o = e.n_obs();
+            std::vector<double> block(SPEC_TAU_GG * n_z * n_o);
+            {
+                py::gil_scoped_release release;
+                // tau_gg matters at gamma-ray energies and tau_FF at radio ones, so every photon spectrum takes
+                // their sum at its emitted energy
+                std::vector<double> tau(n_E);
+                const double *tau_gg = spectra.row(SPEC_TAU_GG), *tau_FF = spectra.row(SPEC_TAU_FF);
+                for (size_t j = 0; j < n_E; j++) tau[j] = tau_gg[j] + tau_FF[j];
+                // The photon spectra lie before the optical depths; neutrinos escape unattenuated
+                e.observe(SPEC_NU, spectra.row(0), tau.data(), true, true, n_z, z.data(), E2, block.data());
+                e.observe(1, spectra.row(SPEC_NU), NULL, false, false, n_z, z.data(), E2,
+                          block.data() + SPEC_NU * n_z * n_o);
+                e.observe(SPEC_TAU_GG - SPEC_NU - 1, spectra.row(SPEC_NU + 1), tau.data(), true, true,
+                          n_z, z.data(), E2, block.data() + (SPEC_NU + 1) * n_z * n_o);
+            }
+            py::dict d;
+            for (int k = 0; k < SPEC_TAU_GG; k++) {
+                d[galaxy_spectrum_names[k]] =
+                    py::array_t<double>({ (py::ssize_t) n_z, (py::ssize_t) n_o }, block.data() + k * n_z * n_o);
+            }
+            return d;
+        }, "Observed spectra of a galaxy computed on E_rest__GeV, as a dict of (n_z, n_obs) arrays: the photon "
+           "spectra attenuated by its tau_gg + tau_FF and the EBL, the neutrinos unattenuated",
+           py::arg("spectra"), py::arg("z"), py::arg("E2") = false);
+}
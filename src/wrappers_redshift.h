@@ -0,0 +1,76 @@
+/**
+ * Rest-frame to observer-frame redshift stage
+ * A galaxy template is computed once on a rest-frame grid and then observed
+ * at any number of redshifts without recomputing its emission. The rest
+ * grid is log-uniform, starts at the lowest observed energy and reaches
+ * (1 + z_max) times the highest one, so every observed energy of every
+ * redshift up to z_max falls on it, and the emitted energy E_obs (1 + z)
+ * of an observed one is a fixed fractional index shift of log(1 + z) / dlog.
+ * Resampling is linear in (log E, log Q) where both knots are positive and
+ * linear in log E otherwise.
+ *
+ * For a rest-frame spectrum Q(E) [GeV^-1 s^-1] the observed photon flux is
+ *   Phi(E_obs) = Q(E_obs (1 + z)) (1 + z)^2 distmod(z) exp(-(tau_int + tau_EBL)) [GeV^-1 s^-1 cm^-2]
+ * with distmod = 1/(4 pi d_l^2), tau_int the galaxy's internal optical depth
+ * at the emitted energy and tau_EBL taken at the observed energy. E_obs^2 Phi
+ * is then E^2 Q distmod at the emitted energy, the quantity the writers give.
+ */
+
+#ifndef WRAPPERS_REDSHIFT_H
+#define WRAPPERS_REDSHIFT_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <vector>
+#include "wrappers_cosmo.h"
+#include "wrappers_ebl.h"
+
+namespace py = pybind11;
+
+class RedshiftEngine {
+public:
+    /**
+     * @param E_obs__GeV Observed energies, increasing
+     * @param z_max Highest redshift to observe at
+     * @param cosmo Cosmology of the distance moduli
+     * @param ebl EBL table, NULL for no EBL attenuation; it must outlive the engine
+     * @param oversample Rest-grid points per step of the observed grid (its smallest one if it is not log-uniform)
+     */
+    RedshiftEngine(const std::vector<double> &E_obs__GeV, double z_max, const Cosmology &cosmo,
+                   const EBLTable *ebl = NULL, int oversample = 1);
+
+    // Grid to compute the rest-frame spectra on
+    const std::vector<double> &E_rest__GeV() const { return E_rest__GeV_; }
+    const std::vector<double> &E_obs__GeV() const { return E_obs__GeV_; }
+    size_t n_rest() const { return E_rest__GeV_.size(); }
+    size_t n_obs() const { return E_obs__GeV_.size(); }
+    double z_max() const { return z_max_; }
+    const Cosmology &cosmology() const { return cosmo_; }
+    const EBLTable *ebl() const { return ebl_; }
+
+    /**
+     * Observe a block of rest-frame spectra at a set of redshifts
+     * @param n_spec Spectra in the block
+     * @param rest Rest-frame spectra (n_spec, n_rest)
+     * @param tau_int Internal optical depths on the rest grid (n_spec, n_rest), NULL for none
+     * @param tau_shared tau_int is a single row (n_rest) shared by all the spectra
+     * @param attenuate Apply tau_int and tau_EBL (false for neutrinos)
+     * @param n_z, z Redshifts, 0 <= z <= z_max
+     * @param E2 Multiply by E_obs^2
+     * @param out Observed spectra (n_spec, n_z, n_obs)
+     */
+    void observe(size_t n_spec, const double *rest, const double *tau_int, bool tau_shared, bool attenuate,
+                 size_t n_z, const double *z, bool E2, double *out) const;
+
+private:
+    std::vector<double> E_obs__GeV_, E_rest__GeV_;
+    std::vector<double> pos_obs_;  // position of each observed energy on the rest grid, in steps
+    double z_max_, log_E0_, inv_dlog_;
+    Cosmology cosmo_;
+    const EBLTable *ebl_;
+};
+
+// Bind to Python module
+void bind_redshift_functions(py::module &m);
+
+#endif
@@ -30,8 +30,12 @@ double eps_pi_wrapper(
         f_cal_ptr
     );
     
-    // Call original function
-    double result = eps_pi(E_gam__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, gso1D_fcal);
+    // Call original function, without holding the GIL
+    double result;
+    {
+        py::gil_scoped_release release;
+        result = eps_pi(E_gam__GeV, n_H__cmm3, C_p, T_p_cutoff__GeV, gso1D_fcal);
+    }
     
     // Clean up
     gsl_so1D_free(gso1D_fcal);
@@ -73,8 +77,12 @@ double q_e_wrapper(
         f_cal_ptr
     );
     
-    // Call original function
-    double result = q_e(T_CR__GeV, n_H__cmm3, C, T_p_cutoff__GeV, gso1D_fcal);
+    // Call original function, without holding the GIL
+    double result;
+    {
+        py::gil_scoped_release release;
+        result = q_e(T_CR__GeV, n_H__cmm3, C, T_p_cutoff__GeV, gso1D_fcal);
+    }
     
     // Clean up
     gsl_so1D_free(gso1D_fcal);
@@ -82,6 +90,17 @@ double q_e_wrapper(
     return result;
 }
 
+py::array_t<double> J_vec(c_array_d T, c_array_d C, c_array_d q, c_array_d m, c_array_d T_cutoff) {
+    return vectorize_broadcast({T, C, q, m, T_cutoff},
+                               [](const double* v) { return J(v[0], v[1], v[2], v[3], v[4]); });
+}
+
+py::array_t<double> C_norm_E_vec(c_array_d q, c_array_d m, c_array_d T_cutoff) {
+    return vectorize_broadcast({q, m, T_cutoff},
+                               [](const double* v) { return C_norm_E(v[0], v[1], v[2]); },
+                               VECTORIZE_INTEGRAL);
+}
+
 void bind_spectra_functions(py::module &m) {
     m.def("eps_pi", &eps_pi_wrapper,
           "Pion decay gamma-ray spectrum",
@@ -98,6 +117,7 @@ void bind_spectra_functions(py::module &m) {
     
     m.def("C_norm_E", &C_norm_E_wrapper,
           "Normalization constant for cosmic ray energy",
+          py::call_guard<py::gil_scoped_release>(),
           py::arg("q"), py::arg("m"), py::arg("T_cutoff"));
     
     m.def("q_e", &q_e_wrapper,
@@ -108,4 +128,13 @@ void bind_spectra_functions(py::module &m) {
           py::arg("T_p_cutoff__GeV"),
           py::arg("T_CR_array"),
           py::arg("f_cal_array"));
+    
+    // Array overloads, tried after the scalar versions above
+    m.def("J", &J_vec,
+          "Cosmic ray injection spectrum",
+          py::arg("T"), py::arg("C"), py::arg("q"), py::arg("m"), py::arg("T_cutoff"));
+    
+    m.def("C_norm_E", &C_norm_E_vec,
+          "Normalization constant for cosmic ray energy",
+          py::arg("q"), py::arg("m"), py::arg("T_cutoff"));
 }
@@ -9,6 +9,7 @@
 #include <pybind11/numpy.h>
 #include "spectra_funcs.h"
 #include "gsl_decs.h"
+#include "wrappers_vectorize.h"
 
 namespace py = pybind11;
 
@@ -51,6 +52,11 @@ double q_e_wrapper(
     py::array_t<double> f_cal_array
 );
 
+// Vectorized versions, arguments are broadcast against each other
+// (the spline-based functions are vectorized in wrappers_handles)
+py::array_t<double> J_vec(c_array_d T, c_array_d C, c_array_d q, c_array_d m, c_array_d T_cutoff);
+py::array_t<double> C_norm_E_vec(c_array_d q, c_array_d m, c_array_d T_cutoff);
+
 // Bind to Python module
 void bind_spectra_functions(py::module &m);
 
@@ -65,54 +65,88 @@ py::array_t<double> CRe_steadystate_solve_wrapper(
     gsl_spline_object_1D gso_1D_Q_inject_1 = gsl_so1D(E_e_inj_buf.size, E_e_inj_ptr, Q1_ptr);
     gsl_spline_object_1D gso_1D_Q_inject_2 = gsl_so1D(E_e_inj_buf.size, E_e_inj_ptr, Q2_ptr);
     
-    // Create IC Gamma spline (simplified)
-    gsl_spline_object_2D gso2D_IC_Gamma;
-    // TODO: Initialize from arrays
+    // IC Gamma splines, IC_Gamma_table_2D stacks n_gso2D tables of shape (len(E_e_table), len(E_gam_table))
+    auto E_gam_buf = E_gam_table.request();
+    auto E_e_buf = E_e_table.request();
+    auto IC_buf = IC_Gamma_table_2D.request();
+    auto E_gam_BS_buf = E_gam_BS_table.request();
+    auto E_e_BS_buf = E_e_BS_table.request();
+    auto BS_buf = BS_table_2D.request();
+    
+    size_t n_IC = E_gam_buf.size * E_e_buf.size;
+    if (n_gso2D < 1 || IC_buf.size != n_gso2D * (py::ssize_t) n_IC) {
+        gsl_so1D_free(De_gso1D);
+        gsl_so1D_free(gso_1D_Q_inject_1);
+        gsl_so1D_free(gso_1D_Q_inject_2);
+        throw std::runtime_error("IC_Gamma_table_2D must hold n_gso2D tables of len(E_gam_table) * len(E_e_table) entries");
+    }
+    if (BS_buf.size != E_gam_BS_buf.size * E_e_BS_buf.size) {
+        gsl_so1D_free(De_gso1D);
+        gsl_so1D_free(gso_1D_Q_inject_1);
+        gsl_so1D_free(gso_1D_Q_inject_2);
+        throw std::runtime_error("BS_table_2D must have len(E_gam_BS_table) * len(E_e_BS_table) entries");
+    }
     
-    // Create BS spline (simplified)
-    gsl_spline_object_2D gso2D_BS;
-    // TODO: Initialize from arrays
+    std::vector<gsl_spline_object_2D> gso2D_IC_Gamma(n_gso2D);
+    for (int k = 0; k < n_gso2D; k++) {
+        gso2D_IC_Gamma[k] = gsl_so2D(E_gam_buf.size, E_e_buf.size,
+                                     static_cast<double*>(E_gam_buf.ptr),
+                                     static_cast<double*>(E_e_buf.ptr),
+                                     static_cast<double*>(IC_buf.ptr) + k * n_IC);
+    }
+    
+    // BS spline
+    gsl_spline_object_2D gso2D_BS = gsl_so2D(E_gam_BS_buf.size, E_e_BS_buf.size,
+                                             static_cast<double*>(E_gam_BS_buf.ptr),
+                                             static_cast<double*>(E_e_BS_buf.ptr),
+                                             static_cast<double*>(BS_buf.ptr));
     
     // Output splines
     gsl_spline_object_1D qe_1_so, qe_2_so;
     
-    // Call original function
-    int result = CRe_steadystate_solve(
-        structure,
-        E_e_lims,
-        n_E,
-        n_H__cmm3,
-        B__G,
-        h__pc,
-        n_gso2D,
-        &gso2D_IC_Gamma,
-        gso2D_BS,
-        De_gso1D,
-        gso_1D_Q_inject_1,
-        gso_1D_Q_inject_2,
-        &qe_1_so,
-        &qe_2_so
-    );
+    // Call original function, without holding the GIL
+    int result;
+    {
+        py::gil_scoped_release release;
+        result = CRe_steadystate_solve(
+            structure,
+            E_e_lims,
+            n_E,
+            n_H__cmm3,
+            B__G,
+            h__pc,
+            n_gso2D,
+            gso2D_IC_Gamma.data(),
+            gso2D_BS,
+            De_gso1D,
+            gso_1D_Q_inject_1,
+            gso_1D_Q_inject_2,
+            &qe_1_so,
+            &qe_2_so
+        );
+    }
+    
+    for (int k = 0; k < n_gso2D; k++) {
+        gsl_so2D_free(gso2D_IC_Gamma[k]);
+    }
+    gsl_so2D_free(gso2D_BS);
     
     if (result != 0) {
+        gsl_so1D_free(De_gso1D);
+        gsl_so1D_free(gso_1D_Q_inject_1);
+        gsl_so1D_free(gso_1D_Q_inject_2);
         throw std::runtime_error("CRe_steadystate_solve failed");
     }
     
-    // Extract results to numpy array
-    // Create energy array for output
-    std::vector<double> E_out(n_E);
+    // Evaluate both solutions on the log-spaced output grid, straight into the
+    // buffer handed to NumPy: row 0 is qe_1, row 1 is qe_2
+    double* out = new double[2 * n_E];
     double log_E_min = log(E_e_lims[0]);
     double log_E_max = log(E_e_lims[1]);
     for (int i = 0; i < n_E; i++) {
-        double log_E = log_E_min + (log_E_max - log_E_min) * i / (n_E - 1.0);
-        E_out[i] = exp(log_E);
-    }
-    
-    // Evaluate splines
-    std::vector<double> qe_1_out(n_E), qe_2_out(n_E);
-    for (int i = 0; i < n_E; i++) {
-        qe_1_out[i] = gsl_so1D_eval(qe_1_so, E_out[i]);
-        qe_2_out[i] = gsl_so1D_eval(qe_2_so, E_out[i]);
+        double E = exp(log_E_min + (log_E_max - log_E_min) * i / (n_E - 1.0));
+        out[i] = gsl_so1D_eval(qe_1_so, E);
+        out[n_E + i] = gsl_so1D_eval(qe_2_so, E);
     }
     
     // Clean up
@@ -122,9 +156,9 @@ py::array_t<double> CRe_steadystate_solve_wrapper(
     gsl_so1D_free(qe_1_so);
     gsl_so1D_free(qe_2_so);
     
-    // Return as numpy array (stacked: [qe_1, qe_2])
-    py::array_t<double> output = py::cast(std::vector<double>{qe_1_out.begin(), qe_1_out.end()});
-    return output;
+    // The array takes ownership of the buffer
+    py::capsule owner(out, [](void* p) { delete[] static_cast<double*>(p); });
+    return py::array_t<double>({(py::ssize_t) 2, (py::ssize_t) n_E}, out, owner);
 }
 
 void bind_steadystate_functions(py::module &m) {
@@ -13,7 +13,7 @@
 namespace py = pybind11;
 
 // Steady state solver wrapper
-// Returns electron spectrum as numpy array
+// Returns the electron spectra (qe_1, qe_2) on n_E log-spaced energies as a (2, n_E) numpy array
 py::array_t<double> CRe_steadystate_solve_wrapper(
     int structure,
     py::array_t<double> E_e_lims__GeV,
@@ -0,0 +1,167 @@
+/**
+ * Implementation of the galaxy structure stage
+ */
+
+#include "wrappers_structure.h"
+#include "wrappers_data.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+const char *structure_column_names[N_STRUCTURE_COLUMNS] = {
+    "z", "M_star__Msol", "Re__kpc", "SFR__Msolyrm1", "T_dust__K", "h__pc", "n_H__cmm3", "B__G",
+    "h_halo__pc", "n_H_halo__cmm3", "B_halo__G", "sigma_gas__kmsm1", "sigma_star__kmsm1",
+    "Sigma_gas__Msolpcm2", "Sigma_star__Msolpcm2", "Sigma_SFR__Msolyrm1pcm2", "v_Ai__kmsm1",
+};
+
+GalaxyParams GalaxyStructure::galaxy(size_t i) const {
+    GalaxyParams gal;
+    gal.z = column(STRUCT_Z)[i];
+    gal.M_star__Msol = column(STRUCT_M_STAR)[i];
+    gal.Re__kpc = column(STRUCT_RE)[i];
+    gal.SFR__Msolyrm1 = column(STRUCT_SFR)[i];
+    gal.T_dust__K = column(STRUCT_T_DUST)[i];
+    gal.h__pc = column(STRUCT_H)[i];
+    gal.n_H__cmm3 = column(STRUCT_N_H)[i];
+    gal.B__G = column(STRUCT_B)[i];
+    gal.h_halo__pc = column(STRUCT_H_HALO)[i];
+    gal.n_H_halo__cmm3 = column(STRUCT_N_H_HALO)[i];
+    gal.B_halo__G = column(STRUCT_B_HALO)[i];
+    return gal;
+}
+
+void GalaxyStructure::fill_columns(CatalogColumns &cols) const {
+    cols.n_gal = n_gal_;
+    cols.z = column(STRUCT_Z);
+    cols.M_star__Msol = column(STRUCT_M_STAR);
+    cols.Re__kpc = column(STRUCT_RE);
+    cols.SFR__Msolyrm1 = column(STRUCT_SFR);
+    cols.T_dust__K = column(STRUCT_T_DUST);
+    cols.h__pc = column(STRUCT_H);
+    cols.n_H__cmm3 = column(STRUCT_N_H);
+    cols.B__G = column(STRUCT_B);
+    cols.h_halo__pc = column(STRUCT_H_HALO);
+    cols.n_H_halo__cmm3 = column(STRUCT_N_H_HALO);
+    cols.B_halo__G = column(STRUCT_B_HALO);
+}
+
+GalaxyStructure galaxy_structure(size_t n_gal, const double *z, const double *M_star__Msol, const double *Re__kpc,
+                                 const double *SFR__Msolyrm1, const StructureConfig &config) {
+    GalaxyStructure s(n_gal);
+    double *z_o = s.column(STRUCT_Z), *M_o = s.column(STRUCT_M_STAR), *Re_o = s.column(STRUCT_RE);
+    double *SFR_o = s.column(STRUCT_SFR), *T_dust = s.column(STRUCT_T_DUST), *h = s.column(STRUCT_H);
+    double *n_H = s.column(STRUCT_N_H), *B = s.column(STRUCT_B), *h_halo = s.column(STRUCT_H_HALO);
+    double *n_H_halo = s.column(STRUCT_N_H_HALO), *B_halo = s.column(STRUCT_B_HALO);
+    double *sig_gas = s.column(STRUCT_SIGMA_GAS), *sig_star = s.column(STRUCT_SIGMA_STAR);
+    double *Sig_gas = s.column(STRUCT_SIG_GAS), *Sig_star = s.column(STRUCT_SIG_STAR);
+    double *Sig_SFR = s.column(STRUCT_SIG_SFR), *v_Ai = s.column(STRUCT_V_AI);
+
+    // Everything that does not depend on the galaxy, with the constants of spectra_main.py
+    const double G__pcMsolm1km2sm2 = 4.302e-3;
+    const double K_nu = 73.32 / (10.465 + (1. - 0.94) * (1. - 0.94)) + 0.954;  // Sersic index n = 1
+    const double sig_star_fac = G__pcMsolm1km2sm2 / (0.557 * K_nu * 1e3);
+    const double log_Sig_gas_fac = 10.28 * M_LN10;
+    const double log_sig_gas_fac = 1.6 * M_LN10;
+    const double n_H_fac = 1.989e30 / (config.mu_H * 1.673e-27 * 2. * pow(3.086e18, 3));
+    // u_LA = sigma_gas / sqrt(2), v_Ai = 1000 (u_LA / 10) / (sqrt(chi / 1e-4) M_A) [km/s]
+    const double v_Ai_fac = 100. / (sqrt(2.) * sqrt(config.chi / 1e-4) * config.M_A);
+    // B = sqrt(4 pi chi rho) v_Ai with rho = n_H mu_H m_p, in cgs
+    const double B2_fac = 4. * M_PI * config.chi * config.mu_H * 1.673e-27 * 1e3;
+    const double h_halo_fac = config.h_halo_h_disc, n_H_halo_fac = config.n_H_halo_n_H_disc;
+
+    // The columns are independent and every galaxy costs the same, so the loop is split statically and vectorized
+    #pragma omp parallel for simd schedule(static)
+    for (long i = 0; i < (long) n_gal; i++) {
+        double zi = z[i], M = M_star__Msol[i], Re = Re__kpc[i], SFR = SFR__Msolyrm1[i];
+        double A_Re__pc2 = M_PI * (Re * 1e3) * (Re * 1e3);
+        double Sig_s = M / (2. * A_Re__pc2);
+        double Sig_SF = SFR / (2. * A_Re__pc2);
+        double Sig_g = exp(log_Sig_gas_fac - 0.48 * log(Sig_s)) * Sig_SF;
+        double sg = exp(log_sig_gas_fac + 0.2 * log(SFR));
+        double ss = sqrt(sig_star_fac * M / Re);
+        double hi = sg * sg / (M_PI * G__pcMsolm1km2sm2 * (Sig_g + sg / ss * Sig_s));
+        double nH = Sig_g * n_H_fac / hi;
+        double vA = v_Ai_fac * sg;
+        double Bi = sqrt(B2_fac * nH) * vA * 1e5;
+
+        z_o[i] = zi;
+        M_o[i] = M;
+        Re_o[i] = Re;
+        SFR_o[i] = SFR;
+        T_dust[i] = 98. * exp(-0.065 * log1p(zi)) + 6.9 * log10(SFR / M);
+        h[i] = hi;
+        n_H[i] = nH;
+        B[i] = Bi;
+        h_halo[i] = hi * h_halo_fac;
+        n_H_halo[i] = nH * n_H_halo_fac;
+        // Starbursts (sSFR above 1e-10 /yr) get the weaker halo field, a third of the disc field rather than 1/1.5
+        B_halo[i] = SFR / M > 1e-10 ? Bi / 3. : Bi / 1.5;
+        sig_gas[i] = sg;
+        sig_star[i] = ss;
+        Sig_gas[i] = Sig_g;
+        Sig_star[i] = Sig_s;
+        Sig_SFR[i] = Sig_SF;
+        v_Ai[i] = vA;
+    }
+    return s;
+}
+
+// Python bindings
+
+void bind_structure_functions(py::module &m) {
+    py::class_<StructureConfig>(m, "StructureConfig", "Gas and magnetic-field parameters of the galaxy structure")
+        .def(py::init<>())
+        .def_readwrite("mu_H", &StructureConfig::mu_H)
+        .def_readwrite("chi", &StructureConfig::chi)
+        .def_readwrite("M_A", &StructureConfig::M_A)
+        .def_readwrite("h_halo_h_disc", &StructureConfig::h_halo_h_disc)
+        .def_readwrite("n_H_halo_n_H_disc", &StructureConfig::n_H_halo_n_H_disc);
+
+    // Every column is a read-only view into the one block, which stays alive as long as any view of it
+    py::class_<GalaxyStructure> structure(m, "GalaxyStructure", "Catalog values and derived structure of a catalog");
+    structure
+        .def_property_readonly("n_gal", &GalaxyStructure::n_gal)
+        .def_property_readonly("array", [](py::object self) {
+            const GalaxyStructure &s = self.cast<const GalaxyStructure &>();
+            return readonly_view({(py::ssize_t) N_STRUCTURE_COLUMNS, (py::ssize_t) s.n_gal()}, s.column(0), self);
+        })
+        .def_property_readonly_static("names", [](py::object) {
+            return std::vector<std::string>(structure_column_names, structure_column_names + N_STRUCTURE_COLUMNS);
+        })
+        .def("as_dict", [](py::object self) {
+            const GalaxyStructure &s = self.cast<const GalaxyStructure &>();
+            py::dict d;
+            for (int k = 0; k < N_STRUCTURE_COLUMNS; k++) {
+                d[structure_column_names[k]] = readonly_view({(py::ssize_t) s.n_gal()}, s.column(k), self);
+            }
+            return d;
+        }, "Columns by name, usable as the galaxies of run_catalog")
+        .def("galaxy", [](const GalaxyStructure &s, size_t i) {
+            if (i >= s.n_gal()) throw py::index_error("Galaxy index out of range");
+            return s.galaxy(i);
+        }, py::arg("i"));
+    for (int k = 0; k < N_STRUCTURE_COLUMNS; k++) {
+        structure.def_property_readonly(structure_column_names[k], [k](py::object self) {
+            const GalaxyStructure &s = self.cast<const GalaxyStructure &>();
+            return readonly_view({(py::ssize_t) s.n_gal()}, s.column(k), self);
+        });
+    }
+
+    m.def("galaxy_structure", [](c_array_d z, c_array_d M_star__Msol, c_array_d Re__kpc, c_array_d SFR__Msolyrm1,
+                                 const StructureConfig &config) {
+              size_t n_gal = z.size();
+              if ((size_t) M_star__Msol.size() != n_gal || (size_t) Re__kpc.size() != n_gal ||
+                  (size_t) SFR__Msolyrm1.size() != n_gal) {
+                  throw std::runtime_error("z, M_star__Msol, Re__kpc and SFR__Msolyrm1 must have the same length");
+              }
+              py::gil_scoped_release release;
+              return galaxy_structure(n_gal, z.data(), M_star__Msol.data(), Re__kpc.data(), SFR__Msolyrm1.data(),
+                                      config);
+          },
+          "Disc and halo structure of a catalog from its columns, in one parallel pass",
+          py::arg("z"), py::arg("M_star__Msol"), py::arg("Re__kpc"), py::arg("SFR__Msolyrm1"),
+          py::arg("config") = StructureConfig());
+}
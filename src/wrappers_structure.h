@@ -0,0 +1,91 @@
+/**
+ * Galaxy structure stage
+ * Derives the disc and halo structure of every galaxy of a catalog from its
+ * catalog values (z, M_star, Re, SFR) in one pass over the columns: the
+ * stellar, star-formation and gas surface densities (inverse Kennicutt-Schmidt
+ * of Shi et al.), the gas (Yu et al.) and stellar (Bezanson et al.) velocity
+ * dispersions, the dust temperature (Magnelli et al.), the disc scale height
+ * and density, the ion Alfven speed and equipartition magnetic field, and the
+ * halo quantities.
+ * The formulas are those calculate_calorimetry used to evaluate in NumPy,
+ * written out inline so the loop vectorizes. The result is a struct of
+ * arrays whose leading columns are the GalaxyParams fields in order, so it
+ * plugs straight into CatalogColumns and run_catalog.
+ */
+
+#ifndef WRAPPERS_STRUCTURE_H
+#define WRAPPERS_STRUCTURE_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <vector>
+#include "wrappers_pipeline.h"
+#include "wrappers_catalog.h"
+
+namespace py = pybind11;
+
+// Columns of a GalaxyStructure, the GalaxyParams fields first
+enum StructureColumn {
+    STRUCT_Z,
+    STRUCT_M_STAR,
+    STRUCT_RE,
+    STRUCT_SFR,
+    STRUCT_T_DUST,
+    STRUCT_H,
+    STRUCT_N_H,
+    STRUCT_B,
+    STRUCT_H_HALO,
+    STRUCT_N_H_HALO,
+    STRUCT_B_HALO,
+    STRUCT_SIGMA_GAS,
+    STRUCT_SIGMA_STAR,
+    STRUCT_SIG_GAS,
+    STRUCT_SIG_STAR,
+    STRUCT_SIG_SFR,
+    STRUCT_V_AI,
+    N_STRUCTURE_COLUMNS
+};
+
+extern const char *structure_column_names[N_STRUCTURE_COLUMNS];
+
+// Gas and magnetic-field parameters of the structure, the defaults of spectra_main.py
+struct StructureConfig {
+    double mu_H = 1.4;
+    // Ionisation fraction and Alfven Mach number of the turbulence
+    double chi = 1e-4;
+    double M_A = 2.;
+    double h_halo_h_disc = 10.;
+    double n_H_halo_n_H_disc = 1e-2;
+};
+
+// Structure of n_gal galaxies as one (N_STRUCTURE_COLUMNS, n_gal) block
+class GalaxyStructure {
+public:
+    explicit GalaxyStructure(size_t n_gal) : n_gal_(n_gal), data_(N_STRUCTURE_COLUMNS * n_gal) {}
+
+    size_t n_gal() const { return n_gal_; }
+    double *column(int k) { return data_.data() + k * n_gal_; }
+    const double *column(int k) const { return data_.data() + k * n_gal_; }
+
+    GalaxyParams galaxy(size_t i) const;
+    // Point the per-galaxy columns of cols at this structure
+    void fill_columns(CatalogColumns &cols) const;
+
+private:
+    size_t n_gal_;
+    std::vector<double> data_;
+};
+
+/**
+ * Structure of a catalog in one OpenMP pass
+ * @param n_gal Galaxies
+ * @param z, M_star__Msol, Re__kpc, SFR__Msolyrm1 Catalog columns (n_gal)
+ * @param config Gas and magnetic-field parameters
+ */
+GalaxyStructure galaxy_structure(size_t n_gal, const double *z, const double *M_star__Msol, const double *Re__kpc,
+                                 const double *SFR__Msolyrm1, const StructureConfig &config);
+
+// Bind to Python module
+void bind_structure_functions(py::module &m);
+
+#endif
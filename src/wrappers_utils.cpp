@@ -28,6 +28,88 @@ double R_half_mass__kpc_wrapper(double Re__kpc, double z) {
     return R_half_mass__kpc(Re__kpc, z);
 }
 
+py::array_t<double> sigma_gas_Yu_vec(c_array_d SFR__Msolyrm1) {
+    return vectorize_broadcast({SFR__Msolyrm1}, [](const double* v) { return sigma_gas_Yu__kmsm1(v[0]); });
+}
+
+py::array_t<double> sigma_star_Bezanson_vec(c_array_d M_star__Msol, c_array_d Re__kpc) {
+    return vectorize_broadcast({M_star__Msol, Re__kpc},
+                               [](const double* v) { return sigma_star_Bezanson__kmsm1(v[0], v[1]); });
+}
+
+py::array_t<double> Sigma_gas_Shi_iKS_vec(c_array_d Sigma_SFR__Msolyrm1pcm2, c_array_d Sigma_star__Msolpcm2) {
+    return vectorize_broadcast({Sigma_SFR__Msolyrm1pcm2, Sigma_star__Msolpcm2},
+                               [](const double* v) { return Sigma_gas_Shi_iKS__Msolpcm2(v[0], v[1]); });
+}
+
+py::array_t<double> Tdust_vec(c_array_d z, c_array_d SFR__Msolyrm1, c_array_d M_star__Msol) {
+    return vectorize_broadcast({z, SFR__Msolyrm1, M_star__Msol},
+                               [](const double* v) { return Tdust__K(v[0], v[1], v[2]); });
+}
+
+py::array_t<double> R_vir__kpc_vec(c_array_d R_half_mass__kpc) {
+    return vectorize_broadcast({R_half_mass__kpc}, [](const double* v) { return R_vir__kpc(v[0]); });
+}
+
+py::array_t<double> R_half_mass__kpc_vec(c_array_d Re__kpc, c_array_d z) {
+    return vectorize_broadcast({Re__kpc, z}, [](const double* v) { return R_half_mass__kpc(v[0], v[1]); });
+}
+
+static size_t radspecs_n_gal(c_array_d z, c_array_d T_dust__K, c_array_d M_star__Msol,
+                             c_array_d SFR__Msolyrm1, c_array_d Re__kpc, c_array_d h__pc) {
+    size_t n_gal = z.size();
+    if (T_dust__K.size() != (py::ssize_t) n_gal || M_star__Msol.size() != (py::ssize_t) n_gal ||
+        SFR__Msolyrm1.size() != (py::ssize_t) n_gal || Re__kpc.size() != (py::ssize_t) n_gal || h__pc.size() != (py::ssize_t) n_gal) {
+        throw std::runtime_error("Galaxy property arrays must have the same size");
+    }
+    return n_gal;
+}
+
+py::array_t<double> radspecs_wrapper(c_array_d z, c_array_d T_dust__K, c_array_d M_star__Msol,
+                                     c_array_d SFR__Msolyrm1, c_array_d Re__kpc, c_array_d h__pc,
+                                     c_array_d E__GeV) {
+    size_t n_gal = radspecs_n_gal(z, T_dust__K, M_star__Msol, SFR__Msolyrm1, Re__kpc, h__pc);
+    size_t n_E = E__GeV.size();
+
+    // Filled in C and handed to NumPy without a copy, the capsule frees it with the array
+    double* out = new double[n_gal * 7 * n_E];
+    py::capsule owner(out, [](void* p) { delete[] static_cast<double*>(p); });
+
+    {
+        py::gil_scoped_release release;
+        radspecs_fill(n_gal, const_cast<double*>(z.data()), const_cast<double*>(T_dust__K.data()),
+                      const_cast<double*>(M_star__Msol.data()), const_cast<double*>(SFR__Msolyrm1.data()),
+                      const_cast<double*>(Re__kpc.data()), const_cast<double*>(h__pc.data()),
+                      n_E, const_cast<double*>(E__GeV.data()), out);
+    }
+
+    return py::array_t<double>({n_gal, (size_t) 7, n_E}, out, owner);
+}
+
+void write_radspecs_wrapper(c_array_d z, c_array_d T_dust__K, c_array_d M_star__Msol,
+                            c_array_d SFR__Msolyrm1, c_array_d Re__kpc, c_array_d h__pc,
+                            const std::string &outdir, bool binary) {
+    size_t n_gal = radspecs_n_gal(z, T_dust__K, M_star__Msol, SFR__Msolyrm1, Re__kpc, h__pc);
+    std::string dir(outdir);
+
+    int err = 0;
+    {
+        py::gil_scoped_release release;
+        if (binary) {
+            err = write_radspecs_npy(n_gal, const_cast<double*>(z.data()), const_cast<double*>(T_dust__K.data()),
+                                     const_cast<double*>(M_star__Msol.data()), const_cast<double*>(SFR__Msolyrm1.data()),
+                                     const_cast<double*>(Re__kpc.data()), const_cast<double*>(h__pc.data()), &dir[0]);
+        } else {
+            write_radspecs(n_gal, const_cast<double*>(z.data()), const_cast<double*>(T_dust__K.data()),
+                           const_cast<double*>(M_star__Msol.data()), const_cast<double*>(SFR__Msolyrm1.data()),
+                           const_cast<double*>(Re__kpc.data()), const_cast<double*>(h__pc.data()), &dir[0]);
+        }
+    }
+    if (err != 0) {
+        throw std::runtime_error("Failed to write radiation field spectra to " + dir);
+    }
+}
+
 void bind_utility_functions(py::module &m) {
     m.def("sigma_gas_Yu", &sigma_gas_Yu_wrapper,
           "Gas velocity dispersion (Yu et al.)",
@@ -52,4 +134,39 @@ void bind_utility_functions(py::module &m) {
     m.def("R_half_mass__kpc", &R_half_mass__kpc_wrapper,
           "Half-mass radius",
           py::arg("Re__kpc"), py::arg("z"));
+    
+    // Array overloads, tried after the scalar versions above
+    m.def("sigma_gas_Yu", &sigma_gas_Yu_vec,
+          "Gas velocity dispersion (Yu et al.)",
+          py::arg("SFR__Msolyrm1"));
+    
+    m.def("sigma_star_Bezanson", &sigma_star_Bezanson_vec,
+          "Stellar velocity dispersion (Bezanson et al.)",
+          py::arg("M_star__Msol"), py::arg("Re__kpc"));
+    
+    m.def("Sigma_gas_Shi_iKS", &Sigma_gas_Shi_iKS_vec,
+          "Gas surface density (Shi et al.)",
+          py::arg("Sigma_SFR__Msolyrm1pcm2"), py::arg("Sigma_star__Msolpcm2"));
+    
+    m.def("Tdust", &Tdust_vec,
+          "Dust temperature",
+          py::arg("z"), py::arg("SFR__Msolyrm1"), py::arg("M_star__Msol"));
+    
+    m.def("R_vir__kpc", &R_vir__kpc_vec,
+          "Virial radius",
+          py::arg("R_half_mass__kpc"));
+    
+    m.def("R_half_mass__kpc", &R_half_mass__kpc_vec,
+          "Half-mass radius",
+          py::arg("Re__kpc"), py::arg("z"));
+    
+    m.def("radspecs", &radspecs_wrapper,
+          "Radiation field spectra of a galaxy catalog, shape (n_gal, 7, n_E): CMB, FIR, 3000K, 4000K, 7500K, UV, total",
+          py::arg("z"), py::arg("T_dust__K"), py::arg("M_star__Msol"), py::arg("SFR__Msolyrm1"),
+          py::arg("Re__kpc"), py::arg("h__pc"), py::arg("E__GeV"));
+    
+    m.def("write_radspecs", &write_radspecs_wrapper,
+          "Write radiation field spectra to outdir as rad_specs.npy/rad_specs_E.npy (binary) or rad_specs.txt",
+          py::arg("z"), py::arg("T_dust__K"), py::arg("M_star__Msol"), py::arg("SFR__Msolyrm1"),
+          py::arg("Re__kpc"), py::arg("h__pc"), py::arg("outdir"), py::arg("binary") = true);
 }
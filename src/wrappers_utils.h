@@ -6,8 +6,11 @@
 #define WRAPPERS_UTILS_H
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <string>
 #include "halo_mass_funcs.h"
 #include "gal_rad.h"
+#include "wrappers_vectorize.h"
 
 namespace py = pybind11;
 
@@ -21,6 +24,22 @@ double Tdust_wrapper(double z, double SFR__Msolyrm1, double M_star__Msol);
 double R_vir__kpc_wrapper(double R_half_mass__kpc);
 double R_half_mass__kpc_wrapper(double Re__kpc, double z);
 
+// Vectorized versions, arguments are broadcast against each other
+py::array_t<double> sigma_gas_Yu_vec(c_array_d SFR__Msolyrm1);
+py::array_t<double> sigma_star_Bezanson_vec(c_array_d M_star__Msol, c_array_d Re__kpc);
+py::array_t<double> Sigma_gas_Shi_iKS_vec(c_array_d Sigma_SFR__Msolyrm1pcm2, c_array_d Sigma_star__Msolpcm2);
+py::array_t<double> Tdust_vec(c_array_d z, c_array_d SFR__Msolyrm1, c_array_d M_star__Msol);
+py::array_t<double> R_vir__kpc_vec(c_array_d R_half_mass__kpc);
+py::array_t<double> R_half_mass__kpc_vec(c_array_d Re__kpc, c_array_d z);
+
+// Radiation field spectra
+py::array_t<double> radspecs_wrapper(c_array_d z, c_array_d T_dust__K, c_array_d M_star__Msol,
+                                     c_array_d SFR__Msolyrm1, c_array_d Re__kpc, c_array_d h__pc,
+                                     c_array_d E__GeV);
+void write_radspecs_wrapper(c_array_d z, c_array_d T_dust__K, c_array_d M_star__Msol,
+                            c_array_d SFR__Msolyrm1, c_array_d Re__kpc, c_array_d h__pc,
+                            const std::string &outdir, bool binary);
+
 // Bind to Python module
 void bind_utility_functions(py::module &m);
 
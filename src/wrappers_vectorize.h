@@ -0,0 +1,122 @@
+/**
+ * Vectorized evaluation of scalar functions over NumPy arrays
+ * Inputs are broadcast against each other following NumPy rules and the
+ * elements are evaluated in parallel with OpenMP, with the GIL released,
+ * under the calling thread's precision profile.
+ */
+
+#ifndef WRAPPERS_VECTORIZE_H
+#define WRAPPERS_VECTORIZE_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <stdexcept>
+#include <vector>
+#include "wrappers_precision.h"
+
+namespace py = pybind11;
+
+// Contiguous double arrays, converted on the way in if needed
+typedef py::array_t<double, py::array::c_style | py::array::forcecast> c_array_d;
+
+// Largest number of broadcast arguments of a vectorized function
+#define VECTORIZE_MAX_ARGS 8
+
+// Cost of one element: a closed form or table lookup, split statically between the threads, or an integral whose
+// cost varies with its limits, handed out one element at a time
+enum VectorizeCost {
+    VECTORIZE_CHEAP,
+    VECTORIZE_INTEGRAL
+};
+
+/**
+ * Evaluate f over the broadcast of the input arrays
+ * f is called from several threads at once with the GIL released, so it must
+ * not touch Python objects or shared mutable state (GSL splines must be passed
+ * as accelerator-free copies, see gsl_so1D_shared/gsl_so2D_shared).
+ * @param args Input arrays, broadcast against each other
+ * @param f Callable taking a const double* to one value per argument, returning double
+ * @param cost Cost of one element, sets the OpenMP schedule
+ * @return Array of the broadcast shape
+ */
+template <typename F>
+py::array_t<double> vectorize_broadcast(const std::vector<c_array_d> &args, F f,
+                                        VectorizeCost cost = VECTORIZE_CHEAP) {
+    size_t n_args = args.size();
+    if (n_args > VECTORIZE_MAX_ARGS) {
+        throw std::runtime_error("Too many arguments to vectorize");
+    }
+
+    // Broadcast shape, dimensions aligned from the right
+    py::ssize_t ndim = 0;
+    for (size_t k = 0; k < n_args; k++) {
+        if (args[k].ndim() > ndim) ndim = args[k].ndim();
+    }
+    std::vector<py::ssize_t> shape(ndim, 1);
+    for (size_t k = 0; k < n_args; k++) {
+        for (py::ssize_t d = 0; d < args[k].ndim(); d++) {
+            py::ssize_t dim = ndim - args[k].ndim() + d;
+            py::ssize_t ext = args[k].shape(d);
+            if (shape[dim] == 1) {
+                shape[dim] = ext;
+            } else if (ext != 1 && ext != shape[dim]) {
+                throw std::runtime_error("Operands could not be broadcast together");
+            }
+        }
+    }
+
+    // Element strides of each argument along the broadcast dimensions, 0 where it is broadcast
+    std::vector<py::ssize_t> strides(n_args * ndim, 0);
+    for (size_t k = 0; k < n_args; k++) {
+        py::ssize_t stride = 1;
+        for (py::ssize_t d = args[k].ndim() - 1; d >= 0; d--) {
+            py::ssize_t dim = ndim - args[k].ndim() + d;
+            strides[k * ndim + dim] = (args[k].shape(d) == 1) ? 0 : stride;
+            stride *= args[k].shape(d);
+        }
+    }
+
+    py::ssize_t size = 1;
+    for (py::ssize_t d = 0; d < ndim; d++) size *= shape[d];
+
+    std::vector<const double*> ptr(n_args);
+    for (size_t k = 0; k < n_args; k++) ptr[k] = args[k].data();
+
+    py::array_t<double> out(shape);
+    double* res = out.mutable_data();
+
+    // Element i of the output from the broadcast inputs
+    auto eval = [&](py::ssize_t i) {
+        double v[VECTORIZE_MAX_ARGS];
+        py::ssize_t off[VECTORIZE_MAX_ARGS] = { 0 };
+        py::ssize_t rem = i;
+        for (py::ssize_t d = ndim - 1; d >= 0; d--) {
+            py::ssize_t idx = rem % shape[d];
+            rem /= shape[d];
+            for (size_t k = 0; k < n_args; k++) off[k] += idx * strides[k * ndim + d];
+        }
+        for (size_t k = 0; k < n_args; k++) v[k] = ptr[k][off[k]];
+        res[i] = f(v);
+    };
+
+    precision_profile precision = precision_current();
+    {
+        py::gil_scoped_release release;
+        #pragma omp parallel
+        {
+            PrecisionScope thread_precision(precision);
+            if (cost == VECTORIZE_INTEGRAL) {
+                // Costs differ a lot between elements (integration limits), so elements are handed out dynamically
+                #pragma omp for schedule(dynamic)
+                for (py::ssize_t i = 0; i < size; i++) eval(i);
+            } else {
+                #pragma omp for schedule(static)
+                for (py::ssize_t i = 0; i < size; i++) eval(i);
+            }
+        }
+    }
+
+    return out;
+}
+
+#endif
@@ -0,0 +1,232 @@
+/**
+ * Implementation of the background spectrum writer
+ */
+
+#include "wrappers_writer.h"
+#include "npy_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Releases the GIL for its lifetime if the calling thread holds it (the writer may be closed from C++ alone)
+class release_gil {
+public:
+    release_gil() : state_(PyGILState_Check() ? PyEval_SaveThread() : nullptr) {}
+    ~release_gil() {
+        if (state_ != nullptr) PyEval_RestoreThread(state_);
+    }
+
+private:
+    PyThreadState *state_;
+};
+
+}
+
+SpectraWriter::SpectraWriter(const std::string &outdir, c_array_d E_gam__GeV, size_t n_gal, bool single_precision,
+                             size_t queue_size, size_t buffer_bytes)
+    : outdir_(outdir), n_gal_(n_gal), n_E_(E_gam__GeV.size()),
+      elem_size_(single_precision ? sizeof(float) : sizeof(double)), queue_size_(std::max<size_t>(queue_size, 1)),
+      single_precision_(single_precision), n_written_(0), closing_(false), closed_(false) {
+    if (n_E_ == 0) {
+        throw std::runtime_error("E_gam__GeV must not be empty");
+    }
+    // Room for at least one galaxy's row
+    staging_.resize(std::max(buffer_bytes, n_E_ * elem_size_));
+    std::fill(fd_, fd_ + N_GALAXY_SPECTRA, -1);
+
+    size_t shape_E[1] = { n_E_ };
+    std::string path = outdir + "/E_gam.npy";
+    if (npy_write_double(path.c_str(), 1, shape_E, E_gam__GeV.data())) {
+        throw std::runtime_error("Can't write " + path);
+    }
+
+    size_t shape[2] = { n_gal_, n_E_ };
+    for (int k = 0; k < N_GALAXY_SPECTRA; k++) {
+        path = outdir + "/" + galaxy_spectrum_names[k] + ".npy";
+        FILE *fp = fopen(path.c_str(), "wb");
+        int err = (fp == NULL) || npy_write_header(fp, single_precision ? "<f4" : "<f8", 2, shape);
+        long offset = err ? -1 : ftell(fp);
+        if (fp != NULL && fclose(fp) != 0) err = 1;
+
+        if (!err && offset > 0) fd_[k] = ::open(path.c_str(), O_WRONLY);
+        // Full size up front: rows never written read back as zeros
+        if (fd_[k] < 0 || ftruncate(fd_[k], offset + n_gal_ * n_E_ * elem_size_) != 0) {
+            for (int l = 0; l <= k; l++) {
+                if (fd_[l] >= 0) ::close(fd_[l]);
+            }
+            throw std::runtime_error("Can't create " + path);
+        }
+        data_offset_[k] = offset;
+    }
+
+    thread_ = std::thread(&SpectraWriter::run, this);
+}
+
+SpectraWriter::~SpectraWriter() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void SpectraWriter::check_error() {
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+}
+
+void SpectraWriter::consume(size_t i, GalaxySpectra &&spectra) {
+    if (i >= n_gal_) {
+        throw std::runtime_error("Galaxy index " + std::to_string(i) + " is past the writer's " +
+                                 std::to_string(n_gal_) + " rows");
+    }
+    if (spectra.n_E() != n_E_) {
+        throw std::runtime_error("Spectra have the wrong number of photon energies for this writer");
+    }
+
+    auto ready = [this] { return queue_.size() < queue_size_ || !error_.empty() || closing_; };
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!ready()) {
+        // The GIL is taken back only after mutex_ is released, since a Python thread holding the GIL may be
+        // waiting for mutex_ (n_written)
+        lock.unlock();
+        {
+            release_gil release;
+            std::unique_lock<std::mutex> wait_lock(mutex_);
+            cv_space_.wait(wait_lock, ready);
+        }
+        lock.lock();
+    }
+    check_error();
+    if (closing_) {
+        throw std::runtime_error("SpectraWriter is closed");
+    }
+    queue_.emplace_back(i, std::move(spectra));
+    cv_work_.notify_one();
+}
+
+void SpectraWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) return;
+        closing_ = true;
+        cv_work_.notify_one();
+    }
+    if (thread_.joinable()) {
+        release_gil release;
+        thread_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    for (int k = 0; k < N_GALAXY_SPECTRA; k++) {
+        if (fd_[k] >= 0 && ::close(fd_[k]) != 0 && error_.empty()) {
+            error_ = outdir_ + "/" + galaxy_spectrum_names[k] + ".npy: " + strerror(errno);
+        }
+        fd_[k] = -1;
+    }
+    check_error();
+}
+
+size_t SpectraWriter::n_written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return n_written_;
+}
+
+void SpectraWriter::run() {
+    std::vector<std::pair<size_t, GalaxySpectra>> batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_work_.wait(lock, [this] { return !queue_.empty() || closing_; });
+            if (queue_.empty()) return;
+            batch.swap(queue_);
+            cv_space_.notify_all();
+        }
+
+        try {
+            write_batch(batch);
+        } catch (const std::exception &e) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = e.what();
+            queue_.clear();
+            cv_space_.notify_all();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        n_written_ += batch.size();
+        batch.clear();
+    }
+}
+
+void SpectraWriter::pwrite_all(int k, size_t row, const char *buf, size_t n_bytes) {
+    off_t offset = data_offset_[k] + row * n_E_ * elem_size_;
+    while (n_bytes > 0) {
+        ssize_t n = pwrite(fd_[k], buf, n_bytes, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(outdir_ + "/" + galaxy_spectrum_names[k] + ".npy: " + strerror(errno));
+        }
+        buf += n;
+        offset += n;
+        n_bytes -= n;
+    }
+}
+
+void SpectraWriter::write_batch(std::vector<std::pair<size_t, GalaxySpectra>> &batch) {
+    std::sort(batch.begin(), batch.end(),
+              [](const std::pair<size_t, GalaxySpectra> &a, const std::pair<size_t, GalaxySpectra> &b) {
+                  return a.first < b.first;
+              });
+
+    size_t row_bytes = n_E_ * elem_size_;
+    size_t rows_per_write = staging_.size() / row_bytes;
+
+    // Runs of consecutive galaxies go out as one write per file, up to the staging buffer size
+    for (size_t start = 0; start < batch.size();) {
+        size_t end = start + 1;
+        while (end < batch.size() && end - start < rows_per_write && batch[end].first == batch[end - 1].first + 1) {
+            end++;
+        }
+
+        for (int k = 0; k < N_GALAXY_SPECTRA; k++) {
+            for (size_t b = start; b < end; b++) {
+                const double *src = batch[b].second.row(k);
+                char *dst = staging_.data() + (b - start) * row_bytes;
+                if (single_precision_) {
+                    float *dst_f = reinterpret_cast<float *>(dst);
+                    for (size_t j = 0; j < n_E_; j++) dst_f[j] = (float) src[j];
+                } else {
+                    std::memcpy(dst, src, row_bytes);
+                }
+            }
+            pwrite_all(k, batch[start].first, staging_.data(), (end - start) * row_bytes);
+        }
+        start = end;
+    }
+}
+
+void bind_writer_functions(py::module &m) {
+    py::class_<SpectraWriter>(m, "SpectraWriter",
+                              "Writes galaxy spectra to one .npy file per spectrum on a background thread")
+        .def(py::init<const std::string &, c_array_d, size_t, bool, size_t, size_t>(),
+             py::arg("outdir"), py::arg("E_gam__GeV"), py::arg("n_gal"), py::arg("single_precision") = false,
+             py::arg("queue_size") = SPECTRA_WRITER_QUEUE_DEFAULT,
+             py::arg("buffer_bytes") = SPECTRA_WRITER_BUFFER_DEFAULT)
+        .def("write", [](SpectraWriter &self, size_t i, const GalaxySpectra &spectra) {
+                 self.consume(i, GalaxySpectra(spectra));
+             },
+             "Queue a copy of galaxy i's spectra for writing", py::arg("i"), py::arg("spectra"))
+        .def("close", &SpectraWriter::close, "Write everything queued and close the files")
+        .def_property_readonly("n_gal", &SpectraWriter::n_gal)
+        .def_property_readonly("n_written", &SpectraWriter::n_written)
+        .def("__enter__", [](SpectraWriter &self) -> SpectraWriter & { return self; },
+             py::return_value_policy::reference)
+        .def("__exit__", [](SpectraWriter &self, py::object, py::object, py::object) { self.close(); });
+}
@@ -0,0 +1,76 @@
+/**
+ * Background spectrum writer
+ * A SpectraSink that hands finished galaxies to a writer thread, so the
+ * thread running the catalog never waits on the disk. Each of the 16
+ * spectra goes to its own <name>.npy file of shape (n_gal, n_E), float64
+ * or float32, preallocated up front so that galaxies can be written at
+ * their row in whatever order they finish. Galaxies with consecutive
+ * indices are coalesced into one large pwrite per file.
+ */
+
+#ifndef WRAPPERS_WRITER_H
+#define WRAPPERS_WRITER_H
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "wrappers_catalog.h"
+
+namespace py = pybind11;
+
+#define SPECTRA_WRITER_QUEUE_DEFAULT 256
+#define SPECTRA_WRITER_BUFFER_DEFAULT (16 << 20)
+
+class SpectraWriter : public SpectraSink {
+public:
+    /**
+     * @param outdir Output directory (must exist), receives E_gam.npy and one <name>.npy per spectrum
+     * @param E_gam__GeV Photon energies of the spectra
+     * @param n_gal Rows of each file
+     * @param single_precision Write float32 rather than float64
+     * @param queue_size Galaxies waiting to be written before consume blocks
+     * @param buffer_bytes Staging buffer of the writer thread, the largest single write
+     */
+    SpectraWriter(const std::string &outdir, c_array_d E_gam__GeV, size_t n_gal, bool single_precision,
+                  size_t queue_size, size_t buffer_bytes);
+    ~SpectraWriter();
+
+    // Queue galaxy i for writing (waits without the GIL while the queue is full)
+    void consume(size_t i, GalaxySpectra &&spectra) override;
+    // Write everything queued and close the files, throws if any write failed
+    void close();
+
+    size_t n_gal() const { return n_gal_; }
+    size_t n_written() const;
+
+private:
+    void run();
+    void write_batch(std::vector<std::pair<size_t, GalaxySpectra>> &batch);
+    void pwrite_all(int k, size_t row, const char *buf, size_t n_bytes);
+    void check_error();
+
+    std::string outdir_;
+    size_t n_gal_, n_E_, elem_size_, queue_size_;
+    bool single_precision_;
+    std::vector<char> staging_;
+    int fd_[N_GALAXY_SPECTRA];
+    size_t data_offset_[N_GALAXY_SPECTRA];
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_work_, cv_space_;
+    std::vector<std::pair<size_t, GalaxySpectra>> queue_;
+    size_t n_written_;
+    bool closing_, closed_;
+    std::string error_;
+    std::thread thread_;
+};
+
+// Bind to Python module
+void bind_writer_functions(py::module &m);
+
+#endif